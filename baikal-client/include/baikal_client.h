@@ -34,6 +34,7 @@
 #include "baikal_client_bns_connection_pool.h"
 #include "baikal_client_instance.h"
 #include "baikal_client_connection.h"
+#include "baikal_client_async_query.h"
 
 #endif  //FC_DBRD_BAIKAL_CLIENT_BAIKAL_CLIENT_H
 
@@ -0,0 +1,145 @@
+// Copyright (c) 2019 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file baikal_client_async_query.h
+ * @brief 基于epoll线程的异步查询接口
+ *  每个连接上的sql依次流水执行，等待网络时不占用线程，结果按行流式回调
+ **/
+
+#ifndef  FC_DBRD_BAIKAL_CLIENT_INCLUDE_BAIKAL_CLIENT_ASYNC_QUERY_H
+#define  FC_DBRD_BAIKAL_CLIENT_INCLUDE_BAIKAL_CLIENT_ASYNC_QUERY_H
+
+#include <string>
+#include <vector>
+#include "mysql.h"
+#include "boost/atomic.hpp"
+#include "baikal_client_define.h"
+#include "baikal_client_connection.h"
+
+namespace baikal {
+namespace client {
+class Service;
+
+// @brief 异步查询结果回调，在bthread中调用，不要长时间阻塞
+class AsyncQueryHandler {
+public:
+    virtual ~AsyncQueryHandler() {}
+
+    // @brief 结果逐行回调，row只在本次回调内有效，不会缓存整个结果集
+    // 可用mysql_fetch_lengths(res)/mysql_fetch_fields(res)取长度和列信息
+    // @returnVal 非0表示不再需要剩余的行
+    virtual int on_row(MYSQL_RES* /*res*/, MYSQL_ROW /*row*/) {
+        return 0;
+    }
+
+    // @brief 查询结束，每条sql恰好回调一次，之后不再访问handler
+    // ret 0表示成功，其他为ErrorCode; affected_rows只对非select语句有效
+    virtual void on_done(int ret, uint64_t affected_rows) = 0;
+};
+
+struct AsyncQuery {
+    AsyncQuery() : partition_key(0), handler(NULL) {}
+    AsyncQuery(uint32_t key, const std::string& sql_str, AsyncQueryHandler* query_handler) :
+        partition_key(key), sql(sql_str), handler(query_handler) {}
+    uint32_t partition_key;
+    std::string sql;
+    AsyncQueryHandler* handler;
+};
+
+class AsyncQueryLane;
+// @brief 一次批量提交，多个连接从同一个队列里取sql执行，全部结束后自动释放
+class AsyncQueryBatch {
+public:
+    // @brief 启动不超过max_concurrency个连接执行queries
+    static int start(Service* service, const std::vector<AsyncQuery>& queries,
+            int max_concurrency);
+
+    // @brief 取下一条待执行的sql，取完返回NULL
+    const AsyncQuery* next();
+
+    // @brief 一个连接上的流水执行结束，最后一个结束时释放batch
+    void lane_finish();
+
+    Service* get_service() const {
+        return _service;
+    }
+private:
+    AsyncQueryBatch(Service* service, const std::vector<AsyncQuery>& queries, int lane_num) :
+        _service(service), _queries(queries), _next_index(0), _lane_num(lane_num) {}
+
+    Service* _service;
+    std::vector<AsyncQuery> _queries;
+    boost::atomic<size_t> _next_index;
+    boost::atomic<int> _lane_num;
+};
+
+// @brief 一个连接上的执行状态机
+// 用mysql非阻塞接口发起每一步，需要等待时把fd注册到epoll线程后返回，
+// 事件就绪后启动bthread从断点继续；同partition_key的后续sql复用该连接
+class AsyncQueryLane : public MysqlEventHandler {
+public:
+    explicit AsyncQueryLane(AsyncQueryBatch* batch);
+    virtual ~AsyncQueryLane();
+
+    // @brief 在bthread中开始执行
+    int start();
+
+    virtual void on_event(int event_out);
+
+    static void* run_thread(void* arg);
+private:
+    enum State {
+        LANE_IDLE = 0,
+        LANE_QUERY = 1,
+        LANE_FETCH_ROW = 2,
+        LANE_FREE_RESULT = 3
+    };
+
+    // @brief 从上次等待的地方继续执行，直到需要等待网络或没有sql可执行
+    void _run(int event);
+
+    // @brief 以event继续当前步骤，返回mysql仍需等待的事件，0表示该步骤完成
+    int _cont(int event);
+
+    // @brief 处理已完成步骤的结果并发起下一步，返回需等待的事件
+    // @returnVal false 表示没有sql可执行
+    bool _advance(int* status);
+
+    bool _start_query(const AsyncQuery* query, int* status);
+
+    void _finish_query(int ret);
+
+    bool _wait(int status);
+
+    AsyncQueryBatch* _batch;
+    const AsyncQuery* _query;
+    SmartConnection _conn;
+    std::string _sql_rewrite;
+    State _state;
+    int _query_ret;
+    int _ret;
+    uint64_t _affected_rows;
+    MYSQL_RES* _res;
+    MYSQL_ROW _row;
+    ScopeProcWeight* _proc_weight;
+    int _event;
+    MysqlEventInfo _event_info;
+};
+}
+}
+
+#endif  //FC_DBRD_BAIKAL_CLIENT_INCLUDE_BAIKAL_CLIENT_ASYNC_QUERY_H
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -123,6 +123,7 @@ private:
     Instance* _select_instance_random();
     Instance* _select_instance_rolling(bool whether_lower);
     Instance* _select_instance_local_aware();
+    Instance* _select_instance_latency_aware();
    
     // @brief 释放所以占用的资源
     void _clear();
@@ -102,6 +102,12 @@ public:
     // @brief 在connection上执行rollback操作
     virtual int rollback();
 
+    // @brief 按注释和分表规则改写sql，不执行，供异步查询使用
+    virtual int rewrite_sql(const std::string& sql, std::string& sql_rewrite);
+
+    // @brief sql执行失败后根据错误码处理实例状态并返回错误码，供异步查询使用
+    virtual int handle_query_error(const std::string& sql_rewrite);
+
     // @brief 得到mysql句柄, 仅供mysql类型连接使用
     MYSQL* get_mysql_handle();
 
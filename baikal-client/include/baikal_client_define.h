@@ -65,11 +65,12 @@ enum ConnectionType {
     NONE = 0,
     MYSQL_CONN = 1
 };
-//选择实例算法， 目前支持随机和轮询两种
+//选择实例算法， 目前支持随机、轮询、按权重和按延迟四种
 enum SelectAlgo {
     RANDOM = 1,
     ROLLING = 2,
-    LOCAL_AWARE = 3
+    LOCAL_AWARE = 3,
+    LATENCY_AWARE = 4  // power-of-two-choices，比较ewma延迟*在途请求
 };
 //从配置文件读取的连接的参数信息
 struct ConnectionConf {
@@ -233,12 +234,23 @@ private:
     timeval _end;
 };
 
+// @brief 事件就绪或超时后的回调，在epoll线程中调用，不能阻塞
+class MysqlEventHandler {
+public:
+    virtual ~MysqlEventHandler() {}
+    // event_out为MYSQL_WAIT_READ/MYSQL_WAIT_WRITE/MYSQL_WAIT_EXCEPT/MYSQL_WAIT_TIMEOUT组合
+    virtual void on_event(int event_out) = 0;
+};
+
 struct MysqlEventInfo {
+    MysqlEventInfo() : event_in(0), event_out(0), timeout(0), handler(NULL) {}
     BthreadCond     cond;
     TimeCost        cost;
     int             event_in;
     int             event_out;
-    int             timeout;
+    int             timeout; // ms，只对handler方式注册的事件生效
+    // 非NULL时事件就绪调用handler而不是signal cond
+    MysqlEventHandler* handler;
 };
 
 #ifndef BAIDU_INTERNAL
@@ -21,6 +21,8 @@
 #include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/select.h>
+#include <set>
+#include <vector>
 #include <boost/thread.hpp>
 #include "baikal_client_define.h"
 #include "baikal_client_util.h"
@@ -52,18 +54,34 @@ public:
     bool poll_events_add(int fd, unsigned int events);
     bool poll_events_delete(int fd);
 
+    // @brief 以回调方式注册一次性事件，info->handler不能为NULL
+    // 事件就绪或超过info->timeout毫秒后在epoll线程里注销并回调handler
+    bool add_event(int fd, unsigned int events, MysqlEventInfo* info);
+
     void set_shutdown() {
         _shutdown = true;
     }
+    bool is_running() const {
+        return _running;
+    }
 private:
     EpollServer();
 
+    // 注销回调方式注册的事件，调用方持有_event_mutex
+    void _unregister(int fd);
+    // 回调已注销的事件，调用方不能持有_event_mutex
+    void _run_handlers(const std::vector<MysqlEventInfo*>& ready);
+    void _check_timeout();
+
     MysqlEventInfo**    _fd_mapping; // fd -> MysqlEventInfo.
     int                 _epfd;
     struct epoll_event* _events;
     size_t              _event_size;
     bool                _is_init;
     bool                _shutdown;
+    bool                _running;
+    boost::mutex        _event_mutex;
+    std::set<int>       _event_fds; // 回调方式注册的fd，用于超时检查
 };
 }
 } // namespace baikal
@@ -138,6 +138,14 @@ public:
     static const int WRITE_TIMEOUT = 1; //s
     static const int READ_TIMEOUT = 1; //s
     static const int TIMEOUT_CONN_MAX = 3;
+
+    // 延迟感知选择的参数，时间单位us
+    static const int64_t EWMA_DECAY_US = 2000000; // 延迟ewma的时间常数，空闲时向0衰减
+    static const int64_t OUTLIER_LATENCY_RATIO = 5; // 超过对比实例的倍数视为异常
+    static const int64_t OUTLIER_MIN_LATENCY_US = 50000;
+    static const int64_t EJECT_BASE_US = 1000000; // 首次摘除时间，每次翻倍
+    static const int64_t EJECT_MAX_US = 30000000;
+    static const int64_t READMIT_US = 5000000; // 摘除结束后线性放量的时间
     Instance(
             std::string ip,
             int port,
@@ -261,6 +269,15 @@ public:
     int64_t get_qps() const {
         return _weight.get_qps();
     }
+    int64_t get_inflight() {
+        return _weight.get_begin_time_count();
+    }
+    // 请求结束时更新peak ewma延迟，延迟突增立即生效，回落按时间平滑
+    void update_ewma(int64_t latency_us, int64_t now_us);
+    int64_t get_ewma_latency(int64_t now_us);
+    // 摘除中返回false，放量恢复期内按比例返回true
+    bool is_available(int64_t now_us);
+    void eject(int64_t now_us);
 private:
 
     // @brief 当实例故障或离线时删除所有的连接 
@@ -316,6 +333,12 @@ private:
 
     BnsConnectionPool* _bns_pool;
     bool _first_update_quartile;
+
+    boost::mutex _ewma_lock;
+    double _ewma_latency;
+    int64_t _ewma_update_us;
+    int32_t _eject_times;
+    int64_t _eject_until_us;
 };
 
 }
@@ -83,6 +83,12 @@ public:
     // @brief 若client只配置了一个service，可直接调用该接口执行sql语句
     int query(uint32_t partition_key, const std::string& sql, ResultSet* result);
 
+    // @brief 若client只配置了一个service，可直接调用该接口异步执行sql语句
+    // 需要开启use_epoll和async，参见Service::async_query
+    int async_query(uint32_t partition_key, const std::string& sql, AsyncQueryHandler* handler);
+
+    int async_query_batch(const std::vector<AsyncQuery>& queries, int max_concurrency);
+
     std::string get_manager_name();
 
     // @brief 根据客户端输入的db_name,得到相应的service
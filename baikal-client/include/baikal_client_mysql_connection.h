@@ -84,6 +84,12 @@ public:
     int execute_raw(const std::string& sql, bool store, MYSQL_RES*& result);
     int execute_raw(const std::string& sql, MYSQL_RES*& result);
     
+    // @brief 加注释、分表改写sql，从sql语句中解析表名
+    int rewrite_sql(const std::string& sql, std::string& sql_rewrite);
+
+    // @brief 根据_sqlhandle上的错误码处理实例状态，返回错误码
+    int handle_query_error(const std::string& sql_rewrite);
+
     // @brief 在connection上执行start transition操作
     int begin_transaction();
     
@@ -108,6 +114,11 @@ public:
     virtual void close();
 private:
 
+    // @brief 加注释并按table_name_list分表改写sql
+    int _rewrite_sql(const std::string& sql,
+                     std::vector<std::string>& table_name_list,
+                     std::string& sql_rewrite);
+
     // @brief 进行分表
     int _split_table(std::vector<std::string>& table_name_list, std::string& sql_rewrite);
 
@@ -34,6 +34,7 @@
 #include "global.h"
 #include "baikal_client_logic_db.h"
 #include "baikal_client_bns_connection_pool.h"
+#include "baikal_client_async_query.h"
 
 namespace baikal {
 namespace client {
@@ -129,6 +130,15 @@ public:
     // @returnVal int 0 表示执行成功
     int query(uint32_t partition_key, const std::string& sql, ResultSet* result);
 
+    // @brief 异步执行sql，立即返回，结果通过handler流式回调
+    // @note 需要async连接且Manager开启use_epoll
+    // @returnVal int 0 表示提交成功，非0时handler不会被回调
+    int async_query(uint32_t partition_key, const std::string& sql, AsyncQueryHandler* handler);
+
+    // @brief 批量异步执行，最多占用max_concurrency个连接，
+    // 每个连接上的sql依次流水执行，同partition_key的sql复用连接
+    int async_query_batch(const std::vector<AsyncQuery>& queries, int max_concurrency);
+
     //给定分片id，具体实例(ip_port，为空则随机/轮询调度)的接口
     //内部带重试，秒级超时设置（-1不超时）
     //暂时只有凤脉能用到
@@ -0,0 +1,278 @@
+// Copyright (c) 2019 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "baikal_client_async_query.h"
+#include <algorithm>
+#include "global.h"
+#include "baikal_client_service.h"
+#include "baikal_client_epoll.h"
+#include "baikal_client_mysql_async.h"
+
+using std::string;
+using std::vector;
+
+namespace baikal {
+namespace client {
+
+int AsyncQueryBatch::start(Service* service, const vector<AsyncQuery>& queries,
+        int max_concurrency) {
+    if (queries.empty()) {
+        return SUCCESS;
+    }
+    int lane_num = std::min(std::max(max_concurrency, 1), (int)queries.size());
+    AsyncQueryBatch* batch = new AsyncQueryBatch(service, queries, lane_num);
+    int started = 0;
+    for (int i = 0; i < lane_num; ++i) {
+        AsyncQueryLane* lane = new AsyncQueryLane(batch);
+        if (lane->start() != 0) {
+            CLIENT_WARNING("start async query lane fail, started:%d", started);
+            delete lane;
+            // 未启动的连接也要计数，batch在最后一个lane_finish时释放
+            for (int j = i; j < lane_num; ++j) {
+                batch->lane_finish();
+            }
+            break;
+        }
+        ++started;
+    }
+    // 已启动的连接会执行完队列中所有sql
+    return started > 0 ? SUCCESS : THREAD_START_ERROR;
+}
+
+const AsyncQuery* AsyncQueryBatch::next() {
+    size_t index = _next_index.fetch_add(1);
+    if (index >= _queries.size()) {
+        return NULL;
+    }
+    return &_queries[index];
+}
+
+void AsyncQueryBatch::lane_finish() {
+    if (_lane_num.fetch_sub(1) == 1) {
+        delete this;
+    }
+}
+
+AsyncQueryLane::AsyncQueryLane(AsyncQueryBatch* batch) :
+        _batch(batch),
+        _query(NULL),
+        _state(LANE_IDLE),
+        _query_ret(SUCCESS),
+        _ret(0),
+        _affected_rows(0),
+        _res(NULL),
+        _row(NULL),
+        _proc_weight(NULL),
+        _event(0) {
+    _event_info.handler = this;
+}
+
+AsyncQueryLane::~AsyncQueryLane() {
+    if (_conn) {
+        _conn->close();
+    }
+}
+
+void* AsyncQueryLane::run_thread(void* arg) {
+    AsyncQueryLane* lane = static_cast<AsyncQueryLane*>(arg);
+    lane->_run(lane->_event);
+    return NULL;
+}
+
+int AsyncQueryLane::start() {
+    _event = 0;
+    bthread_t tid;
+    return bthread_start_background(&tid, NULL, run_thread, this);
+}
+
+void AsyncQueryLane::on_event(int event_out) {
+    // 结果处理和用户回调放到bthread里，不阻塞epoll线程
+    _event = event_out;
+    bthread_t tid;
+    if (bthread_start_background(&tid, NULL, run_thread, this) != 0) {
+        CLIENT_WARNING("start bthread fail, run async query in event loop thread");
+        _run(event_out);
+    }
+}
+
+void AsyncQueryLane::_run(int event) {
+    while (true) {
+        int status = 0;
+        if (event != 0) {
+            status = _cont(event);
+        }
+        while (status == 0) {
+            if (!_advance(&status)) {
+                AsyncQueryBatch* batch = _batch;
+                delete this;
+                batch->lane_finish();
+                return;
+            }
+        }
+        // 注册成功后可能已经在其他bthread里继续执行，不能再访问成员
+        if (_wait(status)) {
+            return;
+        }
+        // 注册失败时让mysql按超时结束当前步骤
+        event = MYSQL_WAIT_TIMEOUT;
+    }
+}
+
+int AsyncQueryLane::_cont(int event) {
+    MYSQL* mysql = _conn->get_mysql_handle();
+    switch (_state) {
+    case LANE_QUERY:
+        return mysql_real_query_cont(&_ret, mysql, event);
+    case LANE_FETCH_ROW:
+        return mysql_fetch_row_cont(&_row, _res, event);
+    case LANE_FREE_RESULT:
+        return mysql_free_result_cont(_res, event);
+    default:
+        CLIENT_FATAL("wrong async query state:%d", _state);
+        return 0;
+    }
+}
+
+bool AsyncQueryLane::_advance(int* status) {
+    *status = 0;
+    switch (_state) {
+    case LANE_IDLE: {
+        const AsyncQuery* query = _batch->next();
+        if (query == NULL) {
+            return false;
+        }
+        _start_query(query, status);
+        return true;
+    }
+    case LANE_QUERY: {
+        MYSQL* mysql = _conn->get_mysql_handle();
+        if (_ret != 0) {
+            _finish_query(_conn->handle_query_error(_sql_rewrite));
+            return true;
+        }
+        if (mysql_field_count(mysql) == 0) {
+            _affected_rows = mysql_affected_rows(mysql);
+            _finish_query(SUCCESS);
+            return true;
+        }
+        // use_result不缓存结果集，fetch时才从网络读取行
+        _res = mysql_use_result(mysql);
+        if (_res == NULL) {
+            CLIENT_WARNING("mysql use result fail, info:%s", _conn->get_instance_info().c_str());
+            _finish_query(CONNECTION_QUERY_FAIL);
+            return true;
+        }
+        _state = LANE_FETCH_ROW;
+        *status = mysql_fetch_row_start(&_row, _res);
+        return true;
+    }
+    case LANE_FETCH_ROW:
+        if (_row != NULL) {
+            if (_query->handler->on_row(_res, _row) == 0) {
+                *status = mysql_fetch_row_start(&_row, _res);
+                return true;
+            }
+            // 不需要剩余的行，free_result会读完并丢弃
+            _query_ret = SUCCESS;
+        } else if (mysql_errno(_conn->get_mysql_handle()) != 0) {
+            _query_ret = _conn->handle_query_error(_sql_rewrite);
+        } else {
+            _query_ret = SUCCESS;
+        }
+        _state = LANE_FREE_RESULT;
+        *status = mysql_free_result_start(_res);
+        return true;
+    case LANE_FREE_RESULT:
+        _res = NULL;
+        _finish_query(_query_ret);
+        return true;
+    }
+    return false;
+}
+
+bool AsyncQueryLane::_start_query(const AsyncQuery* query, int* status) {
+    _query = query;
+    _affected_rows = 0;
+    _query_ret = SUCCESS;
+    // 同partition_key的sql复用上一条的连接
+    if (_conn && _conn->get_partition_key() != query->partition_key) {
+        _conn->close();
+        _conn.reset();
+    }
+    if (!_conn) {
+        _conn = _batch->get_service()->fetch_connection(query->partition_key);
+        if (!_conn) {
+            CLIENT_WARNING("fetch connection in async query fail, partition_key:%u",
+                    query->partition_key);
+            _finish_query(FETCH_CONNECT_FAIL);
+            return false;
+        }
+        if (!_conn->get_async() || _conn->get_mysql_handle() == NULL) {
+            CLIENT_WARNING("async query need async connection, info:%s",
+                    _conn->get_instance_info().c_str());
+            _finish_query(INPUTPARAM_ERROR);
+            return false;
+        }
+    }
+    int ret = _conn->rewrite_sql(query->sql, _sql_rewrite);
+    if (ret < 0) {
+        _finish_query(ret);
+        return false;
+    }
+    _proc_weight = new ScopeProcWeight(_conn.get());
+    _state = LANE_QUERY;
+    *status = mysql_real_query_start(&_ret, _conn->get_mysql_handle(),
+            _sql_rewrite.c_str(), _sql_rewrite.size());
+    return true;
+}
+
+void AsyncQueryLane::_finish_query(int ret) {
+    if (_proc_weight != NULL) {
+        delete _proc_weight;
+        _proc_weight = NULL;
+    }
+    _state = LANE_IDLE;
+    // 出错的连接不再复用
+    if (ret != SUCCESS && _conn) {
+        _conn->close();
+        _conn.reset();
+    }
+    _query->handler->on_done(ret, _affected_rows);
+    _query = NULL;
+}
+
+bool AsyncQueryLane::_wait(int status) {
+    MYSQL* mysql = _conn->get_mysql_handle();
+    unsigned int events = 0;
+    if (status & MYSQL_WAIT_READ) {
+        events |= EPOLLIN;
+    }
+    if (status & MYSQL_WAIT_WRITE) {
+        events |= EPOLLOUT;
+    }
+    if (status & MYSQL_WAIT_TIMEOUT) {
+        _event_info.timeout = mysql_get_timeout_value(mysql) * 1000;
+    } else {
+        _event_info.timeout = DEFAULT_READ_TIMEOUT * 1000;
+    }
+    if (!EpollServer::get_instance()->add_event(mysql_get_socket(mysql), events, &_event_info)) {
+        CLIENT_WARNING("add event to epoll fail, info:%s", _conn->get_instance_info().c_str());
+        return false;
+    }
+    return true;
+}
+}
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
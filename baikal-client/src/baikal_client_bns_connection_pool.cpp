@@ -23,6 +23,7 @@
 #include "baikal_client_bns_connection_pool.h"
 #include "global.h"
 #include <stdlib.h>
+#include <algorithm>
 #ifdef BAIDU_INTERNAL
 #include "com_log.h"
 #include <base/time.h>
@@ -239,6 +240,8 @@ Instance* BnsConnectionPool::_select_instance(const std::string& ip_port) {
         return _select_instance_random();
     } else if (_select_algo == ROLLING) {
         return _select_instance_rolling(false);
+    } else if (_select_algo == LATENCY_AWARE) {
+        return _select_instance_latency_aware();
     } else {
         CLIENT_WARNING("unsupport select algorithm");
         return NULL;
@@ -303,6 +306,51 @@ Instance* BnsConnectionPool::_select_instance_local_aware() {
                 _bns_name.c_str(), total);
     return _select_instance_rolling(true);
 }
+// 随机取两个可用实例，选ewma延迟*(在途请求+1)较小的
+// 其中一个延迟远超另一个时视为异常实例，摘除一段时间后逐步放量
+Instance* BnsConnectionPool::_select_instance_latency_aware() {
+    const size_t n = _instances_index.size();
+    if (n == 0) {
+        return NULL;
+    }
+    int64_t now_us = butil::gettimeofday_us();
+    Instance* chosen[2] = {NULL, NULL};
+    int found = 0;
+    for (size_t tries = 0; found < 2 && tries < 2 * n; ++tries) {
+        Instance* instance = _instances_map[_instances_index[butil::fast_rand_less_than(n)]];
+        if (instance == chosen[0] || instance->get_status() != ON_LINE
+                || !instance->is_available(now_us)) {
+            continue;
+        }
+        if (instance->get_total_connection_num() >= _max_connection_per_instance
+                && !instance->has_not_used_connection()) {
+            continue;
+        }
+        chosen[found++] = instance;
+    }
+    if (found == 0) {
+        CLIENT_WARNING("select instance fail when latency aware, bns_name:%s", _bns_name.c_str());
+        return _select_instance_rolling(true);
+    }
+    if (found == 1) {
+        return chosen[0];
+    }
+    int64_t ewma[2];
+    int64_t cost[2];
+    for (int i = 0; i < 2; ++i) {
+        ewma[i] = chosen[i]->get_ewma_latency(now_us);
+        cost[i] = (ewma[i] + 1) * (chosen[i]->get_inflight() + 1);
+    }
+    for (int i = 0; i < 2; ++i) {
+        int64_t limit = std::max(ewma[1 - i] * Instance::OUTLIER_LATENCY_RATIO,
+                                 Instance::OUTLIER_MIN_LATENCY_US);
+        if (ewma[i] > limit) {
+            chosen[i]->eject(now_us);
+            return chosen[1 - i];
+        }
+    }
+    return cost[0] <= cost[1] ? chosen[0] : chosen[1];
+}
 Instance* BnsConnectionPool::_select_instance_random() {
     int rand_num = rand() % (_instances_map.size()) + 1;
     // 选实例
@@ -53,7 +53,9 @@ ScopeProcWeight::~ScopeProcWeight() {
     int64_t diff = instance->update(_connection->_begin_time_us);
     instance->get_bns_pool()->update_parent_weight(diff, instance->get_index());
     instance->get_bns_pool()->total_fetch_add(diff); 
-    instance->update_quartile_value(butil::gettimeofday_us() - _connection->_begin_time_us);
+    int64_t now_us = butil::gettimeofday_us();
+    instance->update_quartile_value(now_us - _connection->_begin_time_us);
+    instance->update_ewma(now_us - _connection->_begin_time_us, now_us);
     //instance->print_weight();
     //_connection->_pool->print_instance_weight();
 }
@@ -131,6 +133,16 @@ int Connection::rollback() {
     CLIENT_FATAL("rollback base connection");
     return EXECUTE_FAIL;
 }
+int Connection::rewrite_sql(const string& /*sql*/, string& /*sql_rewrite*/) {
+    CLIENT_FATAL("rewrite_sql base connection");
+    return EXECUTE_FAIL;
+}
+
+int Connection::handle_query_error(const string& /*sql_rewrite*/) {
+    CLIENT_FATAL("handle_query_error base connection");
+    return EXECUTE_FAIL;
+}
+
 MYSQL* Connection::get_mysql_handle() {
     return _sql_handle;
 }
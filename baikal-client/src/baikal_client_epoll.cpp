@@ -25,7 +25,8 @@ EpollServer::EpollServer():
     _epfd(-1), 
     _event_size(0), 
     _is_init(false),
-    _shutdown(false) {
+    _shutdown(false),
+    _running(false) {
         _fd_mapping = new MysqlEventInfo*[EPOLL_MAX_SIZE];
         _events = new struct epoll_event[EPOLL_MAX_SIZE];
 }
@@ -134,6 +135,62 @@ bool EpollServer::poll_events_delete(int fd) {
     return true;
 }
 
+bool EpollServer::add_event(int fd, unsigned int events, MysqlEventInfo* info) {
+    if (info == NULL || info->handler == NULL) {
+        CLIENT_FATAL("event handler is null, fd:%d", fd);
+        return false;
+    }
+    // 加锁后epoll线程在注册完成前不会处理该fd的事件和超时
+    boost::mutex::scoped_lock lock(_event_mutex);
+    info->event_in = events;
+    info->event_out = 0;
+    info->cost.reset();
+    if (!set_fd_mapping(fd, info)) {
+        return false;
+    }
+    if (!poll_events_add(fd, events)) {
+        delete_fd_mapping(fd);
+        return false;
+    }
+    _event_fds.insert(fd);
+    return true;
+}
+
+void EpollServer::_unregister(int fd) {
+    _event_fds.erase(fd);
+    poll_events_delete(fd);
+    delete_fd_mapping(fd);
+}
+
+void EpollServer::_run_handlers(const std::vector<MysqlEventInfo*>& ready) {
+    // 注销后info只属于handler，回调里可能重新注册同一个fd(add_event会加锁)，
+    // 必须在释放_event_mutex之后调用
+    for (size_t i = 0; i < ready.size(); ++i) {
+        ready[i]->handler->on_event(ready[i]->event_out);
+    }
+}
+
+void EpollServer::_check_timeout() {
+    std::vector<MysqlEventInfo*> ready;
+    {
+        boost::mutex::scoped_lock lock(_event_mutex);
+        std::vector<int> timeout_fds;
+        for (std::set<int>::iterator iter = _event_fds.begin(); iter != _event_fds.end(); ++iter) {
+            MysqlEventInfo* info = _fd_mapping[*iter];
+            if (info != NULL && info->cost.get_time() >= (int64_t)info->timeout * 1000) {
+                timeout_fds.push_back(*iter);
+            }
+        }
+        for (size_t i = 0; i < timeout_fds.size(); ++i) {
+            MysqlEventInfo* info = _fd_mapping[timeout_fds[i]];
+            info->event_out = MYSQL_WAIT_TIMEOUT;
+            _unregister(timeout_fds[i]);
+            ready.push_back(info);
+        }
+    }
+    _run_handlers(ready);
+}
+
 void EpollServer::start_server() {
 
     // Initail epoll info.
@@ -141,14 +198,25 @@ void EpollServer::start_server() {
         CLIENT_FATAL("initial epoll info failed.");
         return;
     }
+    _running = true;
     // Process epoll events.
     while (!_shutdown) {
-        int fd_cnt = epoll_wait(_epfd, _events, EPOLL_MAX_SIZE, 2000);
+        // 有回调事件时缩短等待时间以便及时检查超时
+        int wait_ms = 2000;
+        {
+            boost::mutex::scoped_lock lock(_event_mutex);
+            if (!_event_fds.empty()) {
+                wait_ms = 100;
+            }
+        }
+        int fd_cnt = epoll_wait(_epfd, _events, EPOLL_MAX_SIZE, wait_ms);
 
+        std::vector<MysqlEventInfo*> ready;
         for (int idx = 0; idx < fd_cnt; ++idx) {
             int fd = _events[idx].data.fd;
             int event = _events[idx].events;
 
+            boost::mutex::scoped_lock lock(_event_mutex);
             // Check if socket in fd_mapping or not.
             MysqlEventInfo* info = _fd_mapping[fd];
             if (info == NULL) {
@@ -168,11 +236,19 @@ void EpollServer::start_server() {
             if (event & EPOLLHUP || event & EPOLLERR) {
                 info->event_out |= MYSQL_WAIT_EXCEPT;
             }
+            if (info->handler != NULL) {
+                _unregister(fd);
+                ready.push_back(info);
+                continue;
+            }
             poll_events_delete(fd);
             delete_fd_mapping(fd);
             info->cond.signal();
         }
+        _run_handlers(ready);
+        _check_timeout();
     }
+    _running = false;
     return;
 }
 }
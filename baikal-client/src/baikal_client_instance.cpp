@@ -25,6 +25,12 @@
 #include "com_log.h"
 #endif
 #include "baikal_client_bns_connection_pool.h"
+#include <cmath>
+#ifdef BAIDU_INTERNAL
+#include <base/fast_rand.h>
+#else
+#include "butil/fast_rand.h"
+#endif
 using std::string;
 using std::vector;
 
@@ -34,6 +40,12 @@ const int32_t Weight::RECV_QUEUE_SIZE;
 const int64_t Weight::DEFAULT_QPS;
 const int64_t Weight::DEFAULT_AVG_LATENCY;
 const int64_t Weight::MIN_WEIGHT;
+const int64_t Instance::EWMA_DECAY_US;
+const int64_t Instance::OUTLIER_LATENCY_RATIO;
+const int64_t Instance::OUTLIER_MIN_LATENCY_US;
+const int64_t Instance::EJECT_BASE_US;
+const int64_t Instance::EJECT_MAX_US;
+const int64_t Instance::READMIT_US;
 int64_t Weight::_s_weight_scale = 
     std::numeric_limits<int64_t>::max() / 72000000 / (RECV_QUEUE_SIZE - 1);
 int64_t Weight::_s_default_weight = 
@@ -228,7 +240,11 @@ Instance::Instance(
             _max_connection_per_instance(max_connection_per_instance),
             _total_connection_num(0),
             _bns_pool(pool),
-            _first_update_quartile(true) {
+            _first_update_quartile(true),
+            _ewma_latency(0),
+            _ewma_update_us(0),
+            _eject_times(0),
+            _eject_until_us(0) {
     _min_heap.init_heap(TOTAL_COUNT / 10000, 0); // 99.99分位
     _conn_conf_healthy_check = _conn_conf;
     _conn_conf_healthy_check.read_timeout = READ_TIMEOUT;
@@ -745,6 +761,56 @@ int64_t Instance::update(const int64_t& start_time) {
     return _weight.update(start_time);
 }
 
+void Instance::update_ewma(int64_t latency_us, int64_t now_us) {
+    if (latency_us < 0) {
+        return;
+    }
+    boost::mutex::scoped_lock lock(_ewma_lock);
+    if (latency_us > _ewma_latency || _ewma_update_us == 0) {
+        _ewma_latency = latency_us;
+    } else if (now_us > _ewma_update_us) {
+        double w = std::exp(-(double)(now_us - _ewma_update_us) / EWMA_DECAY_US);
+        _ewma_latency = _ewma_latency * w + latency_us * (1 - w);
+    }
+    _ewma_update_us = now_us;
+    // 恢复期结束后仍正常，清空退避次数
+    if (_eject_times > 0 && now_us > _eject_until_us + READMIT_US * 2) {
+        _eject_times = 0;
+    }
+}
+
+int64_t Instance::get_ewma_latency(int64_t now_us) {
+    boost::mutex::scoped_lock lock(_ewma_lock);
+    if (_ewma_update_us == 0 || now_us <= _ewma_update_us) {
+        return _ewma_latency;
+    }
+    return _ewma_latency * std::exp(-(double)(now_us - _ewma_update_us) / EWMA_DECAY_US);
+}
+
+bool Instance::is_available(int64_t now_us) {
+    boost::mutex::scoped_lock lock(_ewma_lock);
+    if (now_us < _eject_until_us) {
+        return false;
+    }
+    int64_t passed_us = now_us - _eject_until_us;
+    if (_eject_until_us == 0 || passed_us >= READMIT_US) {
+        return true;
+    }
+    return (int64_t)butil::fast_rand_less_than(READMIT_US) < passed_us;
+}
+
+void Instance::eject(int64_t now_us) {
+    boost::mutex::scoped_lock lock(_ewma_lock);
+    if (now_us < _eject_until_us) {
+        return;
+    }
+    int64_t eject_us = std::min(EJECT_BASE_US << std::min(_eject_times, 5), EJECT_MAX_US);
+    ++_eject_times;
+    _eject_until_us = now_us + eject_us;
+    CLIENT_WARNING("instance:%s:%d is latency outlier, eject %ld us, ewma:%.0f us",
+                _ip.c_str(), _port, eject_us, _ewma_latency);
+}
+
 int64_t Instance::left_fetch_add(int64_t diff) {
     return _left.fetch_add(diff); 
 }
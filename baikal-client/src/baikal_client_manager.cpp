@@ -332,6 +332,27 @@ int Manager::query(uint32_t partition_key, const std::string& sql, ResultSet* re
     }
     return service->query(partition_key, sql, result);
 }
+int Manager::async_query(uint32_t partition_key, const std::string& sql,
+        AsyncQueryHandler* handler) {
+    vector<AsyncQuery> queries;
+    queries.push_back(AsyncQuery(partition_key, sql, handler));
+    return async_query_batch(queries, 1);
+}
+
+int Manager::async_query_batch(const std::vector<AsyncQuery>& queries, int max_concurrency) {
+    if (_db_service_map.size() != 1) {
+        CLIENT_WARNING("service num is not one, this method cann't be called, service num:%d",
+                _db_service_map.size());
+        return GET_SERVICE_FAIL;
+    }
+    Service* service = get_service(_db_service_map.begin()->first);
+    if (service == NULL) {
+        CLIENT_WARNING("get service in async query fail");
+        return GET_SERVICE_FAIL;
+    }
+    return service->async_query_batch(queries, max_concurrency);
+}
+
 std::string Manager::get_manager_name() {
     return _manager_name;
 }
@@ -145,23 +145,10 @@ int MysqlConnection::execute(const string& sql,
         return CONNECTION_ALREADY_DELETED;
     }
     string sql_rewrite;
-    string comment_format;
-
-    // 增加注释
-    int ret = _add_comment(pool, comment_format);
+    int ret = _rewrite_sql(sql, table_name_list, sql_rewrite);
     if (ret < 0) {
-        CLIENT_WARNING("add comment fail");
         return ret;
     }
-    sql_rewrite = comment_format + " " + sql;
-    // 有partition_key则可能进行分表，若没有，直接查询
-    if (_has_partition_key && pool->is_split_table()) {
-        ret = _split_table(table_name_list, sql_rewrite);
-        if (ret < 0) {
-            CLIENT_WARNING("split table fail, sql statement:%s", sql_rewrite.c_str());
-            return ret;
-        }
-    }
     int64_t pre_t1 = time_cost.get_time();
     time_cost.reset();
     //分类讨论ret返回值，区分出来哪些是连接错误
@@ -213,6 +200,46 @@ int MysqlConnection::execute(const string& sql, ResultSet* result) {
     return ret;
 }
 
+int MysqlConnection::rewrite_sql(const string& sql, string& sql_rewrite) {
+    vector<string> table_name_list;
+    BnsConnectionPool* pool = _pool;
+    if (pool == NULL) {
+        CLIENT_WARNING("the connection has been deleted, please fetch connection again");
+        return CONNECTION_ALREADY_DELETED;
+    }
+    if (_has_partition_key && pool->is_split_table()) {
+        _parse_table_name_list(sql, table_name_list);
+    }
+    return _rewrite_sql(sql, table_name_list, sql_rewrite);
+}
+
+int MysqlConnection::_rewrite_sql(const string& sql,
+                                  vector<string>& table_name_list,
+                                  string& sql_rewrite) {
+    BnsConnectionPool* pool = _pool;
+    if (pool == NULL) {
+        CLIENT_WARNING("the connection has been deleted, please fetch connection again ");
+        return CONNECTION_ALREADY_DELETED;
+    }
+    string comment_format;
+    // 增加注释
+    int ret = _add_comment(pool, comment_format);
+    if (ret < 0) {
+        CLIENT_WARNING("add comment fail");
+        return ret;
+    }
+    sql_rewrite = comment_format + " " + sql;
+    // 有partition_key则可能进行分表，若没有，直接查询
+    if (_has_partition_key && pool->is_split_table()) {
+        ret = _split_table(table_name_list, sql_rewrite);
+        if (ret < 0) {
+            CLIENT_WARNING("split table fail, sql statement:%s", sql_rewrite.c_str());
+            return ret;
+        }
+    }
+    return SUCCESS;
+}
+
 int MysqlConnection::execute_raw(const string& sql,
                               bool store,
                               MYSQL_RES*& res) {
@@ -510,10 +537,15 @@ int MysqlConnection::_process_query(const string& sql_rewrite) {
     if (ret == 0) {
         return SUCCESS;
     }
+    CLIENT_WARNING("query fail, info:%s cost:%ld us", get_instance_info().c_str(), cost.get_time());
+    return handle_query_error(sql_rewrite);
+}
+
+int MysqlConnection::handle_query_error(const string& sql_rewrite) {
     int error_code = 0;
     get_error_code(&error_code);
-    CLIENT_WARNING("error_code:%d error_des:%s info:%s cost:%ld us",
-            error_code, get_error_des().c_str(), get_instance_info().c_str(), cost.get_time());
+    CLIENT_WARNING("error_code:%d error_des:%s info:%s",
+            error_code, get_error_des().c_str(), get_instance_info().c_str());
     if (_is_hang.load()) {
         CLIENT_WARNING("instace is hang, ip:[%s], port:[%d], sql_len:%d, sql is:%s",
                 _instance->get_ip().c_str(), _instance->get_port(),
@@ -15,6 +15,7 @@
 #include "baikal_client_service.h"
 #include <boost/algorithm/string.hpp>
 #include "baikal_client_util.h"
+#include "baikal_client_epoll.h"
 #include "shard_operator_mgr.h"
 #include "global.h"
 
@@ -78,6 +79,8 @@ int Service::init(comcfg::ConfigUnit& conf_unit) {
                 _select_algo = ROLLING;
             } else if (algo_int == 3) {
                 _select_algo = LOCAL_AWARE;
+            } else if (algo_int == 4) {
+                _select_algo = LATENCY_AWARE;
             } else {
                 CLIENT_WARNING("service:%s, unsupport select alogrithm, algo_int:%d", 
                         _name.c_str(), algo_int);
@@ -457,6 +460,8 @@ int Service::init(const Option& option) {
         _select_algo = ROLLING;
     } else if (algo_int == 3) {
         _select_algo = LOCAL_AWARE;
+    } else if (algo_int == 4) {
+        _select_algo = LATENCY_AWARE;
     } else {
         CLIENT_WARNING("service:%s, unsupport select alogrithm, algo_int:%d",
                 _name.c_str(), algo_int);
@@ -722,6 +727,32 @@ int Service::query(uint32_t partition_key, const std::string& sql, ResultSet* re
     return ret;
 }
 
+int Service::async_query(uint32_t partition_key, const std::string& sql,
+        AsyncQueryHandler* handler) {
+    vector<AsyncQuery> queries;
+    queries.push_back(AsyncQuery(partition_key, sql, handler));
+    return async_query_batch(queries, 1);
+}
+
+int Service::async_query_batch(const std::vector<AsyncQuery>& queries, int max_concurrency) {
+    if (!_is_inited) {
+        CLIENT_WARNING("service %s is not inited, please use init2", _name.c_str());
+        return SERVICE_NOT_INIT_ERROR;
+    }
+    if (!_async || !EpollServer::get_instance()->is_running()) {
+        CLIENT_WARNING("async query need async and use_epoll, service:%s", _name.c_str());
+        return INPUTPARAM_ERROR;
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (queries[i].handler == NULL || queries[i].sql.empty()) {
+            CLIENT_WARNING("async query handler is null or sql is empty, service:%s",
+                    _name.c_str());
+            return INPUTPARAM_ERROR;
+        }
+    }
+    return AsyncQueryBatch::start(this, queries, max_concurrency);
+}
+
 SmartConnection Service::fetch_connection() {
     if (!_is_inited) {
         CLIENT_WARNING("service %s is not inited, please use init2", _name.c_str());
@@ -0,0 +1,124 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include "common.h"
+#include "proto/meta.interface.pb.h"
+
+namespace baikaldb {
+DECLARE_bool(row_compact_format);
+
+// 行存主键value的紧凑格式，替代整个TableRecord的pb序列化
+// magic(1) + schema_version(varint) + null bitmap + 定长区 + 变长字段结束偏移(每个4字节) + 变长区
+// 行里不存layout，由meta在字段变化时把layout追加到SchemaInfo.row_layouts，
+// 读时按(table_id, schema_version)找到写入时的layout，删除和改类型的列也能解析
+// layout: 字段数 + 字段id区间(与上个区间的id差值, 个数)列表 + 每个字段类型(4bit)，不含主键列
+// null的定长字段也占位，任意字段都能按layout直接定位，不用从头解析
+// pb序列化的首字节是tag(field_id >= 1)，不会是magic，读时按首字节区分两种格式，
+// 存量pb格式的行在下次写入时改写成紧凑格式
+enum CompactFieldKind {
+    ROW_INT32   = 0,
+    ROW_INT64   = 1,
+    ROW_UINT32  = 2,
+    ROW_UINT64  = 3,
+    ROW_FLOAT   = 4,
+    ROW_DOUBLE  = 5,
+    ROW_BOOL    = 6,
+    ROW_STRING  = 7     // 变长
+};
+
+// 同一张表同一layout版本下所有行的layout相同，解析一次后由TableInfo持有
+struct CompactRowLayout {
+    std::string desc;
+    std::vector<int32_t> field_ids;
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets;      // 定长字段为定长区内偏移，变长字段为变长序号
+    std::vector<int32_t> slot_by_id;    // field_id -> slot，-1表示没有这个字段
+    uint32_t fixed_size = 0;
+    uint32_t var_count = 0;
+
+    int find(int32_t field_id) const {
+        if (field_id < 0 || field_id >= (int32_t)slot_by_id.size()) {
+            return -1;
+        }
+        return slot_by_id[field_id];
+    }
+    int parse(const std::string& layout_desc);
+};
+typedef std::shared_ptr<const CompactRowLayout> SmartRowLayout;
+
+class CompactRowReader {
+public:
+    // 解析行头，按(table_id, schema_version)取layout，0成功，-1格式错误或找不到layout
+    int init(int64_t table_id, const char* data, size_t size);
+    // 行头已由parse_header解析，layout由调用方给出
+    int init(const SmartRowLayout& layout, const char* data, size_t size);
+
+    int64_t schema_version() const {
+        return _schema_version;
+    }
+    const CompactRowLayout& layout() const {
+        return *_layout;
+    }
+    bool is_null(int slot) const {
+        return (_nulls[slot >> 3] >> (slot & 7)) & 1;
+    }
+    // 把slot的值设置到message的field上，列类型修改过时做数值转换
+    int read_field(int slot, const google::protobuf::FieldDescriptor* field,
+            google::protobuf::Message* message) const;
+
+private:
+    int64_t _schema_version = 0;
+    SmartRowLayout _layout;
+    const char* _nulls = nullptr;
+    const char* _fixed = nullptr;
+    const char* _var_ends = nullptr;
+    const char* _var_data = nullptr;
+    uint32_t _var_size = 0;
+};
+
+class CompactRowCodec {
+public:
+    static const uint8_t MAGIC = 0x01;
+
+    static bool is_compact(const char* data, size_t size) {
+        return size > 0 && (uint8_t)data[0] == MAGIC;
+    }
+    // 由schema计算layout原文，meta和store用同一个函数，保证结果一致
+    static int build_layout(const pb::SchemaInfo& schema, std::string* desc);
+    // 按layout编码message，message中除skip_field_ids(主键列)外的字段必须和layout一致
+    static int encode(const google::protobuf::Message& message, int64_t schema_version,
+            const CompactRowLayout& layout, const std::set<int32_t>& skip_field_ids,
+            std::string* out);
+    // 解析行头中的schema_version，返回行头长度，-1表示格式错误
+    static int parse_header(const char* data, size_t size, int64_t* schema_version);
+    // 解码全部字段
+    static int decode(int64_t table_id, const char* data, size_t size,
+            google::protobuf::Message* message);
+    static int decode(const CompactRowReader& reader, google::protobuf::Message* message);
+
+    // 按(table_id, schema_version)从SchemaFactory取layout，线程内缓存
+    static SmartRowLayout get_layout(int64_t table_id, int64_t schema_version);
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
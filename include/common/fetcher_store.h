@@ -14,6 +14,13 @@
 
 #pragma once
 
+#ifdef BAIDU_INTERNAL
+#include <baidu/rpc/channel.h>
+#include <baidu/rpc/controller.h>
+#else
+#include <brpc/channel.h>
+#include <brpc/controller.h>
+#endif
 #include "table_record.h"
 #include "schema_factory.h"
 #include "runtime_state.h"
@@ -82,6 +89,18 @@ public:
         return run(state, region_infos, store_request, start_seq_id, start_seq_id, op_type);
     }
     void choose_opt_instance(pb::RegionInfo& info, std::string& addr);
+private:
+    // 先向addr发请求，delay_us内未返回则向另一副本发对冲请求，取先成功的一个
+    // 返回生效的controller，对冲请求生效时结果换入res并修改addr
+    brpc::Controller* hedged_query(pb::RegionInfo& info,
+                                   brpc::Channel& channel,
+                                   const brpc::ChannelOptions& option,
+                                   const pb::StoreReq& req,
+                                   brpc::Controller* cntl,
+                                   pb::StoreRes* res,
+                                   brpc::Controller* hedge_cntl,
+                                   int64_t delay_us,
+                                   std::string& addr);
 public:
     std::map<int64_t, std::shared_ptr<RowBatch>> region_batch;
     std::map<int64_t, std::vector<SmartRecord>>  index_records; //key: index_id
@@ -16,7 +16,11 @@
 #include <sys/time.h>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <mutex>
+#include <bvar/bvar.h>
 #ifdef BAIDU_INTERNAL
 #include <base/containers/linked_list.h>
 #else
@@ -52,6 +56,65 @@ private:
     int64_t _len_threshold;
 };
 
+
+//同一类缓存的多个实例共享一组监控项
+struct CacheMetrics {
+    explicit CacheMetrics(const std::string& name) :
+        hit(name + "_cache_hit"),
+        miss(name + "_cache_miss"),
+        eviction(name + "_cache_eviction"),
+        usage(name + "_cache_usage_bytes") {}
+    bvar::Adder<int64_t> hit;
+    bvar::Adder<int64_t> miss;
+    bvar::Adder<int64_t> eviction;
+    bvar::Adder<int64_t> usage;
+};
+
+template <typename ItemKey, typename ItemType>
+struct ShardedLruNode : public butil::LinkNode<ShardedLruNode<ItemKey, ItemType>> {
+    ItemType value;
+    ItemKey key;
+    size_t charge = 0;
+};
+
+//按key分片的LRU缓存，每个分片独立加锁，容量按字节计算
+//add时由调用方给出value占用的字节数，超过分片容量时从分片的LRU头部淘汰
+template <typename ItemKey, typename ItemType>
+class ShardedCache {
+public:
+    typedef ShardedLruNode<ItemKey, ItemType> Node;
+    ShardedCache() {}
+    ~ShardedCache();
+    //可重复调用调整容量，分片数只在第一次调用时生效；capacity为0时不缓存
+    int init(int64_t capacity, CacheMetrics* metrics = nullptr, int shard_bits = 4);
+    std::string get_info();
+    int check(const ItemKey& key);
+    int find(const ItemKey& key, ItemType* value);
+    int add(const ItemKey& key, const ItemType& value, size_t charge);
+    int del(const ItemKey& key);
+    int64_t usage();
+private:
+    struct Shard {
+        std::mutex mutex;
+        butil::LinkedList<Node> lru_list;
+        std::unordered_map<ItemKey, Node*> lru_map;
+        int64_t usage = 0;
+        int64_t capacity = 0;
+    };
+    Shard* get_shard(const ItemKey& key) {
+        uint64_t hash = std::hash<ItemKey>()(key) * 0x9E3779B97F4A7C15ULL;
+        return _shards[(hash >> 32) & (_shards.size() - 1)].get();
+    }
+    //调用方持有分片锁
+    void erase(Shard* shard, Node* node);
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    CacheMetrics* _metrics = nullptr;
+    std::atomic<int64_t> _total_count = {0};
+    std::atomic<int64_t> _hit_count = {0};
+    std::atomic<int64_t> _eviction_count = {0};
+};
+
 }
 #include "lru_cache.hpp"
 
@@ -91,6 +91,154 @@ int Cache<ItemKey, ItemType>::del(const ItemKey& key) {
     return 0;
 }
 
+template <typename ItemKey, typename ItemType>
+ShardedCache<ItemKey, ItemType>::~ShardedCache() {
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        while (!shard->lru_list.empty()) {
+            erase(shard.get(), shard->lru_list.head()->value());
+        }
+    }
+}
+
+template <typename ItemKey, typename ItemType>
+int ShardedCache<ItemKey, ItemType>::init(int64_t capacity, CacheMetrics* metrics, int shard_bits) {
+    if (_shards.empty()) {
+        _metrics = metrics;
+        shard_bits = std::max(0, std::min(shard_bits, 10));
+        for (int i = 0; i < (1 << shard_bits); ++i) {
+            _shards.emplace_back(new Shard);
+        }
+    }
+    int64_t shard_capacity = std::max(capacity, 0L) / _shards.size();
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->capacity = shard_capacity;
+    }
+    return 0;
+}
+
+template <typename ItemKey, typename ItemType>
+std::string ShardedCache<ItemKey, ItemType>::get_info() {
+    char buf[100];
+    snprintf(buf, sizeof(buf), "hit:%ld, total:%ld, eviction:%ld, usage:%ld,",
+            _hit_count.load(), _total_count.load(), _eviction_count.load(), usage());
+    return buf;
+}
+
+template <typename ItemKey, typename ItemType>
+int64_t ShardedCache<ItemKey, ItemType>::usage() {
+    int64_t usage = 0;
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        usage += shard->usage;
+    }
+    return usage;
+}
+
+template <typename ItemKey, typename ItemType>
+void ShardedCache<ItemKey, ItemType>::erase(Shard* shard, Node* node) {
+    node->RemoveFromList();
+    shard->lru_map.erase(node->key);
+    shard->usage -= node->charge;
+    if (_metrics != nullptr) {
+        _metrics->usage << -(int64_t)node->charge;
+    }
+    delete node;
+}
+
+template <typename ItemKey, typename ItemType>
+int ShardedCache<ItemKey, ItemType>::check(const ItemKey& key) {
+    if (_shards.empty()) {
+        return -1;
+    }
+    Shard* shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    if (shard->lru_map.count(key) == 1) {
+        return 0;
+    }
+    return -1;
+}
+
+template <typename ItemKey, typename ItemType>
+int ShardedCache<ItemKey, ItemType>::find(const ItemKey& key, ItemType* value) {
+    if (_shards.empty()) {
+        return -1;
+    }
+    ++_total_count;
+    Shard* shard = get_shard(key);
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        auto iter = shard->lru_map.find(key);
+        if (iter != shard->lru_map.end()) {
+            Node* node = iter->second;
+            *value = node->value;
+            node->RemoveFromList();
+            shard->lru_list.Append(node);
+            ++_hit_count;
+            if (_metrics != nullptr) {
+                _metrics->hit << 1;
+            }
+            return 0;
+        }
+    }
+    if (_metrics != nullptr) {
+        _metrics->miss << 1;
+    }
+    return -1;
+}
+
+template <typename ItemKey, typename ItemType>
+int ShardedCache<ItemKey, ItemType>::add(const ItemKey& key, const ItemType& value, size_t charge) {
+    if (_shards.empty()) {
+        return -1;
+    }
+    Shard* shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto iter = shard->lru_map.find(key);
+    if (iter != shard->lru_map.end()) {
+        erase(shard, iter->second);
+    }
+    //单个value超过分片容量时不缓存
+    if ((int64_t)charge > shard->capacity) {
+        return -1;
+    }
+    int64_t eviction = 0;
+    while (shard->usage + (int64_t)charge > shard->capacity && !shard->lru_list.empty()) {
+        erase(shard, shard->lru_list.head()->value());
+        ++eviction;
+    }
+    Node* node = new Node;
+    node->key = key;
+    node->value = value;
+    node->charge = charge;
+    shard->lru_map[key] = node;
+    shard->lru_list.Append(node);
+    shard->usage += charge;
+    _eviction_count += eviction;
+    if (_metrics != nullptr) {
+        _metrics->usage << charge;
+        if (eviction > 0) {
+            _metrics->eviction << eviction;
+        }
+    }
+    return 0;
+}
+
+template <typename ItemKey, typename ItemType>
+int ShardedCache<ItemKey, ItemType>::del(const ItemKey& key) {
+    if (_shards.empty()) {
+        return 0;
+    }
+    Shard* shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto iter = shard->lru_map.find(key);
+    if (iter != shard->lru_map.end()) {
+        erase(shard, iter->second);
+    }
+    return 0;
+}
+
 }
 
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
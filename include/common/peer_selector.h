@@ -0,0 +1,91 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <bvar/bvar.h>
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_bool(peer_select_latency_aware);
+
+// 按观测延迟选择store副本
+// 每个实例维护随时间衰减的EWMA延迟和在途请求数，用power-of-two-choices比较
+// ewma * (inflight + 1)选较小者；连续失败或延迟远超同组其他副本的实例摘除一段时间，
+// 摘除时间按次数指数退避，到期后按比例逐步放量恢复
+class PeerSelector {
+public:
+    static PeerSelector* get_instance() {
+        static PeerSelector _instance;
+        return &_instance;
+    }
+    PeerSelector() {}
+
+    // 从candidates里选一个，跳过exclude；candidates全部被摘除时退化为不摘除
+    // 没有可选实例返回空串
+    std::string select(const std::vector<std::string>& candidates,
+            const std::string& exclude, int64_t now_us);
+    std::string select(const std::vector<std::string>& candidates,
+            const std::string& exclude = "") {
+        return select(candidates, exclude, butil::gettimeofday_us());
+    }
+
+    // 请求发出/结束时调用，failed只算rpc失败，业务错误不算
+    void on_send(const std::string& addr);
+    void on_finish(const std::string& addr, int64_t latency_us, bool failed,
+            int64_t now_us);
+    void on_finish(const std::string& addr, int64_t latency_us, bool failed) {
+        on_finish(addr, latency_us, failed, butil::gettimeofday_us());
+    }
+
+    // 表级读延迟，用于对冲请求的触发时间；样本不足返回-1
+    void record_table_latency(int64_t table_id, int64_t latency_us);
+    int64_t table_latency_percentile(int64_t table_id, double ratio);
+
+    // 以下供观测和测试
+    int64_t ewma_latency(const std::string& addr, int64_t now_us);
+    bool is_ejected(const std::string& addr, int64_t now_us);
+
+private:
+    struct PeerStat {
+        std::mutex mutex;
+        double ewma_us = 0;
+        int64_t update_us = 0;
+        int64_t inflight = 0;
+        int fail_count = 0;
+        int eject_times = 0;
+        int64_t eject_until_us = 0;
+    };
+    typedef std::shared_ptr<PeerStat> SmartPeerStat;
+
+    SmartPeerStat get_stat(const std::string& addr);
+    // 以下调用方持有stat->mutex
+    double decayed_ewma(const PeerStat& stat, int64_t now_us) const;
+    // 摘除中或恢复期内本次未被放行返回false
+    bool available(const PeerStat& stat, int64_t now_us) const;
+    void eject(PeerStat& stat, const std::string& addr, int64_t now_us);
+
+    std::mutex _map_mutex;
+    std::unordered_map<std::string, SmartPeerStat> _peer_stats;
+    std::unordered_map<int64_t, std::shared_ptr<bvar::LatencyRecorder>> _table_latency;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,106 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "proto/meta.interface.pb.h"
+
+namespace baikaldb {
+// region信息创建后不再修改，更新leader等都是拷贝一份新的，可以放心跨线程持有
+typedef std::shared_ptr<const pb::RegionInfo> SmartRegionInfo;
+
+// 有序start_key的扁平数组，前缀压缩，每RESTART_INTERVAL个key存一个完整key，
+// 二分restart点后在块内顺序解码
+class StartKeyIndex {
+public:
+    static const size_t RESTART_INTERVAL = 16;
+
+    explicit StartKeyIndex(const std::vector<SmartRegionInfo>& regions);
+    // 第一个start_key > key的下标
+    size_t upper_bound(const std::string& key) const;
+    size_t size() const {
+        return _count;
+    }
+    size_t bytes() const {
+        return _data.size() + _restarts.size() * sizeof(uint32_t);
+    }
+
+private:
+    // 解析一条记录，cur为上一个key，返回下一条记录的偏移
+    size_t decode_entry(size_t offset, std::string* cur) const;
+
+    std::string _data;
+    std::vector<uint32_t> _restarts;
+    size_t _count = 0;
+};
+
+// 一个索引的路由快照，不可修改；读者拿到shared_ptr后不受后续更新影响
+// 任何region范围变化都重建快照，只有leader变化时复用key索引和其他region
+class RegionRouter {
+public:
+    // regions需按start_key有序
+    RegionRouter(int64_t version, std::vector<SmartRegionInfo> regions);
+
+    int64_t version() const {
+        return _version;
+    }
+    size_t size() const {
+        return _regions.size();
+    }
+    const SmartRegionInfo& region(size_t idx) const {
+        return _regions[idx];
+    }
+    const std::vector<SmartRegionInfo>& regions() const {
+        return _regions;
+    }
+    size_t upper_bound(const std::string& key) const {
+        return _key_index->upper_bound(key);
+    }
+    // 包含key的region，没有时返回nullptr
+    SmartRegionInfo find(const std::string& key) const {
+        size_t idx = upper_bound(key);
+        if (idx == 0) {
+            return nullptr;
+        }
+        return _regions[idx - 1];
+    }
+    SmartRegionInfo get_region(int64_t region_id) const {
+        auto iter = _id_index->find(region_id);
+        if (iter == _id_index->end()) {
+            return nullptr;
+        }
+        return _regions[iter->second];
+    }
+    // 写时复制替换start_key不变的region(如leader变化)，复用key索引，
+    // 返回nullptr表示region不存在或范围变了，需要重建
+    std::shared_ptr<const RegionRouter> replace_region(int64_t version,
+            const SmartRegionInfo& region) const;
+
+private:
+    RegionRouter() {}
+
+    int64_t _version = 0;
+    std::vector<SmartRegionInfo> _regions;
+    std::shared_ptr<const StartKeyIndex> _key_index;
+    std::shared_ptr<const std::unordered_map<int64_t, size_t>> _id_index;
+};
+typedef std::shared_ptr<const RegionRouter> SmartRegionRouter;
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
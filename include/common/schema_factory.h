@@ -26,6 +26,10 @@
 #include <bthread/execution_queue.h>
 #include "common.h"
 #include "expr_value.h"
+#include "statistics.h"
+#include "region_router.h"
+#include "table_partition.h"
+#include "compact_row.h"
 #include "proto/meta.interface.pb.h"
 #include "proto/plan.pb.h"
 
@@ -46,43 +50,72 @@ class TableRecord;
 typedef std::shared_ptr<TableRecord> SmartRecord;
 typedef std::map<std::string, int64_t> StrInt64Map;
 
-struct RegionInfo {
-    pb::RegionInfo region_info;
-    RegionInfo() {}
-    // update leader for all thread
-    explicit RegionInfo(const RegionInfo& other) {
-        region_info = other.region_info;
-    }
-};
 struct TableRegionInfo {
-    // region_id => RegionInfo
-    std::unordered_map<int64_t, RegionInfo> region_info_mapping;
+    // region_id => RegionInfo，与router共享，更新时整体替换不原地修改
+    std::unordered_map<int64_t, SmartRegionInfo> region_info_mapping;
     // partion vector of (start_key => regionid)
     std::vector<StrInt64Map> key_region_mapping;
+    // 读路径用的路由快照，每个分区一个，下标为partition_id，写完后重建
+    std::vector<SmartRegionRouter> routers;
+    int64_t router_version = 0;
+
     void update_leader(int64_t region_id, const std::string& leader) {
-        if (region_info_mapping.count(region_id) == 1) {
-            region_info_mapping[region_id].region_info.set_leader(leader);
+        auto iter = region_info_mapping.find(region_id);
+        if (iter != region_info_mapping.end()) {
+            std::shared_ptr<pb::RegionInfo> region(new pb::RegionInfo(*iter->second));
+            region->set_leader(leader);
+            iter->second = region;
+            // leader变化不影响范围，复用key索引
+            size_t partition_id = region->partition_id();
+            SmartRegionRouter new_router;
+            if (partition_id < routers.size() && routers[partition_id] != nullptr) {
+                new_router = routers[partition_id]->replace_region(router_version + 1, region);
+            }
+            if (new_router != nullptr) {
+                ++router_version;
+                routers[partition_id] = new_router;
+            } else {
+                rebuild_router();
+            }
             DB_NOTICE("double_buffer_write region_id[%ld] set_leader[%s]", 
                 region_id, leader.c_str());
         }
     }
     int get_region_info(int64_t region_id, pb::RegionInfo& info) {
-        if (region_info_mapping.count(region_id) == 1) {
-            info = region_info_mapping[region_id].region_info;
+        auto iter = region_info_mapping.find(region_id);
+        if (iter != region_info_mapping.end()) {
+            info = *iter->second;
             return 0;
         } else {
             return -1;
         }
     }
     void insert_region_info(const pb::RegionInfo& info) {
-        if (region_info_mapping.count(info.region_id()) == 1) {
-            region_info_mapping[info.region_id()].region_info = info;
-        } else {
-            region_info_mapping[info.region_id()].region_info = info;
-        }
+        region_info_mapping[info.region_id()].reset(new pb::RegionInfo(info));
         DB_NOTICE("double_buffer_write region_id[%ld] region_info[%s]", 
             info.region_id(), info.ShortDebugString().c_str());
     }
+    StrInt64Map& partition_key_region(int64_t partition_id) {
+        if ((int64_t)key_region_mapping.size() <= partition_id) {
+            key_region_mapping.resize(partition_id + 1);
+        }
+        return key_region_mapping[partition_id];
+    }
+    void rebuild_router() {
+        ++router_version;
+        routers.resize(key_region_mapping.size());
+        for (size_t partition_id = 0; partition_id < key_region_mapping.size(); ++partition_id) {
+            std::vector<SmartRegionInfo> regions;
+            regions.reserve(key_region_mapping[partition_id].size());
+            for (auto& pair : key_region_mapping[partition_id]) {
+                auto iter = region_info_mapping.find(pair.second);
+                if (iter != region_info_mapping.end()) {
+                    regions.push_back(iter->second);
+                }
+            }
+            routers[partition_id].reset(new RegionRouter(router_version, std::move(regions)));
+        }
+    }
 };
 typedef std::shared_ptr<TableRegionInfo> TableRegionPtr;
 using DoubleBufferedTableRegionInfo = butil::DoublyBufferedData<std::unordered_map<int64_t, TableRegionPtr>>;
@@ -166,6 +199,15 @@ struct TableInfo {
     std::string             fields_sign;
     //>0表示配置有ttl，单位s
     int64_t                 ttl_duration = 0;
+    //analyze table生成的统计信息，没有analyze时为空
+    SmartStatistics         statistics;
+    //partition_num > 1时的分区规则，否则为空
+    SmartPartition          partition;
+    //表数据存放在独立的column family
+    bool                    has_cf_conf = false;
+    pb::ColumnFamilyConf    cf_conf;
+    //紧凑行格式的layout历史，key为开始使用的schema版本
+    std::map<int64_t, SmartRowLayout> row_layouts;
 
     const Descriptor*       tbl_desc;
     DescriptorProto*        tbl_proto = nullptr;
@@ -175,6 +217,17 @@ struct TableInfo {
     const Message*          msg_proto = nullptr;
     
     TableInfo() {}
+    // 写入时schema为schema_version的行的layout，没有记录layout或还没收到该版本时返回nullptr
+    SmartRowLayout get_row_layout(int64_t schema_version) const {
+        if (schema_version > version) {
+            return nullptr;
+        }
+        auto iter = row_layouts.upper_bound(schema_version);
+        if (iter == row_layouts.begin()) {
+            return nullptr;
+        }
+        return (--iter)->second;
+    }
     FieldInfo* get_field_ptr(int32_t field_id) {
         for (auto& info : fields) {
             if (info.id == field_id) {
@@ -306,8 +359,10 @@ public:
     void get_clear_regions(const std::string& new_start_key, 
                            const std::string& origin_start_key,
                            TableRegionPtr background,
+                           int64_t partition_id,
                            std::map<std::string, int64_t>& clear_regions);
     void clear_region(TableRegionPtr background, 
+                      int64_t partition_id,
                       std::map<std::string, int64_t>& clear_regions);
     void update_region(TableRegionPtr background, 
                                      const pb::RegionInfo& region);
@@ -373,13 +428,29 @@ public:
     int get_region_capacity(int64_t global_index_id, int64_t& region_capacity);
     bool get_merge_switch(int64_t table_id);
     bool get_separate_switch(int64_t table_id);
+    bool get_write_combine_switch(int64_t table_id);
     int64_t get_ttl_duration(int64_t table_id);
+    //表没有配置独立column family时返回false
+    bool get_cf_conf(int64_t table_id, pb::ColumnFamilyConf* cf_conf);
     
     int get_region_by_key(int64_t main_table_id, 
             IndexInfo& index,
             const pb::PossibleIndex* primary,
             std::map<int64_t, pb::RegionInfo>& region_infos,
             std::map<int64_t, pb::PossibleIndex>* region_primary = nullptr);
+    // 不拷贝region，直接返回路由快照中的共享对象，只读的调用方优先用这个
+    int get_region_by_key(int64_t main_table_id, 
+            IndexInfo& index,
+            const pb::PossibleIndex* primary,
+            std::map<int64_t, SmartRegionInfo>& region_infos,
+            std::map<int64_t, pb::PossibleIndex>* region_primary = nullptr);
+    // 索引当前每个分区的路由快照，下标为partition_id
+    int get_region_routers(int64_t index_id, std::vector<SmartRegionRouter>& routers);
+    // 分区表的分区规则，非分区表返回nullptr
+    SmartPartition get_table_partition(int64_t table_id);
+    // 按索引的range计算涉及的分区，非分区表返回-1
+    int get_partition_ids(IndexInfo& index, const pb::PossibleIndex& pos_index,
+            std::set<int64_t>& partition_ids);
     // only used for pk (not null)
     int get_region_by_key(IndexInfo& index, 
             const pb::PossibleIndex* primary,
@@ -500,6 +571,13 @@ public:
     }
 
 private:
+    int route_records(IndexInfo& index,
+            const std::vector<SmartRegionRouter>& routers,
+            const SmartPartition& partition,
+            const std::vector<SmartRecord>& records,
+            std::map<int64_t, std::vector<SmartRecord>>& region_ids,
+            std::map<int64_t, pb::RegionInfo>& region_infos);
+
     SchemaFactory() {
         _is_init = false;
         bthread_mutex_init(&_update_user_mutex, NULL);
@@ -0,0 +1,150 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <bvar/bvar.h>
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_bool(statement_stats_enable);
+DECLARE_int32(statement_stats_show_limit);
+
+// 对数分桶的延迟直方图，每个2的幂区间再分4个子桶，分位数误差不超过25%
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 2;
+    static const int BUCKET_NUM = 64 << SUB_BITS;
+
+    LatencyHistogram() {
+        memset(_buckets, 0, sizeof(_buckets));
+    }
+    void add(int64_t value) {
+        ++_buckets[bucket_index(value)];
+        ++_count;
+    }
+    int64_t count() const {
+        return _count;
+    }
+    // 返回rank所在桶的上界
+    int64_t percentile(double ratio) const;
+
+    static int bucket_index(int64_t value);
+    static int64_t bucket_upper(int index);
+
+private:
+    uint32_t _buckets[BUCKET_NUM];
+    int64_t _count = 0;
+};
+
+// 单条sql执行结束后的采样
+struct StatementSample {
+    int64_t latency_us = 0;
+    // 与store交互的耗时
+    int64_t store_us = 0;
+    int64_t rows_returned = 0;
+    int64_t rows_affected = 0;
+    int64_t rows_examined = 0;
+    bool    error = false;
+};
+
+// 一个digest的累计统计，用于展示
+struct StatementDigestInfo {
+    uint64_t    sign = 0;
+    std::string digest;
+    std::string family;
+    std::string table;
+    int         op_type = 0;
+    int64_t     count = 0;
+    int64_t     errors = 0;
+    int64_t     sum_latency_us = 0;
+    int64_t     max_latency_us = 0;
+    int64_t     p50_latency_us = 0;
+    int64_t     p99_latency_us = 0;
+    int64_t     sum_store_us = 0;
+    int64_t     rows_returned = 0;
+    int64_t     rows_affected = 0;
+    int64_t     rows_examined = 0;
+    int64_t     first_seen_us = 0;
+    int64_t     last_seen_us = 0;
+};
+
+// 按语句指纹聚合的sql统计
+// 指纹是去掉常量后的语法树文本(print_sample)，在planner里生成一次；
+// 按sign分片加锁，每片容量固定，满了淘汰最久没有执行的digest
+class StatementStats {
+public:
+    static StatementStats* get_instance() {
+        static StatementStats _instance("statement_stats");
+        return &_instance;
+    }
+    // bvar_name非空时以该名字暴露到/vars页面
+    explicit StatementStats(const std::string& bvar_name = "");
+
+    static uint64_t sign(const std::string& digest);
+
+    void record(uint64_t sign, const std::string& digest, const std::string& family,
+            const std::string& table, int op_type, const StatementSample& sample,
+            int64_t now_us);
+    void record(uint64_t sign, const std::string& digest, const std::string& family,
+            const std::string& table, int op_type, const StatementSample& sample) {
+        record(sign, digest, family, table, op_type, sample, butil::gettimeofday_us());
+    }
+
+    // 按总耗时降序取前limit个，limit<=0不限制
+    void list(std::vector<StatementDigestInfo>* infos, int limit);
+    // 文本格式，用于bvar页面
+    std::string dump(int limit);
+    void clear();
+    size_t size();
+
+private:
+    static const int SHARD_NUM = 16;
+    struct DigestStat {
+        std::string digest;
+        std::string family;
+        std::string table;
+        int op_type = 0;
+        int64_t errors = 0;
+        int64_t sum_latency_us = 0;
+        int64_t max_latency_us = 0;
+        int64_t sum_store_us = 0;
+        int64_t rows_returned = 0;
+        int64_t rows_affected = 0;
+        int64_t rows_examined = 0;
+        int64_t first_seen_us = 0;
+        int64_t last_seen_us = 0;
+        LatencyHistogram latency;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::unique_ptr<DigestStat>> stats;
+    };
+    // 调用方持有shard.mutex
+    void evict_oldest(Shard& shard);
+    static std::string dump_status(void* arg);
+
+    Shard _shards[SHARD_NUM];
+    bvar::PassiveStatus<std::string> _dump_status;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,97 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <queue>
+#include <unordered_map>
+#include "common.h"
+#include "proto/common.pb.h"
+
+namespace baikaldb {
+DECLARE_int32(statistics_bucket_num);
+DECLARE_int32(statistics_mcv_num);
+
+// store端按索引key顺序扫描一个region的索引, 构建该region的统计信息
+// key: 去掉region_id和index_id前缀的完整索引key(二级索引包含主键部分)
+// value_key: key中只包含索引字段的部分, 相同的value_key在有序扫描中一定连续
+class IndexStatisticsBuilder {
+public:
+    IndexStatisticsBuilder(int64_t index_id, int64_t estimate_rows,
+            int bucket_num = FLAGS_statistics_bucket_num,
+            int mcv_num = FLAGS_statistics_mcv_num);
+
+    void add(const std::string& key, const std::string& value_key);
+    void finish(pb::IndexStatistics* statistics);
+
+private:
+    void finish_value();
+    typedef std::pair<int64_t, std::string> CountValue;
+    struct CountValueCompare {
+        bool operator()(const CountValue& l, const CountValue& r) const {
+            return l.first > r.first;
+        }
+    };
+
+    int64_t _index_id;
+    int64_t _bucket_depth;
+    size_t _mcv_num;
+    int64_t _row_count = 0;
+    std::string _hll;
+    pb::HistogramBucket* _cur_bucket = nullptr;
+    pb::IndexStatistics _statistics;
+    std::string _last_value;
+    int64_t _last_value_count = 0;
+    // 小顶堆, 保留出现次数最多的_mcv_num个值
+    std::priority_queue<CountValue, std::vector<CountValue>, CountValueCompare> _mcv_heap;
+};
+
+// baikaldb端合并各region的统计信息
+extern void merge_index_statistics(const std::vector<const pb::IndexStatistics*>& region_statistics,
+        pb::IndexStatistics* statistics,
+        int bucket_num = FLAGS_statistics_bucket_num,
+        int mcv_num = FLAGS_statistics_mcv_num);
+
+// 表的统计信息, 随schema下发到baikaldb, 只读
+// 版本独立于schema版本, baikaldb心跳上报版本, meta据此下发更新
+class TableStatistics {
+public:
+    explicit TableStatistics(const pb::TableStatistics& statistics);
+
+    int64_t version() const {
+        return _version;
+    }
+
+    const pb::IndexStatistics* get_index_statistics(int64_t index_id) const {
+        auto iter = _index_statistics.find(index_id);
+        if (iter == _index_statistics.end()) {
+            return nullptr;
+        }
+        return &iter->second;
+    }
+    // 估算索引key在[left, right]范围内的行数, left/right为前缀, 为空表示无边界
+    static int64_t estimate_range_rows(const pb::IndexStatistics& statistics,
+            const std::string& left, const std::string& right);
+    // 估算索引所有字段等值匹配value_key的行数
+    static int64_t estimate_eq_rows(const pb::IndexStatistics& statistics,
+            const std::string& value_key);
+
+private:
+    int64_t _version = 0;
+    std::unordered_map<int64_t, pb::IndexStatistics> _index_statistics;
+};
+typedef std::shared_ptr<TableStatistics> SmartStatistics;
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
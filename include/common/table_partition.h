@@ -0,0 +1,61 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "expr_value.h"
+#include "proto/meta.interface.pb.h"
+
+namespace baikaldb {
+// 分区表的分区规则，每个分区有独立的region集合，构造后只读
+// HASH: 分区列的整数值取模，与老的partition_num按主键取模一致
+// RANGE: 按分区上界二分，上界不含
+class TablePartition {
+public:
+    // field_type为分区列类型，只支持整数和时间类型
+    int init(const pb::PartitionInfo& info, int64_t partition_num,
+            pb::PrimitiveType field_type);
+
+    pb::PartitionType type() const {
+        return _type;
+    }
+    int32_t field_id() const {
+        return _field_id;
+    }
+    int64_t partition_num() const {
+        return _partition_num;
+    }
+    // 值所在的分区，-1表示超出RANGE分区的最大上界
+    int64_t get_partition_id(const ExprValue& value) const;
+    // 分区列取值在[left, right]内时涉及的分区，null表示该侧无界
+    // HASH分区只有left == right时能裁剪
+    void get_partition_ids(const ExprValue& left, const ExprValue& right,
+            std::vector<int64_t>& partition_ids) const;
+
+private:
+    ExprValue to_field_type(const ExprValue& value) const;
+
+    pb::PartitionType _type = pb::PT_HASH;
+    int32_t _field_id = 0;
+    pb::PrimitiveType _field_type = pb::INT64;
+    int64_t _partition_num = 1;
+    std::vector<ExprValue> _range_bounds;
+};
+typedef std::shared_ptr<const TablePartition> SmartPartition;
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
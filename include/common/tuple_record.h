@@ -17,6 +17,7 @@
 #include "common.h"
 #include "table_record.h"
 #include "schema_factory.h"
+#include "compact_row.h"
 #include "rocksdb/slice.h"
 
 namespace baikaldb {
@@ -76,6 +77,9 @@ public:
     // decode 'required' (rather than 'all') fields from serialized protobuf bytes
     // and fill to SmartRecord, if null, fill default_value
     int decode_fields(const std::map<int32_t, FieldInfo*>& fields, SmartRecord record) {
+        if (CompactRowCodec::is_compact(_data, _size)) {
+            return decode_compact_fields(fields, record);
+        }
         uint64_t field_key  = 0;
         uint64_t field_num  = 0;
         int32_t  wired_type = 0;
@@ -206,6 +210,39 @@ public:
         }
         return 0;
     }
+
+    // 紧凑格式按layout直接定位需要的字段；null和layout中没有的字段(后加的列)
+    // 与pb格式一样填默认值
+    int decode_compact_fields(const std::map<int32_t, FieldInfo*>& fields, SmartRecord record) {
+        if (fields.empty()) {
+            return 0;
+        }
+        // layout按写入时的schema版本从表信息中取
+        int64_t table_id = fields.begin()->second->table_id;
+        CompactRowReader reader;
+        if (reader.init(table_id, _data, _size) != 0) {
+            DB_WARNING("invalid compact row, size: %lu", _size);
+            return -1;
+        }
+        Message* message = record->get_raw_message();
+        for (auto& pair : fields) {
+            auto field = record->get_field_by_tag(pair.first);
+            if (field == nullptr) {
+                DB_FATAL("invalid field: %d", pair.first);
+                return -1;
+            }
+            int slot = reader.layout().find(pair.first);
+            if (slot < 0 || reader.is_null(slot)) {
+                record->set_value(field, pair.second->default_expr_value);
+                continue;
+            }
+            if (reader.read_field(slot, field, message) != 0) {
+                DB_WARNING("decode compact field failed: %d", pair.first);
+                return -1;
+            }
+        }
+        return 0;
+    }
 private:
     const char*   _data;
     size_t  _size;
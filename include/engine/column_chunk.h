@@ -0,0 +1,131 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "expr_value.h"
+#include "mut_table_key.h"
+
+namespace baikaldb {
+DECLARE_bool(cstore_use_chunk);
+DECLARE_int32(cstore_chunk_rows);
+
+// cstore列存chunk
+// 单元格(主键+列)仍是权威数据，作为最近写入的delta；后台把没有写入的连续主键区间
+// 整理成chunk，每列一个kv，扫描时整块解码；区间内任何写入都会在同一事务中删除覆盖它的chunk
+// key: region_id(8) + table_id(4) + slot(4) + 区间第一个纯主键
+// slot = -1 - field_id，主键列记field_id为0；单元格key的field_id为正数，两者不冲突
+enum ChunkValueKind {
+    CHUNK_KIND_INT      = 0,    // 整数、bool、时间类型统一按int64存
+    CHUNK_KIND_DOUBLE   = 1,
+    CHUNK_KIND_STRING   = 2
+};
+
+enum ChunkEncoding {
+    CHUNK_ENC_PLAIN         = 0,
+    CHUNK_ENC_RLE           = 1,
+    CHUNK_ENC_DELTA_BITPACK = 2,    // 首值 + zigzag差值按固定位宽打包
+    CHUNK_ENC_DICT          = 3     // 字典 + 下标按固定位宽打包
+};
+
+// 一列解码后的值，null位置的值为0或空串
+struct ColumnChunk {
+    ChunkValueKind kind = CHUNK_KIND_INT;
+    size_t row_count = 0;
+    std::vector<uint8_t> nulls;     // 全部非null时为空
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    std::vector<std::string> strings;
+
+    bool is_null(size_t idx) const {
+        return !nulls.empty() && nulls[idx] != 0;
+    }
+    void clear() {
+        row_count = 0;
+        nulls.clear();
+        ints.clear();
+        doubles.clear();
+        strings.clear();
+    }
+};
+
+// 一列在一个chunk内的min/max/null数，存在主键chunk头部，扫描时不解码列就能跳过整个chunk
+struct ColumnZoneMap {
+    int32_t field_id = 0;
+    ChunkValueKind kind = CHUNK_KIND_INT;
+    uint32_t row_count = 0;
+    uint32_t null_count = 0;
+    bool has_min_max = false;   // 全null或字符串过长时没有
+    int64_t min_int = 0;
+    int64_t max_int = 0;
+    double min_double = 0;
+    double max_double = 0;
+    std::string min_str;
+    std::string max_str;
+};
+
+enum ZoneOp {
+    ZONE_EQ         = 0,
+    ZONE_LT         = 1,
+    ZONE_LE         = 2,
+    ZONE_GT         = 3,
+    ZONE_GE         = 4,
+    ZONE_IN         = 5,
+    ZONE_IS_NULL    = 6
+};
+
+// 可以用zone map判断的单列条件: field op 常量
+struct ZonePredicate {
+    int32_t field_id = 0;
+    pb::PrimitiveType field_type = pb::NULL_TYPE;
+    ZoneOp op = ZONE_EQ;
+    std::vector<ExprValue> values;  // 已转成字段类型，ZONE_IS_NULL时为空
+};
+
+class ColumnChunkCodec {
+public:
+    static void encode(const ColumnChunk& chunk, std::string* out);
+    static int decode(const char* data, size_t size, ColumnChunk* chunk);
+
+    // 主键chunk：前缀压缩的纯主键列表，头部单独存最后一个主键和各列zone map，
+    // 判断覆盖范围和能否跳过时不用整块解码
+    static void encode_keys(const std::vector<std::string>& keys,
+            const std::vector<ColumnZoneMap>& zone_maps, std::string* out);
+    static int decode_keys(const char* data, size_t size, std::vector<std::string>* keys);
+    static int decode_last_key(const char* data, size_t size, std::string* last_key);
+    static int decode_zone_maps(const char* data, size_t size, std::vector<ColumnZoneMap>* zone_maps);
+
+    static void build_zone_map(const ColumnChunk& chunk, int32_t field_id, ColumnZoneMap* zone_map);
+    // 返回false表示chunk内没有行能满足条件
+    static bool may_match(const ColumnZoneMap& zone_map, const ZonePredicate& pred);
+    // 条件常量能否无损转换成字段类型，不能时不参与zone map过滤
+    static bool convert_zone_value(const ExprValue& literal, pb::PrimitiveType field_type,
+            ExprValue* value);
+
+    static ChunkValueKind value_kind(pb::PrimitiveType type);
+    static void append_value(const ExprValue& value, ColumnChunk* chunk);
+    static ExprValue get_value(const ColumnChunk& chunk, size_t idx, pb::PrimitiveType type);
+
+    static MutTableKey chunk_prefix(int64_t region_id, int64_t table_id, int32_t field_id) {
+        MutTableKey key;
+        key.append_i64(region_id).append_i32(table_id).append_i32(-1 - field_id);
+        return key;
+    }
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
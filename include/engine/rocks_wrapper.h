@@ -15,14 +15,17 @@
 #pragma once
  
 #include <string>
+#include <mutex>
 #include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/options.h"
 #include "rocksdb/slice_transform.h"
+#include "rocksdb/table.h"
 #include "rocksdb/utilities/transaction.h"
 #include "rocksdb/utilities/transaction_db.h"
 #include "common.h"
+#include "proto/meta.interface.pb.h"
 //#include "proto/store.interface.pb.h"
 
 namespace baikaldb {
@@ -39,11 +42,20 @@ enum GetMode {
     GET_LOCK
 };
 
+struct ColumnFamilyMapping {
+    std::map<std::string, rocksdb::ColumnFamilyHandle*> column_families;
+    // table_id => 表独立的cf
+    std::map<int64_t, rocksdb::ColumnFamilyHandle*> table_cfs;
+};
+using DoubleBufferedColumnFamily = butil::DoublyBufferedData<ColumnFamilyMapping>;
+
 class RocksWrapper {
 public:
     static const std::string RAFT_LOG_CF;
     static const std::string DATA_CF;
     static const std::string METAINFO_CF;
+    // 表独立的column family: TABLE_CF_PREFIX + table_id
+    static const std::string TABLE_CF_PREFIX;
 
     virtual ~RocksWrapper() {}
     static RocksWrapper* get_instance() {
@@ -120,10 +132,11 @@ public:
     }
 
     rocksdb::Iterator* new_iterator(const rocksdb::ReadOptions& options, const std::string cf) {
-        if (_column_families.count(cf) == 0) {
+        rocksdb::ColumnFamilyHandle* handle = get_column_family(cf);
+        if (handle == nullptr) {
             return nullptr;
         }
-        return _txn_db->NewIterator(options, _column_families[cf]);
+        return _txn_db->NewIterator(options, handle);
     }
     rocksdb::Status ingest_external_file(rocksdb::ColumnFamilyHandle* family,
             const std::vector<std::string>& external_files,
@@ -134,6 +147,10 @@ public:
     rocksdb::ColumnFamilyHandle* get_raft_log_handle();
 
     rocksdb::ColumnFamilyHandle* get_data_handle();
+    // 表配置了独立column family时返回该cf，否则返回公共data cf
+    rocksdb::ColumnFamilyHandle* get_data_handle(int64_t table_id);
+    // 全局索引region的数据和主表放在同一个cf
+    rocksdb::ColumnFamilyHandle* get_data_handle(const pb::RegionInfo& region_info);
 
     rocksdb::ColumnFamilyHandle* get_meta_info_handle();
 
@@ -142,7 +159,16 @@ public:
     }
 
     int32_t create_column_family(std::string cf_name);
+    int32_t create_column_family(std::string cf_name, const rocksdb::ColumnFamilyOptions& cf_option);
     int32_t delete_column_family(std::string cf_name);
+    // 已存在时返回0；配置持久化在meta cf，重启时按配置打开
+    int32_t create_table_column_family(int64_t table_id, const pb::ColumnFamilyConf& cf_conf);
+    // drop后cf的sst整体删除，不需要逐行删除和compaction
+    int32_t drop_table_column_family(int64_t table_id);
+    void get_table_cf_ids(std::vector<int64_t>* table_ids);
+    static std::string table_cf_name(int64_t table_id) {
+        return TABLE_CF_PREFIX + std::to_string(table_id);
+    }
 
     rocksdb::Options get_options(rocksdb::ColumnFamilyHandle* family) {
         return _txn_db->GetOptions(family);
@@ -152,33 +178,60 @@ public:
         return _txn_db->GetDBOptions();
     }
 
+    // data cf的block cache
     rocksdb::Cache* get_cache() {
         return _cache;
     }
+    rocksdb::Cache* get_raft_log_cache() {
+        return _raft_log_cache;
+    }
+    // 没有开启row cache时为nullptr
+    rocksdb::Cache* get_row_cache() {
+        return _row_cache;
+    }
     const rocksdb::Snapshot* get_snapshot() {
         return _txn_db->GetSnapshot();
     }
     void relase_snapshot(const rocksdb::Snapshot* snapshot) {
         _txn_db->ReleaseSnapshot(snapshot);
     }
-    void close() {
-        delete _txn_db;
-    }
+    // 关闭后可以重新init
+    void close();
 private:
 
     RocksWrapper();
+    void expose_cache_bvars(rocksdb::Statistics* statistics);
+    rocksdb::ColumnFamilyOptions table_cf_option(const pb::ColumnFamilyConf& cf_conf);
+    rocksdb::ColumnFamilyHandle* get_column_family(const std::string& cf_name);
+    void add_column_family(rocksdb::ColumnFamilyHandle* handle);
+    void remove_column_family(const std::string& cf_name);
+    // db打开前以只读方式读meta cf中的表cf配置
+    int32_t load_table_cf_confs(const rocksdb::DBOptions& db_options, const std::string& path,
+            std::map<int64_t, pb::ColumnFamilyConf>* cf_confs);
 
     std::string _db_path;
 
     bool _is_init;
 
     rocksdb::TransactionDB* _txn_db;
-    rocksdb::Cache*         _cache;
-
-    std::map<std::string, rocksdb::ColumnFamilyHandle*> _column_families;
+    rocksdb::Cache*         _cache = nullptr;
+    rocksdb::Cache*         _raft_log_cache = nullptr;
+    rocksdb::Cache*         _row_cache = nullptr;
+
+    // 读路径每次都要按表找cf，用双buffer避免加锁
+    DoubleBufferedColumnFamily _column_families;
+    // raft log/data/meta cf打开后不会删除，直接保存
+    rocksdb::ColumnFamilyHandle* _raft_log_cf = nullptr;
+    rocksdb::ColumnFamilyHandle* _data_cf = nullptr;
+    rocksdb::ColumnFamilyHandle* _meta_info_cf = nullptr;
+    // 串行化cf的创建和删除，同时保护_dropped_cfs
+    std::mutex _cf_mutex;
+    // drop后handle可能还被事务和迭代器持有，close时再释放
+    std::vector<rocksdb::ColumnFamilyHandle*> _dropped_cfs;
 
     rocksdb::ColumnFamilyOptions _log_cf_option;
     rocksdb::ColumnFamilyOptions _data_cf_option;
     rocksdb::ColumnFamilyOptions _meta_info_option;
+    rocksdb::BlockBasedTableOptions _data_table_options;
 };
 }
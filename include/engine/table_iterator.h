@@ -17,6 +17,7 @@
 #include "rocks_wrapper.h"
 #include "schema_factory.h"
 #include "mut_table_key.h"
+#include "column_chunk.h"
 #include "table_record.h"
 #include "item_batch.hpp"
 
@@ -108,6 +109,8 @@ public:
             delete iter;
             iter = nullptr;
         }
+        delete _chunk_iter;
+        _chunk_iter = nullptr;
     }
 
     virtual int open(const IndexRange& range, std::map<int32_t, FieldInfo*>& fields, 
@@ -124,13 +127,16 @@ public:
         const IndexRange&       range, 
         std::map<int32_t, FieldInfo*>&   fields, 
         bool                    check_region, 
-        bool                    forward);
+        bool                    forward,
+        bool                    fill_cache = true);
 
+    // fill_cache=false时读到的block不放入block cache，用于大范围扫描
     static IndexIterator* scan_secondary(
         SmartTransaction    txn,
         const IndexRange&   range, 
         bool                check_region, 
-        bool                forward);
+        bool                forward,
+        bool                fill_cache = true);
 
 protected:
     MutTableKey             _start;
@@ -163,22 +169,34 @@ protected:
     rocksdb::Transaction*   _txn = nullptr;
     bool                    _need_check_region;
     bool                    _forward;
+    bool                    _fill_cache = true;
     rocksdb::ColumnFamilyHandle* _data_cf;
     std::map<int32_t, FieldInfo*>    _fields;
 
     std::vector<rocksdb::Iterator*>     _column_iters; // cstore, own it, should delete when destruct
     std::vector<FieldInfo*>             _non_pk_fields; // cstore
 
+    // cstore column chunk, 只用于正向扫主键
+    rocksdb::Iterator*          _chunk_iter = nullptr;
+    rocksdb::ReadOptions        _chunk_read_options;
+    MutTableKey                 _chunk_prefix;
+    std::vector<std::string>    _chunk_keys;
+    std::vector<ColumnChunk>    _chunks;    // 和_non_pk_fields一一对应
+    size_t                      _chunk_pos = 0;
+
     int _prefix_len = sizeof(int64_t) * 2;
 
     bool _fits_left_bound();
 
     bool _fits_right_bound();
+    bool _fits_right_bound(const rocksdb::Slice& key);
 
     bool _fits_region();
 
     bool _fits_prefix(rocksdb::Iterator* iter, int32_t field_id = 0); // cstore
     bool is_cstore();
+    int open_chunk(const rocksdb::ReadOptions& read_options);
+    void seek_columns();
 };
 
 class TableIterator : public Iterator {
@@ -193,13 +211,29 @@ public:
     // _iter is used to fit_bound and set pk field value,
     // _column_iters is only used for set non-pk field value
     int get_next_columns(SmartRecord record);
+    // 当前主键落在column chunk内时从解码后的chunk取值，返回1表示需要走单元格
+    int get_next_from_chunk(SmartRecord record);
 
     void set_mode(KVMode mode) {
         _mode = mode;
     }
 
+    // cstore chunk的zone map不满足任一条件时整个chunk跳过
+    void set_zone_predicates(const std::vector<ZonePredicate>& zone_predicates) {
+        _zone_predicates = zone_predicates;
+    }
+
+    int64_t skipped_chunks() const {
+        return _skipped_chunks;
+    }
+
 private:
+    bool chunk_may_match(const rocksdb::Slice& value);
+    void skip_chunk(const std::string& last_key);
+
     KVMode  _mode;
+    std::vector<ZonePredicate> _zone_predicates;
+    int64_t _skipped_chunks = 0;
 };
 
 class IndexIterator : public Iterator {
@@ -66,6 +66,7 @@ public:
         if (!_is_finished) {
             rollback();
         }
+        leave_chunk_write();
         if (_db != nullptr && _snapshot != nullptr) {
             _db->relase_snapshot(_snapshot);
         }
@@ -186,10 +187,16 @@ public:
     rocksdb::Status put_kv_without_lock(const std::string& key, const std::string& value, int64_t ttl_timestamp_us);
     int put_kv(const std::string& key, const std::string& value);
     int delete_kv(const std::string& key);
+    // DeleteRange直接追加到事务的WriteBatch，随commit和其他写入原子生效；
+    // 事务内的读看不到，调用后只能再写meta然后提交
+    int remove_range(const std::string& begin, const std::string& end);
     
     int remove(int64_t region, IndexInfo& index, const SmartRecord key);
     int remove(int64_t region, IndexInfo& index, const TableKey&   key);
     int remove_columns(const TableKey& primary_key);
+    // cstore主键写入或删除时，删除覆盖该主键的column chunk
+    int remove_column_chunk(const TableKey& primary_key);
+    void leave_chunk_write();
 
     rocksdb::Transaction* get_txn() {
         return _txn;
@@ -250,14 +257,20 @@ public:
             DB_WARNING("no region_info");
             return;
         }
+        // 表有独立column family时写到该cf
+        if (_db != nullptr) {
+            _data_cf = _db->get_data_handle(*_region_info);
+        }
         _table_info = SchemaFactory::get_instance()->get_table_info_ptr(_region_info->table_id());
         _pri_info = SchemaFactory::get_instance()->get_index_info_ptr(_region_info->table_id());
-        if (is_cstore()) {
-           _pri_field_ids.clear();
-           for (auto& field_info : _pri_info->fields) {
-                 _pri_field_ids.insert(field_info.id);
-           }
-       }
+        // cstore和紧凑行格式都不存主键列
+        _pri_field_ids.clear();
+        if (_pri_info == nullptr) {
+            return;
+        }
+        for (auto& field_info : _pri_info->fields) {
+            _pri_field_ids.insert(field_info.id);
+        }
     }
     bool is_cstore() {
         if (_table_info.get() == nullptr) {
@@ -419,11 +432,12 @@ private:
     TransactionPool*                _pool = nullptr;
     SmartTable                      _table_info; // for cstore
     SmartIndex                      _pri_info;  // for cstore
-    std::set<int32_t>               _pri_field_ids; // for cstore
+    std::set<int32_t>               _pri_field_ids; // for cstore and compact row
 
     bthread_mutex_t                 _txn_mutex;
     SmartDllTransactionState        _ddl_state = nullptr;
     bool                            _use_ttl = false;
+    bool                            _chunk_writing = false; // for cstore
     int64_t                         _read_ttl_timestamp_us = 0; //ttl读取时间
     int64_t                         _write_ttl_timestamp_us = 0; //ttl写入时间
 };
@@ -25,7 +25,9 @@ DECLARE_int32(transaction_clear_delay_ms);
 // TODO: remove locking for thread-safe codes
 class TransactionPool {
 public:
-    virtual ~TransactionPool() {}
+    virtual ~TransactionPool() {
+        bthread_mutex_destroy(&_chunk_mutex);
+    }
 
     void close() {
         std::unique_lock<std::mutex> lock(_map_mutex);
@@ -36,7 +38,9 @@ public:
         }
     }
 
-    TransactionPool() : _num_prepared_txn(0), _txn_count(0) {}
+    TransactionPool() : _num_prepared_txn(0), _txn_count(0) {
+        bthread_mutex_init(&_chunk_mutex, nullptr);
+    }
 
     int init(int64_t region_id, bool use_ttl);
 
@@ -109,6 +113,31 @@ public:
     
     //清空所有的状态
     void clear();
+
+    // cstore chunk生成的乐观校验：会删除chunk的写入在读chunk前进入，
+    // 提交或回滚后退出并增加版本；生成方不加行锁，只在版本不变时写入chunk
+    void chunk_writer_enter() {
+        BAIDU_SCOPED_LOCK(_chunk_mutex);
+        ++_chunk_writers;
+    }
+    void chunk_writer_exit() {
+        BAIDU_SCOPED_LOCK(_chunk_mutex);
+        --_chunk_writers;
+        ++_chunk_version;
+    }
+    // 有进行中的写入返回-1
+    int64_t chunk_version() {
+        BAIDU_SCOPED_LOCK(_chunk_mutex);
+        return _chunk_writers > 0 ? -1 : _chunk_version;
+    }
+    // 持锁执行install，期间新的写入等待，保证写入方能读到刚生成的chunk
+    bool install_chunk(int64_t version, const std::function<bool()>& install) {
+        BAIDU_SCOPED_LOCK(_chunk_mutex);
+        if (_chunk_writers > 0 || _chunk_version != version) {
+            return false;
+        }
+        return install();
+    }
 private:
     int64_t _region_id = 0;
     bool _use_ttl = false;
@@ -122,5 +151,9 @@ private:
 
     BthreadCond  _num_prepared_txn;  // total number of prepared transactions
     std::atomic<int32_t> _txn_count;
+
+    bthread_mutex_t _chunk_mutex;
+    int64_t _chunk_writers = 0;
+    int64_t _chunk_version = 0;
 };
 }
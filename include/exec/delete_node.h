@@ -17,6 +17,7 @@
 #include "exec_node.h"
 #include "dml_node.h"
 #include "transaction.h"
+#include "rocksdb_scan_node.h"
 
 namespace baikaldb {
 class DeleteNode : public DMLNode {
@@ -29,7 +30,13 @@ public:
     virtual int open(RuntimeState* state);
 
 private:
+    // 1pc删除且条件都被主键范围覆盖时，主键用DeleteRange删除
+    bool can_delete_range(RuntimeState* state);
+    // 返回删除的行数，-2表示行数不足、范围过多或重叠，退回逐行删除
+    int delete_range(RuntimeState* state);
+
     std::vector<pb::SlotDescriptor> _primary_slots;
+    RocksdbScanNode* _scan_node = nullptr;
 };
 
 }
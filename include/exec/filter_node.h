@@ -50,6 +50,10 @@ public:
         }
     }
     void remove_primary_conjunct(int64_t index_id);
+    // open后所有条件都被扫描索引覆盖，扫描范围内的行即结果
+    bool all_conjuncts_pruned() const {
+        return _pruned_conjuncts.empty();
+    }
     virtual void show_explain(std::vector<std::map<std::string, std::string>>& output);
 private:
     bool need_copy(MemRow* row);
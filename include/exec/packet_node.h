@@ -57,6 +57,7 @@ private:
     int pack_ok(int num_affected_rows, NetworkSocket* client);
     // 先不用，err在外部填
     int pack_err();
+    int flush_if_needed();
     int pack_head();
     int pack_fields();
     int pack_vector_row(const std::vector<std::string>& row);
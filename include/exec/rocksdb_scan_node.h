@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <queue>
 #include "scan_node.h"
 #include "fetcher_node.h"
 #include "table_record.h"
@@ -85,12 +86,31 @@ public:
     bool covering_index() {
         return _is_covering_index;
     }
+    // open后选中主键做范围扫描(非点查、倒排和索引下推)，行存表可以按主键范围删除
+    bool is_primary_range_scan();
+    size_t range_size() const {
+        return _left_records.size();
+    }
+    // 正向打开第idx个主键范围的迭代器，不填充block cache
+    TableIterator* open_primary_range(RuntimeState* state, size_t idx,
+            std::map<int32_t, FieldInfo*>& fields, KVMode mode);
 private:
     int get_next_by_table_get(RuntimeState* state, RowBatch* batch, bool* eos);
     int get_next_by_table_seek(RuntimeState* state, RowBatch* batch, bool* eos);
     int get_next_by_index_get(RuntimeState* state, RowBatch* batch, bool* eos);
     int get_next_by_index_seek(RuntimeState* state, RowBatch* batch, bool* eos);
     int choose_index(RuntimeState* state);
+    //按planner估算的扫描行数决定是否填充block cache，大范围扫描不挤占热数据
+    bool need_fill_cache(const pb::PossibleIndex& pos_index);
+    //父节点为按__weight降序的sort limit时返回limit，倒排检索可以做top k剪枝
+    int64_t calc_reverse_top_k();
+    //返回false表示分数不可能进入top k
+    bool check_reverse_top_k(SmartRecord record);
+    void update_reverse_top_k(SmartRecord record);
+    //cstore主键扫描时把父节点上 字段 op 常量 的条件转成zone map条件
+    void build_zone_predicates();
+    bool to_zone_predicate(ExprNode* expr, const std::map<int32_t, int32_t>& slot_field_map,
+            ZonePredicate* pred);
 
 private:
     std::map<int32_t, FieldInfo*> _field_ids;
@@ -108,6 +128,7 @@ private:
     // 如果用了排序列做索引，就不需要排序了
     bool _sort_use_index = false;
     bool _scan_forward = true; //scan的方向
+    bool _fill_cache = true;
     
     //被选择的索引
     std::vector<SmartRecord> _left_records;
@@ -124,6 +145,9 @@ private:
     std::vector<ExprNode*> _index_conjuncts;
     IndexIterator* _index_iter = nullptr;
     TableIterator* _table_iter = nullptr;
+    std::vector<ZonePredicate> _zone_predicates;
+    int64_t _skipped_blocks = 0;    //已析构的_table_iter跳过的chunk数
+    int64_t _reported_skipped_blocks = 0;
     ReverseIndexBase* _reverse_index = nullptr;
 
     SmartTable       _table_info;
@@ -135,6 +159,10 @@ private:
     std::vector<ReverseIndexBase*> _reverse_indexes;
     MutilReverseIndex<CommonSchema> _m_index;
     bool _bool_and = false;
+    //倒排top k，_top_k_heap为已返回行分数的小顶堆
+    int64_t _top_k = 0;
+    int32_t _weight_field_id = 0;
+    std::priority_queue<float, std::vector<float>, std::greater<float>> _top_k_heap;
 
     std::map<int64_t, pb::PossibleIndex> _region_primary;
     std::map<int32_t, int32_t> _index_slot_field_map;
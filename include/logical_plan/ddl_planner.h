@@ -14,6 +14,7 @@
 
 // Brief:  the class for generating and executing DDL SQL
 #pragma once
+#include <rapidjson/document.h>
 #include "logical_planner.h"
 #include "query_context.h"
 #include "parser.h"
@@ -38,6 +39,7 @@ private:
 
     int add_column_def(pb::SchemaInfo& table, parser::ColumnDef* column);
     int add_constraint_def(pb::SchemaInfo& table, parser::Constraint* constraint);
+    int parse_cf_conf(const rapidjson::Value& value, pb::ColumnFamilyConf* cf_conf);
     pb::PrimitiveType to_baikal_type(parser::FieldType* field_type);
 };
 } //namespace baikal
\ No newline at end of file
@@ -72,6 +72,9 @@ public:
     virtual int plan() = 0;
 
     static int analyze(QueryContext* ctx);
+
+    // 生成去掉常量的语句指纹，需在plan之后调用
+    static void set_sql_digest(QueryContext* ctx);
    
     static std::map<parser::JoinType, pb::JoinType> join_type_mapping;
 
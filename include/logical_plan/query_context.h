@@ -53,6 +53,9 @@ struct QueryStat {
     std::string table;
     std::string server_ip;
     std::ostringstream sample_sql;
+    // 去掉常量后的语句指纹及其签名，用于按语句聚合统计
+    std::string sql_digest;
+    uint64_t    sql_sign = 0;
 
     MysqlErrCode error_code;
     std::ostringstream error_msg;
@@ -97,6 +100,8 @@ struct QueryStat {
         table.clear();
         server_ip.clear();
         sample_sql.str("");
+        sql_digest.clear();
+        sql_sign            = 0;
 
         error_code          = ER_ERROR_FIRST;
         error_msg.str("");
@@ -173,6 +178,7 @@ public:
     bool                is_explain = false;
     bool                is_full_export = false;
     bool                is_trace = false;
+    bool                is_analyze = false; // explain format='analyze'，执行并输出各算子统计
     bool                is_print_plan = false;
 
     uint8_t             mysql_cmd;      // Command number in mysql protocal.
@@ -59,7 +59,8 @@ public:
                                                 pb::Status status, std::vector<pb::RaftControlRequest>& requests); 
     void pre_process_add_peer_for_store(const std::string& instance, pb::Status status,
             std::unordered_map<std::string, std::vector<pb::AddPeer>>& add_peer_requests);
-    bool add_region_is_exist(int64_t table_id, const std::string& start_key, 
+    bool add_region_is_exist(int64_t table_id, int64_t partition_id, 
+                             const std::string& start_key, 
                                             const std::string& end_key);
     void check_update_region(const pb::BaikalHeartBeatRequest* request,
                 pb::BaikalHeartBeatResponse* response);
@@ -274,6 +275,12 @@ public:
         _instance_leader_count[instance] = table_leader_count;
     }
 
+    //收到过全量心跳的store才有leader数统计，meta切主后会清空
+    bool has_instance_leader_count(const std::string& instance) {
+        BAIDU_SCOPED_LOCK(_count_mutex);
+        return _instance_leader_count.find(instance) != _instance_leader_count.end();
+    }
+
     int64_t get_leader_count(const std::string& instance, int64_t table_id) {
         BAIDU_SCOPED_LOCK(_count_mutex);
         if (_instance_leader_count.find(instance) == _instance_leader_count.end()
@@ -40,11 +40,11 @@ struct TableMem {
     std::unordered_map<int64_t, std::set<int64_t>> partition_regions;//该信息只保存在内存中
     std::unordered_map<std::string, int32_t> field_id_map;
     std::unordered_map<std::string, int64_t> index_id_map;
-    //start_key=>regionid
-    std::map<std::string, RegionDesc>  startkey_regiondesc_map;
+    //partition_id => (start_key=>regionid)，每个分区的region各自覆盖整个key空间
+    std::map<int64_t, std::map<std::string, RegionDesc>>  startkey_regiondesc_map;
     //发生split或merge时，用以下三个map暂存心跳上报的region信息，保证整体更新
-    //start_key => region 存放new region，new region为分裂出来的region
-    std::map<std::string, SmartRegionInfo> startkey_newregion_map;
+    //partition_id => (start_key => region) 存放new region，new region为分裂出来的region
+    std::map<int64_t, std::map<std::string, SmartRegionInfo>> startkey_newregion_map;
     //region id => none region 存放空region
     std::map<int64_t, SmartRegionInfo> id_noneregion_map;
     //region id => region 存放key发生变化的region，以该region为基准，查找merge或split所涉及到的所有region
@@ -137,6 +137,7 @@ public:
     void update_byte_size(const pb::MetaManagerRequest& request, const int64_t apply_index, braft::Closure* done);
     void update_split_lines(const pb::MetaManagerRequest& request, const int64_t apply_index, braft::Closure* done);
     void update_schema_conf(const pb::MetaManagerRequest& request, const int64_t apply_index, braft::Closure* done);
+    void update_statistics(const pb::MetaManagerRequest& request, const int64_t apply_index, braft::Closure* done);
     void update_dists(const pb::MetaManagerRequest& request, const int64_t apply_index, braft::Closure* done);
     void update_resource_tag(const pb::MetaManagerRequest& request, const int64_t apply_index, braft::Closure* done);
 
@@ -167,20 +168,24 @@ public:
                         pb::BaikalHeartBeatResponse* response);
 
     int load_table_snapshot(const std::string& value);
-    int erase_region(int64_t table_id, int64_t region_id, std::string start_key);
-    int64_t get_next_region_id(int64_t table_id, std::string start_key, 
+    int erase_region(int64_t table_id, int64_t partition_id, 
+            int64_t region_id, std::string start_key);
+    int64_t get_next_region_id(int64_t table_id, int64_t partition_id, std::string start_key, 
             std::string end_key);
     int add_startkey_regionid_map(const pb::RegionInfo& region_info);
-    bool check_region_when_update(int64_t table_id, std::string min_start_key, 
-            std::string max_end_key);
+    bool check_region_when_update(int64_t table_id, int64_t partition_id, 
+            std::string min_start_key, std::string max_end_key);
     int check_startkey_regionid_map();
-    void update_startkey_regionid_map_old_pb(int64_t table_id, 
+    void update_startkey_regionid_map_old_pb(int64_t table_id, int64_t partition_id, 
             std::map<std::string, int64_t>& key_id_map);
-    void update_startkey_regionid_map(int64_t table_id, std::string min_start_key, 
+    void update_startkey_regionid_map(int64_t table_id, int64_t partition_id, 
+                                      std::string min_start_key, 
                                       std::string max_end_key, 
                                       std::map<std::string, int64_t>& key_id_map);
-    int64_t get_pre_regionid(int64_t table_id, const std::string& start_key);
-    int64_t get_startkey_regionid(int64_t table_id, const std::string& start_key);
+    int64_t get_pre_regionid(int64_t table_id, int64_t partition_id, 
+            const std::string& start_key);
+    int64_t get_startkey_regionid(int64_t table_id, int64_t partition_id, 
+            const std::string& start_key);
     void add_new_region(const pb::RegionInfo& leader_region_info);
     void add_update_region(const pb::RegionInfo& leader_region_info, bool is_none);
     int get_merge_regions(int64_t table_id, 
@@ -598,9 +603,11 @@ private:
                                 braft::Closure* done,
                                 int64_t max_table_id_tmp,
                                 bool has_auto_increment);
+    // 写入前按需追加紧凑行格式的layout，调用方随后用schema_info更新内存
     int update_schema_for_rocksdb(int64_t table_id, 
-                                    const pb::SchemaInfo& schema_info, 
+                                    pb::SchemaInfo& schema_info, 
                                     braft::Closure* done);
+    void update_row_layouts(pb::SchemaInfo& schema_info);
     
     void send_drop_table_request(const std::string& namespace_name,
                                 const std::string& database,
@@ -625,6 +632,8 @@ private:
     }
     int alloc_field_id(pb::SchemaInfo& table_info, bool& has_auto_increment, TableMem& table_mem);
     int alloc_index_id(pb::SchemaInfo& table_info, TableMem& table_mem, int64_t& max_table_id_tmp);
+    // 分区表填充分区列id并校验分区规则
+    int alloc_partition_info(pb::SchemaInfo& table_info, TableMem& table_mem);
     void construct_common_region(pb::RegionInfo* region_info, int32_t replica_num) {
         region_info->set_version(1);
         region_info->set_conf_version(1);
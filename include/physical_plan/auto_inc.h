@@ -14,10 +14,62 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "common.h"
 #include "query_context.h"
 #include "meta_server_interact.hpp"
 namespace baikaldb {
 DECLARE_string(meta_server_bns);
+
+// 单表的自增id号段缓存，insert在本地无锁分配id
+// 号段剩余不足一定比例时异步从meta预取下一个号段，号段大小根据消耗速度自适应
+class AutoIncSegmentCache : public std::enable_shared_from_this<AutoIncSegmentCache> {
+public:
+    // 从meta分配count个id，结果为[start_id, end_id)，0成功
+    typedef std::function<int(int64_t table_id, int64_t count,
+            int64_t& start_id, int64_t& end_id)> FetchFunc;
+    // fetch为空时使用AutoInc::gen_id_from_meta，必须由shared_ptr持有
+    AutoIncSegmentCache(int64_t table_id, int64_t version, FetchFunc fetch = nullptr);
+    ~AutoIncSegmentCache() {
+        bthread_mutex_destroy(&_mutex);
+    }
+    // 分配count个连续的id，返回起始id，失败返回-1
+    int64_t alloc(int64_t count);
+    // 用户显式指定了id, 跳过号段中不大于max_id的部分
+    // 返回true表示meta的计数已经大于max_id, 不需要再通知meta
+    bool skip_to(int64_t max_id);
+    int64_t version() const {
+        return _version;
+    }
+
+private:
+    struct Segment {
+        Segment(int64_t start, int64_t end) : next(start), end(end), size(end - start) {}
+        std::atomic<int64_t> next;
+        const int64_t end;
+        const int64_t size;
+    };
+    typedef std::shared_ptr<Segment> SmartSegment;
+
+    SmartSegment fetch_segment(int64_t count);
+    int switch_segment(const SmartSegment& exhausted, int64_t count);
+    void async_prefetch();
+    void adjust_segment_size();
+
+    int64_t _table_id;
+    int64_t _version;
+    FetchFunc _fetch;
+    SmartSegment _current;
+    SmartSegment _prefetched;
+    bthread_mutex_t _mutex;
+    std::atomic<bool> _prefetching;
+    std::atomic<int64_t> _segment_size;
+    TimeCost _segment_time;
+};
+typedef std::shared_ptr<AutoIncSegmentCache> SmartAutoIncSegmentCache;
+
 class AutoInc {
 public:
     static MetaServerInteract auto_incr_meta_inter;
@@ -28,6 +80,13 @@ public:
     static int init_meta_inter() {
         return auto_incr_meta_inter.init_internal(FLAGS_meta_server_bns);
     }
+    // 同步请求meta分配[start_id, end_id)
+    static int gen_id_from_meta(int64_t table_id, int64_t count, int64_t max_id,
+            int64_t& start_id, int64_t& end_id);
+
+private:
+    SmartAutoIncSegmentCache get_segment_cache(int64_t table_id, int64_t version);
+    static ThreadSafeMap<int64_t, SmartAutoIncSegmentCache> _segment_caches;
 };
 }
 
@@ -70,6 +70,11 @@ private:
             int32_t tuple_id, int32_t slot_id,
             const IndexInfo& index_info, int field_cnt, std::vector<ExprValue>* values);
 
+    //有统计信息时，估算每个候选索引的扫描行数和代价，写入PossibleIndex
+    void estimate_index_cost(QueryContext* ctx, ScanNode* scan_node);
+    int64_t estimate_range_rows(int64_t table_id, IndexInfo& index_info,
+            const pb::IndexStatistics& statistics, const pb::PossibleIndex::Range& range);
+
     //检查order by是否可以使用索引
     bool check_sort_use_index(const std::function<int(int, int)>& get_slot_id, 
                               IndexInfo& index_info, 
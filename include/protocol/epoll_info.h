@@ -16,6 +16,7 @@
 
 #include <sys/epoll.h>
 #include <sys/types.h>
+#include <atomic>
 #include "common.h" 
 
 namespace baikaldb {
@@ -35,6 +36,10 @@ public:
     bool set_fd_mapping(int fd, SmartSocket sock);
     SmartSocket get_fd_mapping(int fd);
     void delete_fd_mapping(int fd);
+    // 当前注册的连接数
+    int64_t fd_count() {
+        return _fd_count.load();
+    }
     int get_ready_fd(int cnt);
     int get_ready_events(int cnt);
 
@@ -48,6 +53,7 @@ private:
     int                 _epfd;
     struct epoll_event  _events[CONFIG_MPL_EPOLL_MAX_SIZE];
     size_t              _event_size;
+    std::atomic<int64_t> _fd_count;
 };
 
 } // namespace baikal
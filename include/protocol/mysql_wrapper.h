@@ -21,6 +21,7 @@
 #include "mysql_err_code.h"
 
 namespace baikaldb {
+DECLARE_int64(send_buf_flush_watermark);
 
 class NetworkSocket;
 const uint32_t PACKET_LEN_MAX                    = 0x00ffffff;
@@ -77,6 +78,8 @@ public:
     int real_read_header(SmartSocket sock, int want_len, int* real_read_len);
     int real_read(SmartSocket sock, int we_want, int* ret_read_len);
     int real_write(SmartSocket sock);
+    // 执行过程中把send_buf中已打包的结果写出，客户端读得慢时阻塞等待
+    int flush_send_buf(NetworkSocket* sock);
 
     bool is_shutdown_command(uint8_t command);
     bool is_prepare_command(uint8_t command);
@@ -0,0 +1,70 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <thread>
+#include <bvar/bvar.h>
+#include "common.h"
+#include "epoll_info.h"
+
+namespace baikaldb {
+DECLARE_int32(network_reactor_num);
+
+// 每个reactor一个pthread和一个epoll，负责分配给它的客户端连接
+// 语句执行会阻塞在store rpc上，总是交给bthread执行，避免阻塞同一reactor上的其他连接；
+// 只有握手和认证可以按network_reactor_inline_us在reactor线程内执行(默认关闭)
+class NetworkReactor {
+public:
+    explicit NetworkReactor(int idx);
+    ~NetworkReactor();
+
+    bool init();
+    void start();
+    void join();
+
+    // 由accept线程调用，注册可写事件，由reactor发送握手包
+    bool add_client(SmartSocket sock);
+    // 处理一个就绪的客户端socket，调用方已持有sock->mutex
+    void dispatch(SmartSocket sock, bool shutdown);
+
+    EpollInfo* epoll_info() {
+        return &_epoll_info;
+    }
+    int64_t conn_count() {
+        return _epoll_info.fd_count();
+    }
+
+private:
+    void run();
+    void process_event(int fd, int event);
+
+    static int64_t get_conn_count(void* reactor) {
+        return static_cast<NetworkReactor*>(reactor)->conn_count();
+    }
+
+    int                 _idx;
+    EpollInfo           _epoll_info;
+    std::thread         _thread;
+    int64_t             _loop_start_us = 0;     // 本轮epoll事件开始处理的时间
+
+    bvar::PassiveStatus<int64_t> _conn_count;
+    bvar::Adder<int64_t>        _event_count;
+    bvar::Adder<int64_t>        _inline_count;
+    bvar::Adder<int64_t>        _offload_count;
+    bvar::LatencyRecorder       _inline_latency;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -18,6 +18,7 @@
 #include "network_socket.h"
 #include "state_machine.h"
 #include "epoll_info.h"
+#include "network_reactor.h"
 #include "machine_driver.h"
 #include "proto/meta.interface.pb.h"
 #include "schema_factory.h"
@@ -51,6 +52,8 @@ public:
     EpollInfo* get_epoll_info() {
         return _epoll_info;
     }
+    // 遍历所有reactor上的客户端连接
+    void for_each_client(const std::function<void(SmartSocket, EpollInfo*)>& func);
     
     static uint8_t transaction_prefix;
 
@@ -60,6 +63,7 @@ private:
     NetworkServer& operator=(const NetworkServer& other);
 
     bool set_fd_flags(int fd);
+    NetworkReactor* choose_reactor();
     SmartSocket create_listen_socket();
     int make_worker_process();
     void construct_heart_beat_request(pb::BaikalHeartBeatRequest& request);
@@ -82,7 +86,8 @@ private:
     bool            _shutdown = false;  // Flag of graceful shutdown.
     // Socket info.
     SmartSocket     _service = nullptr;  // Server socket.
-    EpollInfo*      _epoll_info = nullptr;      // Epoll info and fd mapping.
+    EpollInfo*      _epoll_info = nullptr;      // Epoll info of listen socket.
+    std::vector<NetworkReactor*> _reactors;     // Epoll loops of client sockets.
     
     RocksWrapper*   _meta_db = nullptr;
     rocksdb::ColumnFamilyHandle* _meta_handle = nullptr;
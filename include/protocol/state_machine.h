@@ -53,6 +53,8 @@ const std::string SQL_SHOW_WARNINGS              = "show warnings";
 const std::string SQL_SHOW_REGION                = "show region";
 const std::string SQL_SHOW_SOCKET                = "show socket";
 const std::string SQL_SHOW_PROCESSLIST           = "show processlist";
+const std::string SQL_SHOW_STATEMENT_STATS       = "show statement stats";
+const std::string SQL_ANALYZE_TABLE              = "analyze table";
 
 enum QUERY_TYPE {
     SQL_UNKNOWN_NUM                         = 0,
@@ -140,6 +142,8 @@ private:
     bool _handle_client_query_show_region(SmartSocket client);
     bool _handle_client_query_show_socket(SmartSocket client);
     bool _handle_client_query_show_processlist(SmartSocket client);
+    bool _handle_client_query_show_statement_stats(SmartSocket client);
+    bool _handle_client_query_analyze_table(SmartSocket client);
     bool _handle_client_query_common_query(SmartSocket client);
 
     bool _handle_client_query_select_1(SmartSocket client);
@@ -14,6 +14,7 @@
 
 #pragma once
 #include <vector>
+#include <limits>
 #include <google/protobuf/message.h>
 namespace baikaldb {
 
@@ -44,6 +45,14 @@ public:
     //如果倒排链表是有序数组，用二分查找优化
     //大于等于target_id的第一个元素（包括当前元素）
     virtual const PostingNodeT* advance(const PrimaryIdT& target_id) = 0; 
+    //链表中节点分数的上界，未知时返回float最大值
+    virtual float max_score() {
+        return std::numeric_limits<float>::max();
+    }
+    //读取链表失败，此时返回的nullptr不代表遍历结束
+    virtual bool is_failed() {
+        return false;
+    }
 protected:
     Schema* _schema;
 };
@@ -57,6 +66,12 @@ enum bool_executor_type {
 class BooleanExecutorBase {
 public:
     virtual const google::protobuf::Message* next() = 0;
+    //top k检索时由调用方设置当前第k大的分数，只有WandBooleanExecutor使用
+    virtual void set_threshold(float threshold) {}
+    //next返回nullptr时用于区分遍历结束和读取失败
+    virtual bool is_failed() {
+        return false;
+    }
     virtual ~BooleanExecutorBase() {}
 };
 
@@ -74,6 +89,10 @@ public:
     virtual const PostingNodeT* next() = 0;
     //大于等于target_id的第一个元素（包括当前元素）
     virtual const PostingNodeT* advance(const PrimaryIdT& target_id) = 0;
+    //返回节点分数的上界，用于WAND剪枝
+    virtual float max_score() {
+        return std::numeric_limits<float>::max();
+    }
 
     bool_executor_type get_type() {
         return _type;
@@ -123,6 +142,12 @@ public:
     virtual const PrimaryIdT* current_id();
     virtual const PostingNodeT* next();
     virtual const PostingNodeT* advance(const PrimaryIdT& target_id);
+    virtual float max_score() {
+        return _posting_list->max_score();
+    }
+    virtual bool is_failed() {
+        return _posting_list->is_failed();
+    }
 private:
     RindexNodeParser<Schema>* _posting_list;     // 倒排拉链
     std::string _term;
@@ -146,6 +171,16 @@ public:
 
     void add(BooleanExecutor<Schema>* executor);
     void set_merge_func(MergeFuncT merge_func);
+    //合并函数为求和或取最大值，分数非负时子节点上界之和为上界
+    virtual float max_score();
+    virtual bool is_failed() {
+        for (auto sub : _sub_clauses) {
+            if (sub->is_failed()) {
+                return true;
+            }
+        }
+        return false;
+    }
 protected:
     //子节点
     std::vector<BooleanExecutor<Schema>*> _sub_clauses;
@@ -218,6 +253,7 @@ public:
 
     void add_not_must(BooleanExecutor<Schema>* executor);
     void add_must(BooleanExecutor<Schema>* executor);
+    virtual float max_score();
 
 private:
     void add_weight();
@@ -225,6 +261,40 @@ private:
     BooleanExecutor<Schema>* _op_executor;
 };
 
+// or节点的top k版本(WAND)
+// 子节点按当前id排序，累加分数上界直到超过阈值，得到pivot；
+// 排在pivot之前的子节点直接advance到pivot的id，跳过不可能进入top k的文档
+// 阈值由调用方根据已返回结果的第k大分数设置，返回的是top k的超集，最终排序由上层完成
+template <typename Schema>
+class WandBooleanExecutor : public OperatorBooleanExecutor<Schema> {
+public:
+    typedef typename Schema::PostingNodeT PostingNodeT;
+    typedef typename Schema::PrimaryIdT PrimaryIdT;
+    typedef int (*MergeFuncT)(PostingNodeT&, const PostingNodeT&, BoolArg*);
+
+    explicit WandBooleanExecutor(bool_executor_type type = NODE_NOT_COPY, BoolArg* arg = nullptr);
+    virtual ~WandBooleanExecutor();
+
+    virtual const PostingNodeT* current_node();
+    virtual const PrimaryIdT* current_id();
+    virtual const PostingNodeT* next();
+    virtual const PostingNodeT* advance(const PrimaryIdT& target_id);
+    virtual void set_threshold(float threshold) {
+        _threshold = threshold;
+    }
+    int64_t skip_count() const {
+        return _skip_count;
+    }
+
+private:
+    const PostingNodeT* find_next();
+    //子节点分数上界，下标与_sub_clauses一致
+    std::vector<float> _max_scores;
+    std::vector<size_t> _order;
+    float _threshold = -std::numeric_limits<float>::max();
+    int64_t _skip_count = 0;
+};
+
 }  // namespace boolean_engine
 
 #include "boolean_executor.hpp"
@@ -131,6 +131,19 @@ inline void OperatorBooleanExecutor<Schema>::set_merge_func(
         MergeFuncT merge_func) {
     _merge_func = merge_func;
 }
+
+template <typename Schema>
+float OperatorBooleanExecutor<Schema>::max_score() {
+    float score = 0;
+    for (auto sub : _sub_clauses) {
+        float sub_score = sub->max_score();
+        if (sub_score == std::numeric_limits<float>::max()) {
+            return sub_score;
+        }
+        score += std::max(sub_score, 0.0f);
+    }
+    return score;
+}
 // AndBooleanExecutor
 // ------------------
 template <typename Schema>
@@ -201,7 +214,7 @@ const typename Schema::PostingNodeT* AndBooleanExecutor<Schema>::advance(
                 return NULL;
             }
         }
-    } else if (target_id.compare(*this->current_id()) <= 0) {
+    } else if (Schema::compare_id_func(target_id, *this->current_id()) <= 0) {
         return this->current_node();
     } else {
         this->_sub_clauses[this->_sub_clauses.size() - 1]->advance(target_id);
@@ -315,7 +328,7 @@ const typename Schema::PostingNodeT* OrBooleanExecutor<Schema>::advance(
     }
     if (this->_init_flag) {
         this->_init_flag = false;
-    } else if (target_id.compare(*this->current_id()) <= 0) {
+    } else if (Schema::compare_id_func(target_id, *this->current_id()) <= 0) {
         return this->current_node();
     }
     for (auto sub : clauses) {
@@ -452,6 +465,20 @@ inline void WeightedBooleanExecutor<Schema>::add_must(
     _op_executor = executor;
 }
 
+template <typename Schema>
+float WeightedBooleanExecutor<Schema>::max_score() {
+    if (_op_executor == NULL) {
+        return 0;
+    }
+    float score = OperatorBooleanExecutor<Schema>::max_score();
+    float must_score = _op_executor->max_score();
+    if (score == std::numeric_limits<float>::max() 
+            || must_score == std::numeric_limits<float>::max()) {
+        return std::numeric_limits<float>::max();
+    }
+    return score + std::max(must_score, 0.0f);
+}
+
 template <typename Schema>
 void WeightedBooleanExecutor<Schema>::add_weight() {
     std::vector<BooleanExecutor<Schema>*>& sub_clauses = this->_sub_clauses;
@@ -477,6 +504,146 @@ void WeightedBooleanExecutor<Schema>::add_weight() {
         }
     }
 }
+
+// WandBooleanExecutor
+// ------------------
+template <typename Schema>
+WandBooleanExecutor<Schema>::WandBooleanExecutor(bool_executor_type type, BoolArg* arg) {
+    this->_is_null_flag = false;
+    this->set_merge_func(Schema::merge_or);
+    this->_type = type;
+    this->_curr_node_ptr = &this->_curr_node;
+    this->_curr_id_ptr = &this->_curr_id;
+    this->_arg = arg;
+}
+
+template <typename Schema>
+WandBooleanExecutor<Schema>::~WandBooleanExecutor() {
+    delete this->_arg;
+}
+
+template <typename Schema>
+const typename Schema::PostingNodeT* WandBooleanExecutor<Schema>::current_node() {
+    if (this->_is_null_flag) {
+        return NULL;
+    }
+    return this->_curr_node_ptr;
+}
+
+template <typename Schema>
+const typename Schema::PrimaryIdT* WandBooleanExecutor<Schema>::current_id() {
+    if (this->_is_null_flag) {
+        return NULL;
+    }
+    return this->_curr_id_ptr;
+}
+
+template <typename Schema>
+const typename Schema::PostingNodeT* WandBooleanExecutor<Schema>::next() {
+    std::vector<BooleanExecutor<Schema>*>& clauses = this->_sub_clauses;
+    if (clauses.size() == 0 || this->_is_null_flag) {
+        this->_is_null_flag = true;
+        return NULL;
+    }
+    if (this->_init_flag) {
+        for (size_t i = 0; i < clauses.size(); ++i) {
+            clauses[i]->next();
+            _max_scores.push_back(std::max(clauses[i]->max_score(), 0.0f));
+            _order.push_back(i);
+        }
+        this->_init_flag = false;
+    }
+    return find_next();
+}
+
+template <typename Schema>
+const typename Schema::PostingNodeT* WandBooleanExecutor<Schema>::advance(
+        const PrimaryIdT& target_id) {
+    std::vector<BooleanExecutor<Schema>*>& clauses = this->_sub_clauses;
+    if (clauses.size() == 0 || this->_is_null_flag) {
+        this->_is_null_flag = true;
+        return NULL;
+    }
+    if (this->_init_flag) {
+        for (size_t i = 0; i < clauses.size(); ++i) {
+            _max_scores.push_back(std::max(clauses[i]->max_score(), 0.0f));
+            _order.push_back(i);
+        }
+        this->_init_flag = false;
+    } else if (Schema::compare_id_func(target_id, *this->current_id()) <= 0) {
+        return this->current_node();
+    }
+    for (auto sub : clauses) {
+        sub->advance(target_id);
+    }
+    return find_next();
+}
+
+template <typename Schema>
+const typename Schema::PostingNodeT* WandBooleanExecutor<Schema>::find_next() {
+    std::vector<BooleanExecutor<Schema>*>& clauses = this->_sub_clauses;
+    while (true) {
+        //按当前id排序，遍历结束的子节点排在最后
+        std::sort(_order.begin(), _order.end(), [&clauses](size_t l, size_t r) {
+            return CompareAsc<Schema>()(clauses[l], clauses[r]);
+        });
+        float score_sum = 0;
+        int pivot = -1;
+        for (size_t i = 0; i < _order.size(); ++i) {
+            if (clauses[_order[i]]->current_id() == NULL) {
+                break;
+            }
+            score_sum += _max_scores[_order[i]];
+            if (score_sum > _threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        //剩余文档的分数上界都不超过阈值
+        if (pivot == -1) {
+            this->_is_null_flag = true;
+            return NULL;
+        }
+        BooleanExecutor<Schema>* first = clauses[_order[0]];
+        const PrimaryIdT pivot_id = *clauses[_order[pivot]]->current_id();
+        if (Schema::compare_id_func(*first->current_id(), pivot_id) != 0) {
+            //pivot之前的文档只命中上界之和不超过阈值的子节点，直接跳过
+            for (int i = 0; i < pivot; ++i) {
+                BooleanExecutor<Schema>* sub = clauses[_order[i]];
+                if (Schema::compare_id_func(*sub->current_id(), pivot_id) < 0) {
+                    sub->advance(pivot_id);
+                    ++_skip_count;
+                }
+            }
+            continue;
+        }
+        if (this->_type == NODE_COPY) {
+            this->_curr_node = *first->current_node();
+            this->_curr_id = *first->current_id();
+        }
+        if (this->_type == NODE_NOT_COPY) {
+            this->_curr_node_ptr = (PostingNodeT*)first->current_node();
+            this->_curr_id_ptr = first->current_id();
+        }
+        for (size_t i = 1; i < _order.size(); ++i) {
+            BooleanExecutor<Schema>* sub = clauses[_order[i]];
+            if (sub->current_id() == NULL || 
+                    Schema::compare_id_func(*sub->current_id(), *this->_curr_id_ptr) != 0) {
+                break;
+            }
+            this->_merge_func(*this->_curr_node_ptr, *sub->current_node(), this->_arg);
+            sub->next();
+        }
+        float score = Schema::score(*this->_curr_node_ptr);
+        first->next();
+        //上界超过阈值但实际分数没有超过
+        if (score <= _threshold) {
+            ++_skip_count;
+            continue;
+        }
+        return this->_curr_node_ptr;
+    }
+}
 }  // namespace boolean_engine
 
 // vim: set expandtab ts=4 sw=4 sts=4 tw=100: 
@@ -23,7 +23,8 @@ enum NodeType {
     AND = 1,
     OR,
     WEIGHT,
-    TERM
+    TERM,
+    WAND    //top k检索的or
 };
 
 template <typename Schema>
@@ -28,6 +28,7 @@ BooleanExecutor<Schema>* LogicalQuery<Schema>::parse_executor_node(
         case AND    :
         case OR     :
         case WEIGHT :
+        case WAND   :
             return parse_op_node(executor_node);
         default     :
             DB_WARNING("boolean executor type (%d) is invalid", executor_node._type);
@@ -64,6 +65,12 @@ BooleanExecutor<Schema>* LogicalQuery<Schema>::parse_op_node(
                 and_or_add_subnode(node, result);
                 break;
             }
+            case WAND : {
+                result = new WandBooleanExecutor<Schema>(_schema->executor_type, node._arg);
+                result->set_merge_func(node._merge_func);
+                and_or_add_subnode(node, result);
+                break;
+            }
             case WEIGHT : {
                 result = new WeightedBooleanExecutor<Schema>(_schema->executor_type, node._arg);
                 result->set_merge_func(node._merge_func);
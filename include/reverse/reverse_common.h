@@ -16,7 +16,9 @@
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <limits>
 #include "proto/reverse.pb.h"
+#include "proto/meta.interface.pb.h"
 #include "rocks_wrapper.h"
 #include "key_encoder.h"
 #include "lru_cache.h"
@@ -28,10 +30,21 @@
 #endif
 
 namespace baikaldb {
+DECLARE_bool(reverse_block_posting);
+DECLARE_int32(reverse_block_size);
+DECLARE_int64(reverse_list_cache_bytes);
+DECLARE_int64(reverse_seg_cache_bytes);
 typedef std::shared_ptr<google::protobuf::Message> MessageSP;
 typedef std::pair<std::string, std::string> KeyRange;
 extern std::atomic_long g_statistic_insert_key_num;
 extern std::atomic_long g_statistic_delete_key_num;
+//进程内所有倒排索引共享一份缓存，容量由reverse_list_cache_bytes和reverse_seg_cache_bytes限定
+//链表缓存key为完整的rocksdb key，自带region和index前缀
+typedef ShardedCache<std::string, MessageSP> ReverseListCache;
+//分词结果缓存key为index_id和word的签名，value按各索引的ReverseNode类型转换
+typedef ShardedCache<uint64_t, std::shared_ptr<void>> ReverseSegCache;
+ReverseListCache& reverse_list_cache();
+ReverseSegCache& reverse_seg_cache();
 
 #ifdef BAIDU_INTERNAL
 extern drpc::NLPCClient* wordrank_client;
@@ -58,6 +71,20 @@ public:
     int es_standard_gbk(std::string word, std::map<std::string, float>& term_map);
     int simple_seg_gbk(std::string word, uint32_t word_count, std::map<std::string, float>& term_map);
     void split_str_gbk(const std::string& word, std::vector<std::string>& split_word, char delim);
+
+    // utf8切词，归一化(全角转半角、转小写)后按字符类型切分
+    // 中日韩文字连续片段按word_count个字切分，不足word_count个字时整体作为一个term；
+    // 英文、数字等连续片段整体作为一个term；标点空白作为分隔符
+    int ngram_seg_utf8(const std::string& word, uint32_t word_count, 
+            std::map<std::string, float>& term_map);
+    // 中日韩文字按词典正向最大匹配，未登录的字单字切分，其他同ngram_seg_utf8
+    int dict_seg_utf8(const std::string& word, std::map<std::string, float>& term_map);
+    void split_str_utf8(const std::string& word, std::vector<std::string>& split_word, char delim);
+    int load_utf8_dict(const std::string& path);
+    static bool is_utf8_segment(pb::SegmentType segment_type) {
+        return segment_type == pb::S_UTF8_UNIGRAMS || segment_type == pb::S_UTF8_BIGRAMS
+            || segment_type == pb::S_UTF8_DICT;
+    }
 private:
     Tokenizer() {};
     void normalization_gbk(std::string& word);
@@ -65,6 +92,8 @@ private:
     std::unordered_set<std::string> _punctuation_blank;
     std::unordered_map<std::string, std::string> _q2b_gbk;
     std::unordered_map<std::string, std::string> _q2b_utf8;
+    std::unordered_set<std::string> _utf8_dict;
+    uint32_t _utf8_dict_max_len = 0; //词典中最长词的字数
 };
 
 //自动管理原子对象
@@ -116,7 +145,8 @@ public:
                        const std::string& merge_term,
                        bool del = false, 
                        RocksWrapper* rocksdb = NULL,
-                       rocksdb::Transaction* txn = NULL) : 
+                       rocksdb::Transaction* txn = NULL,
+                       rocksdb::ColumnFamilyHandle* data_cf = NULL) : 
                            _iter(iter),
                            _merge_term(merge_term),
                            _first(true),
@@ -124,7 +154,8 @@ public:
                            _key_range(key_range),
                            _del(del),
                            _rocksdb(rocksdb),
-                           _txn(txn) {}
+                           _txn(txn),
+                           _data_cf(data_cf) {}
     virtual int next(std::string& key, bool& res);
     virtual void fill_node(ReverseNode* node);
     virtual pb::ReverseNodeType get_flag();
@@ -140,6 +171,7 @@ private:
     bool _del;
     RocksWrapper* _rocksdb;
     rocksdb::Transaction* _txn;
+    rocksdb::ColumnFamilyHandle* _data_cf;
 };
 /*
  *第二/三层倒排链表的抽象，ReverseNode是有序数组的形式
@@ -163,6 +195,97 @@ private:
     int _index;
     bool _first;
 };
+
+/*
+ *3层倒排链表的块存储
+ *level3 key的value以REVERSE_BLOCK_MAGIC开头时为跳表(ReverseSkipTable)，
+ *节点按FLAGS_reverse_block_size分块存在level4：
+ *regionid_tableid_4_term_\0_version_blockid
+ *块格式：varint节点数 + 删除标记bitmap + 每个节点(varint共享前缀长度, varint后缀长度,
+ *后缀, varint附加信息长度, 去掉key和flag后的节点pb)
+ */
+const char REVERSE_BLOCK_MAGIC = '\0';
+const uint8_t REVERSE_BLOCK_LEVEL = 4;
+inline bool is_block_reverse_list(const rocksdb::Slice& value) {
+    return !value.empty() && value[0] == REVERSE_BLOCK_MAGIC;
+}
+void append_varint32(std::string* buf, uint32_t value);
+bool get_varint32(rocksdb::Slice* input, uint32_t* value);
+//块key: regionid_tableid_4_term_\0 + version + blockid，大端编码
+void append_block_version(std::string& key, uint64_t version);
+void append_block_id(std::string& key, uint32_t block_id);
+//将list的[begin, end)编码为一个块
+template<typename ReverseNode, typename ReverseList>
+void encode_reverse_block(const ReverseList& list, int begin, int end, std::string* value);
+//解码一个块，节点追加到list
+template<typename ReverseNode, typename ReverseList>
+int decode_reverse_block(const rocksdb::Slice& value, ReverseList* list);
+
+class BlockReverseListBase {
+public:
+    virtual ~BlockReverseListBase() {}
+    virtual int size() = 0;
+};
+typedef std::shared_ptr<BlockReverseListBase> BlockListSP;
+/*
+ *按块存储的3层倒排链表，检索时使用
+ *跳表常驻，块在第一次访问时读取并解码，advance先二分跳表定位块，只解码命中的块
+ *块通过快照读取，merge重写链表不影响进行中的检索
+ */
+template<typename ReverseNode, typename ReverseList>
+class BlockReverseList : public BlockReverseListBase {
+public:
+    BlockReverseList(RocksWrapper* rocksdb,
+                     rocksdb::ColumnFamilyHandle* data_cf,
+                     const std::string& block_key_prefix,
+                     pb::ReverseSkipTable& skip_table,
+                     const rocksdb::Snapshot* snapshot);
+    virtual ~BlockReverseList() {
+        if (_snapshot != nullptr) {
+            _rocksdb->relase_snapshot(_snapshot);
+        }
+    }
+    virtual int size() {
+        return _size;
+    }
+    //第idx个节点，读取失败返回nullptr并设置is_failed
+    ReverseNode* node(int idx);
+    //[idx, size)中第一个key大于等于target的位置，不存在或读取失败返回-1
+    int lower_bound(int idx, const std::string& target);
+    bool is_failed() const {
+        return _is_failed;
+    }
+    int loaded_block_count() const {
+        return _loaded_block_count;
+    }
+    //跳表中各块分数上界的最大值，旧数据没有记录时返回float最大值
+    float max_score() const {
+        float score = 0;
+        for (auto& block : _skip_table.blocks()) {
+            if (!block.has_max_score()) {
+                return std::numeric_limits<float>::max();
+            }
+            score = std::max(score, block.max_score());
+        }
+        return score;
+    }
+private:
+    int find_block(int idx);
+    int load_block(int block_idx);
+
+    RocksWrapper* _rocksdb;
+    rocksdb::ColumnFamilyHandle* _data_cf;
+    std::string _block_key_prefix;
+    pb::ReverseSkipTable _skip_table;
+    const rocksdb::Snapshot* _snapshot;
+    //每个块第一个节点的下标
+    std::vector<int> _block_offsets;
+    std::vector<std::unique_ptr<ReverseList>> _blocks;
+    int _size = 0;
+    int _cur_block = 0;
+    int _loaded_block_count = 0;
+    bool _is_failed = false;
+};
 //合并不同层次的倒排链表，返回合并后的长度
 template<typename ReverseNode, typename ReverseList>
 int level_merge(MergeSortIterator<ReverseNode>* new_iter, 
@@ -201,6 +324,7 @@ public:
     int64_t get_list = 0;
     int second_length = 0;
     int third_length = 0;
+    bool is_block = false;
 };
 class ReverseSearchStatistic {
 public:
@@ -219,11 +343,11 @@ public:
             DB_NOTICE("Reverse index item : term[%s], get_list[%ld]{"
                        "is_fast[%d]{get_new_fast[%ld] | seek_new[%ld],"
                        "seek_old[%ld], merge_one_one[%ld], get_two[%ld, %d], merge_one_two[%ld]},"
-                       "is_cache[%d], get_three[%ld, %d]{parse_nocache[%ld]}",
+                       "is_cache[%d], get_three[%ld, %d, is_block:%d]{parse_nocache[%ld]}",
                        item.term.c_str(), item.get_list, item.is_fast, item.get_new, 
                        item.seek_new, item.seek_old, item.merge_one_one, item.get_two, 
                        item.second_length, item.merge_one_two, item.is_cache, item.get_three, 
-                       item.third_length, item.parse);
+                       item.third_length, item.is_block, item.parse);
         }
     }
 };
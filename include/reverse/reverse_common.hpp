@@ -80,7 +80,7 @@ int FirstLevelMSIterator<ReverseNode>::next(std::string& key, bool& res) {
         //rocksdb::Status s;
         //rocksdb::ReadOptions read_opt;
         //rocksdb::PinnableSlice pin_slice;
-        auto data_cf = _rocksdb->get_data_handle();
+        auto data_cf = _data_cf;
         //s = _txn->GetForUpdate(read_opt, data_cf, _iter->key(), &pin_slice);
         //if (!s.ok()) {
         //    DB_WARNING("get for update failed:%s, term:%s, key:%s", s.ToString().c_str(), 
@@ -255,4 +255,198 @@ int level_merge(MergeSortIterator<ReverseNode>* new_iter,
     return result_count;
 }
 
+template<typename ReverseNode, typename ReverseList>
+void encode_reverse_block(const ReverseList& list, int begin, int end, std::string* value) {
+    uint32_t count = end - begin;
+    append_varint32(value, count);
+    size_t bitmap_pos = value->size();
+    value->append((count + 7) / 8, '\0');
+    const std::string* last_key = nullptr;
+    ReverseNode extra_node;
+    std::string extra;
+    for (int i = begin; i < end; ++i) {
+        const ReverseNode& node = list.reverse_nodes(i);
+        if (node.flag() == pb::REVERSE_NODE_DELETE) {
+            (*value)[bitmap_pos + (i - begin) / 8] |= (char)(1 << ((i - begin) % 8));
+        }
+        const std::string& key = node.key();
+        size_t shared = 0;
+        if (last_key != nullptr) {
+            size_t min_len = std::min(last_key->size(), key.size());
+            while (shared < min_len && (*last_key)[shared] == key[shared]) {
+                ++shared;
+            }
+        }
+        append_varint32(value, shared);
+        append_varint32(value, key.size() - shared);
+        value->append(key.data() + shared, key.size() - shared);
+        last_key = &key;
+        //key和flag已单独编码，其余字段序列化
+        extra_node = node;
+        extra_node.clear_key();
+        extra_node.clear_flag();
+        extra.clear();
+        extra_node.SerializePartialToString(&extra);
+        append_varint32(value, extra.size());
+        value->append(extra);
+    }
+}
+
+template<typename ReverseNode, typename ReverseList>
+int decode_reverse_block(const rocksdb::Slice& value, ReverseList* list) {
+    rocksdb::Slice input = value;
+    uint32_t count = 0;
+    if (!get_varint32(&input, &count)) {
+        return -1;
+    }
+    size_t bitmap_size = (count + 7) / 8;
+    if (input.size() < bitmap_size) {
+        return -1;
+    }
+    rocksdb::Slice bitmap(input.data(), bitmap_size);
+    input.remove_prefix(bitmap_size);
+    std::string key;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t shared = 0;
+        uint32_t non_shared = 0;
+        uint32_t extra_size = 0;
+        if (!get_varint32(&input, &shared) || !get_varint32(&input, &non_shared)
+                || shared > key.size() || input.size() < non_shared) {
+            return -1;
+        }
+        key.resize(shared);
+        key.append(input.data(), non_shared);
+        input.remove_prefix(non_shared);
+        if (!get_varint32(&input, &extra_size) || input.size() < extra_size) {
+            return -1;
+        }
+        ReverseNode* node = list->add_reverse_nodes();
+        if (extra_size > 0 && !node->ParsePartialFromArray(input.data(), extra_size)) {
+            return -1;
+        }
+        input.remove_prefix(extra_size);
+        node->set_key(key);
+        if ((bitmap[i / 8] >> (i % 8)) & 1) {
+            node->set_flag(pb::REVERSE_NODE_DELETE);
+        } else {
+            node->set_flag(pb::REVERSE_NODE_NORMAL);
+        }
+    }
+    return 0;
+}
+
+template<typename ReverseNode, typename ReverseList>
+BlockReverseList<ReverseNode, ReverseList>::BlockReverseList(
+                                        RocksWrapper* rocksdb,
+                                        rocksdb::ColumnFamilyHandle* data_cf,
+                                        const std::string& block_key_prefix,
+                                        pb::ReverseSkipTable& skip_table,
+                                        const rocksdb::Snapshot* snapshot) :
+                                            _rocksdb(rocksdb),
+                                            _data_cf(data_cf),
+                                            _block_key_prefix(block_key_prefix),
+                                            _snapshot(snapshot) {
+    _skip_table.Swap(&skip_table);
+    _block_offsets.reserve(_skip_table.blocks_size());
+    for (auto& block : _skip_table.blocks()) {
+        _block_offsets.push_back(_size);
+        _size += block.node_count();
+    }
+    _blocks.resize(_skip_table.blocks_size());
+}
+
+template<typename ReverseNode, typename ReverseList>
+int BlockReverseList<ReverseNode, ReverseList>::find_block(int idx) {
+    //顺序访问时一般落在当前块或下一个块
+    int block_count = _block_offsets.size();
+    for (int i = _cur_block; i < block_count && i < _cur_block + 2; ++i) {
+        if (idx >= _block_offsets[i] && (i + 1 == block_count || idx < _block_offsets[i + 1])) {
+            return i;
+        }
+    }
+    auto iter = std::upper_bound(_block_offsets.begin(), _block_offsets.end(), idx);
+    return iter - _block_offsets.begin() - 1;
+}
+
+template<typename ReverseNode, typename ReverseList>
+int BlockReverseList<ReverseNode, ReverseList>::load_block(int block_idx) {
+    if (_blocks[block_idx] != nullptr) {
+        return 0;
+    }
+    auto data_cf = _data_cf;
+    if (data_cf == nullptr) {
+        DB_WARNING("get rocksdb data column family failed");
+        _is_failed = true;
+        return -1;
+    }
+    std::string key = _block_key_prefix;
+    append_block_id(key, block_idx);
+    rocksdb::ReadOptions roptions;
+    roptions.snapshot = _snapshot;
+    std::string value;
+    auto get_res = _rocksdb->get(roptions, data_cf, key, &value);
+    if (!get_res.ok()) {
+        DB_FATAL("get reverse block failed, block:%d, code=%d, msg=%s",
+                block_idx, get_res.code(), get_res.ToString().c_str());
+        _is_failed = true;
+        return -1;
+    }
+    std::unique_ptr<ReverseList> block(new ReverseList());
+    if (decode_reverse_block<ReverseNode, ReverseList>(value, block.get()) != 0 ||
+            (uint32_t)block->reverse_nodes_size() != _skip_table.blocks(block_idx).node_count()) {
+        DB_FATAL("decode reverse block failed, block:%d", block_idx);
+        _is_failed = true;
+        return -1;
+    }
+    _blocks[block_idx] = std::move(block);
+    ++_loaded_block_count;
+    return 0;
+}
+
+template<typename ReverseNode, typename ReverseList>
+ReverseNode* BlockReverseList<ReverseNode, ReverseList>::node(int idx) {
+    if (idx < 0 || idx >= _size) {
+        return nullptr;
+    }
+    int block_idx = find_block(idx);
+    if (load_block(block_idx) != 0) {
+        return nullptr;
+    }
+    _cur_block = block_idx;
+    return _blocks[block_idx]->mutable_reverse_nodes(idx - _block_offsets[block_idx]);
+}
+
+template<typename ReverseNode, typename ReverseList>
+int BlockReverseList<ReverseNode, ReverseList>::lower_bound(int idx, const std::string& target) {
+    if (idx < 0 || idx >= _size) {
+        return -1;
+    }
+    int block_idx = find_block(idx);
+    //跳表中二分查找第一个last_key大于等于target的块
+    int first = block_idx;
+    int last = _skip_table.blocks_size();
+    while (first < last) {
+        int mid = first + ((last - first) >> 1);
+        if (_skip_table.blocks(mid).last_key().compare(target) < 0) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    if (first >= _skip_table.blocks_size()) {
+        return -1;
+    }
+    if (load_block(first) != 0) {
+        return -1;
+    }
+    _cur_block = first;
+    int begin = (first == block_idx) ? idx - _block_offsets[first] : 0;
+    auto& nodes = _blocks[first]->reverse_nodes();
+    auto iter = std::lower_bound(nodes.begin() + begin, nodes.end(), target,
+            [](const ReverseNode& node, const std::string& target) {
+                return node.key().compare(target) < 0;
+            });
+    return _block_offsets[first] + (iter - nodes.begin());
+}
+
 } // end of namespace
@@ -57,16 +57,20 @@ public:
                        std::vector<ExprNode*> conjuncts, 
                        bool is_fast = false) = 0;
     virtual bool valid() = 0;
+    //valid返回false时区分遍历结束和读取倒排链表失败
+    virtual bool is_failed() = 0;
     virtual void clear() = 0;
     virtual int get_next(SmartRecord record) = 0;
     virtual void sync(AtomicManager<std::atomic<long>>& am) = 0;
 
     //获取1、2level倒排集合和3level倒排，用于Parser获取底层数据
+    //3level按块存储时返回list_block_ptr，list_old_ptr为空
     virtual int get_reverse_list_two(
                        rocksdb::Transaction* txn,  
                        const std::string& term, 
                        MessageSP& list_new_ptr,
                        MessageSP& list_old_ptr,
+                       BlockListSP& list_block_ptr,
                        bool is_fast = false) = 0;
     //返回exe，用来给多个倒排索引字段join
     virtual int create_executor(
@@ -76,9 +80,13 @@ public:
                     const std::string& search_data,
                     std::vector<ExprNode*> conjuncts, 
                     BooleanExecutorBase*& exe,
-                    bool is_fast = false) = 0;
+                    bool is_fast = false,
+                    int64_t top_k = 0) = 0;
+    //top k检索时设置当前第k大的分数，低于该分数的文档不再返回
+    virtual void set_score_threshold(float threshold) = 0;
     virtual void set_second_level_length(int length) = 0;
-    virtual void set_cache_size(int size) = 0;
+    //缓存容量，单位字节，所有倒排索引共享
+    virtual void set_cache_size(int64_t size) = 0;
     virtual void set_cached_list_length(int length) = 0;
     virtual void print_reverse_statistic_log() = 0;
     virtual void add_field(const std::string& name, int32_t field_id) = 0;
@@ -91,16 +99,22 @@ public:
     SchemaBase() {
     }
     void init(ReverseIndexBase *reverse, rocksdb::Transaction *txn, 
-            const KeyRange& key_range, std::vector<ExprNode*> conjuncts, bool is_fast) {
+            const KeyRange& key_range, std::vector<ExprNode*> conjuncts, bool is_fast,
+            int64_t top_k = 0) {
         _reverse = reverse;
         _txn = txn;
         _key_range = key_range;
         _conjuncts = conjuncts;
         _is_fast = is_fast;
+        _top_k = top_k;
     }
     static int compare_id_func(const PrimaryIdT& id1, const PrimaryIdT& id2) {
         return id1.compare(id2);
     }
+    //节点的相关性分数，用于top k剪枝
+    static float score(const ReverseNode& node) {
+        return 0;
+    }
     // term filter，not return the node when true;
     static bool filter(const ReverseNode& node, BoolArg* arg) {
         return false;
@@ -114,8 +128,9 @@ public:
     int get_reverse_list(
                     const std::string& term, 
                     MessageSP& list_new, 
-                    MessageSP& list_old) {
-        return _reverse->get_reverse_list_two(_txn, term, list_new, list_old, _is_fast);
+                    MessageSP& list_old,
+                    BlockListSP& list_block) {
+        return _reverse->get_reverse_list_two(_txn, term, list_new, list_old, list_block, _is_fast);
     }
     virtual bool valid() {
         if (_exe != NULL) {
@@ -138,9 +153,17 @@ public:
     KeyRange key_range() {
         return _key_range;
     }
+    bool is_failed() {
+        return _exe != NULL && _exe->is_failed();
+    }
     BooleanExecutorBase*& exe() {
         return _exe;
     }
+    void set_score_threshold(float threshold) {
+        if (_exe != NULL) {
+            _exe->set_threshold(threshold);
+        }
+    }
     ReverseSearchStatistic& statistic() {
         return _statistic;
     }
@@ -164,6 +187,7 @@ protected:
     rocksdb::Transaction *_txn;//读取时用的transaction，由调用者释放
     KeyRange _key_range;
     bool _is_fast = false;
+    int64_t _top_k = 0;
     IndexInfo _index_info;
     TableInfo _table_info;
     ReverseSearchStatistic _statistic;
@@ -180,27 +204,22 @@ public:
             int64_t index_id, 
             int length, 
             RocksWrapper* rocksdb,
+            rocksdb::ColumnFamilyHandle* data_cf,
             pb::SegmentType segment_type = pb::S_DEFAULT,
             bool is_over_cache = true,
             bool is_seg_cache = true,
-            int cache_size = 300,
             int cached_list_length = 3000) : 
                         _region_id(region_id),
                         _index_id(index_id),
                         _second_level_length(length),
                         _rocksdb(rocksdb),
+                        _data_cf(data_cf),
                         _segment_type(segment_type),
                         _is_over_cache(is_over_cache),
                         _is_seg_cache(is_seg_cache),
                         _cached_list_length(cached_list_length) {
         _sync_prefix_0 = 0;
         _sync_prefix_1 = 0;
-        if (is_over_cache) {
-            _cache.init(cache_size);
-        }
-        if (is_seg_cache) {
-            _seg_cache.init(cache_size);
-        }
     }
     ~ReverseIndex(){}
 
@@ -225,10 +244,19 @@ public:
                        const TableInfo& table_info,
                        const std::string& search_data,
                        std::vector<ExprNode*> conjuncts, 
-                       bool is_fast = false); 
+                       bool is_fast = false,
+                       int64_t top_k = 0); 
     virtual bool valid() {
         return _schema->valid();
     }
+    virtual bool is_failed() {
+        return _schema != nullptr && _schema->is_failed();
+    }
+    virtual void set_score_threshold(float threshold) {
+        if (_schema != nullptr) {
+            _schema->set_score_threshold(threshold);
+        }
+    }
     // release immediately
     virtual void clear() {
         TimeCost timer;
@@ -244,6 +272,7 @@ public:
                        const std::string& term, 
                        MessageSP& list_new,
                        MessageSP& list_old,
+                       BlockListSP& list_block,
                        bool is_fast = false);
     virtual int create_executor(
                     rocksdb::Transaction* txn,
@@ -252,7 +281,8 @@ public:
                     const std::string& search_data,
                     std::vector<ExprNode*> conjuncts, 
                     BooleanExecutorBase*& exe,
-                    bool is_fast = false);
+                    bool is_fast = false,
+                    int64_t top_k = 0);
     //读写和merge同步
     void sync(AtomicManager<std::atomic<long>>& am) {
         if (_reverse_prefix == 0) {
@@ -264,8 +294,8 @@ public:
     void set_second_level_length(int length) {
         _second_level_length = length;
     }
-    void set_cache_size(int size) {
-        _cache.init(size);
+    void set_cache_size(int64_t size) {
+        reverse_list_cache().init(size);
     }
     void set_cached_list_length(int length) {
         _cached_list_length = length;
@@ -293,13 +323,31 @@ private:
     //first(0/1) level merge to second(2) level
     int _reverse_merge_to_second_level(std::unique_ptr<rocksdb::Iterator>&, uint8_t);
     //get some level list
+    //level3按块存储时：block_list不为空则返回延迟读取的块链表，否则读取全部块，
+    //skip_table不为空时返回跳表，用于重写时删除旧块
     int _get_level_reverse_list(
                     rocksdb::Transaction* txn, 
                     uint8_t level, 
                     const std::string& term, 
                     MessageSP& list,
                     bool is_statistic = false,
-                    bool is_over_cache = false);
+                    bool is_over_cache = false,
+                    BlockListSP* block_list = nullptr,
+                    pb::ReverseSkipTable* skip_table = nullptr);
+    //key = tableid_regionid_4_term_\0_version
+    int _create_block_key_prefix(const std::string& term, uint64_t version, std::string& key);
+    //读取跳表对应的全部块
+    int _read_reverse_blocks(
+                    rocksdb::Transaction* txn,
+                    const std::string& term,
+                    const pb::ReverseSkipTable& skip_table,
+                    ReverseList* list);
+    //写3level链表，开启块存储且链表超过一个块时分块写入，并删除old_skip_table对应的旧块
+    int _put_third_level_list(
+                    rocksdb::Transaction* txn,
+                    const std::string& term,
+                    const ReverseList& list,
+                    const pb::ReverseSkipTable& old_skip_table);
     //delete some level list
     int _delete_level_reverse_list(
                     rocksdb::Transaction* txn, 
@@ -321,14 +369,14 @@ private:
     std::atomic<long>    _sync_prefix_1;
     int                 _second_level_length;
     RocksWrapper*       _rocksdb;
+    // region数据所在的column family
+    rocksdb::ColumnFamilyHandle* _data_cf;
     KeyRange            _key_range;
     bool                _prefix_0_succ = false;
     bool                _merge_success_flag = true;
     int64_t             _level_1_scan_count = 0;
     // todo: replace thread_local because bthread will switch thread
     static thread_local SchemaBase<ReverseNode, ReverseList>* _schema;
-    Cache<std::string, std::shared_ptr<google::protobuf::Message>> _cache;
-    Cache<uint64_t, std::shared_ptr<std::map<std::string, ReverseNode>>> _seg_cache;
     pb::SegmentType _segment_type;
     bool _is_over_cache;
     bool _is_seg_cache;
@@ -359,7 +407,13 @@ public:
             const TableInfo& table_info,
             const std::vector<ReverseIndexBase*>& reverse_indexes,
             const std::vector<std::string>& search_datas,
-            bool is_fast, bool bool_or); 
+            bool is_fast, bool bool_or, int64_t top_k = 0); 
+    //top k检索时设置当前第k大的分数，只在多个索引做or时生效
+    void set_score_threshold(float threshold) {
+        if (_exe != nullptr) {
+            _exe->set_threshold(threshold);
+        }
+    }
     bool valid() {
         if (_exe != NULL) {
             while (true) {
@@ -392,6 +446,17 @@ public:
             }
         }
     }
+    bool is_failed() {
+        if (_exe != NULL) {
+            return _exe->is_failed();
+        }
+        for (auto exe : _son_exe_vec) {
+            if (exe != nullptr && exe->is_failed()) {
+                return true;
+            }
+        }
+        return false;
+    }
     int get_next(SmartRecord record) {
         if (!_cur_node) {
             return -1;
@@ -65,7 +65,7 @@ int ReverseIndex<Schema>::reverse_merge_func(pb::RegionInfo info, bool need_remo
     roptions.iterate_upper_bound = &upper_bound_slice;
     roptions.prefix_same_as_start = true;
     roptions.total_order_seek = false;
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
@@ -85,7 +85,7 @@ int ReverseIndex<Schema>::reverse_merge_func(pb::RegionInfo info, bool need_remo
         DB_DEBUG("seek end merge dowith time:%ld, seek time:%ld, region_id:%ld, cache:%s, "
                 "seg_cache:%s, prefix:%d,level_1_scan_count:%ld", 
                 timer.get_time(), seek_time, _region_id, 
-                _cache.get_info().c_str(), _seg_cache.get_info().c_str(), prefix, _level_1_scan_count);
+                reverse_list_cache().get_info().c_str(), reverse_seg_cache().get_info().c_str(), prefix, _level_1_scan_count);
         return 0;
     }
     while (true) {
@@ -94,7 +94,7 @@ int ReverseIndex<Schema>::reverse_merge_func(pb::RegionInfo info, bool need_remo
             DB_WARNING("error merge dowith time:%ld, seek time:%ld, region_id:%ld, cache:%s, "
                     "seg_cache:%s, prefix:%d,level_1_scan_count:%ld", 
                     timer.get_time(), seek_time, _region_id, 
-                    _cache.get_info().c_str(), _seg_cache.get_info().c_str(), prefix, _level_1_scan_count);
+                    reverse_list_cache().get_info().c_str(), reverse_seg_cache().get_info().c_str(), prefix, _level_1_scan_count);
             return -1;
         } 
         if (status == 1) {
@@ -105,7 +105,7 @@ int ReverseIndex<Schema>::reverse_merge_func(pb::RegionInfo info, bool need_remo
     //清理旧缓存
     if (_is_over_cache) {
         for (auto& key: _cache_keys) {
-            _cache.del(key);
+            reverse_list_cache().del(key);
         }
     }
     
@@ -127,7 +127,7 @@ int ReverseIndex<Schema>::reverse_merge_func(pb::RegionInfo info, bool need_remo
     DB_WARNING("merge dowith time:%ld, seek time:%ld, region_id:%ld, index_id:%ld, cache:%s, "
     "seg_cache:%s, prefix:%d,level_1_scan_count:%ld", 
             timer.get_time(), seek_time, _region_id, _index_id, 
-            _cache.get_info().c_str(), _seg_cache.get_info().c_str(), prefix, _level_1_scan_count);
+            reverse_list_cache().get_info().c_str(), reverse_seg_cache().get_info().c_str(), prefix, _level_1_scan_count);
     return 0;
 }
 
@@ -144,16 +144,23 @@ int ReverseIndex<Schema>::handle_reverse(
         return 0;
     }
     int8_t status;
-    std::shared_ptr<std::map<std::string, ReverseNode>> cache_seg_res;
+    std::shared_ptr<void> cache_seg_res;
     std::shared_ptr<std::map<std::string, ReverseNode>> seg_res =
         std::make_shared<std::map<std::string, ReverseNode>>();
     if (_is_seg_cache) {
-        uint64_t key = make_sign(word);
-        if (_seg_cache.find(key, &cache_seg_res) != 0) {
+        //分词结果和索引的分词类型相关，key带上index_id
+        std::string sign_key((char*)&_index_id, sizeof(int64_t));
+        sign_key.append(word);
+        uint64_t key = make_sign(sign_key);
+        if (reverse_seg_cache().find(key, &cache_seg_res) != 0) {
             Schema::segment(word, pk, record, _segment_type, _name_field_id_map, flag, *seg_res);
-            _seg_cache.add(key, seg_res);
+            size_t charge = word.size();
+            for (auto& pair : *seg_res) {
+                charge += pair.first.size() + sizeof(ReverseNode) + pair.second.key().size();
+            }
+            reverse_seg_cache().add(key, seg_res, charge);
         } else {
-            *seg_res = *cache_seg_res;
+            *seg_res = *std::static_pointer_cast<std::map<std::string, ReverseNode>>(cache_seg_res);
             // 填充pk，flag信息
             Schema::segment(word, pk, record, _segment_type, _name_field_id_map, flag, *seg_res);
         }
@@ -198,10 +205,12 @@ int ReverseIndex<Schema>::search(
                        const TableInfo& table_info,
                        const std::string& search_data,
                        std::vector<ExprNode*> conjuncts, 
-                       bool is_fast) {
+                       bool is_fast,
+                       int64_t top_k) {
     BooleanExecutorBase* exe = nullptr;
     TimeCost time;
-    int ret = create_executor(txn, index_info, table_info, search_data, conjuncts, exe, is_fast);
+    int ret = create_executor(txn, index_info, table_info, search_data, conjuncts, exe, 
+            is_fast, top_k);
     if (ret < 0) {
         return -1;
     }
@@ -217,10 +226,11 @@ int ReverseIndex<Schema>::get_reverse_list_two(
                                     const std::string& term, 
                                     MessageSP& list_new_ptr,
                                     MessageSP& list_old_ptr,
+                                    BlockListSP& list_block_ptr,
                                     bool is_fast) {
     rocksdb::ReadOptions roptions;
     roptions.prefix_same_as_start = true;
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return 0;
@@ -266,7 +276,7 @@ int ReverseIndex<Schema>::get_reverse_list_two(
         timer_tmp.reset();
     }
 
-    _get_level_reverse_list(txn, 3, term, list_old_ptr, true, true);
+    _get_level_reverse_list(txn, 3, term, list_old_ptr, true, true, &list_block_ptr);
     ReverseList* tmp = nullptr;
     tmp = (ReverseList*)list_new_ptr.get();
     if (tmp != nullptr) {
@@ -276,6 +286,8 @@ int ReverseIndex<Schema>::get_reverse_list_two(
     tmp = (ReverseList*)list_old_ptr.get();
     if (tmp != nullptr) { 
         item_statistic.third_length = tmp->reverse_nodes_size();
+    } else if (list_block_ptr != nullptr) {
+        item_statistic.third_length = list_block_ptr->size();
     }
     item_statistic.get_three += timer_tmp.get_time();
     item_statistic.get_list += timer.get_time();
@@ -290,10 +302,11 @@ int ReverseIndex<Schema>::create_executor(
                             const std::string& search_data, 
                             std::vector<ExprNode*> conjuncts, 
                             BooleanExecutorBase*& exe,
-                            bool is_fast) {
+                            bool is_fast,
+                            int64_t top_k) {
     TimeCost timer;
     _schema = new Schema();
-    _schema->init(this, txn, _key_range, conjuncts, is_fast);
+    _schema->init(this, txn, _key_range, conjuncts, is_fast, top_k);
     timer.reset();
     _schema->set_index_info(index_info);
     _schema->set_table_info(table_info);
@@ -335,7 +348,7 @@ int ReverseIndex<Schema>::_reverse_remove_range_for_third_level(uint8_t prefix)
     rocksdb::ReadOptions roptions;
     roptions.iterate_upper_bound = &upper_bound_slice;
     roptions.prefix_same_as_start = true;
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
@@ -365,13 +378,31 @@ int ReverseIndex<Schema>::_reverse_remove_range_for_third_level(uint8_t prefix)
         // 搞个空的level2，用来帮助merge
         MessageSP second_level_list(new ReverseList());
         MessageSP third_level_list(new ReverseList());
+        ReverseList& third_msg = static_cast<ReverseList&>(*third_level_list);
+        pb::ReverseSkipTable third_skip_table;
         //deserialize
-        if (!third_level_list->ParseFromArray(iter->value().data(), iter->value().size())) {
+        if (is_block_reverse_list(iter->value())) {
+            if (!third_skip_table.ParseFromArray(iter->value().data() + 1, iter->value().size() - 1)) {
+                DB_FATAL("parse skip table failed, region_id: %ld, index_id: %ld",
+                        _region_id, _index_id);
+                return -1;
+            }
+            // 跳表中有首尾key，在范围内时不需要读取块
+            int block_count = third_skip_table.blocks_size();
+            if (block_count > 0 &&
+                    third_skip_table.blocks(0).first_key() >= _key_range.first &&
+                    end_key_compare(third_skip_table.blocks(block_count - 1).last_key(),
+                        _key_range.second) < 0) {
+                continue;
+            }
+            if (_read_reverse_blocks(txn->get_txn(), merge_term, third_skip_table, &third_msg) != 0) {
+                return -1;
+            }
+        } else if (!third_level_list->ParseFromArray(iter->value().data(), iter->value().size())) {
             DB_FATAL("parse level %d list from pb failed, region_id: %ld, index_id: %ld",
                     prefix, _region_id, _index_id);
             return -1;
         }
-        ReverseList& third_msg = static_cast<ReverseList&>(*third_level_list);
         int old_count = third_msg.reverse_nodes_size();
         scan_node_count += old_count;
         if (old_count > 0) {
@@ -411,7 +442,15 @@ int ReverseIndex<Schema>::_reverse_remove_range_for_third_level(uint8_t prefix)
                     _region_id, _index_id);
             return -1;
         }
-        if (result_count > 0) {
+        if (prefix == 3) {
+            if (result_count == 0) {
+                ++remove_rows;
+            }
+            if (_put_third_level_list(txn->get_txn(), merge_term, 
+                        *new_third_level_list, third_skip_table) != 0) {
+                return -1;
+            }
+        } else if (result_count > 0) {
             auto put_res = txn->get_txn()->Put(data_cf, iter->key(), value);
             if (!put_res.ok()) {
                 DB_FATAL("index_id: %ld, old_count: %d, rocksdb put error: code=%d, msg=%s",
@@ -457,13 +496,14 @@ int ReverseIndex<Schema>::_reverse_merge_to_second_level(
     //get merge term
     std::string merge_term = get_term_from_reverse_key(iterator->key());
     FirstLevelMSIterator<ReverseNode> first_iter(iterator, prefix, 
-                                        _key_range, merge_term, true, _rocksdb, txn->get_txn());
+                                        _key_range, merge_term, true, _rocksdb, txn->get_txn(),
+                                        _data_cf);
     //create second level key
     std::string second_level_key;
     _create_reverse_key_prefix(2, second_level_key);
     second_level_key.append(merge_term);
     //get second level reverse list
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
@@ -509,7 +549,9 @@ int ReverseIndex<Schema>::_reverse_merge_to_second_level(
         SmartTransaction txn_level2(new Transaction(0, nullptr, false));
         txn_level2->begin();
         MessageSP third_level_list(new ReverseList());
-        status = _get_level_reverse_list(txn_level2->get_txn(), 3, merge_term, third_level_list);
+        pb::ReverseSkipTable third_skip_table;
+        status = _get_level_reverse_list(txn_level2->get_txn(), 3, merge_term, third_level_list,
+                false, false, nullptr, &third_skip_table);
         if (status != 0) {
             return -1;
         }
@@ -525,27 +567,12 @@ int ReverseIndex<Schema>::_reverse_merge_to_second_level(
             DB_WARNING("merge 2 and 3 failed");
             return -1;
         }   
-        if (!new_third_level_list->SerializeToString(&value)) {
-            DB_WARNING("serialize failed");
-            return -1;
-        }
         std::string third_level_key;
         _create_reverse_key_prefix(3, third_level_key);
         third_level_key.append(merge_term);
-        if (result_count > 0) {
-            auto put_res = txn_level2->get_txn()->Put(data_cf, third_level_key, value);
-            if (!put_res.ok()) {
-                DB_WARNING("rocksdb put error: code=%d, msg=%s",
-                        put_res.code(), put_res.ToString().c_str());
-                return -1;
-            }
-        } else {
-            auto del_res = txn_level2->get_txn()->Delete(data_cf, third_level_key);
-            if (!del_res.ok()) {
-                DB_WARNING("rocksdb del error: code=%d, msg=%s",
-                        del_res.code(), del_res.ToString().c_str());
-                return -1;
-            }
+        if (_put_third_level_list(txn_level2->get_txn(), merge_term,
+                    *new_third_level_list, third_skip_table) != 0) {
+            return -1;
         }
         status = _delete_level_reverse_list(txn_level2->get_txn(), 2, merge_term);
         if (status != 0) {
@@ -571,12 +598,14 @@ int ReverseIndex<Schema>::_get_level_reverse_list(
                                     const std::string& term, 
                                     MessageSP& list_ptr,
                                     bool is_statistic,
-                                    bool is_over_cache) {
+                                    bool is_over_cache,
+                                    BlockListSP* block_list_ptr,
+                                    pb::ReverseSkipTable* skip_table) {
     std::string key;
     _create_reverse_key_prefix(level, key);
     key.append(term);
     rocksdb::ReadOptions roptions;
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
@@ -590,9 +619,9 @@ int ReverseIndex<Schema>::_get_level_reverse_list(
     }
     TimeCost time;
     if (_is_over_cache) {
-        //cache key is same as db key
+        //cache key is same as db key, unique in process
         if (is_over_cache) {
-            if (_cache.find(key, &list_ptr) == 0) {
+            if (reverse_list_cache().find(key, &list_ptr) == 0) {
                 if (item_statistic) {
                     item_statistic->is_cache = true;
                 }
@@ -600,9 +629,49 @@ int ReverseIndex<Schema>::_get_level_reverse_list(
             }
         }
     }
+    // 块链表在检索过程中延迟读取，跳表和块用同一个快照读
+    const rocksdb::Snapshot* snapshot = nullptr;
+    if (block_list_ptr != nullptr) {
+        snapshot = _rocksdb->get_snapshot();
+        roptions.snapshot = snapshot;
+    }
     std::string value;
     auto get_res = txn->Get(roptions, data_cf, key, &value);      
     time.reset();
+    if (get_res.ok() && is_block_reverse_list(value)) {
+        pb::ReverseSkipTable tmp_skip_table;
+        if (!tmp_skip_table.ParseFromArray(value.data() + 1, value.size() - 1)) {
+            DB_FATAL("parse skip table failed, region_id: %ld, index_id: %ld",
+                    _region_id, _index_id);
+            if (snapshot != nullptr) {
+                _rocksdb->relase_snapshot(snapshot);
+            }
+            return -1;
+        }
+        if (block_list_ptr != nullptr) {
+            std::string block_key_prefix;
+            _create_block_key_prefix(term, tmp_skip_table.version(), block_key_prefix);
+            block_list_ptr->reset(new BlockReverseList<ReverseNode, ReverseList>(
+                        _rocksdb, _data_cf, block_key_prefix, tmp_skip_table, snapshot));
+            if (item_statistic) {
+                item_statistic->is_block = true;
+                item_statistic->parse += time.get_time();
+            }
+            return 0;
+        }
+        MessageSP tmp_ptr(new ReverseList());
+        if (_read_reverse_blocks(txn, term, tmp_skip_table, (ReverseList*)tmp_ptr.get()) != 0) {
+            return -1;
+        }
+        list_ptr = tmp_ptr;
+        if (skip_table != nullptr) {
+            skip_table->Swap(&tmp_skip_table);
+        }
+        return 0;
+    }
+    if (snapshot != nullptr) {
+        _rocksdb->relase_snapshot(snapshot);
+    }
     if (get_res.ok()) {
         //deserialize
         MessageSP tmp_ptr(new ReverseList());
@@ -617,7 +686,8 @@ int ReverseIndex<Schema>::_get_level_reverse_list(
         if (_is_over_cache) {
             if (is_over_cache) {
                 if (((ReverseList*)tmp_ptr.get())->reverse_nodes_size() >= _cached_list_length) {
-                    _cache.add(key, tmp_ptr);
+                    // 解析后的pb比序列化数据大，按2倍估算
+                    reverse_list_cache().add(key, tmp_ptr, value.size() * 2);
                 }
             }
         }
@@ -630,6 +700,138 @@ int ReverseIndex<Schema>::_get_level_reverse_list(
     return 0;
 }
 
+template <typename Schema>
+int ReverseIndex<Schema>::_create_block_key_prefix(
+                                    const std::string& term,
+                                    uint64_t version,
+                                    std::string& key) {
+    _create_reverse_key_prefix(REVERSE_BLOCK_LEVEL, key);
+    key.append(term);
+    key.append(1, '\0');
+    append_block_version(key, version);
+    return 0;
+}
+
+template <typename Schema>
+int ReverseIndex<Schema>::_read_reverse_blocks(
+                                    rocksdb::Transaction* txn,
+                                    const std::string& term,
+                                    const pb::ReverseSkipTable& skip_table,
+                                    ReverseList* list) {
+    auto data_cf = _data_cf;
+    if (data_cf == nullptr) {
+        DB_WARNING("get rocksdb data column family failed");
+        return -1;
+    }
+    std::string block_key_prefix;
+    _create_block_key_prefix(term, skip_table.version(), block_key_prefix);
+    rocksdb::ReadOptions roptions;
+    for (int i = 0; i < skip_table.blocks_size(); ++i) {
+        std::string key = block_key_prefix;
+        append_block_id(key, i);
+        std::string value;
+        auto get_res = txn->Get(roptions, data_cf, key, &value);
+        if (!get_res.ok()) {
+            DB_FATAL("get reverse block failed, region_id: %ld, index_id: %ld, block: %d, "
+                    "code=%d, msg=%s", _region_id, _index_id, i, 
+                    get_res.code(), get_res.ToString().c_str());
+            return -1;
+        }
+        if (decode_reverse_block<ReverseNode, ReverseList>(value, list) != 0) {
+            DB_FATAL("decode reverse block failed, region_id: %ld, index_id: %ld, block: %d",
+                    _region_id, _index_id, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+template <typename Schema>
+int ReverseIndex<Schema>::_put_third_level_list(
+                                    rocksdb::Transaction* txn,
+                                    const std::string& term,
+                                    const ReverseList& list,
+                                    const pb::ReverseSkipTable& old_skip_table) {
+    auto data_cf = _data_cf;
+    if (data_cf == nullptr) {
+        DB_WARNING("get rocksdb data column family failed");
+        return -1;
+    }
+    std::string third_level_key;
+    _create_reverse_key_prefix(3, third_level_key);
+    third_level_key.append(term);
+    int count = list.reverse_nodes_size();
+    int block_size = std::max(FLAGS_reverse_block_size, 1);
+    std::string value;
+    if (count == 0) {
+        auto del_res = txn->Delete(data_cf, third_level_key);
+        if (!del_res.ok()) {
+            DB_WARNING("rocksdb del error: code=%d, msg=%s",
+                    del_res.code(), del_res.ToString().c_str());
+            return -1;
+        }
+    } else if (FLAGS_reverse_block_posting && count > block_size) {
+        pb::ReverseSkipTable skip_table;
+        skip_table.set_version(old_skip_table.version() + 1);
+        std::string block_key_prefix;
+        _create_block_key_prefix(term, skip_table.version(), block_key_prefix);
+        for (int begin = 0; begin < count; begin += block_size) {
+            int end = std::min(begin + block_size, count);
+            std::string block_key = block_key_prefix;
+            append_block_id(block_key, skip_table.blocks_size());
+            std::string block_value;
+            encode_reverse_block<ReverseNode, ReverseList>(list, begin, end, &block_value);
+            auto put_res = txn->Put(data_cf, block_key, block_value);
+            if (!put_res.ok()) {
+                DB_WARNING("rocksdb put error: code=%d, msg=%s",
+                        put_res.code(), put_res.ToString().c_str());
+                return -1;
+            }
+            pb::ReverseBlockMeta* block = skip_table.add_blocks();
+            block->set_first_key(list.reverse_nodes(begin).key());
+            block->set_last_key(list.reverse_nodes(end - 1).key());
+            block->set_node_count(end - begin);
+            float max_score = 0;
+            for (int i = begin; i < end; ++i) {
+                max_score = std::max(max_score, Schema::score(list.reverse_nodes(i)));
+            }
+            block->set_max_score(max_score);
+        }
+        value.append(1, REVERSE_BLOCK_MAGIC);
+        if (!skip_table.AppendToString(&value)) {
+            DB_WARNING("serialize skip table failed");
+            return -1;
+        }
+    } else if (!list.SerializeToString(&value)) {
+        DB_WARNING("serialize failed");
+        return -1;
+    }
+    if (count > 0) {
+        auto put_res = txn->Put(data_cf, third_level_key, value);
+        if (!put_res.ok()) {
+            DB_WARNING("rocksdb put error: code=%d, msg=%s",
+                    put_res.code(), put_res.ToString().c_str());
+            return -1;
+        }
+    }
+    // 旧版本的块，进行中的检索通过快照仍可读到
+    if (old_skip_table.blocks_size() > 0) {
+        std::string old_block_key_prefix;
+        _create_block_key_prefix(term, old_skip_table.version(), old_block_key_prefix);
+        for (int i = 0; i < old_skip_table.blocks_size(); ++i) {
+            std::string block_key = old_block_key_prefix;
+            append_block_id(block_key, i);
+            auto del_res = txn->Delete(data_cf, block_key);
+            if (!del_res.ok()) {
+                DB_WARNING("rocksdb del error: code=%d, msg=%s",
+                        del_res.code(), del_res.ToString().c_str());
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
 template <typename Schema>
 int ReverseIndex<Schema>::_delete_level_reverse_list(
                                     rocksdb::Transaction* txn, 
@@ -638,7 +840,7 @@ int ReverseIndex<Schema>::_delete_level_reverse_list(
     std::string key;
     _create_reverse_key_prefix(level, key);
     key.append(term);
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
@@ -671,7 +873,7 @@ int ReverseIndex<Schema>::_insert_one_reverse_node(
         return -1;
     }
     // 3. put to RocksDB
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
@@ -702,7 +904,7 @@ int MutilReverseIndex<Schema>::search(
                        const TableInfo& table_info,
                        const std::vector<ReverseIndexBase*>& reverse_indexes,
                        const std::vector<std::string>& search_datas,
-                       bool is_fast, bool bool_or) {
+                       bool is_fast, bool bool_or, int64_t top_k) {
     uint32_t son_size = reverse_indexes.size();
     if (son_size == 0) {
         _exe = nullptr;
@@ -724,7 +926,14 @@ int MutilReverseIndex<Schema>::search(
         } 
         reverse_indexes[i]->print_reverse_statistic_log();
     } 
-    if (bool_or) {
+    if (bool_or && top_k > 0) {
+        _exe = new WandBooleanExecutor<Schema>(type, nullptr);
+        for (int i = 0; i < son_size; ++i) {
+            if (_son_exe_vec[i]) {
+                _exe->add((BooleanExecutor<Schema>*)_son_exe_vec[i]);
+            }
+        }
+    } else if (bool_or) {
         _exe = new OrBooleanExecutor<Schema>(type, nullptr);
         _exe->set_merge_func(Schema::merge_or);
         for (int i = 0; i < son_size; ++i) {
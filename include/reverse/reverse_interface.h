@@ -44,16 +44,31 @@ public:
     //只进不退
     const ReverseNode* next();
     const ReverseNode* advance(const std::string& target_id);
+    //链表节点分数的上界，第一次调用时计算
+    float max_score();
+    //按块存储的3层链表读取块失败
+    bool is_failed() {
+        return _old_block_list != nullptr && _old_block_list->is_failed();
+    }
 private:
     //二分查找，大于或等于
     uint32_t binary_search(uint32_t first, 
                            uint32_t last, 
                            const std::string& target_id, 
                            ReverseList* list);
+    //3层链表可能是整个pb或者按块存储
+    ReverseNode* old_node(int32_t ix) {
+        if (_old_block_list != nullptr) {
+            return _old_block_list->node(ix);
+        }
+        return _old_list->mutable_reverse_nodes(ix);
+    }
     MessageSP _new_list_ptr;
     MessageSP _old_list_ptr;
+    BlockListSP _old_block_list_ptr;
     ReverseList* _new_list;
     ReverseList* _old_list;
+    BlockReverseList<ReverseNode, ReverseList>* _old_block_list;
     int32_t _curr_ix_new;//-1表示链表遍历结束，大于等于0表示链表当前节点
     int32_t _curr_ix_old;
     uint32_t _list_size_new;//链表的长度
@@ -63,6 +78,7 @@ private:
     int _cmp_res;//确定当前使用的node
     ReverseNode* _curr_node; // nullptr 代表遍历结束
     KeyRange _key_range;
+    float _max_score = -1;
 };
 
 //--common
@@ -96,6 +112,9 @@ public:
         to.set_weight(std::max(to.weight(), from.weight()));
         return 0;
     }
+    static float score(const ReverseNode& node) {
+        return node.weight();
+    }
     static int merge_weight(
                     ReverseNode& to, 
                     const ReverseNode& from, 
@@ -154,6 +173,9 @@ public:
     static int merge_and(ReverseNode& to, const ReverseNode& from, BoolArg* arg);
     static int merge_or(ReverseNode& to, const ReverseNode& from, BoolArg* arg);
     static int merge_weight(ReverseNode& to, const ReverseNode& from, BoolArg* arg);
+    static float score(const ReverseNode& node) {
+        return node.weight();
+    }
     static void init_node(ReverseNode& node, const std::string& term, BoolArg* arg);
     static bool filter(const ReverseNode& node, BoolArg* arg);
     //saerch_data json格式 
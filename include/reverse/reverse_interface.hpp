@@ -26,9 +26,16 @@ int CommRindexNodeParser<Schema>::init(const std::string& term) {
         *this = *exist_parser;
         return 0;
     }
-    this->_schema->get_reverse_list(term, _new_list_ptr, _old_list_ptr);
+    this->_schema->get_reverse_list(term, _new_list_ptr, _old_list_ptr, _old_block_list_ptr);
     _new_list = (ReverseList*)_new_list_ptr.get();
     _old_list = (ReverseList*)_old_list_ptr.get();
+    _old_block_list = (BlockReverseList<ReverseNode, ReverseList>*)_old_block_list_ptr.get();
+    _list_size_old = 0;
+    if (_old_block_list != nullptr) {
+        _list_size_old = _old_block_list->size();
+    } else if (_old_list != nullptr) {
+        _list_size_old = _old_list->reverse_nodes_size();
+    }
     _curr_node = nullptr;
     if (_new_list != nullptr && _new_list->reverse_nodes_size() > 0) {
         _list_size_new = _new_list->reverse_nodes_size();
@@ -40,17 +47,16 @@ int CommRindexNodeParser<Schema>::init(const std::string& term) {
         _curr_ix_new = -1;
         _cmp_res = 1;
     }
-    if (_old_list != nullptr && _old_list->reverse_nodes_size() > 0) {
-        _list_size_old = _old_list->reverse_nodes_size();
+    if (_list_size_old > 0 && old_node(0) != nullptr) {
         _curr_ix_old = 0;
-        _curr_id_old = _old_list->mutable_reverse_nodes(0)->mutable_key();
+        _curr_id_old = old_node(0)->mutable_key();
         if (_curr_ix_new != -1) {
             _cmp_res = _curr_id_new->compare(*_curr_id_old);
             if (_cmp_res > 0) {
-                _curr_node = _old_list->mutable_reverse_nodes(0);
+                _curr_node = old_node(0);
             } 
         } else {
-            _curr_node = _old_list->mutable_reverse_nodes(0);
+            _curr_node = old_node(0);
         }
     } else {
         _curr_ix_old = -1;
@@ -94,10 +100,10 @@ const typename Schema::ReverseNode* CommRindexNodeParser<Schema>::next() {
         } else {
             _curr_id_new = _new_list->mutable_reverse_nodes(_curr_ix_new)->mutable_key();
         }
-        if (_curr_ix_old >= _list_size_old) {
+        if (_curr_ix_old >= (int32_t)_list_size_old || old_node(_curr_ix_old) == nullptr) {
             _curr_ix_old = -1;
         } else {
-            _curr_id_old = _old_list->mutable_reverse_nodes(_curr_ix_old)->mutable_key();
+            _curr_id_old = old_node(_curr_ix_old)->mutable_key();
         }
 
         if (_curr_ix_new != -1 && _curr_ix_old != -1) {
@@ -114,7 +120,7 @@ const typename Schema::ReverseNode* CommRindexNodeParser<Schema>::next() {
         if (_cmp_res <= 0) { 
             _curr_node = _new_list->mutable_reverse_nodes(_curr_ix_new);
         } else {
-            _curr_node = _old_list->mutable_reverse_nodes(_curr_ix_old);
+            _curr_node = old_node(_curr_ix_old);
         }
         if (!_key_range.second.empty() && _curr_node->key() >= _key_range.second) {
             _curr_node = nullptr;
@@ -174,10 +180,18 @@ const typename Schema::ReverseNode*
         }
 
         if (_curr_ix_old != -1) {
-            _curr_ix_old = binary_search(_curr_ix_old, _list_size_old - 1, target_id, _old_list);
+            if (_old_block_list != nullptr) {
+                //先在跳表中定位块，只读取解码命中的块
+                _curr_ix_old = _old_block_list->lower_bound(_curr_ix_old, target_id);
+            } else {
+                _curr_ix_old = binary_search(_curr_ix_old, _list_size_old - 1, target_id, _old_list);
+            }
+        }
+        if (_curr_ix_old != -1 && old_node(_curr_ix_old) == nullptr) {
+            _curr_ix_old = -1;
         }
         if (_curr_ix_old != -1) {
-            _curr_id_old = _old_list->mutable_reverse_nodes(_curr_ix_old)->mutable_key();
+            _curr_id_old = old_node(_curr_ix_old)->mutable_key();
         }
 
         if (_curr_ix_new != -1 && _curr_ix_old != -1) {
@@ -194,7 +208,7 @@ const typename Schema::ReverseNode*
         if (_cmp_res <= 0) { 
             _curr_node = _new_list->mutable_reverse_nodes(_curr_ix_new);
         } else {
-            _curr_node = _old_list->mutable_reverse_nodes(_curr_ix_old);
+            _curr_node = old_node(_curr_ix_old);
         }
         
         if (!_key_range.second.empty() && _curr_node->key() >= _key_range.second) {
@@ -204,4 +218,27 @@ const typename Schema::ReverseNode*
     }
 }
 
+template<typename Schema>
+float CommRindexNodeParser<Schema>::max_score() {
+    if (_max_score >= 0) {
+        return _max_score;
+    }
+    float score = 0;
+    if (_new_list != nullptr) {
+        for (auto& node : _new_list->reverse_nodes()) {
+            score = std::max(score, Schema::score(node));
+        }
+    }
+    if (_old_block_list != nullptr) {
+        //按块存储时使用跳表中记录的块上界，不读取块
+        score = std::max(score, _old_block_list->max_score());
+    } else if (_old_list != nullptr) {
+        for (auto& node : _old_list->reverse_nodes()) {
+            score = std::max(score, Schema::score(node));
+        }
+    }
+    _max_score = score;
+    return _max_score;
+}
+
 } // end of namespace
@@ -285,8 +285,10 @@ public:
     MysqlErrCode      error_code = ER_ERROR_FIRST;
     std::ostringstream error_msg;
     bool              is_full_export = false;
+    bool              is_analyze = false; // trace汇总所有region，不截断
     bool              is_separate = false; //是否为计算存储分离模式
     bool              use_ttl = false;
+    int64_t           range_delete_rows = 0; // delete走DeleteRange删除的行数
     BthreadCond       txn_cond;
     std::function<void(RuntimeState* state, SmartTransaction txn)> raft_func;
     bool              is_fail = false;
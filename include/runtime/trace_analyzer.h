@@ -0,0 +1,71 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "common.h"
+#include "proto/plan.pb.h"
+
+namespace baikaldb {
+// explain format='analyze'的结果
+// 把trace树按算子展开成行，store端各region的同一算子按位置合并，
+// 耗时给出min/avg/max和最慢的region，store行的wait为rpc往返减去store执行时间(网络+排队)
+class TraceAnalyzer {
+public:
+    static std::vector<std::string> field_names();
+    void analyze(const pb::TraceNode& root, std::vector<std::vector<std::string>>* rows);
+
+private:
+    // 一个region上的trace节点
+    struct Sample {
+        const pb::TraceNode* node;
+        const pb::TraceNode* region;
+    };
+    struct RegionCost {
+        const pb::TraceNode* region;
+        int64_t rpc_time;
+        int64_t rows;
+    };
+    struct OpStat {
+        int64_t count = 0;
+        int64_t min_time = 0;
+        int64_t max_time = 0;
+        int64_t sum_time = 0;
+        int64_t rows_out = 0;
+        int64_t cpu_time = 0;
+        int64_t cache_hit = 0;
+        int64_t block_read = 0;
+        int64_t read_byte = 0;
+        int64_t key_skipped = 0;
+        int64_t seek = 0;
+        const pb::TraceNode* slowest = nullptr;
+
+        void add_time(int64_t time, const pb::TraceNode* region);
+        void add_local(const pb::LocalTraceNode& local);
+    };
+
+    int64_t walk_local(const pb::TraceNode& node, int depth);
+    int64_t walk_store(const std::vector<Sample>& regions, int depth);
+    int64_t walk_merged(const std::vector<Sample>& samples, int depth);
+    void add_row(size_t index, const std::string& name, int depth, const OpStat& stat,
+            int64_t rows_in, const std::string& wait, const std::string& info);
+
+    std::vector<std::vector<std::string>>* _rows = nullptr;
+    std::vector<RegionCost> _region_costs;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
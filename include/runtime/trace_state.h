@@ -15,6 +15,10 @@
 #pragma once
 
 #include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <rocksdb/perf_context.h>
+#include <rocksdb/perf_level.h>
 #include "common.h"
 #include "mem_row_descriptor.h"
 #include "data_buffer.h"
@@ -49,6 +53,12 @@ public:
             } else if (_trace_type == GET_NEXT_TRACE) {
                 _local_node = _trace_node->mutable_get_next_trace();
             }
+            // perf_level和perf_context都是pthread局部的，在算子内设置并在同一线程上恢复
+            _start_thread = pthread_self();
+            _perf_level = rocksdb::GetPerfLevel();
+            rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+            _start_cpu_time = thread_cpu_time_us();
+            _start_perf = PerfCount::current();
         }
     }
     
@@ -59,6 +69,29 @@ public:
             }
             _local_node->set_time_cost_us(_local_node->time_cost_us() 
                                           + (butil::gettimeofday_us() - _start_time));
+            // bthread迁移到其他pthread后，cpu和perf计数是两个线程的差值，不再统计；
+            // 原线程的perf_level保持kEnableCount，与rocksdb默认值相同
+            if (pthread_equal(_start_thread, pthread_self())) {
+                // 与耗时一样包含子节点；bthread切换时会计入同线程上其他bthread的cpu
+                int64_t cpu_time = thread_cpu_time_us() - _start_cpu_time;
+                if (cpu_time >= 0) {
+                    _local_node->set_cpu_time_us(_local_node->cpu_time_us() + cpu_time);
+                }
+                PerfCount perf = PerfCount::current().minus(_start_perf);
+                if (perf.valid()) {
+                    _local_node->set_block_cache_hit(_local_node->block_cache_hit()
+                            + perf.block_cache_hit);
+                    _local_node->set_block_read_count(_local_node->block_read_count()
+                            + perf.block_read_count);
+                    _local_node->set_block_read_byte(_local_node->block_read_byte()
+                            + perf.block_read_byte);
+                    _local_node->set_key_skipped(_local_node->key_skipped()
+                            + perf.key_skipped);
+                    _local_node->set_seek_count(_local_node->seek_count()
+                            + perf.seek_count);
+                }
+                rocksdb::SetPerfLevel(_perf_level);
+            }
             _local_node->set_repeat_cnt(_local_node->repeat_cnt() + 1);
             std::string desc(_description);
             desc += " " + _append_description.str();
@@ -98,6 +131,12 @@ public:
         }
     }
     
+    void add_skipped_blocks(int64_t blocks) {
+        if (_trace_node != nullptr) {
+            _local_node->set_skipped_blocks(_local_node->skipped_blocks() + blocks);
+        }
+    }
+    
     void add_sort_time(int64_t time_cost) {
         if (_trace_node != nullptr) {
             _local_node->set_sort_time(_local_node->sort_time() + time_cost);
@@ -124,13 +163,62 @@ public:
     pb::TraceNode* get_trace() {
         return _trace_node;
     }
+
+    static int64_t thread_cpu_time_us() {
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+            return 0;
+        }
+        return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+    }
 private:
+    // perf_context是线程局部的，构造时SetPerfLevel(kEnableCount)才会计数
+    struct PerfCount {
+        int64_t block_cache_hit = 0;
+        int64_t block_read_count = 0;
+        int64_t block_read_byte = 0;
+        int64_t key_skipped = 0;
+        int64_t seek_count = 0;
+
+        static PerfCount current() {
+            rocksdb::PerfContext* ctx = rocksdb::get_perf_context();
+            PerfCount count;
+            count.block_cache_hit = ctx->block_cache_hit_count;
+            count.block_read_count = ctx->block_read_count;
+            count.block_read_byte = ctx->block_read_byte;
+            count.key_skipped = ctx->internal_key_skipped_count
+                + ctx->internal_delete_skipped_count;
+            count.seek_count = ctx->seek_child_seek_count;
+            return count;
+        }
+
+        PerfCount minus(const PerfCount& start) const {
+            PerfCount count;
+            count.block_cache_hit = block_cache_hit - start.block_cache_hit;
+            count.block_read_count = block_read_count - start.block_read_count;
+            count.block_read_byte = block_read_byte - start.block_read_byte;
+            count.key_skipped = key_skipped - start.key_skipped;
+            count.seek_count = seek_count - start.seek_count;
+            return count;
+        }
+
+        // 期间perf_context被其他bthread Reset时差值为负，整组丢弃
+        bool valid() const {
+            return block_cache_hit >= 0 && block_read_count >= 0 && block_read_byte >= 0
+                && key_skipped >= 0 && seek_count >= 0;
+        }
+    };
+
     const char* _description;
     std::ostringstream _append_description;
     pb::TraceNode* _trace_node = nullptr;
     int    _trace_type      = OPEN_TRACE;
     int    _is_successful   = 1;
     int64_t _start_time     = 0;
+    int64_t _start_cpu_time = 0;
+    PerfCount _start_perf;
+    pthread_t _start_thread;
+    rocksdb::PerfLevel _perf_level = rocksdb::PerfLevel::kEnableCount;
     pb::LocalTraceNode* _local_node = nullptr;
     std::function<void(TraceLocalNode&)> _exit_func = nullptr;
 };
@@ -22,6 +22,7 @@
 #include <mutex>
 #include <list>
 #include <unordered_map>
+#include <butil/iobuf.h>
 #include "user_info.h"
 #include "type_utils.h"
 #include "common.h"
@@ -87,11 +88,13 @@ struct NetworkSocket {
     uint32_t            thread_idx;   // current thread id processing the socket
     std::mutex          mutex;        // mutex to protect socket from multi-thread process
     time_t              last_active;  // last active time of the socket
+    int64_t             last_process_us = 0;   // 上一次状态机处理的耗时，reactor据此决定是否在本线程执行
     timeval             connect_time;
 
     // Socket buffer and session infomation.
     DataBuffer*     send_buf;                       // Send buffer.
     int             send_buf_offset;
+    butil::IOBuf    send_iobuf;                     // 已从send_buf转出、等待写socket的数据
     DataBuffer*     self_buf;                       // receive buffer.
     bool            has_multi_packet;
     int             header_read_len;                // readed header length.
@@ -73,6 +73,8 @@ enum NodeType {
     NT_DROP_DATABASE,
     NT_ALTER_TABLE,
     NT_ALTER_SEPC,
+    NT_PARTITION_OPT,
+    NT_PARTITION_RANGE,
 
     NT_START_TRANSACTION,
     NT_COMMIT_TRANSACTION,
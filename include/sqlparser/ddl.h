@@ -128,6 +128,11 @@ enum DatabaseOptionType : unsigned char {
     DATABASE_OPT_COLLATE
 };
 
+enum PartitionType : unsigned char {
+    PARTITION_HASH = 0,
+    PARTITION_RANGE
+};
+
 // https://dev.mysql.com/doc/refman/8.0/en/alter-table.html
 enum AlterSpecType : unsigned char {
     ALTER_SPEC_ADD_COLUMN = 0,   // only support add column at the tail
@@ -224,6 +229,29 @@ struct TableOption : public Node {
     }
 };
 
+// PARTITION pname VALUES LESS THAN (expr | MAXVALUE)
+struct PartitionRange : public Node {
+    String      name;
+    ExprNode*   less_expr = nullptr;  // nullptr表示MAXVALUE
+
+    PartitionRange() {
+        node_type = NT_PARTITION_RANGE;
+        name = nullptr;
+    }
+};
+
+// PARTITION BY HASH(col) PARTITIONS n | PARTITION BY RANGE(col) (...)
+struct PartitionOption : public Node {
+    PartitionType   type = PARTITION_HASH;
+    ColumnName*     column = nullptr;
+    int64_t         partition_num = 0;
+    Vector<PartitionRange*> ranges;
+
+    PartitionOption() {
+        node_type = NT_PARTITION_OPT;
+    }
+};
+
 struct Constraint : public Node {
     ConstraintType  type;
     String          name;
@@ -246,6 +274,7 @@ struct CreateTableStmt : public DdlNode {
     Vector<ColumnDef*>  columns;
     Vector<Constraint*> constraints;
     Vector<TableOption*>  options;
+    PartitionOption*    partition = nullptr;
 
     CreateTableStmt() {
         node_type = NT_CREATE_TABLE;
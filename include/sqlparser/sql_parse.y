@@ -522,6 +522,11 @@ extern int sql_error(YYLTYPE* yylloc, yyscan_t yyscanner, SqlParser* parser, con
     WhenClauseList
     WhenClause
 
+%type <item> 
+    PartitionOpt
+    PartitionRangeList
+    PartitionRange
+
 %type <item> 
     TableElementList 
     TableElement 
@@ -2561,7 +2566,7 @@ BetweenOrNot:
 /*create table statement*/
 // TODO: create table xx like xx
 CreateTableStmt:
-    CREATE TABLE IfNotExists TableName '(' TableElementList ')' CreateTableOptionListOpt
+    CREATE TABLE IfNotExists TableName '(' TableElementList ')' CreateTableOptionListOpt PartitionOpt
     {
         CreateTableStmt* stmt = new_node(CreateTableStmt);
         stmt->if_not_exist = $3;
@@ -2577,10 +2582,67 @@ CreateTableStmt:
             stmt->options.push_back((TableOption*)($8->children[idx]), parser->arena);
         }
         //stmt->options = $8->children;
+        stmt->partition = (PartitionOption*)$9;
         $$ = stmt;
     }
     ;
 
+PartitionOpt:
+    {
+        $$ = nullptr;
+    }
+    | PARTITION BY HASH '(' ColumnName ')' PARTITIONS INTEGER_LIT
+    {
+        PartitionOption* option = new_node(PartitionOption);
+        option->type = PARTITION_HASH;
+        option->column = (ColumnName*)$5;
+        option->partition_num = ((LiteralExpr*)$8)->_u.int64_val;
+        $$ = option;
+    }
+    | PARTITION BY RANGE '(' ColumnName ')' '(' PartitionRangeList ')'
+    {
+        PartitionOption* option = new_node(PartitionOption);
+        option->type = PARTITION_RANGE;
+        option->column = (ColumnName*)$5;
+        for (int idx = 0; idx < $8->children.size(); ++idx) {
+            option->ranges.push_back((PartitionRange*)$8->children[idx], parser->arena);
+        }
+        option->partition_num = option->ranges.size();
+        $$ = option;
+    }
+    ;
+
+PartitionRangeList:
+    PartitionRange
+    {
+        Node* list = new_node(Node);
+        list->children.reserve(10, parser->arena);
+        list->children.push_back($1, parser->arena);
+        $$ = list;
+    }
+    | PartitionRangeList ',' PartitionRange
+    {
+        $1->children.push_back($3, parser->arena);
+        $$ = $1;
+    }
+    ;
+
+PartitionRange:
+    PARTITION AllIdent VALUES LESS THAN '(' SignedLiteral ')'
+    {
+        PartitionRange* range = new_node(PartitionRange);
+        range->name = $2;
+        range->less_expr = $7;
+        $$ = range;
+    }
+    | PARTITION AllIdent VALUES LESS THAN MAXVALUE
+    {
+        PartitionRange* range = new_node(PartitionRange);
+        range->name = $2;
+        $$ = range;
+    }
+    ;
+
 IfNotExists:
     {
         $$ = false;
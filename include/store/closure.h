@@ -32,6 +32,17 @@ struct DMLClosure : public braft::Closure {
     std::string remote_side;
 };
 
+// 合并后的insert共用一条raft日志，apply时各条结果写入各自closure的response
+struct CombinedInsertClosure : public DMLClosure {
+    CombinedInsertClosure() {
+        response = &combined_response;
+    }
+    virtual void Run();
+
+    std::vector<DMLClosure*> closures;
+    pb::StoreRes combined_response;
+};
+
 struct AddPeerClosure : public braft::Closure {
     AddPeerClosure(BthreadCond& cond) : cond(cond) {};
     virtual void Run(); 
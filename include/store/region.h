@@ -88,6 +88,7 @@ private:
     Region* _region;
 };
 class TransactionPool;
+struct DMLClosure;
 typedef std::shared_ptr<Region> SmartRegion;
 class Region : public braft::StateMachine {
 friend class RegionControl;
@@ -102,6 +103,8 @@ public:
             delete pair.second;
         }
         bthread_mutex_destroy(&_commit_meta_mutex);
+        bthread_cond_destroy(&_combine_cond);
+        bthread_mutex_destroy(&_combine_mutex);
     }
 
     void shutdown() {
@@ -138,12 +141,16 @@ public:
                 _node(groupId, peerId),
                 _is_leader(false),
                 _shutdown(false),
+                _last_heartbeat_digest(0),
+                _leader_start_count(0),
                 _num_table_lines(0),
                 _num_delete_lines(0),
                 _region_control(this, region_id),
                 _snapshot_adaptor(new RocksdbFileSystemAdaptor(region_id)) {
         //create table and add peer请求状态初始化都为IDLE, 分裂请求状态初始化为DOING
         bthread_mutex_init(&_commit_meta_mutex, NULL);
+        bthread_mutex_init(&_combine_mutex, NULL);
+        bthread_cond_init(&_combine_cond, NULL);
         _region_control.store_status(_region_info.status());
         _is_global_index = _region_info.has_main_table_id() && 
             _region_info.main_table_id() != 0 && 
@@ -214,8 +221,15 @@ public:
     void on_snapshot_load_for_restart(braft::SnapshotReader* reader,
             std::map<int64_t, std::string>& prepared_log_entrys);
 
+    //incremental为true时，leader状态与上次上报一致的region只上报region_id
+    //完整上报的leader摘要放入heartbeat_digests，meta确认后再调用commit_heartbeat_digest
     void construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bool need_peer_balance, 
-        std::set<int64_t>& ddl_wait_doing_table_ids); 
+        std::set<int64_t>& ddl_wait_doing_table_ids, bool incremental = false,
+        std::map<int64_t, uint64_t>* heartbeat_digests = nullptr); 
+
+    void commit_heartbeat_digest(uint64_t digest) {
+        _last_heartbeat_digest = digest;
+    }
     
     void set_can_add_peer();
     
@@ -255,6 +269,8 @@ public:
     void reverse_merge();
     // other thread
     void ttl_remove_expired_data();
+    // other thread, cstore表把连续的主键区间整理成column chunk
+    void build_column_chunk();
 
     // dump the the tuples in this region in format {{k1:v1},{k2:v2},{k3,v3}...}
     // used for debug
@@ -311,6 +327,9 @@ public:
             int64_t& split_end_index);
     
     int get_split_key(std::string& split_key);
+
+    //扫描region内各索引，生成统计信息(行数、ndv、直方图、高频值)
+    void analyze(const pb::StoreReq* request, pb::StoreRes* response);
     
     int64_t get_region_id() {
         return _region_id;
@@ -337,9 +356,15 @@ public:
         _split_param.prepared_txn.clear();
     }
 
+    void real_writing_increase() {
+        _real_writing_cond.increase();
+    }
     void real_writing_decrease() {
         _real_writing_cond.decrease_signal();
     }
+    int real_writing_count() {
+        return _real_writing_cond.count();
+    }
     void reset_allow_write() {
         _disable_write_cond.decrease_broadcast();
     }
@@ -533,6 +558,9 @@ public:
     void set_separate_switch(bool is_separate) {
         _storage_compute_separate = is_separate;
     }
+    void set_write_combine_switch(bool write_combine) {
+        _write_combine = write_combine;
+    }
     void lock_commit_meta_mutex() {
         bthread_mutex_lock(&_commit_meta_mutex); 
     }
@@ -552,6 +580,8 @@ public:
     void delete_local_rocksdb_for_ddl();
     int ddlwork_del_index_process();
 
+    // start_add_index/start_drop_index提交到后台池执行
+    void run_ddl_in_background(void (Region::*ddl_func)());
     bool is_wait_ddl();
     int add_reverse_index();
     int ddl_schema_state(pb::IndexState& state);
@@ -610,6 +640,10 @@ private:
                                   int64_t index, int64_t term);
     void apply_kv_split(const pb::StoreReq& request, braft::Closure* done, 
                                 int64_t index, int64_t term);
+    void apply_combined_insert(const pb::StoreReq& request, braft::Closure* done, 
+                                int64_t index, int64_t term);
+    bool can_combine_insert(const pb::StoreReq& request);
+    void combine_insert(const pb::StoreReq* request, DMLClosure* closure);
     bool validate_version(const pb::StoreReq* request, pb::StoreRes* response);
 
     void set_region(const pb::RegionInfo& region_info) {
@@ -649,7 +683,7 @@ private:
     //Singleton
     RocksWrapper*       _rocksdb;
     SchemaFactory*      _factory;
-    rocksdb::ColumnFamilyHandle* _data_cf;    
+    rocksdb::ColumnFamilyHandle* _data_cf = nullptr;    
     rocksdb::ColumnFamilyHandle* _meta_cf;    
     std::string         _address; //ip:port
     
@@ -685,6 +719,15 @@ private:
     bool                                _restart = false;
     //计算存储分离开关，在store定时任务中更新，避免每次dml都访问schema factory
     bool                                _storage_compute_separate = false;
+    //insert合并开关，同样在store定时任务中更新
+    bool                                _write_combine = false;
+    bthread_mutex_t                     _combine_mutex;
+    bthread_cond_t                      _combine_cond;
+    bool                                _combine_leader = false; //是否已有请求在等待合并窗口
+    std::vector<const pb::StoreReq*>    _combine_reqs;
+    std::vector<DMLClosure*>            _combine_closures;
+    // 下次生成column chunk的起始纯主键
+    std::string                         _chunk_build_key;
     bool                                _use_ttl = false; //init时更新，表的ttl后续不会改变
     bool                                _reverse_remove_range = false; //split的数据，把拉链过滤一遍
     //raft node
@@ -698,6 +741,10 @@ private:
     std::atomic<bool>                   _shutdown;
     bool                                _init_success = false;
     bool                                _can_heartbeat = false;
+    //上次心跳上报的leader状态摘要，增量心跳时用于判断region是否有变化
+    std::atomic<uint64_t>               _last_heartbeat_digest;
+    //每次成为leader加一并计入摘要，重新成为leader后必须完整上报一次
+    std::atomic<int64_t>                _leader_start_count;
 
     BthreadCond                         _multi_thread_cond;
     // region stat variables
@@ -16,6 +16,7 @@
 
 #include <atomic>
 #include "common.h"
+#include "rocks_wrapper.h"
 #include "proto/store.interface.pb.h"
 
 namespace baikaldb {
@@ -23,6 +24,8 @@ class Region;
 class RegionControl {
 typedef std::shared_ptr<Region> SmartRegion;
 public:
+    // region数据所在的column family
+    static rocksdb::ColumnFamilyHandle* get_data_cf(int64_t region_id);
     static int remove_data(int64_t drop_region_id);
     static void compact_data(int64_t region_id);
     static void compact_data_in_queue(int64_t region_id);
@@ -33,6 +33,7 @@
 #include "proto/store.interface.pb.h"
 #include "proto/common.pb.h"
 #include "region.h"
+#include "store_scheduler.h"
 #include "schema_factory.h"
 #include "rocks_wrapper.h"
 #include "table_record.h"
@@ -115,6 +116,7 @@ public:
 
     void reverse_merge_thread();
     void ttl_remove_thread();
+    void column_chunk_thread();
 
     void flush_region_thread();
     void snapshot_thread();
@@ -140,10 +142,6 @@ public:
     std::string address() const {
         return _address;
     }
-    ExecutionQueue& compact_queue() {
-        return _compact_queue;
-    }
-    
     void sub_split_num() {
         --_split_num;
     }
@@ -190,7 +188,6 @@ public:
     void close() {
         _add_peer_queue.stop();
         _remove_region_queue.stop();
-        _compact_queue.stop();
         _shutdown = true;
         _heart_beat_bth.join();
         DB_WARNING("heart beat bth join");
@@ -198,14 +195,17 @@ public:
         DB_WARNING("_add_peer_queue join");
         _remove_region_queue.join();
         DB_WARNING("_remove_region_queue join");
-        _compact_queue.join();
-        DB_WARNING("_compact_queue join");
+        // ttl和chunk线程等待提交到后台池的任务，需要在关闭后台池之前join
+        _ttl_bth.join();
+        DB_WARNING("ttl bth check bth join");
+        _column_chunk_bth.join();
+        DB_WARNING("column chunk bth join");
+        StoreScheduler::get_instance()->close();
+        DB_WARNING("store scheduler join");
         _split_check_bth.join();
         DB_WARNING("split check bth join");
         _merge_bth.join();
         DB_WARNING("merge bth check bth join");
-        _ttl_bth.join();
-        DB_WARNING("ttl bth check bth join");
         _flush_bth.join();
         DB_WARNING("flush check bth join");
         _snapshot_bth.join();
@@ -221,16 +221,22 @@ private:
              _disk_total("disk_total", 0),
              _disk_used("disk_used", 0),
              dml_time_cost("dml_time_cost"),
-             select_time_cost("select_time_cost") {}
+             select_time_cost("select_time_cost") {
+        bthread_mutex_init(&_heart_beat_mutex, NULL);
+    }
     
     int drop_region_from_store(int64_t drop_region_id);
+    // 表已删除且本store上没有该表的region时，整体drop表独立的column family
+    void drop_unused_table_cf();
 
     void update_schema_info(const pb::SchemaInfo& request);
 
     //判断分裂在3600S内是否完成，不完成，则自动删除该region
     void check_region_legal_complete(int64_t region_id);
 
-    void construct_heart_beat_request(pb::StoreHeartBeatRequest& request);
+    //heartbeat_digests返回本次完整上报的leader region摘要
+    void construct_heart_beat_request(pb::StoreHeartBeatRequest& request,
+            std::map<int64_t, uint64_t>* heartbeat_digests = nullptr);
     
     void process_heart_beat_response(const pb::StoreHeartBeatResponse& response);
 
@@ -254,12 +260,18 @@ private:
     
     //发送心跳的线程
     Bthread _heart_beat_bth;
+    //上次心跳失败或meta要求时，下次心跳发送全量region信息
+    std::atomic<bool> _need_full_heartbeat = {true};
+    //心跳线程和分裂完成时都会发心跳，串行发送
+    bthread_mutex_t _heart_beat_mutex;
     //判断是否需要分裂的线程
     Bthread _split_check_bth;
     //全文索引定时merge线程
     Bthread _merge_bth;
     //TTL定期删除过期数据
     Bthread _ttl_bth;
+    //cstore表定期生成column chunk
+    Bthread _column_chunk_bth;
 
     //定时flush region meta信息，确保rocksdb的wal正常删除
     Bthread _flush_bth;
@@ -275,7 +287,6 @@ private:
 
     std::vector<rocksdb::Transaction*> _recovered_txns;
     ExecutionQueue _add_peer_queue;
-    ExecutionQueue _compact_queue;
     ExecutionQueue _remove_region_queue;
 
     bool _has_prepared_tran = true;
@@ -0,0 +1,119 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <queue>
+#include <vector>
+#include <functional>
+#include <bvar/bvar.h>
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_int32(store_background_worker_num);
+
+enum TaskPriority {
+    TASK_PRIORITY_LOW       = 0,   // compact, ttl等可以延后的任务
+    TASK_PRIORITY_NORMAL    = 1,   // ddl, analyze等
+    TASK_PRIORITY_HIGH      = 2    // 不受前台过载限流，目前没有任务使用(snapshot由braft调度，不进入任务池)
+};
+
+// 固定worker数的bthread任务池，按优先级调度，同优先级先进先出
+// need_throttle返回true时非高优任务留在队列里，worker只取高优任务，不占着任务等待
+// stop之后还在队列里的任务不再执行，join时调用其cancel，提交方在cancel里释放资源
+class TaskPool {
+public:
+    TaskPool(const std::string& name, int worker_num);
+    ~TaskPool();
+
+    void start(const std::function<bool()>& need_throttle = nullptr);
+    int run(TaskPriority priority, const std::function<void()>& call,
+            const std::function<void()>& cancel = nullptr);
+    void stop();
+    void join();
+    int64_t queue_size() {
+        return _queue_size.get_value();
+    }
+
+private:
+    struct Task {
+        TaskPriority priority;
+        uint64_t seq;
+        int64_t enqueue_time;
+        std::function<void()> call;
+        std::function<void()> cancel;
+    };
+    struct TaskCompare {
+        bool operator()(const Task& l, const Task& r) const {
+            if (l.priority != r.priority) {
+                return l.priority < r.priority;
+            }
+            return l.seq > r.seq;
+        }
+    };
+    void worker_loop();
+    // 调用方持有_mutex
+    bool can_run_top();
+
+    std::string _name;
+    int _worker_num;
+    bool _stop = false;
+    uint64_t _seq = 0;
+    std::function<bool()> _need_throttle;
+    std::priority_queue<Task, std::vector<Task>, TaskCompare> _queue;
+    bthread_mutex_t _mutex;
+    bthread_cond_t _cond;
+    std::vector<Bthread> _workers;
+
+    bvar::Adder<int64_t> _queue_size;
+    bvar::Adder<int64_t> _running;
+    bvar::Adder<int64_t> _throttle_count;
+    bvar::LatencyRecorder _wait_latency;
+    bvar::LatencyRecorder _exec_latency;
+};
+
+// store级调度器
+// raft apply仍在braft的execution queue中执行，前台查询在brpc bthread中执行，
+// 这里统计前台延时；后台维护任务(compact, ttl, ddl, snapshot)进入固定大小的后台池，
+// 前台过载(qps和p99延时都超过阈值)时低优任务延后执行
+class StoreScheduler {
+public:
+    static StoreScheduler* get_instance() {
+        static StoreScheduler _instance;
+        return &_instance;
+    }
+    void init();
+    void close() {
+        _background_pool.stop();
+        _background_pool.join();
+    }
+    // 返回<0时call和cancel都不会执行
+    int run_background(TaskPriority priority, const std::function<void()>& call,
+            const std::function<void()>& cancel = nullptr) {
+        return _background_pool.run(priority, call, cancel);
+    }
+    void record_foreground_latency(int64_t cost_us) {
+        _foreground_latency << cost_us;
+    }
+    bool need_throttle_background();
+
+private:
+    StoreScheduler();
+
+    TaskPool _background_pool;
+    bvar::LatencyRecorder _foreground_latency;
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,516 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "compact_row.h"
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include "schema_factory.h"
+
+namespace baikaldb {
+DEFINE_bool(row_compact_format, false,
+        "write primary index values of row tables in compact row format, "
+        "values in protobuf format are rewritten lazily on update");
+DEFINE_int32(compact_row_layout_cache_size, 1024, "cached compact row layouts per thread, key is (table_id, schema_version)");
+
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+namespace {
+const uint32_t MAX_FIELD_ID = 1 << 20;
+const uint32_t KIND_WIDTH[] = {4, 8, 4, 8, 4, 8, 1, 0};
+
+void put_varint64(std::string* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((char)value);
+}
+
+bool get_varint64(const char** p, const char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift <= 63 && *p < end; shift += 7) {
+        uint64_t byte = (uint8_t)**p;
+        ++(*p);
+        result |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+inline T load(const char* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline void store(char* p, T value) {
+    memcpy(p, &value, sizeof(T));
+}
+
+int cpp_type_kind(FieldDescriptor::CppType cpp_type) {
+    switch (cpp_type) {
+    case FieldDescriptor::CPPTYPE_INT32:
+        return ROW_INT32;
+    case FieldDescriptor::CPPTYPE_INT64:
+        return ROW_INT64;
+    case FieldDescriptor::CPPTYPE_UINT32:
+        return ROW_UINT32;
+    case FieldDescriptor::CPPTYPE_UINT64:
+        return ROW_UINT64;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+        return ROW_FLOAT;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return ROW_DOUBLE;
+    case FieldDescriptor::CPPTYPE_BOOL:
+        return ROW_BOOL;
+    case FieldDescriptor::CPPTYPE_STRING:
+        return ROW_STRING;
+    default:
+        return -1;
+    }
+}
+
+int field_kind(const FieldDescriptor* field) {
+    return cpp_type_kind(field->cpp_type());
+}
+
+// 按存储类型取出定长值并转成T，列类型没改过时就是原类型
+template <typename T>
+inline T fixed_value(uint8_t kind, const char* p) {
+    switch (kind) {
+    case ROW_INT32:
+        return (T)load<int32_t>(p);
+    case ROW_INT64:
+        return (T)load<int64_t>(p);
+    case ROW_UINT32:
+        return (T)load<uint32_t>(p);
+    case ROW_UINT64:
+        return (T)load<uint64_t>(p);
+    case ROW_FLOAT:
+        return (T)load<float>(p);
+    case ROW_DOUBLE:
+        return (T)load<double>(p);
+    case ROW_BOOL:
+        return (T)(*p != 0);
+    default:
+        return (T)0;
+    }
+}
+
+std::string fixed_to_string(uint8_t kind, const char* p) {
+    switch (kind) {
+    case ROW_UINT32:
+    case ROW_UINT64:
+        return std::to_string(fixed_value<uint64_t>(kind, p));
+    case ROW_FLOAT:
+    case ROW_DOUBLE:
+        return std::to_string(fixed_value<double>(kind, p));
+    default:
+        return std::to_string(fixed_value<int64_t>(kind, p));
+    }
+}
+} // namespace
+
+int CompactRowLayout::parse(const std::string& layout_desc) {
+    desc = layout_desc;
+    const char* p = desc.data();
+    const char* end = p + desc.size();
+    uint64_t field_count = 0;
+    uint64_t run_count = 0;
+    if (!get_varint64(&p, end, &field_count) || !get_varint64(&p, end, &run_count)
+            || field_count > MAX_FIELD_ID || run_count > field_count) {
+        return -1;
+    }
+    field_ids.clear();
+    field_ids.reserve(field_count);
+    uint64_t next_id = 0;
+    for (uint64_t i = 0; i < run_count; ++i) {
+        uint64_t delta = 0;
+        uint64_t len = 0;
+        if (!get_varint64(&p, end, &delta) || !get_varint64(&p, end, &len)) {
+            return -1;
+        }
+        next_id += delta;
+        if (len > field_count - field_ids.size() || next_id + len > MAX_FIELD_ID) {
+            return -1;
+        }
+        for (uint64_t j = 0; j < len; ++j) {
+            field_ids.push_back((int32_t)next_id++);
+        }
+    }
+    if (field_ids.size() != field_count || (size_t)(end - p) != (field_count + 1) / 2) {
+        return -1;
+    }
+    kinds.resize(field_count);
+    offsets.resize(field_count);
+    fixed_size = 0;
+    var_count = 0;
+    for (size_t i = 0; i < field_count; ++i) {
+        uint8_t kind = ((uint8_t)p[i / 2] >> ((i & 1) * 4)) & 0x0F;
+        if (kind > ROW_STRING) {
+            return -1;
+        }
+        kinds[i] = kind;
+        if (kind == ROW_STRING) {
+            offsets[i] = var_count++;
+        } else {
+            offsets[i] = fixed_size;
+            fixed_size += KIND_WIDTH[kind];
+        }
+    }
+    slot_by_id.assign(field_ids.empty() ? 0 : field_ids.back() + 1, -1);
+    for (size_t i = 0; i < field_count; ++i) {
+        slot_by_id[field_ids[i]] = i;
+    }
+    return 0;
+}
+
+int CompactRowCodec::build_layout(const pb::SchemaInfo& schema, std::string* desc) {
+    std::set<int32_t> pk_ids;
+    for (auto& index : schema.indexs()) {
+        if (index.index_type() != pb::I_PRIMARY) {
+            continue;
+        }
+        for (auto field_id : index.field_ids()) {
+            pk_ids.insert(field_id);
+        }
+        // 建表请求里主键只有字段名
+        if (index.field_ids_size() == 0) {
+            for (auto& name : index.field_names()) {
+                for (auto& field : schema.fields()) {
+                    if (!field.deleted() && field.field_name() == name) {
+                        pk_ids.insert(field.field_id());
+                    }
+                }
+            }
+        }
+    }
+    std::vector<std::pair<int32_t, int>> fields;
+    for (auto& field : schema.fields()) {
+        if (field.deleted() || pk_ids.count(field.field_id()) != 0) {
+            continue;
+        }
+        int proto_type = primitive_to_proto_type(field.mysql_type());
+        if (proto_type < 0) {
+            return -1;
+        }
+        int kind = cpp_type_kind(FieldDescriptor::TypeToCppType((FieldDescriptor::Type)proto_type));
+        if (kind < 0 || field.field_id() < 0 || (uint32_t)field.field_id() >= MAX_FIELD_ID) {
+            return -1;
+        }
+        fields.emplace_back(field.field_id(), kind);
+    }
+    std::sort(fields.begin(), fields.end());
+
+    // layout: 字段数 + 连续id区间 + 每个字段4bit类型
+    std::vector<std::pair<int32_t, int32_t>> runs;
+    for (auto& field : fields) {
+        if (!runs.empty() && runs.back().first + runs.back().second == field.first) {
+            ++runs.back().second;
+        } else {
+            runs.emplace_back(field.first, 1);
+        }
+    }
+    desc->clear();
+    put_varint64(desc, fields.size());
+    put_varint64(desc, runs.size());
+    int32_t next_id = 0;
+    for (auto& run : runs) {
+        put_varint64(desc, run.first - next_id);
+        put_varint64(desc, run.second);
+        next_id = run.first + run.second;
+    }
+    size_t kind_pos = desc->size();
+    desc->append((fields.size() + 1) / 2, '\0');
+    for (size_t i = 0; i < fields.size(); ++i) {
+        (*desc)[kind_pos + i / 2] |= (char)(fields[i].second << ((i & 1) * 4));
+    }
+    return 0;
+}
+
+SmartRowLayout CompactRowCodec::get_layout(int64_t table_id, int64_t schema_version) {
+    // 同一(table_id, schema_version)的layout不会再变化
+    typedef std::map<std::pair<int64_t, int64_t>, SmartRowLayout> LayoutCache;
+    static thread_local LayoutCache cache;
+    static thread_local std::pair<int64_t, int64_t> last_key(-1, -1);
+    static thread_local SmartRowLayout last;
+    std::pair<int64_t, int64_t> key(table_id, schema_version);
+    // 扫描时连续的行几乎都是同一个版本
+    if (last != nullptr && last_key == key) {
+        return last;
+    }
+    auto iter = cache.find(key);
+    if (iter != cache.end()) {
+        last_key = key;
+        last = iter->second;
+        return last;
+    }
+    SmartTable table = SchemaFactory::get_instance()->get_table_info_ptr(table_id);
+    if (table == nullptr) {
+        return nullptr;
+    }
+    SmartRowLayout layout = table->get_row_layout(schema_version);
+    if (layout == nullptr) {
+        return nullptr;
+    }
+    if (cache.size() >= (size_t)FLAGS_compact_row_layout_cache_size) {
+        cache.clear();
+    }
+    cache[key] = layout;
+    last_key = key;
+    last = layout;
+    return last;
+}
+
+int CompactRowCodec::encode(const Message& message, int64_t schema_version,
+        const CompactRowLayout& layout, const std::set<int32_t>& skip_field_ids,
+        std::string* out) {
+    const Descriptor* descriptor = message.GetDescriptor();
+    const Reflection* reflection = message.GetReflection();
+    size_t field_count = layout.field_ids.size();
+    // layout里的字段都能找到且个数相同，说明message中没有layout之外的字段
+    if ((size_t)descriptor->field_count() != field_count + skip_field_ids.size()) {
+        DB_WARNING("message field count: %d not match layout: %lu",
+                descriptor->field_count(), field_count);
+        return -1;
+    }
+    out->clear();
+    out->push_back((char)MAGIC);
+    put_varint64(out, (uint64_t)schema_version);
+    size_t null_pos = out->size();
+    out->append((field_count + 7) / 8, '\0');
+    size_t fixed_pos = out->size();
+    out->append(layout.fixed_size, '\0');
+    size_t ends_pos = out->size();
+    out->append(layout.var_count * sizeof(uint32_t), '\0');
+    size_t var_pos = out->size();
+    std::string scratch;
+    for (size_t i = 0; i < field_count; ++i) {
+        const FieldDescriptor* field = descriptor->FindFieldByNumber(layout.field_ids[i]);
+        uint8_t kind = layout.kinds[i];
+        if (field == nullptr || field->is_repeated() || field_kind(field) != kind) {
+            DB_WARNING("field: %d not match layout", layout.field_ids[i]);
+            return -1;
+        }
+        bool has = reflection->HasField(message, field);
+        if (!has) {
+            (*out)[null_pos + i / 8] |= (char)(1 << (i & 7));
+        }
+        if (kind == ROW_STRING) {
+            if (has) {
+                out->append(reflection->GetStringReference(message, field, &scratch));
+            }
+            if (out->size() - var_pos > UINT32_MAX) {
+                DB_WARNING("row too large: %lu", out->size());
+                return -1;
+            }
+            store<uint32_t>(&(*out)[ends_pos + layout.offsets[i] * sizeof(uint32_t)],
+                    out->size() - var_pos);
+            continue;
+        }
+        if (!has) {
+            continue;
+        }
+        char* p = &(*out)[fixed_pos + layout.offsets[i]];
+        switch (kind) {
+        case ROW_INT32:
+            store<int32_t>(p, reflection->GetInt32(message, field));
+            break;
+        case ROW_INT64:
+            store<int64_t>(p, reflection->GetInt64(message, field));
+            break;
+        case ROW_UINT32:
+            store<uint32_t>(p, reflection->GetUInt32(message, field));
+            break;
+        case ROW_UINT64:
+            store<uint64_t>(p, reflection->GetUInt64(message, field));
+            break;
+        case ROW_FLOAT:
+            store<float>(p, reflection->GetFloat(message, field));
+            break;
+        case ROW_DOUBLE:
+            store<double>(p, reflection->GetDouble(message, field));
+            break;
+        case ROW_BOOL:
+            *p = reflection->GetBool(message, field) ? 1 : 0;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int CompactRowCodec::parse_header(const char* data, size_t size, int64_t* schema_version) {
+    if (!is_compact(data, size)) {
+        return -1;
+    }
+    const char* p = data + 1;
+    uint64_t version = 0;
+    if (!get_varint64(&p, data + size, &version)) {
+        return -1;
+    }
+    *schema_version = (int64_t)version;
+    return p - data;
+}
+
+int CompactRowCodec::decode(int64_t table_id, const char* data, size_t size, Message* message) {
+    CompactRowReader reader;
+    if (reader.init(table_id, data, size) != 0) {
+        return -1;
+    }
+    return decode(reader, message);
+}
+
+int CompactRowCodec::decode(const CompactRowReader& reader, Message* message) {
+    const Descriptor* descriptor = message->GetDescriptor();
+    const CompactRowLayout& layout = reader.layout();
+    for (size_t i = 0; i < layout.field_ids.size(); ++i) {
+        const FieldDescriptor* field = descriptor->FindFieldByNumber(layout.field_ids[i]);
+        // 已删除的列
+        if (field == nullptr || reader.is_null(i)) {
+            continue;
+        }
+        if (reader.read_field(i, field, message) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int CompactRowReader::init(int64_t table_id, const char* data, size_t size) {
+    int64_t version = 0;
+    if (CompactRowCodec::parse_header(data, size, &version) < 0) {
+        return -1;
+    }
+    SmartRowLayout layout = CompactRowCodec::get_layout(table_id, version);
+    if (layout == nullptr) {
+        DB_WARNING("compact row layout not found, table_id: %ld, version: %ld", table_id, version);
+        return -1;
+    }
+    return init(layout, data, size);
+}
+
+int CompactRowReader::init(const SmartRowLayout& layout, const char* data, size_t size) {
+    int header_len = CompactRowCodec::parse_header(data, size, &_schema_version);
+    if (header_len < 0 || layout == nullptr) {
+        return -1;
+    }
+    _layout = layout;
+    const char* p = data + header_len;
+    const char* end = data + size;
+    size_t null_size = (_layout->field_ids.size() + 7) / 8;
+    size_t ends_size = _layout->var_count * sizeof(uint32_t);
+    if ((size_t)(end - p) < null_size + _layout->fixed_size + ends_size) {
+        return -1;
+    }
+    _nulls = p;
+    _fixed = _nulls + null_size;
+    _var_ends = _fixed + _layout->fixed_size;
+    _var_data = _var_ends + ends_size;
+    _var_size = end - _var_data;
+    uint32_t last_end = _layout->var_count == 0 ? 0 :
+            load<uint32_t>(_var_ends + ends_size - sizeof(uint32_t));
+    if (last_end != _var_size) {
+        return -1;
+    }
+    return 0;
+}
+
+int CompactRowReader::read_field(int slot, const FieldDescriptor* field, Message* message) const {
+    const Reflection* reflection = message->GetReflection();
+    uint8_t kind = _layout->kinds[slot];
+    uint32_t offset = _layout->offsets[slot];
+    if (kind == ROW_STRING) {
+        uint32_t begin = offset == 0 ? 0 : load<uint32_t>(_var_ends + (offset - 1) * sizeof(uint32_t));
+        uint32_t end = load<uint32_t>(_var_ends + offset * sizeof(uint32_t));
+        if (begin > end || end > _var_size) {
+            DB_WARNING("invalid var field: %d, %u, %u", field->number(), begin, end);
+            return -1;
+        }
+        std::string str(_var_data + begin, end - begin);
+        switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_STRING:
+            reflection->SetString(message, field, std::move(str));
+            break;
+        // 由字符串列修改成数值列
+        case FieldDescriptor::CPPTYPE_INT32:
+            reflection->SetInt32(message, field, strtoll(str.c_str(), nullptr, 10));
+            break;
+        case FieldDescriptor::CPPTYPE_INT64:
+            reflection->SetInt64(message, field, strtoll(str.c_str(), nullptr, 10));
+            break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+            reflection->SetUInt32(message, field, strtoull(str.c_str(), nullptr, 10));
+            break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+            reflection->SetUInt64(message, field, strtoull(str.c_str(), nullptr, 10));
+            break;
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            reflection->SetFloat(message, field, strtod(str.c_str(), nullptr));
+            break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            reflection->SetDouble(message, field, strtod(str.c_str(), nullptr));
+            break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+            reflection->SetBool(message, field, strtoll(str.c_str(), nullptr, 10) != 0);
+            break;
+        default:
+            return -1;
+        }
+        return 0;
+    }
+    const char* p = _fixed + offset;
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+        reflection->SetInt32(message, field, fixed_value<int32_t>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_INT64:
+        reflection->SetInt64(message, field, fixed_value<int64_t>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+        reflection->SetUInt32(message, field, fixed_value<uint32_t>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+        reflection->SetUInt64(message, field, fixed_value<uint64_t>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+        reflection->SetFloat(message, field, fixed_value<float>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        reflection->SetDouble(message, field, fixed_value<double>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+        reflection->SetBool(message, field, fixed_value<bool>(kind, p));
+        break;
+    case FieldDescriptor::CPPTYPE_STRING:
+        reflection->SetString(message, field, fixed_to_string(kind, p));
+        break;
+    default:
+        return -1;
+    }
+    return 0;
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
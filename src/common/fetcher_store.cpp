@@ -22,6 +22,7 @@
 #include "network_socket.h"
 #include "dml_node.h"
 #include "trace_state.h"
+#include "peer_selector.h"
 
 namespace baikaldb {
 
@@ -33,6 +34,92 @@ DEFINE_int32(fetcher_request_timeout, 100000,
                     "store as server request timeout, default:10000ms");
 DEFINE_int32(fetcher_connect_timeout, 1000,
                     "store as server connect timeout, default:1000ms");
+DEFINE_double(fetcher_hedge_percentile, 0,
+                    "send hedged read to another peer when latency exceed this percentile "
+                    "of the table, 0 means disable, e.g. 0.95");
+DEFINE_int64(fetcher_hedge_min_delay_us, 1000, "min delay of hedged read, default:1ms");
+
+static bvar::Adder<int64_t> fetcher_hedge_count("fetcher_hedge_count");
+static bvar::Adder<int64_t> fetcher_hedge_win_count("fetcher_hedge_win_count");
+
+namespace {
+class HedgeDone : public google::protobuf::Closure {
+public:
+    explicit HedgeDone(BthreadCond* cond) : _cond(cond) {}
+    void Run() override {
+        finished = true;
+        _cond->decrease_broadcast();
+    }
+    std::atomic<bool> finished {false};
+private:
+    BthreadCond* _cond;
+};
+}
+
+brpc::Controller* FetcherStore::hedged_query(pb::RegionInfo& info,
+        brpc::Channel& channel,
+        const brpc::ChannelOptions& option,
+        const pb::StoreReq& req,
+        brpc::Controller* cntl,
+        pb::StoreRes* res,
+        brpc::Controller* hedge_cntl,
+        int64_t delay_us,
+        std::string& addr) {
+    PeerSelector* selector = PeerSelector::get_instance();
+    BthreadCond cond;
+    HedgeDone primary_done(&cond);
+    HedgeDone hedge_done(&cond);
+    cond.increase();
+    selector->on_send(addr);
+    pb::StoreService_Stub(&channel).query(cntl, &req, res, &primary_done);
+    cond.timed_wait(delay_us);
+    if (primary_done.finished) {
+        brpc::Join(cntl->call_id());
+        selector->on_finish(addr, cntl->latency_us(), cntl->Failed());
+        return cntl;
+    }
+    std::vector<std::string> peers(info.peers().begin(), info.peers().end());
+    std::string hedge_addr = selector->select(peers, addr);
+    brpc::Channel hedge_channel;
+    if (hedge_addr.empty() || hedge_channel.Init(hedge_addr.c_str(), &option) != 0) {
+        brpc::Join(cntl->call_id());
+        selector->on_finish(addr, cntl->latency_us(), cntl->Failed());
+        return cntl;
+    }
+    fetcher_hedge_count << 1;
+    pb::StoreRes hedge_res;
+    hedge_cntl->set_log_id(cntl->log_id());
+    cond.increase();
+    selector->on_send(hedge_addr);
+    pb::StoreService_Stub(&hedge_channel).query(hedge_cntl, &req, &hedge_res, &hedge_done);
+    // 任一返回即可
+    cond.wait(1);
+    brpc::Controller* first = primary_done.finished ? cntl : hedge_cntl;
+    brpc::Controller* second = (first == cntl) ? hedge_cntl : cntl;
+    brpc::Controller* winner = first;
+    if (first->Failed()) {
+        // 先返回的失败了，等另一个
+        brpc::Join(second->call_id());
+        if (!second->Failed()) {
+            winner = second;
+        }
+    } else {
+        brpc::StartCancel(second->call_id());
+        brpc::Join(second->call_id());
+    }
+    brpc::Join(first->call_id());
+    // 被取消的请求只计延迟下限，不算失败
+    selector->on_finish(addr, cntl->latency_us(),
+            cntl->Failed() && cntl->ErrorCode() != ECANCELED);
+    selector->on_finish(hedge_addr, hedge_cntl->latency_us(),
+            hedge_cntl->Failed() && hedge_cntl->ErrorCode() != ECANCELED);
+    if (winner == hedge_cntl) {
+        fetcher_hedge_win_count << 1;
+        res->Swap(&hedge_res);
+        addr = hedge_addr;
+    }
+    return winner;
+}
                     
 ErrorType FetcherStore::send_request(
         RuntimeState* state,
@@ -213,7 +300,36 @@ ErrorType FetcherStore::send_request(
     }
     int64_t entry_ms5 = butil::gettimeofday_ms() % 1000;
     TimeCost query_time;
-    pb::StoreService_Stub(&channel).query(&cntl, &req, &res, NULL);
+    // 非事务读按副本延迟选择，首次发送时可以在表的延迟分位值后向另一副本发对冲请求
+    bool latency_aware = op_type == pb::OP_SELECT && state->txn_id == 0
+            && FLAGS_peer_select_latency_aware;
+    int64_t hedge_delay_us = -1;
+    // 对冲请求会发给其他副本，和同机房读一样只在配置了机房时开启
+    if (latency_aware && retry_times == 0 && FLAGS_fetcher_hedge_percentile > 0
+            && info.peers_size() > 1
+            && !SchemaFactory::get_instance()->get_logical_room().empty()) {
+        hedge_delay_us = PeerSelector::get_instance()->table_latency_percentile(
+                info.table_id(), FLAGS_fetcher_hedge_percentile);
+        if (hedge_delay_us >= 0) {
+            hedge_delay_us = std::max(hedge_delay_us, FLAGS_fetcher_hedge_min_delay_us);
+        }
+    }
+    brpc::Controller* rpc_cntl = &cntl;
+    brpc::Controller hedge_cntl;
+    if (hedge_delay_us >= 0) {
+        rpc_cntl = hedged_query(info, channel, option, req, &cntl, &res, &hedge_cntl,
+                hedge_delay_us, addr);
+    } else if (latency_aware) {
+        PeerSelector::get_instance()->on_send(addr);
+        pb::StoreService_Stub(&channel).query(&cntl, &req, &res, NULL);
+        PeerSelector::get_instance()->on_finish(addr, cntl.latency_us(), cntl.Failed());
+    } else {
+        pb::StoreService_Stub(&channel).query(&cntl, &req, &res, NULL);
+    }
+    if (latency_aware && !rpc_cntl->Failed() && res.errcode() == pb::SUCCESS) {
+        PeerSelector::get_instance()->record_table_latency(info.table_id(), 
+                query_time.get_time());
+    }
 
     //DB_WARNING("fetch store req: %s", req.DebugString().c_str());
     //DB_WARNING("fetch store res: %s", res.DebugString().c_str());
@@ -221,11 +337,11 @@ ErrorType FetcherStore::send_request(
         DB_WARNING("entry_ms:%d, %d, %d, %d, %d, lock:%ld, wait region_id: %ld version:%ld time:%ld rpc_time: %ld log_id:%lu txn_id: %lu, ip:%s", 
                 entry_ms, entry_ms2, entry_ms3, entry_ms4, entry_ms5, client_lock_tm, region_id, 
                 info.version(), cost.get_time(), query_time.get_time(), log_id, state->txn_id,
-                butil::endpoint2str(cntl.remote_side()).c_str());
+                butil::endpoint2str(rpc_cntl->remote_side()).c_str());
     }
-    if (cntl.Failed()) {
+    if (rpc_cntl->Failed()) {
         DB_WARNING("call failed region_id: %ld, error:%s, log_id:%lu", 
-                region_id, cntl.ErrorText().c_str(), log_id);
+                region_id, rpc_cntl->ErrorText().c_str(), log_id);
         other_peer_to_leader_func(info);
         //schema_factory->update_leader(info);
         bthread_usleep(retry_times * FLAGS_retry_interval_us);
@@ -481,15 +597,28 @@ ErrorType FetcherStore::send_request(
 void FetcherStore::choose_opt_instance(pb::RegionInfo& info, std::string& addr) {
     SchemaFactory* schema_factory = SchemaFactory::get_instance();
     std::string baikaldb_logical_room = schema_factory->get_logical_room();
-    if (baikaldb_logical_room.empty()) {
+    std::vector<std::string> candicate_peers;
+    if (!baikaldb_logical_room.empty()) {
+        for (auto& peer: info.peers()) {
+            std::string logical_room = schema_factory->logical_room_for_instance(peer);
+            if (!logical_room.empty()  && logical_room == baikaldb_logical_room) {
+                candicate_peers.push_back(peer);
+            }  
+        }
+    }
+    if (FLAGS_peer_select_latency_aware) {
+        // 只在同机房副本中按延迟选，没有配置机房或同机房没有副本时仍读leader
+        if (candicate_peers.empty()) {
+            return;
+        }
+        std::string peer = PeerSelector::get_instance()->select(candicate_peers);
+        if (!peer.empty()) {
+            addr = peer;
+        }
         return;
     }
-    std::vector<std::string> candicate_peers;
-    for (auto& peer: info.peers()) {
-        std::string logical_room = schema_factory->logical_room_for_instance(peer);
-        if (!logical_room.empty()  && logical_room == baikaldb_logical_room) {
-            candicate_peers.push_back(peer);
-        }  
+    if (baikaldb_logical_room.empty()) {
+        return;
     }
     if (std::find(candicate_peers.begin(), candicate_peers.end(), addr) 
             != candicate_peers.end()) {
@@ -583,15 +712,17 @@ int FetcherStore::run(RuntimeState* state,
         }
         return -1;
     }
-    std::map<uint64_t, std::shared_ptr<pb::TraceNode>> cost_trace_map;
+    // 耗时相同的region都要保留
+    std::multimap<uint64_t, std::shared_ptr<pb::TraceNode>> cost_trace_map;
     if (store_request->get_trace() != nullptr) {
         for (auto& pair : send_region_ids_map) {
             for (auto& trace : pair.second) {
-                cost_trace_map[trace->trace_node->total_time()] = trace->trace_node;
+                cost_trace_map.insert(std::make_pair(trace->trace_node->total_time(),
+                        trace->trace_node));
             }
         }
         int region_cnt = cost_trace_map.size();
-        if (region_cnt > 10) {
+        if (region_cnt > 10 && !state->is_analyze) {
             for (auto& pair : cost_trace_map) {
                 if (region_cnt > 10) {
                     pb::LocalTraceNode* local_node = store_request->get_trace()->mutable_store_agg();
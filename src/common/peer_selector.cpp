@@ -0,0 +1,235 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "peer_selector.h"
+#include <cmath>
+#include <gflags/gflags.h>
+
+namespace baikaldb {
+DEFINE_bool(peer_select_latency_aware, false,
+        "choose store peer for read by ewma latency and inflight among peers in the same "
+        "logical room, only when baikaldb has logical room, default:false");
+DEFINE_int64(peer_ewma_decay_ms, 2000,
+        "time constant of peer latency ewma, idle peer latency decays to 0, default:2s");
+DEFINE_int32(peer_eject_fail_count, 3, "eject peer after continuous rpc failures, default:3");
+DEFINE_double(peer_outlier_latency_ratio, 5.0,
+        "eject peer whose ewma latency exceed ratio * fastest peer, default:5");
+DEFINE_int64(peer_outlier_min_latency_us, 50000,
+        "peer whose ewma latency below this never ejected as outlier, default:50ms");
+DEFINE_int64(peer_eject_base_ms, 1000, "first eject time, doubled each time, default:1s");
+DEFINE_int64(peer_eject_max_ms, 30000, "max eject time, default:30s");
+DEFINE_int64(peer_readmit_ms, 5000,
+        "after eject, traffic to peer grows linearly in this window, default:5s");
+DEFINE_int64(table_latency_min_samples, 100,
+        "table latency percentile is valid after these samples, default:100");
+
+static bvar::Adder<int64_t> peer_eject_count("peer_selector_eject_count");
+
+PeerSelector::SmartPeerStat PeerSelector::get_stat(const std::string& addr) {
+    std::unique_lock<std::mutex> lock(_map_mutex);
+    auto& stat = _peer_stats[addr];
+    if (stat == nullptr) {
+        stat.reset(new PeerStat);
+    }
+    return stat;
+}
+
+double PeerSelector::decayed_ewma(const PeerStat& stat, int64_t now_us) const {
+    if (stat.update_us == 0 || now_us <= stat.update_us) {
+        return stat.ewma_us;
+    }
+    // 长时间没有请求的实例延迟逐渐衰减，慢节点恢复后还能重新被选中
+    double elapsed = (now_us - stat.update_us) / 1000.0;
+    return stat.ewma_us * std::exp(-elapsed / FLAGS_peer_ewma_decay_ms);
+}
+
+bool PeerSelector::available(const PeerStat& stat, int64_t now_us) const {
+    if (now_us < stat.eject_until_us) {
+        return false;
+    }
+    int64_t readmit_us = FLAGS_peer_readmit_ms * 1000;
+    int64_t passed_us = now_us - stat.eject_until_us;
+    if (stat.eject_until_us == 0 || readmit_us <= 0 || passed_us >= readmit_us) {
+        return true;
+    }
+    return (int64_t)butil::fast_rand_less_than(readmit_us) < passed_us;
+}
+
+void PeerSelector::eject(PeerStat& stat, const std::string& addr, int64_t now_us) {
+    int shift = std::min(stat.eject_times, 10);
+    int64_t eject_ms = std::min(FLAGS_peer_eject_base_ms << shift, FLAGS_peer_eject_max_ms);
+    ++stat.eject_times;
+    stat.fail_count = 0;
+    stat.eject_until_us = now_us + eject_ms * 1000;
+    peer_eject_count << 1;
+    DB_WARNING("eject peer:%s for %ld ms, times:%d, ewma:%.0f us",
+            addr.c_str(), eject_ms, stat.eject_times, stat.ewma_us);
+}
+
+std::string PeerSelector::select(const std::vector<std::string>& candidates,
+        const std::string& exclude, int64_t now_us) {
+    struct Choice {
+        const std::string* addr;
+        SmartPeerStat stat;
+        double ewma;
+        int64_t inflight;
+    };
+    std::vector<Choice> all;
+    std::vector<size_t> avail;
+    all.reserve(candidates.size());
+    double min_ewma = -1;
+    for (auto& addr : candidates) {
+        if (addr == exclude) {
+            continue;
+        }
+        SmartPeerStat stat = get_stat(addr);
+        std::unique_lock<std::mutex> lock(stat->mutex);
+        Choice choice = {&addr, stat, decayed_ewma(*stat, now_us), stat->inflight};
+        if (available(*stat, now_us)) {
+            avail.push_back(all.size());
+            if (choice.ewma > 0 && (min_ewma < 0 || choice.ewma < min_ewma)) {
+                min_ewma = choice.ewma;
+            }
+        }
+        all.push_back(choice);
+    }
+    if (all.empty()) {
+        return "";
+    }
+    // 延迟远高于最快副本的实例视为异常，摘除
+    if (min_ewma > 0 && avail.size() > 1) {
+        double limit = std::max(min_ewma * FLAGS_peer_outlier_latency_ratio,
+                (double)FLAGS_peer_outlier_min_latency_us);
+        for (auto iter = avail.begin(); iter != avail.end();) {
+            Choice& choice = all[*iter];
+            if (choice.ewma > limit) {
+                std::unique_lock<std::mutex> lock(choice.stat->mutex);
+                if (now_us >= choice.stat->eject_until_us) {
+                    eject(*choice.stat, *choice.addr, now_us);
+                }
+                iter = avail.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+    if (avail.empty()) {
+        // 全部摘除时不能拒绝服务，退化为在所有候选里选
+        for (size_t i = 0; i < all.size(); ++i) {
+            avail.push_back(i);
+        }
+    }
+    if (avail.size() == 1) {
+        return *all[avail[0]].addr;
+    }
+    size_t i = butil::fast_rand_less_than(avail.size());
+    size_t j = butil::fast_rand_less_than(avail.size() - 1);
+    if (j >= i) {
+        ++j;
+    }
+    const Choice& a = all[avail[i]];
+    const Choice& b = all[avail[j]];
+    // 加1us避免冷启动时ewma都为0，只比在途数
+    double cost_a = (a.ewma + 1) * (a.inflight + 1);
+    double cost_b = (b.ewma + 1) * (b.inflight + 1);
+    return cost_a <= cost_b ? *a.addr : *b.addr;
+}
+
+void PeerSelector::on_send(const std::string& addr) {
+    SmartPeerStat stat = get_stat(addr);
+    std::unique_lock<std::mutex> lock(stat->mutex);
+    ++stat->inflight;
+}
+
+void PeerSelector::on_finish(const std::string& addr, int64_t latency_us, bool failed,
+        int64_t now_us) {
+    SmartPeerStat stat = get_stat(addr);
+    std::unique_lock<std::mutex> lock(stat->mutex);
+    if (stat->inflight > 0) {
+        --stat->inflight;
+    }
+    if (latency_us < 0) {
+        return;
+    }
+    // peak ewma: 延迟突增立即生效，回落按时间常数平滑，请求稀疏时新样本占比更大
+    double w = 0;
+    if (stat->update_us != 0 && now_us > stat->update_us) {
+        w = std::exp(-(now_us - stat->update_us) / 1000.0 / FLAGS_peer_ewma_decay_ms);
+    } else if (stat->update_us != 0) {
+        w = 1;
+    }
+    if (latency_us > stat->ewma_us) {
+        stat->ewma_us = latency_us;
+    } else {
+        stat->ewma_us = stat->ewma_us * w + latency_us * (1 - w);
+    }
+    stat->update_us = now_us;
+    if (failed) {
+        if (++stat->fail_count >= FLAGS_peer_eject_fail_count
+                && now_us >= stat->eject_until_us) {
+            eject(*stat, addr, now_us);
+        }
+        return;
+    }
+    stat->fail_count = 0;
+    // 恢复期结束后仍正常，清空退避次数
+    if (stat->eject_times > 0
+            && now_us > stat->eject_until_us + FLAGS_peer_readmit_ms * 1000 * 2) {
+        stat->eject_times = 0;
+    }
+}
+
+void PeerSelector::record_table_latency(int64_t table_id, int64_t latency_us) {
+    std::shared_ptr<bvar::LatencyRecorder> recorder;
+    {
+        std::unique_lock<std::mutex> lock(_map_mutex);
+        auto& ptr = _table_latency[table_id];
+        if (ptr == nullptr) {
+            ptr.reset(new bvar::LatencyRecorder);
+        }
+        recorder = ptr;
+    }
+    *recorder << latency_us;
+}
+
+int64_t PeerSelector::table_latency_percentile(int64_t table_id, double ratio) {
+    std::shared_ptr<bvar::LatencyRecorder> recorder;
+    {
+        std::unique_lock<std::mutex> lock(_map_mutex);
+        auto iter = _table_latency.find(table_id);
+        if (iter == _table_latency.end()) {
+            return -1;
+        }
+        recorder = iter->second;
+    }
+    if (recorder->count() < FLAGS_table_latency_min_samples) {
+        return -1;
+    }
+    return recorder->latency_percentile(ratio);
+}
+
+int64_t PeerSelector::ewma_latency(const std::string& addr, int64_t now_us) {
+    SmartPeerStat stat = get_stat(addr);
+    std::unique_lock<std::mutex> lock(stat->mutex);
+    return decayed_ewma(*stat, now_us);
+}
+
+bool PeerSelector::is_ejected(const std::string& addr, int64_t now_us) {
+    SmartPeerStat stat = get_stat(addr);
+    std::unique_lock<std::mutex> lock(stat->mutex);
+    return now_us < stat->eject_until_us;
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
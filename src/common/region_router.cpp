@@ -0,0 +1,131 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "region_router.h"
+#include <algorithm>
+
+namespace baikaldb {
+namespace {
+void put_varint32(std::string* out, uint32_t value) {
+    while (value >= 0x80) {
+        out->push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((char)value);
+}
+
+uint32_t get_varint32(const std::string& data, size_t* offset) {
+    uint32_t result = 0;
+    for (int shift = 0; shift <= 28; shift += 7) {
+        uint32_t byte = (uint8_t)data[(*offset)++];
+        result |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return result;
+}
+} // namespace
+
+// 记录格式: shared(varint) + unshared(varint) + unshared字节
+StartKeyIndex::StartKeyIndex(const std::vector<SmartRegionInfo>& regions) {
+    _count = regions.size();
+    _restarts.reserve(_count / RESTART_INTERVAL + 1);
+    const std::string* last = nullptr;
+    for (size_t i = 0; i < _count; ++i) {
+        const std::string& key = regions[i]->start_key();
+        size_t shared = 0;
+        if (i % RESTART_INTERVAL == 0) {
+            _restarts.push_back(_data.size());
+        } else {
+            size_t max_shared = std::min(last->size(), key.size());
+            while (shared < max_shared && (*last)[shared] == key[shared]) {
+                ++shared;
+            }
+        }
+        put_varint32(&_data, shared);
+        put_varint32(&_data, key.size() - shared);
+        _data.append(key, shared, std::string::npos);
+        last = &key;
+    }
+}
+
+size_t StartKeyIndex::decode_entry(size_t offset, std::string* cur) const {
+    uint32_t shared = get_varint32(_data, &offset);
+    uint32_t unshared = get_varint32(_data, &offset);
+    cur->resize(shared);
+    cur->append(_data, offset, unshared);
+    return offset + unshared;
+}
+
+size_t StartKeyIndex::upper_bound(const std::string& key) const {
+    // 最后一个restart key <= key的块
+    size_t lo = 0;
+    size_t hi = _restarts.size();
+    std::string cur;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        decode_entry(_restarts[mid], &cur);
+        if (cur <= key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return 0;
+    }
+    size_t block = lo - 1;
+    size_t idx = block * RESTART_INTERVAL;
+    size_t end = std::min(idx + RESTART_INTERVAL, _count);
+    size_t offset = _restarts[block];
+    cur.clear();
+    for (; idx < end; ++idx) {
+        offset = decode_entry(offset, &cur);
+        if (cur > key) {
+            break;
+        }
+    }
+    return idx;
+}
+
+RegionRouter::RegionRouter(int64_t version, std::vector<SmartRegionInfo> regions) :
+        _version(version), _regions(std::move(regions)) {
+    _key_index.reset(new StartKeyIndex(_regions));
+    auto id_index = std::make_shared<std::unordered_map<int64_t, size_t>>();
+    id_index->reserve(_regions.size());
+    for (size_t i = 0; i < _regions.size(); ++i) {
+        (*id_index)[_regions[i]->region_id()] = i;
+    }
+    _id_index = id_index;
+}
+
+SmartRegionRouter RegionRouter::replace_region(int64_t version,
+        const SmartRegionInfo& region) const {
+    auto iter = _id_index->find(region->region_id());
+    if (iter == _id_index->end()
+            || _regions[iter->second]->start_key() != region->start_key()) {
+        return nullptr;
+    }
+    std::shared_ptr<RegionRouter> router(new RegionRouter);
+    router->_version = version;
+    router->_regions = _regions;
+    router->_key_index = _key_index;
+    router->_id_index = _id_index;
+    router->_regions[iter->second] = region;
+    return router;
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
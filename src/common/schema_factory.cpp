@@ -227,6 +227,11 @@ void SchemaFactory::update_schema_conf(const std::string& table_name,
         DB_WARNING("table:%s changed storage_compute_separate:%d", 
                    table_name.c_str(), schema_conf.storage_compute_separate());
     }
+    if (schema_conf.has_write_combine()) {
+        mem_conf.set_write_combine(schema_conf.write_combine());
+        DB_WARNING("table:%s changed write_combine:%d", 
+                   table_name.c_str(), schema_conf.write_combine());
+    }
 }
 
 // not thread-safe
@@ -254,7 +259,7 @@ int SchemaFactory::update_table_internal(SchemaMapping& background, const pb::Sc
         DB_FATAL("missing fields in SchemaInfo");
         return -1;
     }
-    if (table.partition_num() != 1) {
+    if (table.partition_num() < 1) {
         DB_FATAL("invalid partion_num: %d", table.partition_num());
         return -1;
     }
@@ -290,6 +295,12 @@ int SchemaFactory::update_table_internal(SchemaMapping& background, const pb::Sc
         if (tbl_info.version >= table.version()) {
             //DB_WARNING("need not  update, orgin version:%ld, new version:%ld, table_id:%ld", 
                     //tbl_info.version, table.version(), table_id);
+            // analyze只更新统计信息，不修改schema版本
+            if (table.has_statistics() && (tbl_info.statistics == nullptr 
+                    || tbl_info.statistics->version() < table.statistics().version())) {
+                tbl_info.statistics = std::make_shared<TableStatistics>(table.statistics());
+                _table_info_mapping[table_id] = tbl_info_ptr;
+            }
             return 0;
         }
         //old_tbl_name = tbl_info.name;
@@ -305,7 +316,8 @@ int SchemaFactory::update_table_internal(SchemaMapping& background, const pb::Sc
     tbl_info.tbl_proto = tbl_info.file_proto->add_message_type();
     tbl_info.id = table_id;
     tbl_info.db_id = database_id;
-    tbl_info.partition_num = table.partition_num(); //TODO
+    tbl_info.partition_num = table.partition_num();
+    tbl_info.partition = nullptr;
     if (!table.has_byte_size_per_record() || table.byte_size_per_record() < 1) {
         tbl_info.byte_size_per_record = 1;
     } else {
@@ -319,6 +331,11 @@ int SchemaFactory::update_table_internal(SchemaMapping& background, const pb::Sc
     if (table.has_schema_conf()) {
         update_schema_conf(_tbl_name, table.schema_conf(), tbl_info.schema_conf);
     } 
+    if (table.has_statistics()) {
+        tbl_info.statistics = std::make_shared<TableStatistics>(table.statistics());
+    } else {
+        tbl_info.statistics = nullptr;
+    }
     tbl_info.version = table.version();
     tbl_info.name = _db_name + "." + _tbl_name;
     tbl_info.short_name = _tbl_name;
@@ -337,6 +354,20 @@ int SchemaFactory::update_table_internal(SchemaMapping& background, const pb::Sc
         tbl_info.ttl_duration = table.ttl_duration();
         DB_DEBUG("table:%s ttl_duration:%ld", tbl_info.name.c_str(), tbl_info.ttl_duration);
     }
+    if (table.has_cf_conf()) {
+        tbl_info.has_cf_conf = true;
+        tbl_info.cf_conf = table.cf_conf();
+    }
+    tbl_info.row_layouts.clear();
+    for (auto& row_layout : table.row_layouts()) {
+        std::shared_ptr<CompactRowLayout> layout(new CompactRowLayout);
+        if (layout->parse(row_layout.layout()) != 0) {
+            DB_FATAL("parse row layout failed, table_id: %ld, version: %ld",
+                    table_id, row_layout.version());
+            return -1;
+        }
+        tbl_info.row_layouts[row_layout.version()] = layout;
+    }
     for (auto& dist : table.dists()) {
         DistInfo dist_info;
         dist_info.logical_room = dist.logical_room();
@@ -419,6 +450,31 @@ int SchemaFactory::update_table_internal(SchemaMapping& background, const pb::Sc
         tbl_info.fields.push_back(field_info);
         //DB_WARNING("field_name:%s, field_id:%d", field_info.name.c_str(), field_info.id);
     }
+    if (tbl_info.partition_num > 1) {
+        //老的partition_num表没有partition_info，按主键取模
+        pb::PartitionInfo partition_info = table.partition_info();
+        if (!table.has_partition_info()) {
+            partition_info.set_type(pb::PT_HASH);
+            for (auto& index : table.indexs()) {
+                if (index.index_type() == pb::I_PRIMARY && index.field_ids_size() > 0) {
+                    partition_info.set_field_id(index.field_ids(0));
+                }
+            }
+        }
+        pb::PrimitiveType field_type = pb::NULL_TYPE;
+        for (auto& field_info : tbl_info.fields) {
+            if (field_info.id == partition_info.field_id()) {
+                field_type = field_info.type;
+            }
+        }
+        auto partition = std::make_shared<TablePartition>();
+        if (partition->init(partition_info, tbl_info.partition_num, field_type) != 0) {
+            DB_FATAL("init partition failed, table_id: %ld, partition_info: %s",
+                    table_id, partition_info.ShortDebugString().c_str());
+            return -1;
+        }
+        tbl_info.partition = partition;
+    }
     bool pb_need_update = tbl_info.fields_sign != new_fields_sign.str();
     DB_NOTICE("double_buffer_write pb_need_update:%d, old:%s new:%s table:%s ", pb_need_update,
             tbl_info.fields_sign.c_str(), new_fields_sign.str().c_str(), table.ShortDebugString().c_str());
@@ -716,10 +772,10 @@ void SchemaFactory::update_region(TableRegionPtr table_region_ptr,
     if (region.has_deleted() && region.deleted()) {
         DB_WARNING("region:%s deleted", region.ShortDebugString().c_str());
         std::vector<StrInt64Map>& vec = table_region_ptr->key_region_mapping;
-        if (vec.size() < 1) {
+        if ((int64_t)vec.size() <= region.partition_id()) {
             return;
         }
-        StrInt64Map& key_reg_map = vec[0];
+        StrInt64Map& key_reg_map = vec[region.partition_id()];
         key_reg_map.erase(region.start_key());
         table_region_ptr->region_info_mapping.erase(region.region_id());
         return;
@@ -732,11 +788,11 @@ void SchemaFactory::update_region(TableRegionPtr table_region_ptr,
                    region.region_id(), orgin_region.version(), region.version());
         return;
     }
-    std::vector<StrInt64Map>& vec = table_region_ptr->key_region_mapping;
-    if (vec.size() < 1) {
-        vec.resize(1);
+    if (region.partition_id() < 0) {
+        DB_WARNING("invalid partition_id, region:%s", region.ShortDebugString().c_str());
+        return;
     }
-    StrInt64Map& key_reg_map = vec[0];
+    StrInt64Map& key_reg_map = table_region_ptr->partition_key_region(region.partition_id());
     key_reg_map.insert(std::make_pair(region.start_key(), region.region_id()));
 
     table_region_ptr->insert_region_info(region);
@@ -746,12 +802,13 @@ void SchemaFactory::update_region(TableRegionPtr table_region_ptr,
                str_to_hex(region.end_key()).c_str());
 }
 void SchemaFactory::clear_region(TableRegionPtr table_region_ptr, 
+                                 int64_t partition_id,
                                  std::map<std::string, int64_t>& clear_regions) {
     std::vector<StrInt64Map>& vec = table_region_ptr->key_region_mapping;
-    if (vec.size() < 1) {
+    if ((int64_t)vec.size() <= partition_id) {
         return;
     }
-    StrInt64Map& key_reg_map = vec[0];
+    StrInt64Map& key_reg_map = vec[partition_id];
     for (auto iter : clear_regions) {
         key_reg_map.erase(iter.first);
         table_region_ptr->region_info_mapping.erase(iter.second);
@@ -763,14 +820,14 @@ void SchemaFactory::clear_region(TableRegionPtr table_region_ptr,
 void SchemaFactory::get_clear_regions(const std::string& new_start_key, 
                                       const std::string& origin_start_key,
                                      TableRegionPtr table_region_ptr,
+                                     int64_t partition_id,
                         std::map<std::string, int64_t>& clear_regions) {
     //获取key_region_map中新旧start key之间的所有key，这些key是已经发生merge的，需要删除，
     //包括origin_region
     bool is_over = false;
     std::vector<int64_t> region_ids;
     std::string key = new_start_key;
-    std::vector<StrInt64Map>& vec = table_region_ptr->key_region_mapping;
-    StrInt64Map& key_reg_map = vec[0];
+    StrInt64Map& key_reg_map = table_region_ptr->partition_key_region(partition_id);
     auto region_iter = key_reg_map.find(new_start_key);
     while (region_iter != key_reg_map.end()) {
         if (key.empty() || key > origin_start_key) {
@@ -822,6 +879,7 @@ size_t SchemaFactory::update_regions_table(
     
     DB_NOTICE("double_buffer_write update_regions_table table_id[%ld]", table_id);
     for (auto& start_key_region : key_region_map) {
+        int64_t partition_id = start_key_region.first;
         auto& start_key_region_map = start_key_region.second;
         std::vector<const pb::RegionInfo*> last_regions;
         std::map<std::string, int64_t> clear_regions;
@@ -847,7 +905,7 @@ size_t SchemaFactory::update_regions_table(
                     }
                     last_regions.push_back(&region);
                     if (region.end_key() == end_key) {
-                        clear_region(table_region_ptr, clear_regions);
+                        clear_region(table_region_ptr, partition_id, clear_regions);
                         for (auto r : last_regions) {
                             update_region(table_region_ptr, *r);
                             DB_WARNING("update regions %s", r->ShortDebugString().c_str());
@@ -864,11 +922,8 @@ size_t SchemaFactory::update_regions_table(
                 } else {
                     DB_WARNING("region:%s", region.ShortDebugString().c_str());
                     // 先判断加入的region是否与现有的region有范围重叠
-                    std::vector<StrInt64Map>& vec = table_region_ptr->key_region_mapping;
-                    if (vec.size() < 1) {
-                        vec.resize(1);
-                    }
-                    StrInt64Map& key_reg_map = vec[0];
+                    StrInt64Map& key_reg_map = 
+                        table_region_ptr->partition_key_region(partition_id);
                     auto region_iter = key_reg_map.lower_bound(region.start_key());
                     if (region_iter != key_reg_map.begin()) {
                         int64_t pre_region_id = (--region_iter)->second;
@@ -899,7 +954,7 @@ size_t SchemaFactory::update_regions_table(
                         && end_key_compare(region.end_key(), orgin_region.end_key()) < 0) {
                     //start key变小，end key变小，即发生split又发生merge
                     get_clear_regions(region.start_key(), orgin_region.start_key(), 
-                                    table_region_ptr, clear_regions);
+                                    table_region_ptr, partition_id, clear_regions);
                     if (clear_regions.size() < 2) {
                         clear_regions.clear();
                         last_regions.clear();
@@ -911,10 +966,10 @@ size_t SchemaFactory::update_regions_table(
                           && end_key_compare(region.end_key(), orgin_region.end_key()) == 0) {
                     //start key变小， end key不变，发生merge
                     get_clear_regions(region.start_key(), orgin_region.start_key(), 
-                                      table_region_ptr, clear_regions);
+                                      table_region_ptr, partition_id, clear_regions);
                     if (clear_regions.size() >= 2) {
                         //包含orgin region和前一个已经发生merge的空region，至少有两个
-                        clear_region(table_region_ptr, clear_regions);
+                        clear_region(table_region_ptr, partition_id, clear_regions);
                         update_region(table_region_ptr, region);
                     }
                 } else if (region.start_key() == orgin_region.start_key()
@@ -941,6 +996,7 @@ size_t SchemaFactory::update_regions_table(
             //last_region = nullptr;
         }
     }
+    table_region_ptr->rebuild_router();
     return 1;
 }
 
@@ -1268,6 +1324,22 @@ bool SchemaFactory::get_separate_switch(int64_t table_id) {
     return false;
 }
 
+bool SchemaFactory::get_write_combine_switch(int64_t table_id) {
+    DoubleBufferedTable::ScopedPtr table_ptr;
+    if (_double_buffer_table.Read(&table_ptr) != 0) {
+        DB_WARNING("read double_buffer_table error.");
+        return false;
+    }
+    auto& _table_info_mapping = table_ptr->table_info_mapping;
+    if (_table_info_mapping.count(table_id) == 0) {
+        return false;
+    }
+    if (_table_info_mapping.at(table_id)->schema_conf.has_write_combine()) {
+        return _table_info_mapping.at(table_id)->schema_conf.write_combine();
+    }
+    return false;
+}
+
 int64_t SchemaFactory::get_ttl_duration(int64_t table_id) {
     DoubleBufferedTable::ScopedPtr table_ptr;
     if (_double_buffer_table.Read(&table_ptr) != 0) {
@@ -1281,6 +1353,24 @@ int64_t SchemaFactory::get_ttl_duration(int64_t table_id) {
     return _table_info_mapping.at(table_id)->ttl_duration;
 }
 
+bool SchemaFactory::get_cf_conf(int64_t table_id, pb::ColumnFamilyConf* cf_conf) {
+    DoubleBufferedTable::ScopedPtr table_ptr;
+    if (_double_buffer_table.Read(&table_ptr) != 0) {
+        DB_WARNING("read double_buffer_table error.");
+        return false;
+    }
+    auto& _table_info_mapping = table_ptr->table_info_mapping;
+    if (_table_info_mapping.count(table_id) == 0) {
+        return false;
+    }
+    auto& table_info = _table_info_mapping.at(table_id);
+    if (!table_info->has_cf_conf) {
+        return false;
+    }
+    *cf_conf = table_info->cf_conf;
+    return true;
+}
+
 int SchemaFactory::get_database_id(const std::string& db_name, int64_t& db_id) {
     DoubleBufferedTable::ScopedPtr table_ptr;
     if (_double_buffer_table.Read(&table_ptr) != 0) {
@@ -1351,35 +1441,115 @@ int SchemaFactory::get_region_by_key(int64_t main_table_id,
                                     const pb::PossibleIndex* primary,
                                     std::map<int64_t, pb::RegionInfo>& region_infos,
                                     std::map<int64_t, pb::PossibleIndex>* region_primary) { 
+    std::map<int64_t, SmartRegionInfo> smart_region_infos;
+    int ret = get_region_by_key(main_table_id, index, primary, smart_region_infos, region_primary);
     region_infos.clear();
-    if (region_primary != nullptr) {
-        region_primary->clear();
+    for (auto& pair : smart_region_infos) {
+        region_infos.emplace_hint(region_infos.end(), pair.first, *pair.second);
     }
+    return ret;
+}
+
+int SchemaFactory::get_region_routers(int64_t index_id,
+        std::vector<SmartRegionRouter>& routers) {
+    routers.clear();
     DoubleBufferedTableRegionInfo::ScopedPtr table_region_mapping_ptr;
     if (_table_region_mapping.Read(&table_region_mapping_ptr) != 0) {
         DB_WARNING("DoubleBufferedTableRegion read scoped ptr error."); 
         return -1; 
     }
-
-    auto it = table_region_mapping_ptr->find(index.id);
+    auto it = table_region_mapping_ptr->find(index_id);
     if (it == table_region_mapping_ptr->end()) {
+        return -1;
+    }
+    routers = it->second->routers;
+    return 0;
+}
+
+SmartPartition SchemaFactory::get_table_partition(int64_t table_id) {
+    auto table_ptr = get_table_info_ptr(table_id);
+    if (table_ptr == nullptr) {
+        return nullptr;
+    }
+    return table_ptr->partition;
+}
+
+// 分区列在索引列中的位置，range的左右record都覆盖到这个位置时才能裁剪
+static void get_range_partitions(const IndexInfo& index, const TablePartition& partition,
+        const pb::PossibleIndex::Range& range, const SmartRecord& left, const SmartRecord& right,
+        std::vector<int64_t>& partition_ids) {
+    int pos = -1;
+    for (size_t i = 0; i < index.fields.size(); ++i) {
+        if (index.fields[i].id == partition.field_id()) {
+            pos = i;
+            break;
+        }
+    }
+    ExprValue left_value;
+    ExprValue right_value;
+    if (pos >= 0 && left != nullptr && pos < range.left_field_cnt()) {
+        left_value = left->get_value(left->get_field_by_tag(partition.field_id()));
+    }
+    if (pos >= 0 && right != nullptr && pos < range.right_field_cnt()) {
+        right_value = right->get_value(right->get_field_by_tag(partition.field_id()));
+    }
+    partition.get_partition_ids(left_value, right_value, partition_ids);
+}
+
+int SchemaFactory::get_partition_ids(IndexInfo& index, const pb::PossibleIndex& pos_index,
+        std::set<int64_t>& partition_ids) {
+    partition_ids.clear();
+    SmartPartition partition = get_table_partition(index.pk);
+    if (partition == nullptr) {
+        return -1;
+    }
+    std::vector<int64_t> range_partition_ids;
+    if (pos_index.ranges_size() == 0) {
+        partition->get_partition_ids(ExprValue(), ExprValue(), range_partition_ids);
+        partition_ids.insert(range_partition_ids.begin(), range_partition_ids.end());
+        return 0;
+    }
+    auto record_template = TableRecord::new_record(index.pk);
+    for (const auto& range : pos_index.ranges()) {
+        SmartRecord left;
+        SmartRecord right;
+        if (range.left_pb_record() != "") {
+            left = record_template->clone(false);
+            left->decode(range.left_pb_record());
+        }
+        if (range.right_pb_record() != "") {
+            right = record_template->clone(false);
+            right->decode(range.right_pb_record());
+        }
+        get_range_partitions(index, *partition, range, left, right, range_partition_ids);
+        partition_ids.insert(range_partition_ids.begin(), range_partition_ids.end());
+    }
+    return 0;
+}
+
+int SchemaFactory::get_region_by_key(int64_t main_table_id, 
+                                    IndexInfo& index,
+                                    const pb::PossibleIndex* primary,
+                                    std::map<int64_t, SmartRegionInfo>& region_infos,
+                                    std::map<int64_t, pb::PossibleIndex>* region_primary) { 
+    region_infos.clear();
+    if (region_primary != nullptr) {
+        region_primary->clear();
+    }
+    std::vector<SmartRegionRouter> routers;
+    if (get_region_routers(index.id, routers) != 0) {
         DB_WARNING("index id[%ld] not in table_region_mapping", index.id);
         return -1;
     }
-    auto frontground = it->second;
-    auto& key_region_mapping = frontground->key_region_mapping;
     if (primary == nullptr) {
-        if (key_region_mapping.size() != 1) {
-            DB_WARNING("partion_num not supported:%ld, %lu", index.id, key_region_mapping.size());
-            return -1;
-        }
-        StrInt64Map& map = key_region_mapping[0];
-        for (auto& pair : map) {
-            int64_t region_id = pair.second;
-            frontground->get_region_info(region_id, region_infos[region_id]);
+        for (auto& router : routers) {
+            for (auto& region : router->regions()) {
+                region_infos[region->region_id()] = region;
+            }
         }
         return 0;
     }
+    SmartPartition partition = get_table_partition(index.pk);
     pb::PossibleIndex template_primary;
     template_primary.set_index_id(primary->index_id());
     if (primary->has_sort_index()) {
@@ -1390,6 +1560,7 @@ int SchemaFactory::get_region_by_key(int64_t main_table_id,
     //auto record_template = TableRecord::new_record(index.id);
     auto record_template = TableRecord::new_record(main_table_id);
     int range_size = primary->ranges_size();
+    std::vector<int64_t> partition_ids;
     for (const auto& range : primary->ranges()) {
         SmartRecord left;
         SmartRecord right;
@@ -1428,35 +1599,43 @@ int SchemaFactory::get_region_by_key(int64_t main_table_id,
             _start_sentinel.append_u16(0xFFFF);
         }
 
-        if (key_region_mapping.size() != 1) {
-            DB_WARNING("partion_num not supported:%ld, %lu", index.id, key_region_mapping.size());
-            return -1;
-        }
-        StrInt64Map& map = key_region_mapping[0];
-        auto region_iter = map.upper_bound(_start_sentinel.data());
-        
-        while (left_open && region_iter != map.end() && 
-                boost::starts_with(region_iter->first, _start.data())) {
-            region_iter++;
-        }
-        if (region_iter != map.begin()) {
-            --region_iter;
+        // 分区裁剪：只有分区列被range限定时才能少访问分区
+        partition_ids.clear();
+        if (partition != nullptr) {
+            get_range_partitions(index, *partition, range, left, right, partition_ids);
+        } else {
+            partition_ids.push_back(0);
         }
-        while (region_iter != map.end()) {
-            if (_end.data().empty() || region_iter->first <= _end.data() ||
-                    (!right_open && boost::starts_with(region_iter->first, _end.data()))) {
-                int64_t region_id = region_iter->second;
-                frontground->get_region_info(region_id, region_infos[region_id]);
-                if (range_size > 1 && region_primary != nullptr) {
-                    if (region_primary->count(region_id) == 0) {
-                        (*region_primary)[region_id].CopyFrom(template_primary);
+        for (int64_t partition_id : partition_ids) {
+            if (partition_id >= (int64_t)routers.size() || routers[partition_id] == nullptr) {
+                continue;
+            }
+            const RegionRouter& router = *routers[partition_id];
+            size_t idx = router.upper_bound(_start_sentinel.data());
+            while (left_open && idx < router.size() && 
+                    boost::starts_with(router.region(idx)->start_key(), _start.data())) {
+                idx++;
+            }
+            if (idx > 0) {
+                --idx;
+            }
+            for (; idx < router.size(); ++idx) {
+                const SmartRegionInfo& region = router.region(idx);
+                const std::string& start_key = region->start_key();
+                if (_end.data().empty() || start_key <= _end.data() ||
+                        (!right_open && boost::starts_with(start_key, _end.data()))) {
+                    int64_t region_id = region->region_id();
+                    region_infos[region_id] = region;
+                    if (range_size > 1 && region_primary != nullptr) {
+                        if (region_primary->count(region_id) == 0) {
+                            (*region_primary)[region_id].CopyFrom(template_primary);
+                        }
+                        (*region_primary)[region_id].add_ranges()->CopyFrom(range);
                     }
-                    (*region_primary)[region_id].add_ranges()->CopyFrom(range);
+                } else {
+                    break;
                 }
-            } else {
-                break;
             }
-            region_iter++;
         }
     }
     return 0;
@@ -1467,68 +1646,44 @@ int SchemaFactory::get_region_by_key(int64_t main_table_id,
 int SchemaFactory::get_region_by_key(
         const RepeatedPtrField<pb::RegionInfo>& input_regions,
         std::map<int64_t, pb::RegionInfo>& output_regions) {
+    std::vector<SmartRegionRouter> routers;
     for (int idx = 0; idx < input_regions.size(); ++idx) {
         int64_t table_id = input_regions[idx].table_id();
+        int64_t partition_id = input_regions[idx].partition_id();
 
-        DoubleBufferedTableRegionInfo::ScopedPtr table_region_mapping_ptr;
-        if (_table_region_mapping.Read(&table_region_mapping_ptr) != 0) {
-            DB_WARNING("DoubleBufferedTableRegion read scoped ptr error."); 
+        if (get_region_routers(table_id, routers) != 0) {
+            DB_WARNING("index id[%ld] not in table_region_mapping", table_id);
             continue;
         }
-        auto it = table_region_mapping_ptr->find(table_id);
-        if (it == table_region_mapping_ptr->end()) {
-            DB_WARNING("index id[%ld] not in table_region_mapping", table_id);
+        if (partition_id < 0 || partition_id >= (int64_t)routers.size()) {
+            DB_WARNING("index id[%ld] partition_id[%ld] not exist", table_id, partition_id);
             continue;
         }
-        //读 
-        auto frontground = it->second;
-        auto& key_region_mapping = frontground->key_region_mapping;
-
+        const RegionRouter& router = *routers[partition_id];
         const std::string& start = input_regions[idx].start_key();
         const std::string& end = input_regions[idx].end_key();
-
-        if (key_region_mapping.size() != 1) {
-            DB_WARNING("partion_num not supported:%ld, %lu", table_id, key_region_mapping.size());
-            return -1;
-        }
-        StrInt64Map& map = key_region_mapping[0];
-        auto region_iter = map.upper_bound(start);
-
-        if (region_iter != map.begin()) {
-            --region_iter;
+        size_t region_idx = router.upper_bound(start);
+        if (region_idx > 0) {
+            --region_idx;
         }
-        while (region_iter != map.end()) {
-            if (end.empty() || region_iter->first < end) {
-                int64_t region_id = region_iter->second;
-                frontground->get_region_info(region_id, output_regions[region_id]);
+        for (; region_idx < router.size(); ++region_idx) {
+            const SmartRegionInfo& region = router.region(region_idx);
+            if (end.empty() || region->start_key() < end) {
+                output_regions[region->region_id()] = *region;
             } else {
                 break;
             }
-            region_iter++;
         }
     }
     return 0;
 }
 
-int SchemaFactory::get_region_by_key(IndexInfo& index,
-        std::vector<SmartRecord>    records,
+int SchemaFactory::route_records(IndexInfo& index,
+        const std::vector<SmartRegionRouter>& routers,
+        const SmartPartition& partition,
+        const std::vector<SmartRecord>& records,
         std::map<int64_t, std::vector<SmartRecord>>& region_ids,
         std::map<int64_t, pb::RegionInfo>& region_infos) {
-    region_ids.clear();
-    region_infos.clear();
-
-    DoubleBufferedTableRegionInfo::ScopedPtr table_region_mapping_ptr;
-    if (_table_region_mapping.Read(&table_region_mapping_ptr) != 0) {
-        DB_WARNING("DoubleBufferedTableRegion read scoped ptr error."); 
-        return -1;
-    }
-    auto it = table_region_mapping_ptr->find(index.id);
-    if (it == table_region_mapping_ptr->end()) {
-        DB_WARNING("index id[%ld] not in table_region_mapping", index.id);
-        return -1;
-    }
-    auto frontground = it->second;
-    auto& key_region_mapping = frontground->key_region_mapping;
     for (auto& record : records) {
         MutTableKey  key;
         if (0 != key.append_index(index, record.get(), -1, false)) {
@@ -1541,21 +1696,47 @@ int SchemaFactory::get_region_by_key(IndexInfo& index,
                 return -1;
             }
         }
-        if (key_region_mapping.size() != 1) {
-            DB_WARNING("partion_num not supported:%ld, %lu", index.id, key_region_mapping.size());
+        int64_t partition_id = 0;
+        if (partition != nullptr) {
+            partition_id = partition->get_partition_id(
+                    record->get_value(record->get_field_by_tag(partition->field_id())));
+        }
+        if (partition_id < 0 || partition_id >= (int64_t)routers.size()) {
+            DB_FATAL("no partition for record, table:%ld, partition_id:%ld",
+                    index.id, partition_id);
             return -1;
         }
-        StrInt64Map& map = key_region_mapping[0];
-        auto region_iter = map.upper_bound(key.data());
-        --region_iter;
-        int64_t region_id = region_iter->second;
+        SmartRegionInfo region = routers[partition_id]->find(key.data());
+        if (region == nullptr) {
+            DB_FATAL("no region for key, table:%ld, key:%s", index.id, 
+                    str_to_hex(key.data()).c_str());
+            return -1;
+        }
+        int64_t region_id = region->region_id();
         region_ids[region_id].push_back(record);
-        frontground->get_region_info(region_id, region_infos[region_id]);
+        // 同一region只拷贝一次
+        if (region_infos.count(region_id) == 0) {
+            region_infos[region_id] = *region;
+        }
     }
-    //DB_WARNING("region_id:%ld", region_iter->second);
     return 0;
 }
 
+int SchemaFactory::get_region_by_key(IndexInfo& index,
+        std::vector<SmartRecord>    records,
+        std::map<int64_t, std::vector<SmartRecord>>& region_ids,
+        std::map<int64_t, pb::RegionInfo>& region_infos) {
+    region_ids.clear();
+    region_infos.clear();
+    std::vector<SmartRegionRouter> routers;
+    if (get_region_routers(index.id, routers) != 0) {
+        DB_WARNING("index id[%ld] not in table_region_mapping", index.id);
+        return -1;
+    }
+    return route_records(index, routers, get_table_partition(index.pk),
+            records, region_ids, region_infos);
+}
+
 int SchemaFactory::get_region_by_key(IndexInfo& index,
          const std::vector<SmartRecord>& insert_records,
          const std::vector<SmartRecord>& delete_records,
@@ -1565,67 +1746,18 @@ int SchemaFactory::get_region_by_key(IndexInfo& index,
     insert_region_ids.clear();
     delete_region_ids.clear();
     region_infos.clear();
-
-    DoubleBufferedTableRegionInfo::ScopedPtr table_region_mapping_ptr;
-    if (_table_region_mapping.Read(&table_region_mapping_ptr) != 0) {
-        DB_WARNING("DoubleBufferedTableRegion read scoped ptr error."); 
-        return -1; 
-    }
-
-    auto it = table_region_mapping_ptr->find(index.id);
-    if (it == table_region_mapping_ptr->end()) {
+    std::vector<SmartRegionRouter> routers;
+    if (get_region_routers(index.id, routers) != 0) {
         DB_WARNING("index id[%ld] not in table_region_mapping.", index.id);
         return -1;
     }
-    auto frontground = it->second;
-    auto& key_region_mapping = frontground->key_region_mapping;
-    for (auto& record : insert_records) {
-        MutTableKey  key;
-        if (0 != key.append_index(index, record.get(), -1, false)) {
-            DB_FATAL("Fail to encode_key, table:%ld", index.id);
-            return -1;
-        }
-        if (index.type == pb::I_KEY) {
-            if (0 != record->encode_primary_key(index, key, -1)) {
-                DB_FATAL("Fail to append_pk_index, tab:%ld", index.id);
-                return -1;
-            }
-        }
-        if (key_region_mapping.size() != 1) {
-            DB_WARNING("partion_num not supported:%ld, %lu", index.id, key_region_mapping.size());
-            return -1;
-        }
-        StrInt64Map& map = key_region_mapping[0];
-        auto region_iter = map.upper_bound(key.data());
-        --region_iter;
-        int64_t region_id = region_iter->second;
-        insert_region_ids[region_id].push_back(record);
-        frontground->get_region_info(region_id, region_infos[region_id]); 
-    }
-    for (auto& record : delete_records) {
-        MutTableKey key;
-        if (0 != key.append_index(index, record.get(), -1, false)) {
-            DB_FATAL("Fail to encode_key, table:%ld", index.id);
-            return -1;
-        }
-        if (index.type == pb::I_KEY) {
-            if (0 != record->encode_primary_key(index, key, -1)) {
-                DB_FATAL("Fail to append_pk_index, tab:%ld", index.id);
-                return -1;
-            }
-        }
-        if (key_region_mapping.size() != 1) {
-            DB_WARNING("partion_num not supported:%ld, %lu", index.id, key_region_mapping.size());
-            return -1;
-        }
-        StrInt64Map& map = key_region_mapping[0];
-        auto region_iter = map.upper_bound(key.data());
-        --region_iter;
-        int64_t region_id = region_iter->second;
-        delete_region_ids[region_id].push_back(record);
-        frontground->get_region_info(region_id, region_infos[region_id]);
+    SmartPartition partition = get_table_partition(index.pk);
+    if (route_records(index, routers, partition, insert_records,
+                insert_region_ids, region_infos) != 0) {
+        return -1;
     }
-    return 0;
+    return route_records(index, routers, partition, delete_records,
+            delete_region_ids, region_infos);
 }
 
 }//namespace
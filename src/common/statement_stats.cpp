@@ -0,0 +1,204 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "statement_stats.h"
+#include <algorithm>
+#include <sstream>
+#include <gflags/gflags.h>
+
+namespace baikaldb {
+DEFINE_bool(statement_stats_enable, true, "aggregate sql stats by statement digest, default:true");
+DEFINE_int32(statement_stats_max_digests, 2000,
+        "max statement digests kept, least recently executed evicted, default:2000");
+DEFINE_int32(statement_stats_show_limit, 100,
+        "max digests returned by show statement stats, default:100");
+DEFINE_int32(statement_stats_bvar_limit, 20, "max digests shown in bvar page, default:20");
+
+static bvar::Adder<int64_t> statement_stats_evict_count("statement_stats_evict_count");
+
+int LatencyHistogram::bucket_index(int64_t value) {
+    if (value < (1 << SUB_BITS)) {
+        return value < 0 ? 0 : value;
+    }
+    int exp = 63 - __builtin_clzll(value);
+    int sub = (value >> (exp - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    return ((exp - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+int64_t LatencyHistogram::bucket_upper(int index) {
+    if (index < (1 << SUB_BITS)) {
+        return index;
+    }
+    int exp = (index >> SUB_BITS) + SUB_BITS - 1;
+    int sub = index & ((1 << SUB_BITS) - 1);
+    int64_t lower = ((1LL << SUB_BITS) + sub) << (exp - SUB_BITS);
+    return lower + (1LL << (exp - SUB_BITS)) - 1;
+}
+
+int64_t LatencyHistogram::percentile(double ratio) const {
+    if (_count == 0) {
+        return 0;
+    }
+    int64_t rank = (int64_t)(ratio * _count);
+    if (rank >= _count) {
+        rank = _count - 1;
+    }
+    int64_t seen = 0;
+    for (int i = 0; i < BUCKET_NUM; ++i) {
+        seen += _buckets[i];
+        if (seen > rank) {
+            return bucket_upper(i);
+        }
+    }
+    return bucket_upper(BUCKET_NUM - 1);
+}
+
+StatementStats::StatementStats(const std::string& bvar_name) :
+        _dump_status(dump_status, this) {
+    if (!bvar_name.empty()) {
+        _dump_status.expose(bvar_name);
+    }
+}
+
+uint64_t StatementStats::sign(const std::string& digest) {
+    uint64_t out[2];
+    butil::MurmurHash3_x64_128(digest.c_str(), digest.size(), 0x1234, out);
+    return out[0];
+}
+
+void StatementStats::record(uint64_t sign, const std::string& digest,
+        const std::string& family, const std::string& table, int op_type,
+        const StatementSample& sample, int64_t now_us) {
+    Shard& shard = _shards[sign % SHARD_NUM];
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto iter = shard.stats.find(sign);
+    if (iter == shard.stats.end()) {
+        // 新digest才拷贝文本
+        size_t shard_limit = std::max(FLAGS_statement_stats_max_digests / SHARD_NUM, 1);
+        if (shard.stats.size() >= shard_limit) {
+            evict_oldest(shard);
+        }
+        std::unique_ptr<DigestStat> stat(new DigestStat);
+        stat->digest = digest;
+        stat->family = family;
+        stat->table = table;
+        stat->op_type = op_type;
+        stat->first_seen_us = now_us;
+        iter = shard.stats.emplace(sign, std::move(stat)).first;
+    }
+    DigestStat* s = iter->second.get();
+    if (sample.error) {
+        ++s->errors;
+    }
+    s->sum_latency_us += sample.latency_us;
+    s->max_latency_us = std::max(s->max_latency_us, sample.latency_us);
+    s->sum_store_us += sample.store_us;
+    s->rows_returned += sample.rows_returned;
+    s->rows_affected += sample.rows_affected;
+    s->rows_examined += sample.rows_examined;
+    s->last_seen_us = now_us;
+    s->latency.add(sample.latency_us);
+}
+
+void StatementStats::evict_oldest(Shard& shard) {
+    auto oldest = shard.stats.end();
+    for (auto iter = shard.stats.begin(); iter != shard.stats.end(); ++iter) {
+        if (oldest == shard.stats.end()
+                || iter->second->last_seen_us < oldest->second->last_seen_us) {
+            oldest = iter;
+        }
+    }
+    if (oldest != shard.stats.end()) {
+        shard.stats.erase(oldest);
+        statement_stats_evict_count << 1;
+    }
+}
+
+void StatementStats::list(std::vector<StatementDigestInfo>* infos, int limit) {
+    infos->clear();
+    for (auto& shard : _shards) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        for (auto& pair : shard.stats) {
+            const DigestStat& s = *pair.second;
+            StatementDigestInfo info;
+            info.sign = pair.first;
+            info.digest = s.digest;
+            info.family = s.family;
+            info.table = s.table;
+            info.op_type = s.op_type;
+            info.count = s.latency.count();
+            info.errors = s.errors;
+            info.sum_latency_us = s.sum_latency_us;
+            info.max_latency_us = s.max_latency_us;
+            // 桶上界可能超过真实最大值
+            info.p50_latency_us = std::min(s.latency.percentile(0.5), s.max_latency_us);
+            info.p99_latency_us = std::min(s.latency.percentile(0.99), s.max_latency_us);
+            info.sum_store_us = s.sum_store_us;
+            info.rows_returned = s.rows_returned;
+            info.rows_affected = s.rows_affected;
+            info.rows_examined = s.rows_examined;
+            info.first_seen_us = s.first_seen_us;
+            info.last_seen_us = s.last_seen_us;
+            infos->push_back(info);
+        }
+    }
+    std::sort(infos->begin(), infos->end(),
+            [](const StatementDigestInfo& a, const StatementDigestInfo& b) {
+        return a.sum_latency_us > b.sum_latency_us;
+    });
+    if (limit > 0 && infos->size() > (size_t)limit) {
+        infos->resize(limit);
+    }
+}
+
+std::string StatementStats::dump(int limit) {
+    std::vector<StatementDigestInfo> infos;
+    list(&infos, limit);
+    std::ostringstream os;
+    os << "sign\tcount\terrors\tavg_us\tp50_us\tp99_us\tmax_us\tstore_avg_us"
+        "\trows_returned\trows_affected\trows_examined\tdigest\n";
+    for (auto& info : infos) {
+        int64_t count = std::max(info.count, (int64_t)1);
+        os << info.sign << "\t" << info.count << "\t" << info.errors << "\t"
+            << info.sum_latency_us / count << "\t" << info.p50_latency_us << "\t"
+            << info.p99_latency_us << "\t" << info.max_latency_us << "\t"
+            << info.sum_store_us / count << "\t" << info.rows_returned << "\t"
+            << info.rows_affected << "\t" << info.rows_examined << "\t"
+            << info.family << "." << info.table << " " << info.digest << "\n";
+    }
+    return os.str();
+}
+
+std::string StatementStats::dump_status(void* arg) {
+    return static_cast<StatementStats*>(arg)->dump(FLAGS_statement_stats_bvar_limit);
+}
+
+void StatementStats::clear() {
+    for (auto& shard : _shards) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.stats.clear();
+    }
+}
+
+size_t StatementStats::size() {
+    size_t size = 0;
+    for (auto& shard : _shards) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        size += shard.stats.size();
+    }
+    return size;
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
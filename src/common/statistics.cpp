@@ -0,0 +1,198 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "statistics.h"
+#include "hll_common.h"
+
+namespace baikaldb {
+DEFINE_int32(statistics_bucket_num, 64, "histogram bucket num of index statistics");
+DEFINE_int32(statistics_mcv_num, 16, "most common value num of index statistics");
+
+namespace {
+// key以prefix为前缀时视为相等, 用于比较索引key和只包含部分字段的范围边界
+int prefix_compare(const std::string& key, const std::string& prefix) {
+    if (key.size() >= prefix.size()) {
+        return key.compare(0, prefix.size(), prefix);
+    }
+    return key.compare(prefix);
+}
+}
+
+IndexStatisticsBuilder::IndexStatisticsBuilder(int64_t index_id, int64_t estimate_rows,
+        int bucket_num, int mcv_num) :
+        _index_id(index_id),
+        _bucket_depth(std::max(estimate_rows / std::max(bucket_num, 1), 1L)),
+        _mcv_num(std::max(mcv_num, 0)) {
+    _hll = hll::hll_init().str_val;
+    _statistics.set_index_id(index_id);
+}
+
+void IndexStatisticsBuilder::add(const std::string& key, const std::string& value_key) {
+    ++_row_count;
+    if (_cur_bucket == nullptr || _cur_bucket->count() >= _bucket_depth) {
+        _cur_bucket = _statistics.add_buckets();
+        _cur_bucket->set_lower_bound(key);
+        _cur_bucket->set_count(0);
+    }
+    _cur_bucket->set_upper_bound(key);
+    _cur_bucket->set_count(_cur_bucket->count() + 1);
+
+    if (_last_value_count > 0 && value_key == _last_value) {
+        ++_last_value_count;
+        return;
+    }
+    finish_value();
+    _last_value = value_key;
+    _last_value_count = 1;
+    hll::hll_add(_hll, make_sign(value_key));
+}
+
+void IndexStatisticsBuilder::finish_value() {
+    if (_last_value_count <= 1 || _mcv_num == 0) {
+        return;
+    }
+    if (_mcv_heap.size() < _mcv_num) {
+        _mcv_heap.emplace(_last_value_count, _last_value);
+    } else if (_mcv_heap.top().first < _last_value_count) {
+        _mcv_heap.pop();
+        _mcv_heap.emplace(_last_value_count, _last_value);
+    }
+}
+
+void IndexStatisticsBuilder::finish(pb::IndexStatistics* statistics) {
+    finish_value();
+    _last_value_count = 0;
+    while (!_mcv_heap.empty()) {
+        auto mcv = _statistics.add_mcvs();
+        mcv->set_count(_mcv_heap.top().first);
+        mcv->set_value(_mcv_heap.top().second);
+        _mcv_heap.pop();
+    }
+    _statistics.set_row_count(_row_count);
+    _statistics.set_ndv(hll::hll_estimate(_hll));
+    _statistics.set_hll(_hll);
+    statistics->Swap(&_statistics);
+}
+
+void merge_index_statistics(const std::vector<const pb::IndexStatistics*>& region_statistics,
+        pb::IndexStatistics* statistics, int bucket_num, int mcv_num) {
+    std::string hll = hll::hll_init().str_val;
+    int64_t row_count = 0;
+    std::vector<const pb::HistogramBucket*> buckets;
+    std::map<std::string, int64_t> mcv_counts;
+    for (auto region_stat : region_statistics) {
+        statistics->set_index_id(region_stat->index_id());
+        row_count += region_stat->row_count();
+        if (region_stat->has_hll()) {
+            std::string region_hll = region_stat->hll();
+            hll::hll_merge(hll, region_hll);
+        }
+        for (auto& bucket : region_stat->buckets()) {
+            buckets.push_back(&bucket);
+        }
+        for (auto& mcv : region_stat->mcvs()) {
+            mcv_counts[mcv.value()] += mcv.count();
+        }
+    }
+    statistics->set_row_count(row_count);
+    statistics->set_ndv(hll::hll_estimate(hll));
+    statistics->set_hll(hll);
+
+    // 主键的各region桶互不重叠, 二级索引的桶可能重叠, 按上界排序后重新分桶, 结果是近似的
+    std::sort(buckets.begin(), buckets.end(),
+            [](const pb::HistogramBucket* l, const pb::HistogramBucket* r) {
+                return l->upper_bound() < r->upper_bound();
+            });
+    int64_t depth = std::max(row_count / std::max(bucket_num, 1), 1L);
+    pb::HistogramBucket* cur_bucket = nullptr;
+    for (auto bucket : buckets) {
+        if (cur_bucket == nullptr || cur_bucket->count() >= depth) {
+            cur_bucket = statistics->add_buckets();
+            cur_bucket->set_lower_bound(bucket->lower_bound());
+            cur_bucket->set_count(0);
+        }
+        if (bucket->lower_bound() < cur_bucket->lower_bound()) {
+            cur_bucket->set_lower_bound(bucket->lower_bound());
+        }
+        cur_bucket->set_upper_bound(bucket->upper_bound());
+        cur_bucket->set_count(cur_bucket->count() + bucket->count());
+    }
+
+    std::vector<std::pair<int64_t, std::string>> mcvs;
+    for (auto& pair : mcv_counts) {
+        mcvs.emplace_back(pair.second, pair.first);
+    }
+    std::sort(mcvs.begin(), mcvs.end(), std::greater<std::pair<int64_t, std::string>>());
+    for (size_t i = 0; i < mcvs.size() && i < (size_t)mcv_num; ++i) {
+        auto mcv = statistics->add_mcvs();
+        mcv->set_count(mcvs[i].first);
+        mcv->set_value(mcvs[i].second);
+    }
+}
+
+TableStatistics::TableStatistics(const pb::TableStatistics& statistics) :
+        _version(statistics.version()) {
+    for (auto& index_stat : statistics.indexes()) {
+        pb::IndexStatistics& stat = _index_statistics[index_stat.index_id()];
+        stat.CopyFrom(index_stat);
+        // 合并只在analyze时用到, 常驻内存中不保留hll
+        stat.clear_hll();
+    }
+}
+
+int64_t TableStatistics::estimate_range_rows(const pb::IndexStatistics& statistics,
+        const std::string& left, const std::string& right) {
+    if (left.empty() && right.empty()) {
+        return statistics.row_count();
+    }
+    double rows = 0;
+    for (auto& bucket : statistics.buckets()) {
+        bool after_left = left.empty() || prefix_compare(bucket.lower_bound(), left) >= 0;
+        bool before_right = right.empty() || prefix_compare(bucket.upper_bound(), right) <= 0;
+        if (!left.empty() && prefix_compare(bucket.upper_bound(), left) < 0) {
+            continue;
+        }
+        if (!right.empty() && prefix_compare(bucket.lower_bound(), right) > 0) {
+            break;
+        }
+        if (after_left && before_right) {
+            rows += bucket.count();
+        } else if (after_left || before_right) {
+            // 范围覆盖桶的一部分, 按一半估算
+            rows += bucket.count() / 2.0;
+        } else {
+            // 范围落在桶内部
+            rows += std::max(bucket.count() / 4.0, 1.0);
+        }
+    }
+    return std::max((int64_t)rows, 1L);
+}
+
+int64_t TableStatistics::estimate_eq_rows(const pb::IndexStatistics& statistics,
+        const std::string& value_key) {
+    int64_t mcv_total = 0;
+    for (auto& mcv : statistics.mcvs()) {
+        if (mcv.value() == value_key) {
+            return mcv.count();
+        }
+        mcv_total += mcv.count();
+    }
+    // 非高频值按均匀分布估算
+    int64_t other_ndv = std::max(statistics.ndv() - statistics.mcvs_size(), 1L);
+    int64_t other_rows = std::max(statistics.row_count() - mcv_total, 0L);
+    return std::max(other_rows / other_ndv, 1L);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
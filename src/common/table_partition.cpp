@@ -0,0 +1,128 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "table_partition.h"
+#include <algorithm>
+
+namespace baikaldb {
+int TablePartition::init(const pb::PartitionInfo& info, int64_t partition_num,
+        pb::PrimitiveType field_type) {
+    if (partition_num < 1) {
+        DB_WARNING("invalid partition_num: %ld", partition_num);
+        return -1;
+    }
+    if (!is_int(field_type) && field_type != pb::DATETIME && field_type != pb::TIMESTAMP
+            && field_type != pb::DATE && field_type != pb::TIME) {
+        DB_WARNING("partition field: %s type: %d not support",
+                info.field_name().c_str(), field_type);
+        return -1;
+    }
+    _type = info.has_type() ? info.type() : pb::PT_HASH;
+    _field_id = info.field_id();
+    _field_type = field_type;
+    _partition_num = partition_num;
+    _range_bounds.clear();
+    if (_type != pb::PT_RANGE) {
+        return 0;
+    }
+    if (info.range_bounds_size() != partition_num
+            && info.range_bounds_size() != partition_num - 1) {
+        DB_WARNING("range_bounds size: %d not match partition_num: %ld",
+                info.range_bounds_size(), partition_num);
+        return -1;
+    }
+    for (auto& bound : info.range_bounds()) {
+        ExprValue value(pb::STRING);
+        value.str_val = bound;
+        value.cast_to(_field_type);
+        if (!_range_bounds.empty() && _range_bounds.back().compare(value) >= 0) {
+            DB_WARNING("range_bounds not increasing: %s", bound.c_str());
+            return -1;
+        }
+        _range_bounds.push_back(value);
+    }
+    return 0;
+}
+
+ExprValue TablePartition::to_field_type(const ExprValue& value) const {
+    ExprValue tmp = value;
+    tmp.cast_to(_field_type);
+    return tmp;
+}
+
+int64_t TablePartition::get_partition_id(const ExprValue& value) const {
+    if (_partition_num == 1 || value.is_null()) {
+        return 0;
+    }
+    ExprValue tmp = to_field_type(value);
+    if (_type == pb::PT_RANGE) {
+        auto iter = std::upper_bound(_range_bounds.begin(), _range_bounds.end(), tmp,
+                [](const ExprValue& left, const ExprValue& right) {
+                    return left.compare(right) < 0;
+                });
+        int64_t idx = iter - _range_bounds.begin();
+        return idx < _partition_num ? idx : -1;
+    }
+    if (is_uint(_field_type) || _field_type == pb::TIMESTAMP) {
+        return tmp.get_numberic<uint64_t>() % _partition_num;
+    }
+    if (is_int(_field_type)) {
+        int64_t mod = tmp.get_numberic<int64_t>() % _partition_num;
+        return mod < 0 ? mod + _partition_num : mod;
+    }
+    // datetime按位打包，低位常为0，打散后再取模
+    uint64_t hash = tmp.get_numberic<uint64_t>();
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash % _partition_num;
+}
+
+void TablePartition::get_partition_ids(const ExprValue& left, const ExprValue& right,
+        std::vector<int64_t>& partition_ids) const {
+    partition_ids.clear();
+    bool point = !left.is_null() && !right.is_null()
+            && to_field_type(left).compare(to_field_type(right)) == 0;
+    if (point) {
+        int64_t partition_id = get_partition_id(left);
+        if (partition_id >= 0) {
+            partition_ids.push_back(partition_id);
+        }
+        return;
+    }
+    int64_t begin = 0;
+    int64_t end = _partition_num - 1;
+    if (_type == pb::PT_RANGE) {
+        if (!left.is_null()) {
+            begin = get_partition_id(left);
+            if (begin < 0) {
+                return;
+            }
+        }
+        if (!right.is_null()) {
+            int64_t partition_id = get_partition_id(right);
+            if (partition_id >= 0) {
+                end = partition_id;
+            }
+        }
+    }
+    for (int64_t partition_id = begin; partition_id <= end; ++partition_id) {
+        partition_ids.push_back(partition_id);
+    }
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
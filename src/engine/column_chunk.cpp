@@ -0,0 +1,933 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "column_chunk.h"
+#include <string.h>
+#include <unordered_map>
+
+namespace baikaldb {
+DEFINE_bool(cstore_use_chunk, true, "cstore scan reads column chunks when available");
+DEFINE_int32(cstore_chunk_rows, 4096, "rows per cstore column chunk");
+
+namespace {
+const uint8_t CHUNK_VERSION = 1;
+const size_t ZONE_MAP_MAX_STR_LEN = 64;
+
+// 和chunk中整数列的存储方式一致
+int64_t to_int_raw(const ExprValue& value) {
+    if (value.is_uint() || value.type == pb::DATETIME
+            || value.type == pb::TIMESTAMP || value.type == pb::DATE) {
+        return (int64_t)value.get_numberic<uint64_t>();
+    }
+    return value.get_numberic<int64_t>();
+}
+
+void put_varint64(std::string* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((char)value);
+}
+
+size_t varint64_len(uint64_t value) {
+    size_t len = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++len;
+    }
+    return len;
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+inline int bit_width(uint64_t value) {
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+// 按位宽从低位开始连续打包
+void bit_pack(const std::vector<uint64_t>& values, int width, std::string* out) {
+    if (width == 0) {
+        return;
+    }
+    uint64_t acc = 0;
+    int bits = 0;
+    for (uint64_t value : values) {
+        int left = width;
+        while (left > 0) {
+            int take = std::min(left, 64 - bits);
+            uint64_t part = take == 64 ? value : (value & ((1ULL << take) - 1));
+            acc |= part << bits;
+            bits += take;
+            value = take == 64 ? 0 : (value >> take);
+            left -= take;
+            while (bits >= 8) {
+                out->push_back((char)(acc & 0xFF));
+                acc = bits == 64 ? 0 : (acc >> 8);
+                bits -= 8;
+            }
+        }
+    }
+    if (bits > 0) {
+        out->push_back((char)(acc & 0xFF));
+    }
+}
+
+class ChunkReader {
+public:
+    ChunkReader(const char* data, size_t size) : _data((const uint8_t*)data), _size(size) {}
+
+    bool get_u8(uint8_t* value) {
+        if (_pos >= _size) {
+            return false;
+        }
+        *value = _data[_pos++];
+        return true;
+    }
+    bool get_varint64(uint64_t* value) {
+        uint64_t result = 0;
+        for (int shift = 0; shift <= 63 && _pos < _size; shift += 7) {
+            uint64_t byte = _data[_pos++];
+            result |= (byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                *value = result;
+                return true;
+            }
+        }
+        return false;
+    }
+    bool get_bytes(size_t len, std::string* value) {
+        if (_size - _pos < len) {
+            return false;
+        }
+        value->assign((const char*)_data + _pos, len);
+        _pos += len;
+        return true;
+    }
+    bool get_raw(size_t len, void* value) {
+        if (_size - _pos < len) {
+            return false;
+        }
+        memcpy(value, _data + _pos, len);
+        _pos += len;
+        return true;
+    }
+    bool bit_unpack(size_t count, int width, std::vector<uint64_t>* values) {
+        values->resize(count);
+        if (width == 0) {
+            std::fill(values->begin(), values->end(), 0);
+            return true;
+        }
+        size_t bytes = (count * width + 7) / 8;
+        if (_size - _pos < bytes) {
+            return false;
+        }
+        const uint8_t* p = _data + _pos;
+        size_t bit_pos = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t value = 0;
+            int got = 0;
+            while (got < width) {
+                size_t byte_idx = bit_pos >> 3;
+                int offset = bit_pos & 7;
+                int take = std::min(width - got, 8 - offset);
+                uint64_t part = (p[byte_idx] >> offset) & ((1U << take) - 1);
+                value |= part << got;
+                got += take;
+                bit_pos += take;
+            }
+            (*values)[i] = value;
+        }
+        _pos += bytes;
+        return true;
+    }
+    bool eof() const {
+        return _pos == _size;
+    }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+    size_t _pos = 0;
+};
+
+void encode_ints(const std::vector<int64_t>& ints, std::string* out) {
+    size_t count = ints.size();
+    if (count == 0) {
+        out->push_back(CHUNK_ENC_PLAIN);
+        return;
+    }
+    size_t plain_len = 0;
+    size_t rle_len = 0;
+    uint64_t max_delta = 0;
+    for (size_t i = 0; i < count; ++i) {
+        plain_len += varint64_len(zigzag(ints[i]));
+        if (i == 0 || ints[i] != ints[i - 1]) {
+            size_t run = 1;
+            while (i + run < count && ints[i + run] == ints[i]) {
+                ++run;
+            }
+            rle_len += varint64_len(zigzag(ints[i])) + varint64_len(run);
+        }
+        if (i > 0) {
+            max_delta |= zigzag((int64_t)((uint64_t)ints[i] - (uint64_t)ints[i - 1]));
+        }
+    }
+    int width = bit_width(max_delta);
+    size_t bitpack_len = varint64_len(zigzag(ints[0])) + 1 + ((count - 1) * width + 7) / 8;
+
+    if (bitpack_len <= rle_len && bitpack_len <= plain_len) {
+        out->push_back(CHUNK_ENC_DELTA_BITPACK);
+        put_varint64(out, zigzag(ints[0]));
+        out->push_back((char)width);
+        std::vector<uint64_t> deltas;
+        deltas.reserve(count - 1);
+        for (size_t i = 1; i < count; ++i) {
+            deltas.push_back(zigzag((int64_t)((uint64_t)ints[i] - (uint64_t)ints[i - 1])));
+        }
+        bit_pack(deltas, width, out);
+    } else if (rle_len <= plain_len) {
+        out->push_back(CHUNK_ENC_RLE);
+        for (size_t i = 0; i < count;) {
+            size_t run = 1;
+            while (i + run < count && ints[i + run] == ints[i]) {
+                ++run;
+            }
+            put_varint64(out, zigzag(ints[i]));
+            put_varint64(out, run);
+            i += run;
+        }
+    } else {
+        out->push_back(CHUNK_ENC_PLAIN);
+        for (auto value : ints) {
+            put_varint64(out, zigzag(value));
+        }
+    }
+}
+
+int decode_ints(ChunkReader& reader, size_t count, std::vector<int64_t>* ints) {
+    uint8_t encoding = 0;
+    if (!reader.get_u8(&encoding)) {
+        return -1;
+    }
+    ints->clear();
+    ints->reserve(count);
+    switch (encoding) {
+        case CHUNK_ENC_PLAIN: {
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t value = 0;
+                if (!reader.get_varint64(&value)) {
+                    return -1;
+                }
+                ints->push_back(unzigzag(value));
+            }
+            break;
+        }
+        case CHUNK_ENC_RLE: {
+            while (ints->size() < count) {
+                uint64_t value = 0;
+                uint64_t run = 0;
+                if (!reader.get_varint64(&value) || !reader.get_varint64(&run)
+                        || run == 0 || run > count - ints->size()) {
+                    return -1;
+                }
+                ints->insert(ints->end(), run, unzigzag(value));
+            }
+            break;
+        }
+        case CHUNK_ENC_DELTA_BITPACK: {
+            uint64_t first = 0;
+            uint8_t width = 0;
+            if (count == 0 || !reader.get_varint64(&first) || !reader.get_u8(&width) || width > 64) {
+                return -1;
+            }
+            std::vector<uint64_t> deltas;
+            if (!reader.bit_unpack(count - 1, width, &deltas)) {
+                return -1;
+            }
+            uint64_t value = (uint64_t)unzigzag(first);
+            ints->push_back((int64_t)value);
+            for (auto delta : deltas) {
+                value += (uint64_t)unzigzag(delta);
+                ints->push_back((int64_t)value);
+            }
+            break;
+        }
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+void encode_doubles(const std::vector<double>& doubles, std::string* out) {
+    size_t runs = 0;
+    for (size_t i = 0; i < doubles.size(); ++i) {
+        if (i == 0 || memcmp(&doubles[i], &doubles[i - 1], sizeof(double)) != 0) {
+            ++runs;
+        }
+    }
+    if (runs * 2 <= doubles.size()) {
+        out->push_back(CHUNK_ENC_RLE);
+        for (size_t i = 0; i < doubles.size();) {
+            size_t run = 1;
+            while (i + run < doubles.size()
+                    && memcmp(&doubles[i + run], &doubles[i], sizeof(double)) == 0) {
+                ++run;
+            }
+            out->append((const char*)&doubles[i], sizeof(double));
+            put_varint64(out, run);
+            i += run;
+        }
+        return;
+    }
+    out->push_back(CHUNK_ENC_PLAIN);
+    out->append((const char*)doubles.data(), doubles.size() * sizeof(double));
+}
+
+int decode_doubles(ChunkReader& reader, size_t count, std::vector<double>* doubles) {
+    uint8_t encoding = 0;
+    if (!reader.get_u8(&encoding)) {
+        return -1;
+    }
+    doubles->clear();
+    if (encoding == CHUNK_ENC_PLAIN) {
+        doubles->resize(count);
+        return reader.get_raw(count * sizeof(double), doubles->data()) ? 0 : -1;
+    }
+    if (encoding != CHUNK_ENC_RLE) {
+        return -1;
+    }
+    doubles->reserve(count);
+    while (doubles->size() < count) {
+        double value = 0;
+        uint64_t run = 0;
+        if (!reader.get_raw(sizeof(double), &value) || !reader.get_varint64(&run)
+                || run == 0 || run > count - doubles->size()) {
+            return -1;
+        }
+        doubles->insert(doubles->end(), run, value);
+    }
+    return 0;
+}
+
+void encode_strings(const std::vector<std::string>& strings, std::string* out) {
+    std::unordered_map<std::string, uint32_t> dict;
+    std::vector<const std::string*> dict_values;
+    std::vector<uint64_t> indexes;
+    indexes.reserve(strings.size());
+    size_t max_dict = strings.size() / 2;
+    for (auto& str : strings) {
+        auto iter = dict.find(str);
+        if (iter == dict.end()) {
+            if (dict.size() >= max_dict) {
+                break;
+            }
+            iter = dict.emplace(str, dict_values.size()).first;
+            dict_values.push_back(&iter->first);
+        }
+        indexes.push_back(iter->second);
+    }
+    if (!strings.empty() && indexes.size() == strings.size()) {
+        out->push_back(CHUNK_ENC_DICT);
+        put_varint64(out, dict_values.size());
+        for (auto value : dict_values) {
+            put_varint64(out, value->size());
+            out->append(*value);
+        }
+        int width = bit_width(dict_values.size() - 1);
+        out->push_back((char)width);
+        bit_pack(indexes, width, out);
+        return;
+    }
+    out->push_back(CHUNK_ENC_PLAIN);
+    for (auto& str : strings) {
+        put_varint64(out, str.size());
+        out->append(str);
+    }
+}
+
+int decode_strings(ChunkReader& reader, size_t count, std::vector<std::string>* strings) {
+    uint8_t encoding = 0;
+    if (!reader.get_u8(&encoding)) {
+        return -1;
+    }
+    strings->clear();
+    strings->reserve(count);
+    if (encoding == CHUNK_ENC_PLAIN) {
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t len = 0;
+            strings->emplace_back();
+            if (!reader.get_varint64(&len) || !reader.get_bytes(len, &strings->back())) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (encoding != CHUNK_ENC_DICT) {
+        return -1;
+    }
+    uint64_t dict_size = 0;
+    if (!reader.get_varint64(&dict_size) || dict_size > count) {
+        return -1;
+    }
+    std::vector<std::string> dict(dict_size);
+    for (auto& value : dict) {
+        uint64_t len = 0;
+        if (!reader.get_varint64(&len) || !reader.get_bytes(len, &value)) {
+            return -1;
+        }
+    }
+    uint8_t width = 0;
+    std::vector<uint64_t> indexes;
+    if (!reader.get_u8(&width) || width > 32 || !reader.bit_unpack(count, width, &indexes)) {
+        return -1;
+    }
+    for (auto idx : indexes) {
+        if (idx >= dict_size) {
+            return -1;
+        }
+        strings->push_back(dict[idx]);
+    }
+    return 0;
+}
+
+void encode_zone_map(const ColumnZoneMap& zone_map, std::string* out) {
+    put_varint64(out, zigzag(zone_map.field_id));
+    out->push_back((char)zone_map.kind);
+    put_varint64(out, zone_map.row_count);
+    put_varint64(out, zone_map.null_count);
+    out->push_back(zone_map.has_min_max ? 1 : 0);
+    if (!zone_map.has_min_max) {
+        return;
+    }
+    switch (zone_map.kind) {
+        case CHUNK_KIND_INT:
+            put_varint64(out, zigzag(zone_map.min_int));
+            put_varint64(out, zigzag(zone_map.max_int));
+            break;
+        case CHUNK_KIND_DOUBLE:
+            out->append((const char*)&zone_map.min_double, sizeof(double));
+            out->append((const char*)&zone_map.max_double, sizeof(double));
+            break;
+        case CHUNK_KIND_STRING:
+            put_varint64(out, zone_map.min_str.size());
+            out->append(zone_map.min_str);
+            put_varint64(out, zone_map.max_str.size());
+            out->append(zone_map.max_str);
+            break;
+    }
+}
+
+bool decode_zone_map(ChunkReader& reader, ColumnZoneMap* zone_map) {
+    uint64_t field_id = 0;
+    uint8_t kind = 0;
+    uint64_t row_count = 0;
+    uint64_t null_count = 0;
+    uint8_t has_min_max = 0;
+    if (!reader.get_varint64(&field_id) || !reader.get_u8(&kind) || kind > CHUNK_KIND_STRING
+            || !reader.get_varint64(&row_count) || !reader.get_varint64(&null_count)
+            || !reader.get_u8(&has_min_max)) {
+        return false;
+    }
+    zone_map->field_id = unzigzag(field_id);
+    zone_map->kind = (ChunkValueKind)kind;
+    zone_map->row_count = row_count;
+    zone_map->null_count = null_count;
+    zone_map->has_min_max = has_min_max != 0;
+    if (!zone_map->has_min_max) {
+        return true;
+    }
+    switch (zone_map->kind) {
+        case CHUNK_KIND_INT: {
+            uint64_t min = 0;
+            uint64_t max = 0;
+            if (!reader.get_varint64(&min) || !reader.get_varint64(&max)) {
+                return false;
+            }
+            zone_map->min_int = unzigzag(min);
+            zone_map->max_int = unzigzag(max);
+            return true;
+        }
+        case CHUNK_KIND_DOUBLE:
+            return reader.get_raw(sizeof(double), &zone_map->min_double)
+                && reader.get_raw(sizeof(double), &zone_map->max_double);
+        case CHUNK_KIND_STRING: {
+            uint64_t len = 0;
+            if (!reader.get_varint64(&len) || !reader.get_bytes(len, &zone_map->min_str)) {
+                return false;
+            }
+            return reader.get_varint64(&len) && reader.get_bytes(len, &zone_map->max_str);
+        }
+    }
+    return false;
+}
+
+// 主键chunk头部: version + last_key + zone maps
+bool decode_keys_header(ChunkReader& reader, std::string* last_key,
+        std::vector<ColumnZoneMap>* zone_maps) {
+    uint8_t version = 0;
+    uint64_t len = 0;
+    uint64_t zone_count = 0;
+    if (!reader.get_u8(&version) || version != CHUNK_VERSION
+            || !reader.get_varint64(&len) || !reader.get_bytes(len, last_key)
+            || !reader.get_varint64(&zone_count)) {
+        return false;
+    }
+    ColumnZoneMap zone_map;
+    for (uint64_t i = 0; i < zone_count; ++i) {
+        if (!decode_zone_map(reader, &zone_map)) {
+            return false;
+        }
+        if (zone_maps != nullptr) {
+            zone_maps->push_back(zone_map);
+        }
+    }
+    return true;
+}
+
+template <typename T>
+inline int compare_raw(const T& l, const T& r) {
+    return l < r ? -1 : (r < l ? 1 : 0);
+}
+}
+
+void ColumnChunkCodec::encode(const ColumnChunk& chunk, std::string* out) {
+    out->clear();
+    out->push_back(CHUNK_VERSION);
+    out->push_back((char)chunk.kind);
+    put_varint64(out, chunk.row_count);
+    bool has_null = false;
+    for (auto null : chunk.nulls) {
+        if (null != 0) {
+            has_null = true;
+            break;
+        }
+    }
+    out->push_back(has_null ? 1 : 0);
+    if (has_null) {
+        std::vector<uint64_t> bits(chunk.nulls.begin(), chunk.nulls.end());
+        bit_pack(bits, 1, out);
+    }
+    switch (chunk.kind) {
+        case CHUNK_KIND_INT:
+            encode_ints(chunk.ints, out);
+            break;
+        case CHUNK_KIND_DOUBLE:
+            encode_doubles(chunk.doubles, out);
+            break;
+        case CHUNK_KIND_STRING:
+            encode_strings(chunk.strings, out);
+            break;
+    }
+}
+
+int ColumnChunkCodec::decode(const char* data, size_t size, ColumnChunk* chunk) {
+    ChunkReader reader(data, size);
+    uint8_t version = 0;
+    uint8_t kind = 0;
+    uint64_t row_count = 0;
+    uint8_t has_null = 0;
+    if (!reader.get_u8(&version) || version != CHUNK_VERSION
+            || !reader.get_u8(&kind) || kind > CHUNK_KIND_STRING
+            || !reader.get_varint64(&row_count) || !reader.get_u8(&has_null)) {
+        return -1;
+    }
+    chunk->clear();
+    chunk->kind = (ChunkValueKind)kind;
+    chunk->row_count = row_count;
+    if (has_null) {
+        std::vector<uint64_t> bits;
+        if (!reader.bit_unpack(row_count, 1, &bits)) {
+            return -1;
+        }
+        chunk->nulls.assign(bits.begin(), bits.end());
+    }
+    int ret = 0;
+    switch (chunk->kind) {
+        case CHUNK_KIND_INT:
+            ret = decode_ints(reader, row_count, &chunk->ints);
+            break;
+        case CHUNK_KIND_DOUBLE:
+            ret = decode_doubles(reader, row_count, &chunk->doubles);
+            break;
+        case CHUNK_KIND_STRING:
+            ret = decode_strings(reader, row_count, &chunk->strings);
+            break;
+    }
+    if (ret != 0 || !reader.eof()) {
+        return -1;
+    }
+    return 0;
+}
+
+void ColumnChunkCodec::encode_keys(const std::vector<std::string>& keys,
+        const std::vector<ColumnZoneMap>& zone_maps, std::string* out) {
+    out->clear();
+    out->push_back(CHUNK_VERSION);
+    const std::string empty;
+    const std::string& last_key = keys.empty() ? empty : keys.back();
+    put_varint64(out, last_key.size());
+    out->append(last_key);
+    put_varint64(out, zone_maps.size());
+    for (auto& zone_map : zone_maps) {
+        encode_zone_map(zone_map, out);
+    }
+    put_varint64(out, keys.size());
+    const std::string* prev = &empty;
+    for (auto& key : keys) {
+        size_t shared = 0;
+        size_t limit = std::min(prev->size(), key.size());
+        while (shared < limit && (*prev)[shared] == key[shared]) {
+            ++shared;
+        }
+        put_varint64(out, shared);
+        put_varint64(out, key.size() - shared);
+        out->append(key, shared, std::string::npos);
+        prev = &key;
+    }
+}
+
+int ColumnChunkCodec::decode_last_key(const char* data, size_t size, std::string* last_key) {
+    ChunkReader reader(data, size);
+    uint8_t version = 0;
+    uint64_t len = 0;
+    if (!reader.get_u8(&version) || version != CHUNK_VERSION
+            || !reader.get_varint64(&len) || !reader.get_bytes(len, last_key)) {
+        return -1;
+    }
+    return 0;
+}
+
+int ColumnChunkCodec::decode_zone_maps(const char* data, size_t size,
+        std::vector<ColumnZoneMap>* zone_maps) {
+    ChunkReader reader(data, size);
+    std::string last_key;
+    zone_maps->clear();
+    return decode_keys_header(reader, &last_key, zone_maps) ? 0 : -1;
+}
+
+int ColumnChunkCodec::decode_keys(const char* data, size_t size, std::vector<std::string>* keys) {
+    ChunkReader reader(data, size);
+    std::string last_key;
+    uint64_t count = 0;
+    if (!decode_keys_header(reader, &last_key, nullptr) || !reader.get_varint64(&count)) {
+        return -1;
+    }
+    keys->clear();
+    keys->reserve(count);
+    std::string prev;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t shared = 0;
+        uint64_t unshared = 0;
+        std::string suffix;
+        if (!reader.get_varint64(&shared) || !reader.get_varint64(&unshared)
+                || shared > prev.size() || !reader.get_bytes(unshared, &suffix)) {
+            return -1;
+        }
+        prev.resize(shared);
+        prev.append(suffix);
+        keys->push_back(prev);
+    }
+    if (!reader.eof() || (count > 0 && keys->back() != last_key)) {
+        return -1;
+    }
+    return 0;
+}
+
+void ColumnChunkCodec::build_zone_map(const ColumnChunk& chunk, int32_t field_id,
+        ColumnZoneMap* zone_map) {
+    *zone_map = ColumnZoneMap();
+    zone_map->field_id = field_id;
+    zone_map->kind = chunk.kind;
+    zone_map->row_count = chunk.row_count;
+    bool has_value = false;
+    bool str_too_long = false;
+    for (size_t i = 0; i < chunk.row_count; ++i) {
+        if (chunk.is_null(i)) {
+            ++zone_map->null_count;
+            continue;
+        }
+        switch (chunk.kind) {
+            case CHUNK_KIND_INT:
+                if (!has_value || chunk.ints[i] < zone_map->min_int) {
+                    zone_map->min_int = chunk.ints[i];
+                }
+                if (!has_value || chunk.ints[i] > zone_map->max_int) {
+                    zone_map->max_int = chunk.ints[i];
+                }
+                break;
+            case CHUNK_KIND_DOUBLE:
+                if (!has_value || chunk.doubles[i] < zone_map->min_double) {
+                    zone_map->min_double = chunk.doubles[i];
+                }
+                if (!has_value || chunk.doubles[i] > zone_map->max_double) {
+                    zone_map->max_double = chunk.doubles[i];
+                }
+                break;
+            case CHUNK_KIND_STRING:
+                if (chunk.strings[i].size() > ZONE_MAP_MAX_STR_LEN) {
+                    str_too_long = true;
+                }
+                if (!has_value || chunk.strings[i] < zone_map->min_str) {
+                    zone_map->min_str = chunk.strings[i];
+                }
+                if (!has_value || chunk.strings[i] > zone_map->max_str) {
+                    zone_map->max_str = chunk.strings[i];
+                }
+                break;
+        }
+        has_value = true;
+    }
+    zone_map->has_min_max = has_value && !str_too_long;
+    if (!zone_map->has_min_max) {
+        zone_map->min_str.clear();
+        zone_map->max_str.clear();
+    }
+}
+
+bool ColumnChunkCodec::may_match(const ColumnZoneMap& zone_map, const ZonePredicate& pred) {
+    if (pred.op == ZONE_IS_NULL) {
+        return zone_map.null_count > 0;
+    }
+    if (zone_map.kind != value_kind(pred.field_type)) {
+        return true;
+    }
+    // 比较条件对null恒不成立
+    if (!zone_map.has_min_max) {
+        return zone_map.null_count < zone_map.row_count;
+    }
+    for (auto& value : pred.values) {
+        if (value.is_null()) {
+            continue;
+        }
+        int min_cmp = 0;
+        int max_cmp = 0;
+        switch (zone_map.kind) {
+            case CHUNK_KIND_INT: {
+                int64_t raw = to_int_raw(value);
+                min_cmp = compare_raw(raw, zone_map.min_int);
+                max_cmp = compare_raw(raw, zone_map.max_int);
+                break;
+            }
+            case CHUNK_KIND_DOUBLE: {
+                double raw = value.get_numberic<double>();
+                if (raw != raw) {
+                    return true;
+                }
+                min_cmp = compare_raw(raw, zone_map.min_double);
+                max_cmp = compare_raw(raw, zone_map.max_double);
+                break;
+            }
+            case CHUNK_KIND_STRING:
+                min_cmp = compare_raw(value.str_val, zone_map.min_str);
+                max_cmp = compare_raw(value.str_val, zone_map.max_str);
+                break;
+        }
+        switch (pred.op) {
+            case ZONE_EQ:
+            case ZONE_IN:
+                if (min_cmp >= 0 && max_cmp <= 0) {
+                    return true;
+                }
+                break;
+            case ZONE_LT:
+                if (min_cmp > 0) {
+                    return true;
+                }
+                break;
+            case ZONE_LE:
+                if (min_cmp >= 0) {
+                    return true;
+                }
+                break;
+            case ZONE_GT:
+                if (max_cmp < 0) {
+                    return true;
+                }
+                break;
+            case ZONE_GE:
+                if (max_cmp <= 0) {
+                    return true;
+                }
+                break;
+            default:
+                return true;
+        }
+    }
+    return false;
+}
+
+bool ColumnChunkCodec::convert_zone_value(const ExprValue& literal, pb::PrimitiveType field_type,
+        ExprValue* value) {
+    if (literal.is_null()) {
+        *value = ExprValue();
+        return true;
+    }
+    switch (field_type) {
+        case pb::UINT64:
+            return false;
+        case pb::DATETIME:
+        case pb::TIMESTAMP:
+        case pb::DATE:
+        case pb::TIME: {
+            if (literal.type == field_type) {
+                *value = literal;
+                return true;
+            }
+            if (!literal.is_string()) {
+                return false;
+            }
+            // 转换后能还原成原字符串才认为无损
+            ExprValue tmp = literal;
+            tmp.cast_to(field_type);
+            if (tmp.get_string() != literal.str_val) {
+                return false;
+            }
+            *value = tmp;
+            return true;
+        }
+        default:
+            break;
+    }
+    switch (value_kind(field_type)) {
+        case CHUNK_KIND_INT:
+            if (!literal.is_int() || (literal.type == pb::UINT64
+                    && literal._u.uint64_val > (uint64_t)INT64_MAX)) {
+                return false;
+            }
+            *value = ExprValue(pb::INT64);
+            value->_u.int64_val = literal.get_numberic<int64_t>();
+            return true;
+        case CHUNK_KIND_DOUBLE:
+            if (!literal.is_int() && !literal.is_double()) {
+                return false;
+            }
+            *value = ExprValue(pb::DOUBLE);
+            value->_u.double_val = literal.get_numberic<double>();
+            return true;
+        case CHUNK_KIND_STRING:
+            if (field_type != pb::STRING || !literal.is_string()) {
+                return false;
+            }
+            *value = literal;
+            return true;
+    }
+    return false;
+}
+
+ChunkValueKind ColumnChunkCodec::value_kind(pb::PrimitiveType type) {
+    switch (type) {
+        case pb::BOOL:
+        case pb::INT8:
+        case pb::INT16:
+        case pb::INT32:
+        case pb::INT64:
+        case pb::UINT8:
+        case pb::UINT16:
+        case pb::UINT32:
+        case pb::UINT64:
+        case pb::DATETIME:
+        case pb::TIMESTAMP:
+        case pb::DATE:
+        case pb::TIME:
+            return CHUNK_KIND_INT;
+        case pb::FLOAT:
+        case pb::DOUBLE:
+            return CHUNK_KIND_DOUBLE;
+        default:
+            return CHUNK_KIND_STRING;
+    }
+}
+
+void ColumnChunkCodec::append_value(const ExprValue& value, ColumnChunk* chunk) {
+    bool is_null = value.is_null();
+    // 出现第一个null时才补齐null位图
+    if (is_null || !chunk->nulls.empty()) {
+        chunk->nulls.resize(chunk->row_count, 0);
+        chunk->nulls.push_back(is_null ? 1 : 0);
+    }
+    ++chunk->row_count;
+    switch (chunk->kind) {
+        case CHUNK_KIND_INT: {
+            chunk->ints.push_back(is_null ? 0 : to_int_raw(value));
+            break;
+        }
+        case CHUNK_KIND_DOUBLE:
+            chunk->doubles.push_back(is_null ? 0 : value.get_numberic<double>());
+            break;
+        case CHUNK_KIND_STRING:
+            chunk->strings.push_back(is_null ? "" : value.str_val);
+            break;
+    }
+}
+
+ExprValue ColumnChunkCodec::get_value(const ColumnChunk& chunk, size_t idx,
+        pb::PrimitiveType type) {
+    if (chunk.is_null(idx)) {
+        return ExprValue();
+    }
+    ExprValue value(type);
+    switch (type) {
+        case pb::BOOL:
+            value._u.bool_val = chunk.ints[idx] != 0;
+            break;
+        case pb::INT8:
+            value._u.int8_val = chunk.ints[idx];
+            break;
+        case pb::INT16:
+            value._u.int16_val = chunk.ints[idx];
+            break;
+        case pb::INT32:
+        case pb::TIME:
+            value._u.int32_val = chunk.ints[idx];
+            break;
+        case pb::INT64:
+            value._u.int64_val = chunk.ints[idx];
+            break;
+        case pb::UINT8:
+            value._u.uint8_val = chunk.ints[idx];
+            break;
+        case pb::UINT16:
+            value._u.uint16_val = chunk.ints[idx];
+            break;
+        case pb::UINT32:
+        case pb::TIMESTAMP:
+        case pb::DATE:
+            value._u.uint32_val = chunk.ints[idx];
+            break;
+        case pb::UINT64:
+        case pb::DATETIME:
+            value._u.uint64_val = chunk.ints[idx];
+            break;
+        case pb::FLOAT:
+            value._u.float_val = chunk.doubles[idx];
+            break;
+        case pb::DOUBLE:
+            value._u.double_val = chunk.doubles[idx];
+            break;
+        default:
+            value.str_val = chunk.strings[idx];
+            break;
+    }
+    return value;
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -15,7 +15,9 @@
 #include "rocks_wrapper.h"
 #include "rocksdb/table.h"
 #include "rocksdb/filter_policy.h"
+#include "rocksdb/statistics.h"
 #include <iostream>
+#include <boost/algorithm/string/predicate.hpp>
 #include "common.h"
 #include "mut_table_key.h"
 #include "table_key.h"
@@ -31,10 +33,87 @@ DEFINE_int32(rocks_max_open_files, 1024, "rocksdb max_open_files, default: 1024"
 DEFINE_int32(stop_write_sst_cnt, 40, "level0_stop_writes_trigger");
 DEFINE_bool(rocks_data_dynamic_level_bytes, true, 
         "rocksdb level_compaction_dynamic_level_bytes for data column_family, default true");
+DEFINE_int64(rocks_block_cache_size_mb, 64, "block cache for data column_family, default: 64MB");
+DEFINE_int64(rocks_raft_log_cache_size_mb, 16,
+        "block cache for raft_log column_family, default: 16MB");
+DEFINE_int64(rocks_row_cache_size_mb, 0, "row cache for point get, 0 means disable, default: 0");
+DEFINE_bool(rocks_cache_index_and_filter_blocks, false,
+        "put index and filter blocks into high priority pool of block cache, default: false");
+DEFINE_double(rocks_high_pri_pool_ratio, 0.1,
+        "high priority pool ratio of data block cache, default: 0.1");
+DEFINE_int32(rocks_cache_hit_ratio_window_s, 60, "window of cache hit ratio bvars, default: 60s");
+
+// 最近一个窗口内的命中率，hit/miss取自rocksdb statistics的累计ticker
+class TickerHitRatio {
+public:
+    TickerHitRatio(const std::string& prefix, rocksdb::Statistics* statistics,
+            uint32_t hit_ticker, uint32_t miss_ticker) :
+            _statistics(statistics),
+            _hit_ticker(hit_ticker),
+            _miss_ticker(miss_ticker),
+            _hit(prefix + "_hit", get_hit, this),
+            _miss(prefix + "_miss", get_miss, this),
+            _hit_window(&_hit, FLAGS_rocks_cache_hit_ratio_window_s),
+            _miss_window(&_miss, FLAGS_rocks_cache_hit_ratio_window_s),
+            _ratio(prefix + "_hit_ratio", get_ratio, this) {}
+
+private:
+    static int64_t get_hit(void* arg) {
+        TickerHitRatio* self = static_cast<TickerHitRatio*>(arg);
+        return self->_statistics->getTickerCount(self->_hit_ticker);
+    }
+    static int64_t get_miss(void* arg) {
+        TickerHitRatio* self = static_cast<TickerHitRatio*>(arg);
+        return self->_statistics->getTickerCount(self->_miss_ticker);
+    }
+    static double get_ratio(void* arg) {
+        TickerHitRatio* self = static_cast<TickerHitRatio*>(arg);
+        int64_t hit = self->_hit_window.get_value();
+        int64_t total = hit + self->_miss_window.get_value();
+        return total > 0 ? (double)hit / total : 0;
+    }
+
+    rocksdb::Statistics* _statistics;
+    uint32_t _hit_ticker;
+    uint32_t _miss_ticker;
+    bvar::PassiveStatus<int64_t> _hit;
+    bvar::PassiveStatus<int64_t> _miss;
+    bvar::Window<bvar::PassiveStatus<int64_t>> _hit_window;
+    bvar::Window<bvar::PassiveStatus<int64_t>> _miss_window;
+    bvar::PassiveStatus<double> _ratio;
+};
+
+static int64_t get_cache_usage(void* arg) {
+    rocksdb::Cache* cache = static_cast<rocksdb::Cache*>(arg);
+    return cache != nullptr ? cache->GetUsage() : 0;
+}
 
 const std::string RocksWrapper::RAFT_LOG_CF = "raft_log";
 const std::string RocksWrapper::DATA_CF = "data";
 const std::string RocksWrapper::METAINFO_CF = "meta_info";
+const std::string RocksWrapper::TABLE_CF_PREFIX = "table_";
+//meta cf中表独立cf的配置，key: 0x02 + table_id, 0x01为region的meta信息
+static const std::string TABLE_CF_CONF_IDENTIFY(1, 0x02);
+
+static std::string table_cf_conf_key(int64_t table_id) {
+    MutTableKey key;
+    key.append_char(TABLE_CF_CONF_IDENTIFY.c_str(), 1);
+    key.append_i64(table_id);
+    return key.data();
+}
+
+static rocksdb::CompressionType to_rocksdb_compression(pb::CompressionType type) {
+    switch (type) {
+    case pb::CT_SNAPPY:
+        return rocksdb::kSnappyCompression;
+    case pb::CT_LZ4:
+        return rocksdb::kLZ4Compression;
+    case pb::CT_ZSTD:
+        return rocksdb::kZSTD;
+    default:
+        return rocksdb::kNoCompression;
+    }
+}
 
 RocksWrapper::RocksWrapper() : _is_init(false), _txn_db(nullptr) {}
 int32_t RocksWrapper::init(const std::string& path) {
@@ -44,9 +123,21 @@ int32_t RocksWrapper::init(const std::string& path) {
     rocksdb::BlockBasedTableOptions table_options;
     table_options.index_type = rocksdb::BlockBasedTableOptions::kHashSearch;
     table_options.block_size = FLAGS_rocks_block_size;
-    table_options.block_cache = rocksdb::NewLRUCache(64 * 1024 * 1024, 8);
     table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, true));
+    // raft log单独一个cache，和数据互不挤占
+    rocksdb::BlockBasedTableOptions log_table_options = table_options;
+    log_table_options.block_cache = rocksdb::NewLRUCache(
+            FLAGS_rocks_raft_log_cache_size_mb * 1024 * 1024, 8);
+    _raft_log_cache = log_table_options.block_cache.get();
+    // index和filter放在高优先级池，大范围扫描的数据块不会把它们挤出去
+    table_options.block_cache = rocksdb::NewLRUCache(
+            FLAGS_rocks_block_cache_size_mb * 1024 * 1024, 8, false,
+            FLAGS_rocks_cache_index_and_filter_blocks ? FLAGS_rocks_high_pri_pool_ratio : 0);
+    table_options.cache_index_and_filter_blocks = FLAGS_rocks_cache_index_and_filter_blocks;
+    table_options.cache_index_and_filter_blocks_with_high_priority = true;
+    table_options.pin_l0_filter_and_index_blocks_in_cache = FLAGS_rocks_cache_index_and_filter_blocks;
     _cache = table_options.block_cache.get();
+    _data_table_options = table_options;
     rocksdb::Options db_options;
     db_options.IncreaseParallelism();
     db_options.create_if_missing = true;
@@ -56,6 +147,11 @@ int32_t RocksWrapper::init(const std::string& path) {
     db_options.max_background_compactions = 20;
     //db_options.max_subcompactions = 5;
     db_options.statistics = rocksdb::CreateDBStatistics();
+    // 主键点查的row cache，只对Get生效
+    if (FLAGS_rocks_row_cache_size_mb > 0) {
+        db_options.row_cache = rocksdb::NewLRUCache(FLAGS_rocks_row_cache_size_mb * 1024 * 1024, 8);
+        _row_cache = db_options.row_cache.get();
+    }
     //db_options.max_background_flushes = 1;
     //db_options.memtable_prefix_bloom_bits = 1024 * 1024 * 8;
     rocksdb::TransactionDBOptions txn_db_options;
@@ -71,7 +167,7 @@ int32_t RocksWrapper::init(const std::string& path) {
     _log_cf_option.OptimizeLevelStyleCompaction();
     _log_cf_option.compaction_pri = rocksdb::kOldestLargestSeqFirst;
     //_log_cf_option.compaction_filter = RaftLogCompactionFilter::get_instance();
-    _log_cf_option.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+    _log_cf_option.table_factory.reset(rocksdb::NewBlockBasedTableFactory(log_table_options));
     //log_cf_option.compression = rocksdb::kLZ4Compression;
     _log_cf_option.compaction_style = rocksdb::kCompactionStyleLevel;
     _log_cf_option.level0_file_num_compaction_trigger = 5;
@@ -112,10 +208,28 @@ int32_t RocksWrapper::init(const std::string& path) {
     s = rocksdb::DB::ListColumnFamilies(db_options, path, &column_family_names);
     //db已存在
     if (s.ok()) {
+        std::map<int64_t, pb::ColumnFamilyConf> table_cf_confs;
+        for (auto& column_family_name : column_family_names) {
+            if (boost::starts_with(column_family_name, TABLE_CF_PREFIX)) {
+                if (load_table_cf_confs(db_options, path, &table_cf_confs) != 0) {
+                    return -1;
+                }
+                break;
+            }
+        }
         std::vector<rocksdb::ColumnFamilyDescriptor> column_family_desc;
         std::vector<rocksdb::ColumnFamilyHandle*> handles;
         for (auto& column_family_name : column_family_names) {
-            if (column_family_name == RAFT_LOG_CF) {
+            if (boost::starts_with(column_family_name, TABLE_CF_PREFIX)) {
+                int64_t table_id = strtoll(column_family_name.c_str() + TABLE_CF_PREFIX.size(),
+                        nullptr, 10);
+                if (table_cf_confs.count(table_id) == 0) {
+                    DB_FATAL("no conf for column family:%s, open with data cf option",
+                            column_family_name.c_str());
+                }
+                column_family_desc.push_back(rocksdb::ColumnFamilyDescriptor(column_family_name,
+                            table_cf_option(table_cf_confs[table_id])));
+            } else if (column_family_name == RAFT_LOG_CF) {
                 column_family_desc.push_back(rocksdb::ColumnFamilyDescriptor(RAFT_LOG_CF, _log_cf_option));
             } else if (column_family_name == DATA_CF) {
                 column_family_desc.push_back(rocksdb::ColumnFamilyDescriptor(DATA_CF, _data_cf_option));
@@ -136,7 +250,7 @@ int32_t RocksWrapper::init(const std::string& path) {
         if (s.ok()) {
             DB_WARNING("reopen db:%s success", path.c_str());
             for (auto& handle : handles) {
-                _column_families[handle->GetName()] = handle;
+                add_column_family(handle);
                 DB_WARNING("open column family:%s", handle->GetName().c_str());
             }
         } else {
@@ -153,120 +267,355 @@ int32_t RocksWrapper::init(const std::string& path) {
             return -1;
         }
     }
-    if (0 == _column_families.count(RAFT_LOG_CF)) {
+    if (nullptr == get_column_family(RAFT_LOG_CF)) {
         //create raft_log column_familiy
         rocksdb::ColumnFamilyHandle* raft_log_handle;
         s = _txn_db->CreateColumnFamily(_log_cf_option, RAFT_LOG_CF, &raft_log_handle);
         if (s.ok()) {
             DB_WARNING("create column family success, column family:%s", RAFT_LOG_CF.c_str());
-            _column_families[RAFT_LOG_CF] = raft_log_handle;
+            add_column_family(raft_log_handle);
         } else {
             DB_FATAL("create column family fail, column family:%s, err_message:%s",
                     RAFT_LOG_CF.c_str(), s.ToString().c_str());
             return -1;
         }
     }
-    if (0 == _column_families.count(DATA_CF)) {
+    if (nullptr == get_column_family(DATA_CF)) {
         //create data column_family
         rocksdb::ColumnFamilyHandle* data_handle;
         s =  _txn_db->CreateColumnFamily(_data_cf_option, DATA_CF, &data_handle);
         if (s.ok()) {
             DB_WARNING("create column family success, column family:%s", DATA_CF.c_str());
-            _column_families[DATA_CF] = data_handle;
+            add_column_family(data_handle);
         } else {
             DB_FATAL("create column family fail, column family:%s, err_message:%s",
                     DATA_CF.c_str(), s.ToString().c_str());
             return -1;
         }
     }
-    if (0 == _column_families.count(METAINFO_CF)) {
+    if (nullptr == get_column_family(METAINFO_CF)) {
         rocksdb::ColumnFamilyHandle* metainfo_handle;
         s = _txn_db->CreateColumnFamily(_meta_info_option, METAINFO_CF, &metainfo_handle);
         if (s.ok()) {
             DB_WARNING("create column family success, column family:%s", METAINFO_CF.c_str());
-            _column_families[METAINFO_CF] = metainfo_handle;
+            add_column_family(metainfo_handle);
         } else {
             DB_FATAL("create column family fail, column family:%s, err_message:%s",
                     METAINFO_CF.c_str(), s.ToString().c_str());
             return -1;
         }
     }
+    _raft_log_cf = get_column_family(RAFT_LOG_CF);
+    _data_cf = get_column_family(DATA_CF);
+    _meta_info_cf = get_column_family(METAINFO_CF);
     _is_init = true;
+    expose_cache_bvars(db_options.statistics.get());
     DB_WARNING("rocksdb init success");
     return 0;
 }
+
+void RocksWrapper::expose_cache_bvars(rocksdb::Statistics* statistics) {
+    // block cache的ticker是db级别的，不区分data和raft log两个cache
+    static TickerHitRatio block_cache("rocks_block_cache", statistics,
+            rocksdb::BLOCK_CACHE_HIT, rocksdb::BLOCK_CACHE_MISS);
+    static TickerHitRatio data_block("rocks_block_cache_data", statistics,
+            rocksdb::BLOCK_CACHE_DATA_HIT, rocksdb::BLOCK_CACHE_DATA_MISS);
+    static TickerHitRatio index_block("rocks_block_cache_index", statistics,
+            rocksdb::BLOCK_CACHE_INDEX_HIT, rocksdb::BLOCK_CACHE_INDEX_MISS);
+    static TickerHitRatio filter_block("rocks_block_cache_filter", statistics,
+            rocksdb::BLOCK_CACHE_FILTER_HIT, rocksdb::BLOCK_CACHE_FILTER_MISS);
+    static TickerHitRatio row_cache("rocks_row_cache", statistics,
+            rocksdb::ROW_CACHE_HIT, rocksdb::ROW_CACHE_MISS);
+    static bvar::PassiveStatus<int64_t> data_cache_usage("rocks_data_cache_usage",
+            get_cache_usage, _cache);
+    static bvar::PassiveStatus<int64_t> raft_log_cache_usage("rocks_raft_log_cache_usage",
+            get_cache_usage, _raft_log_cache);
+    static bvar::PassiveStatus<int64_t> row_cache_usage("rocks_row_cache_usage",
+            get_cache_usage, _row_cache);
+}
+int32_t RocksWrapper::load_table_cf_confs(const rocksdb::DBOptions& db_options,
+        const std::string& path, std::map<int64_t, pb::ColumnFamilyConf>* cf_confs) {
+    // 只读方式可以只打开部分cf
+    std::vector<rocksdb::ColumnFamilyDescriptor> column_family_desc;
+    column_family_desc.push_back(rocksdb::ColumnFamilyDescriptor(
+                rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()));
+    column_family_desc.push_back(rocksdb::ColumnFamilyDescriptor(METAINFO_CF, _meta_info_option));
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::DB* db = nullptr;
+    auto s = rocksdb::DB::OpenForReadOnly(db_options, path, column_family_desc, &handles, &db);
+    if (!s.ok()) {
+        DB_FATAL("open db:%s for read only fail, err_message:%s",
+                path.c_str(), s.ToString().c_str());
+        return -1;
+    }
+    rocksdb::ReadOptions read_options;
+    read_options.prefix_same_as_start = true;
+    rocksdb::Iterator* iter = db->NewIterator(read_options, handles[1]);
+    for (iter->Seek(TABLE_CF_CONF_IDENTIFY); iter->Valid(); iter->Next()) {
+        if (!iter->key().starts_with(TABLE_CF_CONF_IDENTIFY)) {
+            break;
+        }
+        int64_t table_id = TableKey(iter->key()).extract_i64(TABLE_CF_CONF_IDENTIFY.size());
+        pb::ColumnFamilyConf cf_conf;
+        if (!cf_conf.ParseFromArray(iter->value().data(), iter->value().size())) {
+            DB_FATAL("parse column family conf fail, table_id:%ld", table_id);
+            continue;
+        }
+        DB_WARNING("table_id:%ld column family conf:%s",
+                table_id, cf_conf.ShortDebugString().c_str());
+        (*cf_confs)[table_id] = cf_conf;
+    }
+    delete iter;
+    for (auto handle : handles) {
+        db->DestroyColumnFamilyHandle(handle);
+    }
+    delete db;
+    return 0;
+}
+
+rocksdb::ColumnFamilyOptions RocksWrapper::table_cf_option(const pb::ColumnFamilyConf& cf_conf) {
+    // prefix_extractor和compaction_filter与公共data cf保持一致
+    rocksdb::ColumnFamilyOptions cf_option = _data_cf_option;
+    rocksdb::BlockBasedTableOptions table_options = _data_table_options;
+    if (cf_conf.has_block_size()) {
+        table_options.block_size = cf_conf.block_size();
+    }
+    if (cf_conf.has_bloom_bits_per_key()) {
+        if (cf_conf.bloom_bits_per_key() > 0) {
+            table_options.filter_policy.reset(
+                    rocksdb::NewBloomFilterPolicy(cf_conf.bloom_bits_per_key(), true));
+        } else {
+            table_options.filter_policy.reset();
+        }
+    }
+    cf_option.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+    if (cf_conf.compression_per_level_size() > 0) {
+        cf_option.compression_per_level.clear();
+        for (auto type : cf_conf.compression_per_level()) {
+            cf_option.compression_per_level.push_back(
+                    to_rocksdb_compression(static_cast<pb::CompressionType>(type)));
+        }
+        cf_option.compression = cf_option.compression_per_level.back();
+    }
+    if (cf_conf.has_write_buffer_size_mb()) {
+        cf_option.write_buffer_size = cf_conf.write_buffer_size_mb() * 1024 * 1024;
+    }
+    switch (cf_conf.compaction_style()) {
+    case pb::CS_UNIVERSAL:
+        cf_option.compaction_style = rocksdb::kCompactionStyleUniversal;
+        cf_option.level_compaction_dynamic_level_bytes = false;
+        break;
+    case pb::CS_FIFO:
+        // 只有L0，总大小超过上限时删除最老的sst
+        cf_option.compaction_style = rocksdb::kCompactionStyleFIFO;
+        cf_option.level_compaction_dynamic_level_bytes = false;
+        cf_option.compaction_options_fifo.max_table_files_size =
+            cf_conf.fifo_max_size_mb() * 1024 * 1024;
+        break;
+    default:
+        break;
+    }
+    return cf_option;
+}
+
+void RocksWrapper::close() {
+    std::lock_guard<std::mutex> lock(_cf_mutex);
+    for (auto handle : _dropped_cfs) {
+        _txn_db->DestroyColumnFamilyHandle(handle);
+    }
+    _dropped_cfs.clear();
+    auto clear_func = [](ColumnFamilyMapping& mapping) {
+        mapping.column_families.clear();
+        mapping.table_cfs.clear();
+        return 1;
+    };
+    _column_families.Modify(clear_func);
+    _raft_log_cf = nullptr;
+    _data_cf = nullptr;
+    _meta_info_cf = nullptr;
+    _is_init = false;
+    delete _txn_db;
+    _txn_db = nullptr;
+}
+
+rocksdb::ColumnFamilyHandle* RocksWrapper::get_column_family(const std::string& cf_name) {
+    DoubleBufferedColumnFamily::ScopedPtr ptr;
+    if (_column_families.Read(&ptr) != 0) {
+        DB_WARNING("read double buffer column family error");
+        return nullptr;
+    }
+    auto iter = ptr->column_families.find(cf_name);
+    if (iter == ptr->column_families.end()) {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+void RocksWrapper::add_column_family(rocksdb::ColumnFamilyHandle* handle) {
+    auto add_func = [](ColumnFamilyMapping& mapping, rocksdb::ColumnFamilyHandle* handle) {
+        const std::string& cf_name = handle->GetName();
+        mapping.column_families[cf_name] = handle;
+        if (boost::starts_with(cf_name, TABLE_CF_PREFIX)) {
+            int64_t table_id = strtoll(cf_name.c_str() + TABLE_CF_PREFIX.size(), nullptr, 10);
+            mapping.table_cfs[table_id] = handle;
+        }
+        return 1;
+    };
+    _column_families.Modify(add_func, handle);
+}
+
+void RocksWrapper::remove_column_family(const std::string& cf_name) {
+    auto remove_func = [](ColumnFamilyMapping& mapping, const std::string& cf_name) {
+        mapping.column_families.erase(cf_name);
+        if (boost::starts_with(cf_name, TABLE_CF_PREFIX)) {
+            int64_t table_id = strtoll(cf_name.c_str() + TABLE_CF_PREFIX.size(), nullptr, 10);
+            mapping.table_cfs.erase(table_id);
+        }
+        return 1;
+    };
+    _column_families.Modify(remove_func, cf_name);
+}
+
 int32_t RocksWrapper::delete_column_family(std::string cf_name) {
-    if (_column_families.count(cf_name) == 0) {
+    std::lock_guard<std::mutex> lock(_cf_mutex);
+    rocksdb::ColumnFamilyHandle* cf_handler = get_column_family(cf_name);
+    if (cf_handler == nullptr) {
         DB_FATAL("column_family: %s not exist", cf_name.c_str());
         return -1;
     }
-    rocksdb::ColumnFamilyHandle* cf_handler = _column_families[cf_name];
+    // 先从映射中去掉，新的请求不再拿到这个handle
+    remove_column_family(cf_name);
     auto res = _txn_db->DropColumnFamily(cf_handler);
     if (!res.ok()) {
         DB_FATAL("drop column_family %s failed, err_message:%s", 
                 cf_name.c_str(), res.ToString().c_str());
+        add_column_family(cf_handler);
         return -1;
     }
-    res = _txn_db->DestroyColumnFamilyHandle(cf_handler);
-    if (!res.ok()) {
-        DB_FATAL("destroy column_family %s failed, err_message:%s", 
-                cf_name.c_str(), res.ToString().c_str());
-        return -1;
-    }
-    _column_families.erase(cf_name);
+    _dropped_cfs.push_back(cf_handler);
     return 0;
 }
+
 int32_t RocksWrapper::create_column_family(std::string cf_name) {
-    if (_column_families.count(cf_name) != 0) {
+    return create_column_family(cf_name, _data_cf_option);
+}
+
+int32_t RocksWrapper::create_column_family(std::string cf_name,
+        const rocksdb::ColumnFamilyOptions& cf_option) {
+    std::lock_guard<std::mutex> lock(_cf_mutex);
+    if (get_column_family(cf_name) != nullptr) {
         DB_FATAL("column_family: %s already exist", cf_name.c_str());
         return -1;
     }
     rocksdb::ColumnFamilyHandle* cf_handler = nullptr;
-    auto s = _txn_db->CreateColumnFamily(_data_cf_option, cf_name, &cf_handler);
-    if (s.ok()) {
-        DB_WARNING("create column family %s success", cf_name.c_str());
-        _column_families[cf_name] = cf_handler;
-    } else {
+    auto s = _txn_db->CreateColumnFamily(cf_option, cf_name, &cf_handler);
+    if (!s.ok()) {
         DB_FATAL("create column family %s fail, err_message:%s",
                 cf_name.c_str(), s.ToString().c_str());
         return -1;
     }
-    _column_families[cf_name] = cf_handler;
+    DB_WARNING("create column family %s success", cf_name.c_str());
+    add_column_family(cf_handler);
+    return 0;
+}
+
+int32_t RocksWrapper::create_table_column_family(int64_t table_id,
+        const pb::ColumnFamilyConf& cf_conf) {
+    std::string cf_name = table_cf_name(table_id);
+    if (get_column_family(cf_name) != nullptr) {
+        return 0;
+    }
+    // 先写配置，cf创建后进程重启也能按配置打开
+    std::string value;
+    if (!cf_conf.SerializeToString(&value)) {
+        DB_FATAL("serialize column family conf fail, table_id:%ld", table_id);
+        return -1;
+    }
+    auto s = _txn_db->Put(rocksdb::WriteOptions(), get_meta_info_handle(),
+            table_cf_conf_key(table_id), value);
+    if (!s.ok()) {
+        DB_FATAL("write column family conf fail, table_id:%ld, err_message:%s",
+                table_id, s.ToString().c_str());
+        return -1;
+    }
+    // 并发创建时只有一个成功，其他的看到已存在
+    if (create_column_family(cf_name, table_cf_option(cf_conf)) != 0
+            && get_column_family(cf_name) == nullptr) {
+        return -1;
+    }
+    DB_WARNING("table_id:%ld use column family:%s, conf:%s",
+            table_id, cf_name.c_str(), cf_conf.ShortDebugString().c_str());
+    return 0;
+}
+
+int32_t RocksWrapper::drop_table_column_family(int64_t table_id) {
+    std::string cf_name = table_cf_name(table_id);
+    if (get_column_family(cf_name) == nullptr) {
+        return 0;
+    }
+    if (delete_column_family(cf_name) != 0) {
+        return -1;
+    }
+    auto s = _txn_db->Delete(rocksdb::WriteOptions(), get_meta_info_handle(),
+            table_cf_conf_key(table_id));
+    if (!s.ok()) {
+        DB_FATAL("remove column family conf fail, table_id:%ld, err_message:%s",
+                table_id, s.ToString().c_str());
+        return -1;
+    }
+    DB_WARNING("table_id:%ld drop column family success", table_id);
     return 0;
 }
 
+void RocksWrapper::get_table_cf_ids(std::vector<int64_t>* table_ids) {
+    DoubleBufferedColumnFamily::ScopedPtr ptr;
+    if (_column_families.Read(&ptr) != 0) {
+        DB_WARNING("read double buffer column family error");
+        return;
+    }
+    for (auto& pair : ptr->table_cfs) {
+        table_ids->push_back(pair.first);
+    }
+}
+
 rocksdb::ColumnFamilyHandle* RocksWrapper::get_raft_log_handle() {
     if (!_is_init) {
         DB_FATAL("rocksdb has not been inited");
         return nullptr;
     }
-    if (0 == _column_families.count(RAFT_LOG_CF)) {
-        DB_FATAL("rocksdb has no raft log cf");
-        return nullptr;
-    }
-    return _column_families[RAFT_LOG_CF];
+    return _raft_log_cf;
 }
 rocksdb::ColumnFamilyHandle* RocksWrapper::get_data_handle() {
     if (!_is_init) {
         DB_FATAL("rocksdb has not been inited");
         return nullptr;
     }
-    if (0 == _column_families.count(DATA_CF)) {
-        DB_FATAL("rocksdb has no data column family");
-        return nullptr;
+    return _data_cf;
+}
+rocksdb::ColumnFamilyHandle* RocksWrapper::get_data_handle(int64_t table_id) {
+    {
+        DoubleBufferedColumnFamily::ScopedPtr ptr;
+        if (_column_families.Read(&ptr) == 0) {
+            auto iter = ptr->table_cfs.find(table_id);
+            if (iter != ptr->table_cfs.end()) {
+                return iter->second;
+            }
+        }
+    }
+    return get_data_handle();
+}
+rocksdb::ColumnFamilyHandle* RocksWrapper::get_data_handle(const pb::RegionInfo& region_info) {
+    if (region_info.has_main_table_id() && region_info.main_table_id() != 0) {
+        return get_data_handle(region_info.main_table_id());
     }
-    return _column_families[DATA_CF];
+    return get_data_handle(region_info.table_id());
 }
 rocksdb::ColumnFamilyHandle* RocksWrapper::get_meta_info_handle() {
     if (!_is_init) {
         DB_FATAL("rocksdb has not been inited");
         return nullptr;
     }
-    if (0 == _column_families.count(METAINFO_CF)) {
-        DB_FATAL("rocksdb has no metainfo column family");
-        return nullptr;
-    }
-    return _column_families[METAINFO_CF];
+    return _meta_info_cf;
 }
 
 }
@@ -23,12 +23,14 @@ TableIterator* Iterator::scan_primary(
         const IndexRange&       range, 
         std::map<int32_t, FieldInfo*>&   fields, 
         bool                    check_region, 
-        bool                    forward) {
+        bool                    forward,
+        bool                    fill_cache) {
     txn->reset_active_time();
     TableIterator* iter = new (std::nothrow)TableIterator(check_region, forward);
     if (nullptr == iter) {
         return nullptr;
     }
+    iter->_fill_cache = fill_cache;
     if (0 != iter->open(range, fields, txn)) {
         DB_WARNING("open table iterator failed");
         delete iter;
@@ -41,12 +43,14 @@ IndexIterator* Iterator::scan_secondary(
         SmartTransaction    txn,
         const IndexRange&   range, 
         bool                check_region, 
-        bool                forward) {
+        bool                forward,
+        bool                fill_cache) {
     txn->reset_active_time();
     IndexIterator* iter = new (std::nothrow)IndexIterator(check_region, forward);
     if (nullptr == iter) {
         return nullptr;
     }
+    iter->_fill_cache = fill_cache;
     std::map<int32_t, FieldInfo*> dummy;
     if (0 != iter->open(range, dummy, txn)) {
         DB_WARNING("open index iterator failed");
@@ -82,7 +86,7 @@ int Iterator::open(const IndexRange& range, std::map<int32_t, FieldInfo*>& field
         DB_WARNING("get rocksdb instance failed");
         return -1;
     }
-    if (nullptr == (_data_cf = _db->get_data_handle())) {
+    if (nullptr == (_data_cf = _db->get_data_handle(*_region_info))) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
     }
@@ -236,6 +240,7 @@ int Iterator::open(const IndexRange& range, std::map<int32_t, FieldInfo*>& field
     //     _lower_is_start, _upper_is_end);
 
     rocksdb::ReadOptions read_options;
+    read_options.fill_cache = _fill_cache;
     if (_left_open) {
         _lower_bound.append_u64(UINT64_MAX);
         _lower_suffix = 8;
@@ -267,7 +272,7 @@ int Iterator::open(const IndexRange& range, std::map<int32_t, FieldInfo*>& field
         read_options.snapshot = txn->get_snapshot();
         _iter = txn->get_txn()->GetIterator(read_options, _data_cf);
     } else {
-        _iter = _db->new_iterator(read_options, RocksWrapper::DATA_CF);
+        _iter = _db->new_iterator(read_options, _data_cf);
     }
     if (!_iter) {
         DB_FATAL("create iterator failed: %ld", index_id);
@@ -301,13 +306,60 @@ int Iterator::open(const IndexRange& range, std::map<int32_t, FieldInfo*>& field
            DB_FATAL("create column iterators failed: %ld", index_id);
            return -1;
        }
+       // 只有带snapshot时chunk和单元格才是同一份数据
+       if (FLAGS_cstore_use_chunk && _forward && !_use_ttl && read_options.snapshot != nullptr) {
+           if (0 != open_chunk(read_options)) {
+               DB_FATAL("create chunk iterator failed: %ld", index_id);
+               return -1;
+           }
+       }
+    }
+    return 0;
+}
+
+// for cstore only
+int Iterator::open_chunk(const rocksdb::ReadOptions& read_options) {
+    _chunk_read_options.snapshot = read_options.snapshot;
+    _chunk_read_options.fill_cache = read_options.fill_cache;
+    _chunk_read_options.prefix_same_as_start = true;
+    _chunk_read_options.total_order_seek = false;
+    _chunk_prefix = ColumnChunkCodec::chunk_prefix(_region, _index_info->id, 0);
+    if (_txn != nullptr) {
+        _chunk_iter = _txn->GetIterator(_chunk_read_options, _data_cf);
+    } else {
+        _chunk_iter = _db->new_iterator(_chunk_read_options, _data_cf);
+    }
+    if (!_chunk_iter) {
+        return -1;
+    }
+    rocksdb::Slice pk = _iter->key();
+    pk.remove_prefix(_prefix_len);
+    MutTableKey key = _chunk_prefix;
+    key.append_char(pk.data(), pk.size());
+    // 可能覆盖当前主键的chunk，不覆盖时在get_next中跳过
+    _chunk_iter->SeekForPrev(key.data());
+    if (!_chunk_iter->Valid() || !_chunk_iter->key().starts_with(_chunk_prefix.data())) {
+        _chunk_iter->Seek(key.data());
     }
     return 0;
 }
 
+// for cstore only, 单元格迭代器重新定位到当前主键
+void Iterator::seek_columns() {
+    const TableKey& primary_key = _iter->key();
+    int64_t table_id = _pri_info->id;
+    for (size_t i = 0; i < _column_iters.size(); i++) {
+        MutTableKey key(primary_key);
+        key.replace_i32(table_id, sizeof(int64_t));
+        key.replace_i32(_non_pk_fields[i]->id, sizeof(int64_t) + sizeof(int32_t));
+        _column_iters[i]->Seek(key.data());
+    }
+}
+
 // for cstore only
 int Iterator::open_columns(std::map<int32_t, FieldInfo*>& fields, SmartTransaction txn) {
     rocksdb::ReadOptions read_options;
+    read_options.fill_cache = _fill_cache;
     if (_forward) {
         read_options.prefix_same_as_start = true;
         read_options.total_order_seek = false;
@@ -340,7 +392,7 @@ int Iterator::open_columns(std::map<int32_t, FieldInfo*>& fields, SmartTransacti
         if (_txn != nullptr) {
             iter = _txn->GetIterator(read_options, _data_cf);
         } else {
-            iter = _db->new_iterator(read_options, RocksWrapper::DATA_CF);
+            iter = _db->new_iterator(read_options, _data_cf);
         }
         if (!iter) {
             DB_FATAL("create iterator failed: %ld", field_id);
@@ -398,8 +450,11 @@ bool Iterator::_fits_region() {
 }
 
 bool Iterator::_fits_right_bound() {
+    return _fits_right_bound(_iter->key());
+}
+
+bool Iterator::_fits_right_bound(const rocksdb::Slice& key) {
     //check range end_key
-    rocksdb::Slice key = _iter->key();
     rocksdb::Slice upper(_upper_bound.data().c_str(), _upper_bound.size() - _upper_sufix);
     rocksdb::Slice right_key(_end.data());
     bool fits = false;
@@ -445,6 +500,16 @@ int TableIterator::get_next(SmartRecord record) {
     if (!_valid) {
         return -1;
     }
+    if (_chunk_iter != nullptr) {
+        int ret = get_next_from_chunk(record);
+        if (ret != 1) {
+            return ret;
+        }
+        // 跳过chunk后可能已经扫完
+        if (!_valid) {
+            return -1;
+        }
+    }
     if ((_forward && !_fits_right_bound()) || (!_forward && !_fits_left_bound())) {
         _valid = false;
         return -1;
@@ -570,6 +635,138 @@ int TableIterator::get_next_columns(SmartRecord record) {
     return 0;
 }
 
+// for cstore only
+int TableIterator::get_next_from_chunk(SmartRecord record) {
+    while (_chunk_pos >= _chunk_keys.size()) {
+        if (!_valid || !_iter->Valid() || !_chunk_iter->Valid()
+                || !_chunk_iter->key().starts_with(_chunk_prefix.data())) {
+            return 1;
+        }
+        rocksdb::Slice pk = _iter->key();
+        pk.remove_prefix(_prefix_len);
+        rocksdb::Slice chunk_start = _chunk_iter->key();
+        chunk_start.remove_prefix(_chunk_prefix.size());
+        if (pk.compare(chunk_start) < 0) {
+            return 1;
+        }
+        rocksdb::Slice value = _chunk_iter->value();
+        if (!_zone_predicates.empty() && !chunk_may_match(value)) {
+            continue;
+        }
+        if (0 != ColumnChunkCodec::decode_keys(value.data(), value.size(), &_chunk_keys)) {
+            DB_WARNING("decode chunk keys failed, region_id: %ld", _region);
+            _chunk_keys.clear();
+            _chunk_iter->Next();
+            return 1;
+        }
+        auto iter = std::lower_bound(_chunk_keys.begin(), _chunk_keys.end(), pk,
+                [](const std::string& l, const rocksdb::Slice& r) {
+            return rocksdb::Slice(l).compare(r) < 0;
+        });
+        _chunk_pos = iter - _chunk_keys.begin();
+        bool load_ok = (_chunk_pos < _chunk_keys.size());
+        if (load_ok && (VAL_ONLY == _mode || KEY_VAL == _mode)) {
+            _chunks.resize(_non_pk_fields.size());
+            for (size_t i = 0; i < _non_pk_fields.size(); i++) {
+                MutTableKey key = ColumnChunkCodec::chunk_prefix(_region, _index_info->id,
+                        _non_pk_fields[i]->id);
+                key.append_index(_chunk_keys[0]);
+                std::string chunk_value;
+                rocksdb::Status s;
+                if (_txn != nullptr) {
+                    s = _txn->Get(_chunk_read_options, _data_cf, key.data(), &chunk_value);
+                } else {
+                    s = _db->get(_chunk_read_options, _data_cf, key.data(), &chunk_value);
+                }
+                // 加列之前生成的chunk没有新列，走单元格
+                if (!s.ok() || 0 != ColumnChunkCodec::decode(chunk_value.data(),
+                        chunk_value.size(), &_chunks[i])
+                        || _chunks[i].row_count != _chunk_keys.size()) {
+                    load_ok = false;
+                    break;
+                }
+            }
+        }
+        if (!load_ok) {
+            _chunk_keys.clear();
+            _chunk_pos = 0;
+            _chunk_iter->Next();
+            return 1;
+        }
+    }
+    MutTableKey key;
+    key.append_i64(_region).append_i64(_index_info->id).append_index(_chunk_keys[_chunk_pos]);
+    if (!_fits_right_bound(key.data())) {
+        _valid = false;
+        return -1;
+    }
+    if (VAL_ONLY == _mode || KEY_VAL == _mode) {
+        for (size_t i = 0; i < _non_pk_fields.size(); i++) {
+            const FieldDescriptor* field = record->get_field_by_tag(_non_pk_fields[i]->id);
+            record->set_value(field, ColumnChunkCodec::get_value(_chunks[i], _chunk_pos,
+                    _non_pk_fields[i]->type));
+        }
+    }
+    if (KEY_ONLY == _mode || KEY_VAL == _mode) {
+        int pos = _prefix_len;
+        TableKey table_key(key.data(), true);
+        if (0 != record->decode_key(*_index_info, table_key, pos)) {
+            DB_WARNING("decode key failed: %ld", _index_info->id);
+            _valid = false;
+            return -1;
+        }
+    }
+    ++_chunk_pos;
+    if (_chunk_pos == _chunk_keys.size()) {
+        // 整个chunk输出完，主键和单元格迭代器跳到chunk之后
+        skip_chunk(_chunk_keys.back());
+    }
+    return 0;
+}
+
+// for cstore only, 返回false时已经跳过当前chunk
+bool TableIterator::chunk_may_match(const rocksdb::Slice& value) {
+    std::vector<ColumnZoneMap> zone_maps;
+    if (0 != ColumnChunkCodec::decode_zone_maps(value.data(), value.size(), &zone_maps)) {
+        return true;
+    }
+    for (auto& pred : _zone_predicates) {
+        for (auto& zone_map : zone_maps) {
+            if (zone_map.field_id != pred.field_id) {
+                continue;
+            }
+            if (!ColumnChunkCodec::may_match(zone_map, pred)) {
+                std::string last_key;
+                if (0 != ColumnChunkCodec::decode_last_key(value.data(), value.size(), &last_key)) {
+                    return true;
+                }
+                ++_skipped_chunks;
+                skip_chunk(last_key);
+                return false;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+// for cstore only, 主键和单元格迭代器跳到last_key之后
+void TableIterator::skip_chunk(const std::string& last_key) {
+    MutTableKey key;
+    key.append_i64(_region).append_i64(_index_info->id).append_index(last_key);
+    _iter->Seek(key.data());
+    if (_iter->Valid() && _iter->key() == rocksdb::Slice(key.data())) {
+        _iter->Next();
+    }
+    _valid = _iter->Valid();
+    if (_valid) {
+        seek_columns();
+    }
+    _chunk_keys.clear();
+    _chunk_pos = 0;
+    _chunk_iter->Next();
+}
+
 int IndexIterator::get_next(SmartRecord index) {
     while (_valid) {
         if ((_forward && !_fits_right_bound()) || (!_forward && !_fits_left_bound())) {
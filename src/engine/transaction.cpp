@@ -15,6 +15,7 @@
 #include "transaction.h"
 #include "transaction_pool.h"
 #include "tuple_record.h"
+#include "column_chunk.h"
 #include <boost/scoped_array.hpp>
 #include <gflags/gflags.h>
 
@@ -33,7 +34,9 @@ int Transaction::begin(rocksdb::TransactionOptions txn_opt) {
         DB_WARNING("get rocksdb instance failed");
         return -1;
     }
-    if (nullptr == (_data_cf = _db->get_data_handle())) {
+    _data_cf = _region_info != nullptr ?
+        _db->get_data_handle(*_region_info) : _db->get_data_handle();
+    if (nullptr == _data_cf) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
     }
@@ -63,7 +66,9 @@ int Transaction::begin(rocksdb::Transaction* txn) {
         DB_WARNING("get rocksdb instance failed");
         return -1;
     }
-    if (nullptr == (_data_cf = _db->get_data_handle())) {
+    _data_cf = _region_info != nullptr ?
+        _db->get_data_handle(*_region_info) : _db->get_data_handle();
+    if (nullptr == _data_cf) {
         DB_WARNING("get rocksdb data column family failed");
         return -1;
     }
@@ -292,7 +297,19 @@ int Transaction::put_primary(int64_t region, IndexInfo& pk_index, SmartRecord re
     }
     std::string value;
     if (!is_cstore()) {
-        ret = record->encode(value);
+        SmartRowLayout layout = nullptr;
+        if (FLAGS_row_compact_format && _table_info != nullptr) {
+            layout = _table_info->get_row_layout(_table_info->version);
+        }
+        ret = -1;
+        if (layout != nullptr) {
+            ret = CompactRowCodec::encode(*record->get_raw_message(), _table_info->version,
+                    *layout, _pri_field_ids, &value);
+        }
+        // meta还没记录layout，或record和事务开始时的schema不一致时写pb格式
+        if (ret != 0) {
+            ret = record->encode(value);
+        }
         if (ret != 0) {
             DB_WARNING("encode record failed: reg=%ld, tab=%ld", region, pk_index.id);
             return -1;
@@ -428,6 +445,16 @@ int Transaction::delete_kv(const std::string& key) {
     return 0;
 }
 
+int Transaction::remove_range(const std::string& begin, const std::string& end) {
+    BAIDU_SCOPED_LOCK(_txn_mutex);
+    auto res = _txn->GetWriteBatch()->GetWriteBatch()->DeleteRange(_data_cf, begin, end);
+    if (!res.ok()) {
+        DB_FATAL("delete range fail, error: %s", res.ToString().c_str());
+        return -1;
+    }
+    return 0;
+}
+
 int Transaction::put_meta_info(const std::string& key, const std::string& value) {
     auto res = _txn->Put(_meta_cf, rocksdb::Slice(key), rocksdb::Slice(value));
     if (!res.ok()) {
@@ -805,6 +832,7 @@ rocksdb::Status Transaction::commit() {
         }
         */
         _is_finished = true;
+        leave_chunk_write();
     }
     return res;
 }
@@ -826,6 +854,7 @@ rocksdb::Status Transaction::rollback() {
         _is_finished = true;
         _is_rolledback = true;
     }
+    leave_chunk_write();
     return res;
 }
 
@@ -876,6 +905,9 @@ int Transaction::put_primary_columns(const TableKey& primary_key, SmartRecord re
         DB_WARNING("no table_info");
         return -1;
     }
+    if (0 != remove_column_chunk(primary_key)) {
+        return -1;
+    }
     int32_t table_id = primary_key.extract_i64(sizeof(int64_t));
     for (auto& field_info : _table_info->fields) {
         int32_t field_id = field_info.id;
@@ -984,6 +1016,9 @@ int Transaction::remove_columns(const TableKey& primary_key) {
        DB_WARNING("no table_info");
        return -1;
     }
+    if (0 != remove_column_chunk(primary_key)) {
+        return -1;
+    }
     int32_t table_id = primary_key.extract_i64(sizeof(int64_t));
     for (auto& field_info : _table_info->fields) {
         int32_t field_id = field_info.id;
@@ -1003,4 +1038,61 @@ int Transaction::remove_columns(const TableKey& primary_key) {
     }
     return 0;
 }
+
+// for cstore only
+// 不带snapshot读，能看到已提交的chunk；读之前登记到pool，
+// chunk生成方在登记期间或之后版本变化时放弃写入
+int Transaction::remove_column_chunk(const TableKey& primary_key) {
+    if (_pool != nullptr && !_chunk_writing) {
+        _pool->chunk_writer_enter();
+        _chunk_writing = true;
+    }
+    int64_t region_id = primary_key.extract_i64(0);
+    int32_t table_id = primary_key.extract_i64(sizeof(int64_t));
+    rocksdb::Slice pure_pk = primary_key.data();
+    pure_pk.remove_prefix(sizeof(int64_t) * 2);
+    MutTableKey prefix = ColumnChunkCodec::chunk_prefix(region_id, table_id, 0);
+    MutTableKey seek_key = prefix;
+    seek_key.append_char(pure_pk.data(), pure_pk.size());
+
+    rocksdb::ReadOptions read_options;
+    read_options.prefix_same_as_start = true;
+    std::unique_ptr<rocksdb::Iterator> iter(_txn->GetIterator(read_options, _data_cf));
+    iter->SeekForPrev(seek_key.data());
+    if (!iter->Valid() || !iter->key().starts_with(prefix.data())) {
+        return 0;
+    }
+    std::string last_key;
+    rocksdb::Slice value = iter->value();
+    if (0 != ColumnChunkCodec::decode_last_key(value.data(), value.size(), &last_key)) {
+        DB_WARNING("decode chunk failed, region_id: %ld, table_id: %d, remove it",
+                region_id, table_id);
+    } else if (pure_pk.compare(last_key) > 0) {
+        return 0;
+    }
+    std::string start_key = iter->key().ToString().substr(prefix.size());
+    std::vector<int32_t> field_ids = {0};
+    for (auto& field_info : _table_info->fields) {
+        if (_pri_field_ids.count(field_info.id) == 0) {
+            field_ids.push_back(field_info.id);
+        }
+    }
+    for (auto field_id : field_ids) {
+        MutTableKey key = ColumnChunkCodec::chunk_prefix(region_id, table_id, field_id);
+        key.append_index(start_key);
+        auto res = _txn->Delete(_data_cf, key.data());
+        if (!res.ok()) {
+            DB_WARNING("delete chunk error: code=%d, msg=%s", res.code(), res.ToString().c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void Transaction::leave_chunk_write() {
+    if (_chunk_writing) {
+        _pool->chunk_writer_exit();
+        _chunk_writing = false;
+    }
+}
 } //nanespace baikaldb
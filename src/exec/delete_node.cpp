@@ -12,11 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include "runtime_state.h"
 #include "delete_node.h"
+#include "filter_node.h"
 
 namespace baikaldb {
 DECLARE_bool(disable_writebatch_index);
+DEFINE_int64(delete_range_min_rows, 100000,
+        "delete covering whole primary key ranges over this rows uses DeleteRange, "
+        "0 means disable, default:100000");
+DEFINE_int64(delete_range_min_range_rows, 10000,
+        "a primary key range uses DeleteRange only over this rows, "
+        "smaller ranges are deleted row by row, default:10000");
+DEFINE_int32(delete_range_max_ranges, 16,
+        "max DeleteRange tombstones one delete writes, reads cost grows with tombstones, default:16");
+static bvar::Adder<int64_t> delete_range_count("delete_range_count");
+static bvar::Adder<int64_t> delete_range_rows("delete_range_rows");
 int DeleteNode::init(const pb::PlanNode& node) { 
     int ret = 0;
     ret = ExecNode::init(node);
@@ -73,6 +85,17 @@ int DeleteNode::open(RuntimeState* state) {
         pair.second->sync(ams[i]);
         i++;
     }
+    if (can_delete_range(state)) {
+        ret = delete_range(state);
+        if (ret >= 0) {
+            num_affected_rows = ret;
+            state->set_num_increase_rows(_num_increase_rows);
+            return num_affected_rows;
+        } else if (ret != -2) {
+            DB_WARNING_STATE(state, "delete_range fail");
+            return -1;
+        }
+    }
     SmartRecord record = _factory->new_record(*_table_info);
     int64_t tmp_num_increase_rows = 0;
     do {
@@ -129,6 +152,166 @@ int DeleteNode::open(RuntimeState* state) {
     state->set_num_increase_rows(_num_increase_rows);
     return num_affected_rows;
 }
+
+bool DeleteNode::can_delete_range(RuntimeState* state) {
+    // DeleteRange不经过事务，只用于非事务的1pc删除(raft apply时执行)
+    if (FLAGS_delete_range_min_rows <= 0 || state->txn_id != 0 || state->is_separate) {
+        return false;
+    }
+    // DeleteRange不加行锁，有未提交的事务(leader上begin未prepare的也算)时逐行删除，避免绕过其行锁
+    if (state->txn_pool() == nullptr || state->txn_pool()->num_began() != 0) {
+        return false;
+    }
+    // 索引ddl回填时加行锁读主键，逐行删除才能和它互斥
+    for (auto index_id : _affected_index_ids) {
+        auto info_ptr = _factory->get_index_info_ptr(index_id);
+        if (info_ptr == nullptr || info_ptr->state != pb::IS_PUBLIC) {
+            return false;
+        }
+    }
+    if (_children.size() != 1) {
+        return false;
+    }
+    ExecNode* child = _children[0];
+    if (child->node_type() == pb::WHERE_FILTER_NODE
+            || child->node_type() == pb::TABLE_FILTER_NODE) {
+        if (child->get_limit() != -1 || child->children_size() != 1
+                || !static_cast<FilterNode*>(child)->all_conjuncts_pruned()) {
+            return false;
+        }
+        child = child->children(0);
+    }
+    if (child->node_type() != pb::SCAN_NODE || child->get_limit() != -1
+            || static_cast<ScanNode*>(child)->engine() != pb::ROCKSDB) {
+        return false;
+    }
+    _scan_node = static_cast<RocksdbScanNode*>(child);
+    return _scan_node->is_primary_range_scan();
+}
+
+int DeleteNode::delete_range(RuntimeState* state) {
+    struct KeyRange {
+        size_t idx;
+        int64_t rows;
+        std::string first;
+        std::string last;
+    };
+    // 第一遍只读主键，得到每个范围实际存在的首尾key和行数
+    std::vector<KeyRange> ranges;
+    int64_t range_rows = 0;
+    int num_delete_ranges = 0;
+    std::map<int32_t, FieldInfo*> no_fields;
+    SmartRecord record = _factory->new_record(*_table_info);
+    for (size_t i = 0; i < _scan_node->range_size(); ++i) {
+        std::unique_ptr<TableIterator> iter(
+                _scan_node->open_primary_range(state, i, no_fields, KEY_ONLY));
+        if (iter == nullptr) {
+            return -1;
+        }
+        KeyRange range;
+        range.idx = i;
+        range.rows = 0;
+        while (iter->valid()) {
+            if (state->is_cancelled()) {
+                DB_WARNING_STATE(state, "cancelled");
+                return -1;
+            }
+            record->clear();
+            if (iter->get_next(record) < 0) {
+                continue;
+            }
+            MutTableKey key;
+            key.append_i64(_region_id).append_i64(_table_id);
+            if (0 != key.append_index(*_pri_info, record.get(), -1, false)) {
+                DB_WARNING_STATE(state, "encode key failed, table_id:%ld", _table_id);
+                return -1;
+            }
+            if (range.rows == 0) {
+                range.first = key.data();
+            }
+            range.last = key.data();
+            ++range.rows;
+        }
+        if (range.rows >= FLAGS_delete_range_min_range_rows) {
+            range_rows += range.rows;
+            ++num_delete_ranges;
+        }
+        if (range.rows > 0) {
+            ranges.push_back(range);
+        }
+    }
+    // 每个range tombstone都会拖慢之后的读，行数少的范围不值得
+    if (range_rows < FLAGS_delete_range_min_rows
+            || num_delete_ranges > FLAGS_delete_range_max_ranges) {
+        return -2;
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const KeyRange& a, const KeyRange& b) {
+        return a.first < b.first;
+    });
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first <= ranges[i - 1].last) {
+            return -2;
+        }
+    }
+    bool has_secondary = false;
+    for (auto index_id : _affected_index_ids) {
+        if (index_id != _table_id) {
+            has_secondary = true;
+        }
+    }
+    // 所有写入都在raft apply的事务中，DeleteRange也追加到它的WriteBatch，
+    // 和二级索引删除、applied_index、num_table_lines一起提交，失败回滚或重放都不会只删一半
+    _txn = state->txn();
+    int num_affected_rows = 0;
+    for (auto& range : ranges) {
+        bool use_delete_range = range.rows >= FLAGS_delete_range_min_range_rows;
+        if (use_delete_range && !has_secondary) {
+            num_affected_rows += range.rows;
+            _num_increase_rows -= range.rows;
+            continue;
+        }
+        // 逐行删除二级索引(含倒排)，小范围连主键一起删
+        std::unique_ptr<TableIterator> iter(
+                _scan_node->open_primary_range(state, range.idx, _field_ids, KEY_VAL));
+        if (iter == nullptr) {
+            return -1;
+        }
+        while (iter->valid()) {
+            record->clear();
+            if (iter->get_next(record) < 0) {
+                continue;
+            }
+            MutTableKey pk_key;
+            if (0 != record->encode_key(*_pri_info, pk_key, -1, false)) {
+                DB_WARNING_STATE(state, "encode key failed, table_id:%ld", _table_id);
+                return -1;
+            }
+            int ret = remove_row(state, record, pk_key.data(), !use_delete_range);
+            if (ret < 0) {
+                DB_WARNING_STATE(state, "remove_row fail");
+                return -1;
+            }
+            num_affected_rows += ret;
+        }
+    }
+    for (auto& range : ranges) {
+        if (range.rows < FLAGS_delete_range_min_range_rows) {
+            continue;
+        }
+        // 末尾补0是最后一个key的后继，DeleteRange不含右边界
+        std::string end = range.last;
+        end.push_back('\0');
+        if (0 != _txn->remove_range(range.first, end)) {
+            DB_WARNING_STATE(state, "remove_range fail, table_id:%ld", _table_id);
+            return -1;
+        }
+    }
+    state->range_delete_rows = range_rows;
+    delete_range_count << num_delete_ranges;
+    delete_range_rows << range_rows;
+    DB_NOTICE("delete range, table_id:%ld, region_id:%ld, ranges:%d, rows:%ld",
+            _table_id, _region_id, num_delete_ranges, range_rows);
+    return num_affected_rows;
 }
 
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
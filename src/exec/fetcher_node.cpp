@@ -23,6 +23,7 @@
 #include "insert_node.h"
 #include "network_socket.h"
 #include "schema_factory.h"
+#include "peer_selector.h"
 #include "proto/store.interface.pb.h"
 
 namespace baikaldb {
@@ -199,7 +200,13 @@ FetcherNode::ErrorType FetcherNode::send_request(
         return E_FATAL;
     }
     int64_t entry_ms5 = butil::gettimeofday_ms() % 1000;
-    pb::StoreService_Stub(&channel).query(&cntl, &req, &res, NULL);
+    if (_op_type == pb::OP_SELECT && state->txn_id == 0 && FLAGS_peer_select_latency_aware) {
+        PeerSelector::get_instance()->on_send(addr);
+        pb::StoreService_Stub(&channel).query(&cntl, &req, &res, NULL);
+        PeerSelector::get_instance()->on_finish(addr, cntl.latency_us(), cntl.Failed());
+    } else {
+        pb::StoreService_Stub(&channel).query(&cntl, &req, &res, NULL);
+    }
 
     //DB_WARNING("req: %s", req.DebugString().c_str());
     //DB_WARNING("res: %s", res.DebugString().c_str());
@@ -441,15 +448,28 @@ FetcherNode::ErrorType FetcherNode::send_request(
 void FetcherNode::choose_opt_instance(pb::RegionInfo& info, std::string& addr) {
     SchemaFactory* schema_factory = SchemaFactory::get_instance();
     std::string baikaldb_logical_room = schema_factory->get_logical_room();
-    if (baikaldb_logical_room.empty()) {
+    std::vector<std::string> candicate_peers;
+    if (!baikaldb_logical_room.empty()) {
+        for (auto& peer: info.peers()) {
+            std::string logical_room = schema_factory->logical_room_for_instance(peer);
+            if (!logical_room.empty()  && logical_room == baikaldb_logical_room) {
+                candicate_peers.push_back(peer);
+            }  
+        }
+    }
+    if (FLAGS_peer_select_latency_aware) {
+        // 只在同机房副本中按延迟选，没有配置机房或同机房没有副本时仍读leader
+        if (candicate_peers.empty()) {
+            return;
+        }
+        std::string peer = PeerSelector::get_instance()->select(candicate_peers);
+        if (!peer.empty()) {
+            addr = peer;
+        }
         return;
     }
-    std::vector<std::string> candicate_peers;
-    for (auto& peer: info.peers()) {
-        std::string logical_room = schema_factory->logical_room_for_instance(peer);
-        if (!logical_room.empty()  && logical_room == baikaldb_logical_room) {
-            candicate_peers.push_back(peer);
-        }  
+    if (baikaldb_logical_room.empty()) {
+        return;
     }
     if (candicate_peers.size() > 0) {
         uint32_t i = butil::fast_rand() % candicate_peers.size();
@@ -16,6 +16,7 @@
 #include "full_export_node.h"
 #include "runtime_state.h"
 #include "network_socket.h"
+#include "trace_analyzer.h"
 
 namespace baikaldb {
 int PacketNode::init(const pb::PlanNode& node) {
@@ -101,6 +102,9 @@ int PacketNode::handle_trace(RuntimeState* state) {
     std::vector<std::string> names = {
         "trace"
     };
+    if (state->is_analyze) {
+        names = TraceAnalyzer::field_names();
+    }
     for (auto& name : names) {
         ResultField field;
         field.name = name;
@@ -109,9 +113,17 @@ int PacketNode::handle_trace(RuntimeState* state) {
     }
     pack_head();
     pack_fields();
-    std::vector<std::string> row;
-    row.push_back(_trace->DebugString().c_str());
-    pack_vector_row(row);
+    if (state->is_analyze) {
+        std::vector<std::vector<std::string>> rows;
+        TraceAnalyzer().analyze(*_trace, &rows);
+        for (auto& row : rows) {
+            pack_vector_row(row);
+        }
+    } else {
+        std::vector<std::string> row;
+        row.push_back(_trace->DebugString().c_str());
+        pack_vector_row(row);
+    }
     pack_eof();
     return 0;
 }
@@ -182,6 +194,10 @@ int PacketNode::open(RuntimeState* state) {
                 return ret;
             }
         }
+        ret = flush_if_needed();
+        if (ret < 0) {
+            return ret;
+        }
     } while (!eos);
     //DB_WARNING("txn_id: %lu, pack_time: %ld", state->txn_id, pack_time);
     if (_trace == nullptr) {
@@ -218,6 +234,10 @@ int PacketNode::get_next(RuntimeState* state) {
             return ret;
         }
     }
+    ret = flush_if_needed();
+    if (ret < 0) {
+        return ret;
+    }
 
     if (state->is_eos()) {
         pack_eof();
@@ -267,6 +287,21 @@ int PacketNode::pack_err() {
     return 0;
 }
 
+// 大结果集不在send_buf中攒完再发，超过水位就写到socket，内存占用有上限
+int PacketNode::flush_if_needed() {
+    if (FLAGS_send_buf_flush_watermark <= 0 || _trace != nullptr
+            || _client->send_buf != _send_buf
+            || (int64_t)_send_buf->_size < FLAGS_send_buf_flush_watermark) {
+        return 0;
+    }
+    int ret = _wrapper->flush_send_buf(_client);
+    if (ret != RET_SUCCESS) {
+        DB_WARNING("flush send_buf fail, ret:%d, conn_id:%ld", ret, _client->conn_id);
+        return -1;
+    }
+    return 0;
+}
+
 // https://dev.mysql.com/doc/internals/en/com-query-response.html#packet-ProtocolText::Resultset
 int PacketNode::pack_head() {
     //Result Set Header Packet
@@ -15,6 +15,7 @@
 #include <map>
 #include "rocksdb_scan_node.h"
 #include "filter_node.h"
+#include "sort_node.h"
 #include "join_node.h"
 #include "schema_factory.h"
 #include "scalar_fn_call.h"
@@ -23,6 +24,10 @@
 #include "parser.h"
 
 namespace baikaldb {
+DEFINE_int64(scan_no_fill_cache_rows, 100000,
+        "scans estimated over this rows do not fill block cache, 0 means always fill, default:100000");
+static bvar::Adder<int64_t> scan_no_fill_cache_count("scan_no_fill_cache_count");
+
 int RocksdbScanNode::select_index(std::vector<int>& multi_reverse_index) {
     //int index_size = node.derive_node().scan_node().indexes_size();
     const pb::PlanNode& node = _pb_node;
@@ -103,6 +108,21 @@ int RocksdbScanNode::select_index(std::vector<int>& multi_reverse_index) {
     if (sort_index != -1) {
         return sort_index;
     }
+    // 有统计信息时(baikaldb在IndexSelector中估算)，选择代价最小的索引
+    int min_cost_index = -1;
+    for (auto& pair : prefix_ratio_id_mapping) {
+        auto& pos_index = node.derive_node().scan_node().indexes(pair.second);
+        if (!pos_index.has_cost()) {
+            min_cost_index = -1;
+            break;
+        }
+        if (min_cost_index == -1 || pos_index.cost() < node.derive_node().scan_node().indexes(min_cost_index).cost()) {
+            min_cost_index = pair.second;
+        }
+    }
+    if (min_cost_index != -1) {
+        return min_cost_index;
+    }
     // ratio * 10(=0...9)相同的possible index中，按照PRIMARY, UNIQUE, KEY的优先级选择
     //DB_WARNING("prefix_ratio_id_mapping.size: %d", prefix_ratio_id_mapping.size());
     for (auto iter = prefix_ratio_id_mapping.crbegin(); iter != prefix_ratio_id_mapping.crend(); ++iter) {
@@ -161,6 +181,10 @@ int RocksdbScanNode::choose_index(RuntimeState* state) {
         return 0;
     }
     _index_ids.push_back(_index_id);
+    _fill_cache = need_fill_cache(pos_index);
+    if (!_fill_cache) {
+        scan_no_fill_cache_count << 1;
+    }
     if (pos_index.ranges_size() == 0) {
         return 0;
     }
@@ -221,6 +245,27 @@ int RocksdbScanNode::choose_index(RuntimeState* state) {
     return 0;
 }
 
+bool RocksdbScanNode::need_fill_cache(const pb::PossibleIndex& pos_index) {
+    if (FLAGS_scan_no_fill_cache_rows <= 0) {
+        return true;
+    }
+    // 按索引序取top n只读很少的block
+    if (pos_index.has_sort_index() && pos_index.sort_index().sort_limit() > 0
+            && pos_index.sort_index().sort_limit() < FLAGS_scan_no_fill_cache_rows) {
+        return true;
+    }
+    if (pos_index.has_estimate_rows()) {
+        return pos_index.estimate_rows() < FLAGS_scan_no_fill_cache_rows;
+    }
+    // 没有统计信息时，没有范围条件的扫描按全表扫描处理
+    for (auto& range : pos_index.ranges()) {
+        if (range.left_field_cnt() > 0 || range.right_field_cnt() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int RocksdbScanNode::init(const pb::PlanNode& node) {
     int ret = 0;
     ret = ScanNode::init(node);
@@ -257,6 +302,103 @@ int RocksdbScanNode::predicate_pushdown(std::vector<ExprNode*>& input_exprs) {
     return 0;
 }
 
+void RocksdbScanNode::build_zone_predicates() {
+    if (_parent == nullptr || (_parent->node_type() != pb::WHERE_FILTER_NODE
+            && _parent->node_type() != pb::TABLE_FILTER_NODE)) {
+        return;
+    }
+    std::map<int32_t, int32_t> slot_field_map;
+    for (auto& slot : _tuple_desc->slots()) {
+        slot_field_map[slot.slot_id()] = slot.field_id();
+    }
+    // 条件仍由filter node计算，这里只用来跳过不可能满足的chunk
+    for (auto expr : *_parent->mutable_conjuncts()) {
+        ZonePredicate pred;
+        if (to_zone_predicate(expr, slot_field_map, &pred)) {
+            _zone_predicates.push_back(pred);
+        }
+    }
+}
+
+bool RocksdbScanNode::to_zone_predicate(ExprNode* expr,
+        const std::map<int32_t, int32_t>& slot_field_map, ZonePredicate* pred) {
+    if (expr->children_size() < 1) {
+        return false;
+    }
+    size_t slot_idx = 0;
+    switch (expr->node_type()) {
+        case pb::IS_NULL_PREDICATE:
+            pred->op = ZONE_IS_NULL;
+            break;
+        case pb::IN_PREDICATE:
+            pred->op = ZONE_IN;
+            break;
+        case pb::FUNCTION_CALL: {
+            if (expr->children_size() != 2) {
+                return false;
+            }
+            // 常量在左边时比较方向反过来
+            bool reverse = !expr->children(0)->is_slot_ref();
+            slot_idx = reverse ? 1 : 0;
+            switch (static_cast<ScalarFnCall*>(expr)->fn().fn_op()) {
+                case parser::FT_EQ:
+                    pred->op = ZONE_EQ;
+                    break;
+                case parser::FT_LT:
+                    pred->op = reverse ? ZONE_GT : ZONE_LT;
+                    break;
+                case parser::FT_LE:
+                    pred->op = reverse ? ZONE_GE : ZONE_LE;
+                    break;
+                case parser::FT_GT:
+                    pred->op = reverse ? ZONE_LT : ZONE_GT;
+                    break;
+                case parser::FT_GE:
+                    pred->op = reverse ? ZONE_LE : ZONE_GE;
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+    if (!expr->children(slot_idx)->is_slot_ref()) {
+        return false;
+    }
+    SlotRef* slot_ref = static_cast<SlotRef*>(expr->children(slot_idx));
+    if (slot_ref->tuple_id() != _tuple_id) {
+        return false;
+    }
+    auto slot_iter = slot_field_map.find(slot_ref->slot_id());
+    if (slot_iter == slot_field_map.end()) {
+        return false;
+    }
+    auto field_iter = _field_ids.find(slot_iter->second);
+    if (field_iter == _field_ids.end()) {
+        return false;
+    }
+    pred->field_id = field_iter->first;
+    pred->field_type = field_iter->second->type;
+    for (size_t i = 0; i < expr->children_size(); i++) {
+        if (i == slot_idx) {
+            continue;
+        }
+        ExprNode* literal = expr->children(i);
+        if (!literal->is_literal()) {
+            return false;
+        }
+        ExprValue value;
+        if (!ColumnChunkCodec::convert_zone_value(literal->get_value(nullptr),
+                pred->field_type, &value)) {
+            return false;
+        }
+        pred->values.push_back(value);
+    }
+    return pred->op == ZONE_IS_NULL || !pred->values.empty();
+}
+
 bool RocksdbScanNode::need_pushdown(ExprNode* expr) {
     pb::IndexType index_type = _index_info->type;
     // get方式和主键无需下推
@@ -424,6 +566,9 @@ int RocksdbScanNode::open(RuntimeState* state) {
     }
     // 索引条件下推，减少主表查询次数
     index_condition_pushdown();
+    if (_index_info->type == pb::I_PRIMARY && _table_info->engine == pb::ROCKSDB_CSTORE) {
+        build_zone_predicates();
+    }
     for (auto expr : _index_conjuncts) {
         //pb::Expr pb;
         //ExprNode::create_pb_expr(&pb, expr);
@@ -451,8 +596,9 @@ int RocksdbScanNode::open(RuntimeState* state) {
         //}
         //DB_NOTICE("or_bool:%d", or_bool);
         // 为了性能,多索引倒排查找不seek
+        _top_k = calc_reverse_top_k();
         _m_index.search(txn->get_txn(), *_pri_info, *_table_info, 
-                    _reverse_indexes, _query_words, true, !_bool_and);
+                    _reverse_indexes, _query_words, true, !_bool_and, _top_k);
     } else if (reverse_index_map.count(_index_id) == 1) {
         //倒排索引不允许是多字段
         if (_index_info->fields.size() != 1) {
@@ -474,8 +620,9 @@ int RocksdbScanNode::open(RuntimeState* state) {
         //bool dont_seek = _index_info->type == pb::I_RECOMMEND;
         // seek性能太差了，倒排索引都不做seek
         bool dont_seek = true;
+        _top_k = calc_reverse_top_k();
         ret = _reverse_index->search(txn->get_txn(), *_pri_info, *_table_info, 
-                word, _index_conjuncts, dont_seek);
+                word, _index_conjuncts, dont_seek, _top_k);
         if (ret < 0) {
             return ret;
         }
@@ -486,6 +633,68 @@ int RocksdbScanNode::open(RuntimeState* state) {
     return 0;
 }
 
+int64_t RocksdbScanNode::calc_reverse_top_k() {
+    if (_index_info->type != pb::I_FULLTEXT) {
+        return 0;
+    }
+    _weight_field_id = get_field_id_by_name(_table_info->fields, "__weight");
+    if (_weight_field_id <= 0) {
+        return 0;
+    }
+    ExecNode* parent = get_parent();
+    // 有过滤条件的filter会减少返回行数，不能剪枝
+    while (parent != nullptr && (parent->node_type() == pb::TABLE_FILTER_NODE 
+            || parent->node_type() == pb::WHERE_FILTER_NODE)
+            && parent->mutable_conjuncts()->empty()) {
+        parent = parent->get_parent();
+    }
+    if (parent == nullptr || parent->node_type() != pb::SORT_NODE || parent->get_limit() <= 0) {
+        return 0;
+    }
+    SortNode* sort_node = static_cast<SortNode*>(parent);
+    if (sort_node->slot_order_exprs().size() != 1 || sort_node->is_asc().size() != 1
+            || sort_node->is_asc()[0]) {
+        return 0;
+    }
+    ExprNode* order_expr = sort_node->slot_order_exprs()[0];
+    if (!order_expr->is_slot_ref()) {
+        return 0;
+    }
+    SlotRef* slot_ref = static_cast<SlotRef*>(order_expr);
+    if (slot_ref->tuple_id() != _tuple_id || slot_ref->field_id() != _weight_field_id) {
+        return 0;
+    }
+    return parent->get_limit();
+}
+
+bool RocksdbScanNode::check_reverse_top_k(SmartRecord record) {
+    if (_top_k <= 0 || (int64_t)_top_k_heap.size() < _top_k) {
+        return true;
+    }
+    float score = record->get_value(record->get_field_by_tag(_weight_field_id))
+            .get_numberic<float>();
+    return score > _top_k_heap.top();
+}
+
+void RocksdbScanNode::update_reverse_top_k(SmartRecord record) {
+    if (_top_k <= 0) {
+        return;
+    }
+    float score = record->get_value(record->get_field_by_tag(_weight_field_id))
+            .get_numberic<float>();
+    _top_k_heap.push(score);
+    if ((int64_t)_top_k_heap.size() > _top_k) {
+        _top_k_heap.pop();
+    }
+    if ((int64_t)_top_k_heap.size() == _top_k) {
+        if (_reverse_indexes.size() > 0) {
+            _m_index.set_score_threshold(_top_k_heap.top());
+        } else if (_reverse_index != nullptr) {
+            _reverse_index->set_score_threshold(_top_k_heap.top());
+        }
+    }
+}
+
 int RocksdbScanNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {  
     if (_is_explain) {
         // 生成一条临时数据跑通所有流程
@@ -525,6 +734,40 @@ void RocksdbScanNode::close(RuntimeState* state) {
     }
 }
 
+bool RocksdbScanNode::is_primary_range_scan() {
+    if (_index_id != _table_id || _use_get || _left_records.empty()) {
+        return false;
+    }
+    if (_reverse_index != nullptr || !_reverse_indexes.empty() || !_index_conjuncts.empty()) {
+        return false;
+    }
+    return _table_info != nullptr && _table_info->engine == pb::ROCKSDB;
+}
+
+TableIterator* RocksdbScanNode::open_primary_range(RuntimeState* state, size_t idx,
+        std::map<int32_t, FieldInfo*>& fields, KVMode mode) {
+    if (idx >= _left_records.size()) {
+        return nullptr;
+    }
+    IndexRange range(_left_records[idx].get(),
+            _right_records[idx].get(),
+            _index_info.get(),
+            _pri_info.get(),
+            _region_info,
+            _left_field_cnts[idx],
+            _right_field_cnts[idx],
+            _left_opens[idx],
+            _right_opens[idx],
+            _like_prefixs[idx]);
+    TableIterator* iter = Iterator::scan_primary(state->txn(), range, fields, true, true, false);
+    if (iter == nullptr) {
+        DB_WARNING_STATE(state, "open TableIterator fail, table_id:%ld", _index_id);
+        return nullptr;
+    }
+    iter->set_mode(mode);
+    return iter;
+}
+
 int RocksdbScanNode::get_next_by_table_get(RuntimeState* state, RowBatch* batch, bool* eos) {
     START_LOCAL_TRACE(get_trace(), GET_NEXT_TRACE, ([this](TraceLocalNode& local_node) {
         local_node.set_affect_rows(_num_rows_returned);
@@ -635,6 +878,12 @@ int RocksdbScanNode::get_next_by_index_get(RuntimeState* state, RowBatch* batch,
 int RocksdbScanNode::get_next_by_table_seek(RuntimeState* state, RowBatch* batch, bool* eos) {
     START_LOCAL_TRACE(get_trace(), GET_NEXT_TRACE, ([this](TraceLocalNode& local_node) {
         local_node.set_affect_rows(_num_rows_returned);
+        int64_t skipped_blocks = _skipped_blocks;
+        if (_table_iter != nullptr) {
+            skipped_blocks += _table_iter->skipped_chunks();
+        }
+        local_node.add_skipped_blocks(skipped_blocks - _reported_skipped_blocks);
+        _reported_skipped_blocks = skipped_blocks;
     }));
     SmartRecord record = _factory->new_record(_table_id);
     int64_t time = 0;
@@ -666,12 +915,19 @@ int RocksdbScanNode::get_next_by_table_seek(RuntimeState* state, RowBatch* batch
                         _left_opens[_idx], 
                         _right_opens[_idx],
                         _like_prefixs[_idx]);
+                if (_table_iter != nullptr) {
+                    _skipped_blocks += _table_iter->skipped_chunks();
+                }
                 delete _table_iter;
-                _table_iter = Iterator::scan_primary(state->txn(), range, _field_ids, true, _scan_forward);
+                _table_iter = Iterator::scan_primary(state->txn(), range, _field_ids, true,
+                        _scan_forward, _fill_cache);
                 if (_table_iter == nullptr) {
                     DB_WARNING_STATE(state, "open TableIterator fail, table_id:%ld", _index_id);
                     return -1;
                 }
+                if (!_zone_predicates.empty()) {
+                    _table_iter->set_zone_predicates(_zone_predicates);
+                }
                 if (_is_covering_index) {
                     _table_iter->set_mode(KEY_ONLY);
                 }
@@ -732,11 +988,19 @@ int RocksdbScanNode::get_next_by_index_seek(RuntimeState* state, RowBatch* batch
         }
         if (_reverse_indexes.size() > 0) {
             if (!_m_index.valid()) {
+                if (_m_index.is_failed()) {
+                    DB_WARNING_STATE(state, "read reverse list fail, region_id: %ld", _region_id);
+                    return -1;
+                }
                 *eos = true; 
                 return 0;
             }
         } else if (_reverse_index != nullptr) {
             if (!_reverse_index->valid()) {
+                if (_reverse_index->is_failed()) {
+                    DB_WARNING_STATE(state, "read reverse list fail, region_id: %ld", _region_id);
+                    return -1;
+                }
                 *eos = true;
                 return 0;
             }
@@ -757,7 +1021,8 @@ int RocksdbScanNode::get_next_by_index_seek(RuntimeState* state, RowBatch* batch
                             _right_opens[_idx],
                             _like_prefixs[_idx]);
                     delete _index_iter;
-                    _index_iter = Iterator::scan_secondary(state->txn(), range, true, _scan_forward);
+                    _index_iter = Iterator::scan_secondary(state->txn(), range, true,
+                            _scan_forward, _fill_cache);
                     if (_index_iter == nullptr) {
                         DB_WARNING_STATE(state, "open IndexIterator fail, index_id:%ld", _index_id);
                         return -1;
@@ -803,6 +1068,11 @@ int RocksdbScanNode::get_next_by_index_seek(RuntimeState* state, RowBatch* batch
             ++index_conjuncts_filter_cnt;
             continue;
         }
+        // 分数进入不了top k，不需要反查主表
+        if (!check_reverse_top_k(record)) {
+            ++index_conjuncts_filter_cnt;
+            continue;
+        }
         //DB_NOTICE("get index: %ld", cost.get_time());
         //cost.reset();
         if (!_is_covering_index && !is_global_index) {
@@ -817,6 +1087,7 @@ int RocksdbScanNode::get_next_by_index_seek(RuntimeState* state, RowBatch* batch
                 continue;
             }
         }
+        update_reverse_top_k(record);
         //DB_NOTICE("record:%s", record->debug_string().c_str());
         //cost.reset();
         //row->set_tuple(_tuple_id, _mem_row_desc);
@@ -104,6 +104,9 @@ void ScanNode::show_explain(std::vector<std::map<std::string, std::string>>& out
         if (pos_index.has_sort_index()) {
             explain_info["sort_index"] = "1";
         }
+        if (pos_index.has_estimate_rows()) {
+            explain_info["rows"] = std::to_string(pos_index.estimate_rows());
+        }
         std::set<int32_t> field_map;
         for (auto& f : pri_info.fields) {
             field_map.insert(f.id);
@@ -39,7 +39,7 @@ int TruncateNode::open(RuntimeState* state) {
         DB_WARNING_STATE(state, "get rocksdb instance failed");
         return -1;
     }
-    rocksdb::ColumnFamilyHandle* _data_cf = _db->get_data_handle();
+    rocksdb::ColumnFamilyHandle* _data_cf = _db->get_data_handle(state->resource()->region_info);
     if (_data_cf == nullptr) {
         DB_WARNING_STATE(state, "get rocksdb data column family failed");
         return -1;
@@ -314,6 +314,32 @@ int DDLPlanner::parse_create_table(pb::SchemaInfo& table) {
                     }
                     DB_WARNING("storage_compute_separate: %ld", separate);
                 }
+                json_iter = root.FindMember("write_combine");
+                if (json_iter != root.MemberEnd()) {
+                    int64_t write_combine = json_iter->value.GetInt64();
+                    table.mutable_schema_conf()->set_write_combine(write_combine != 0);
+                    DB_WARNING("write_combine: %ld", write_combine);
+                }
+                json_iter = root.FindMember("column_family");
+                if (json_iter != root.MemberEnd()) {
+                    if (table.engine() != pb::ROCKSDB) {
+                        DB_FATAL("only ROCKSDB engine support column_family");
+                        return -1;
+                    }
+                    if (0 != parse_cf_conf(json_iter->value, table.mutable_cf_conf())) {
+                        return -1;
+                    }
+                    // fifo按sst整体删除数据，各副本删除的行不同，索引和主键也分别丢失
+                    if (table.cf_conf().compaction_style() == pb::CS_FIFO) {
+                        for (auto& index : table.indexs()) {
+                            if (index.index_type() != pb::I_PRIMARY) {
+                                DB_FATAL("fifo column_family can not create table with index");
+                                return -1;
+                            }
+                        }
+                    }
+                    DB_WARNING("column_family: %s", table.cf_conf().ShortDebugString().c_str());
+                }
             } catch (...) {
                 DB_WARNING("parse create table json comments error [%s]", option->str_value.value);
                 return -1;
@@ -322,6 +348,33 @@ int DDLPlanner::parse_create_table(pb::SchemaInfo& table) {
 
         }
     }
+    if (stmt->partition != nullptr) {
+        parser::PartitionOption* partition = stmt->partition;
+        if (partition->partition_num < 1) {
+            DB_WARNING("invalid partition num: %ld", partition->partition_num);
+            return -1;
+        }
+        table.set_partition_num(partition->partition_num);
+        pb::PartitionInfo* partition_info = table.mutable_partition_info();
+        partition_info->set_field_name(partition->column->name.value);
+        if (partition->type == parser::PARTITION_HASH) {
+            partition_info->set_type(pb::PT_HASH);
+        } else {
+            partition_info->set_type(pb::PT_RANGE);
+            for (int idx = 0; idx < partition->ranges.size(); ++idx) {
+                parser::PartitionRange* range = partition->ranges[idx];
+                if (range->less_expr == nullptr) {
+                    // MAXVALUE只能是最后一个分区
+                    if (idx != partition->ranges.size() - 1) {
+                        DB_WARNING("MAXVALUE can only be used in last partition");
+                        return -1;
+                    }
+                    continue;
+                }
+                partition_info->add_range_bounds(range->less_expr->to_string());
+            }
+        }
+    }
     //set default values if not specified by user
     if (!table.has_byte_size_per_record()) {
         DB_WARNING("no avg_row_length set in comments, use default:50");
@@ -335,6 +388,77 @@ int DDLPlanner::parse_create_table(pb::SchemaInfo& table) {
     return 0;
 }
 
+// {"compaction_style":"universal", "compression":["none","lz4","zstd"],
+//  "bloom_bits_per_key":10, "block_size":4096, "write_buffer_size_mb":64, "fifo_max_size_mb":10240}
+// fifo超过上限时删除最老的sst，删除时机由各副本本地compaction决定，
+// 丢失哪些行在副本间不确定，行数和查询结果会不一致，只用于可以丢数据且没有索引的表
+int DDLPlanner::parse_cf_conf(const rapidjson::Value& value, pb::ColumnFamilyConf* cf_conf) {
+    if (!value.IsObject()) {
+        DB_WARNING("column_family must be json object");
+        return -1;
+    }
+    auto iter = value.FindMember("compaction_style");
+    if (iter != value.MemberEnd()) {
+        std::string style = iter->value.GetString();
+        if (boost::iequals(style, "level")) {
+            cf_conf->set_compaction_style(pb::CS_LEVEL);
+        } else if (boost::iequals(style, "universal")) {
+            cf_conf->set_compaction_style(pb::CS_UNIVERSAL);
+        } else if (boost::iequals(style, "fifo")) {
+            cf_conf->set_compaction_style(pb::CS_FIFO);
+        } else {
+            DB_WARNING("unknown compaction_style: %s", style.c_str());
+            return -1;
+        }
+    }
+    iter = value.FindMember("compression");
+    if (iter != value.MemberEnd()) {
+        std::vector<std::string> compressions;
+        if (iter->value.IsArray()) {
+            for (rapidjson::SizeType i = 0; i < iter->value.Size(); i++) {
+                compressions.push_back(iter->value[i].GetString());
+            }
+        } else {
+            compressions.push_back(iter->value.GetString());
+        }
+        for (auto& compression : compressions) {
+            if (boost::iequals(compression, "none")) {
+                cf_conf->add_compression_per_level(pb::CT_NONE);
+            } else if (boost::iequals(compression, "snappy")) {
+                cf_conf->add_compression_per_level(pb::CT_SNAPPY);
+            } else if (boost::iequals(compression, "lz4")) {
+                cf_conf->add_compression_per_level(pb::CT_LZ4);
+            } else if (boost::iequals(compression, "zstd")) {
+                cf_conf->add_compression_per_level(pb::CT_ZSTD);
+            } else {
+                DB_WARNING("unknown compression: %s", compression.c_str());
+                return -1;
+            }
+        }
+    }
+    iter = value.FindMember("bloom_bits_per_key");
+    if (iter != value.MemberEnd()) {
+        cf_conf->set_bloom_bits_per_key(iter->value.GetInt());
+    }
+    iter = value.FindMember("block_size");
+    if (iter != value.MemberEnd()) {
+        cf_conf->set_block_size(iter->value.GetInt());
+    }
+    iter = value.FindMember("write_buffer_size_mb");
+    if (iter != value.MemberEnd()) {
+        cf_conf->set_write_buffer_size_mb(iter->value.GetInt64());
+    }
+    iter = value.FindMember("fifo_max_size_mb");
+    if (iter != value.MemberEnd()) {
+        cf_conf->set_fifo_max_size_mb(iter->value.GetInt64());
+    }
+    if (cf_conf->compaction_style() == pb::CS_FIFO && cf_conf->fifo_max_size_mb() <= 0) {
+        DB_WARNING("fifo compaction need fifo_max_size_mb");
+        return -1;
+    }
+    return 0;
+}
+
 int DDLPlanner::parse_drop_table(pb::SchemaInfo& table) {
     parser::DropTableStmt* stmt = (parser::DropTableStmt*)(_ctx->stmt);
     if (stmt->table_names.size() > 1) {
@@ -494,6 +618,16 @@ int DDLPlanner::parse_alter_table(pb::MetaManagerRequest& alter_request) {
 
     } else if (spec->spec_type == parser::ALTER_SPEC_ADD_INDEX) {
         alter_request.set_op_type(pb::OP_ADD_INDEX);
+        int64_t table_id = 0;
+        pb::ColumnFamilyConf cf_conf;
+        if (0 == _factory->get_table_id(table->namespace_name() + "." + table->database()
+                    + "." + table->table_name(), table_id)
+                && _factory->get_cf_conf(table_id, &cf_conf)
+                && cf_conf.compaction_style() == pb::CS_FIFO) {
+            _ctx->stat_info.error_code = ER_ALTER_OPERATION_NOT_SUPPORTED;
+            _ctx->stat_info.error_msg << "can not add index to table with fifo column_family";
+            return -1;
+        }
         int constraint_len = spec->new_constraints.size();
 
         for (int idx = 0; idx < constraint_len; ++idx) {
@@ -35,12 +35,12 @@ int KillPlanner::plan() {
     kill->set_db_conn_id(db_conn_id);
     kill->set_is_query(k->is_query);
 
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
     DB_WARNING("kill %d", k->conn_id);
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = epoll_info->get_fd_mapping(idx);
-        if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
-            continue;
+    bool found = false;
+    NetworkServer::get_instance()->for_each_client([this, k, client, &found](
+                SmartSocket sock, EpollInfo* epoll_info) {
+        if (found || sock->is_free || sock->fd == -1 || sock->ip == "") {
+            return;
         }
         if (sock->conn_id == k->conn_id) {
             DB_WARNING("conn_id equal %ld is_query:%d", k->conn_id, k->is_query);
@@ -53,9 +53,9 @@ int KillPlanner::plan() {
                 client->state = STATE_ERROR;
                 // StateMachine::get_instance()->client_free(sock, epoll_info);
             }
-            break;
+            found = true;
         }
-    }
+    });
     return 0;
 }
 } // end of namespace baikaldb
@@ -30,6 +30,7 @@
 #include "predicate.h"
 #include "network_socket.h"
 #include "parser.h"
+#include "statement_stats.h"
 
 namespace bthread {
 DECLARE_int32(bthread_concurrency); //bthread.cpp
@@ -185,6 +186,9 @@ int LogicalPlanner::analyze(QueryContext* ctx) {
         std::string format(stmt->format.c_str());
         if (format == "trace") {
             ctx->is_trace = true;
+        } else if (format == "analyze") {
+            ctx->is_trace = true;
+            ctx->is_analyze = true;
         } else if (format == "plan") {
             ctx->is_print_plan = true;
         } else {
@@ -247,8 +251,11 @@ int LogicalPlanner::analyze(QueryContext* ctx) {
         DB_WARNING("gen plan failed, type:%d", ctx->stmt_type);
         return -1;
     }
-    ctx->stmt->set_print_sample(true);
     auto stat_info = &(ctx->stat_info);
+    // execute时已从prepare继承
+    if (stat_info->sql_sign == 0) {
+        set_sql_digest(ctx);
+    }
     pb::OpType op_type = pb::OP_NONE;
     if (ctx->plan.nodes_size() > 0 && ctx->plan.nodes(0).node_type() == pb::PACKET_NODE) {
         op_type = ctx->plan.nodes(0).derive_node().packet_node().op_type();
@@ -264,11 +271,19 @@ int LogicalPlanner::analyze(QueryContext* ctx) {
         }
         stat_info->sample_sql << "family_table_tag=[" << stat_info->family << "\t"
             << stat_info->table << "\t" << resource_tag << "] op_type=[" << op_type << "] plat=["
-            << FLAGS_log_plat_name << "] sql=[" << ctx->stmt << "]";
+            << FLAGS_log_plat_name << "] sql=[" << stat_info->sql_digest << "]";
     }
     return 0;
 }
 
+void LogicalPlanner::set_sql_digest(QueryContext* ctx) {
+    ctx->stmt->set_print_sample(true);
+    std::ostringstream os;
+    os << ctx->stmt;
+    ctx->stat_info.sql_digest = os.str();
+    ctx->stat_info.sql_sign = StatementStats::sign(ctx->stat_info.sql_digest);
+}
+
 //TODO, add table alias
 int LogicalPlanner::add_table(const std::string& database, const std::string& table,
         const std::string& alias) {
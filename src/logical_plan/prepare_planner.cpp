@@ -190,6 +190,7 @@ int PreparePlanner::stmt_prepare(const std::string& stmt_name, const std::string
         return -1;
     }
     prepare_ctx->root->find_place_holder(prepare_ctx->placeholders);
+    set_sql_digest(prepare_ctx.get());
     // 包括类型推导与常量表达式计算
     ret = ExprOptimize().analyze(prepare_ctx.get());
     if (ret < 0) {
@@ -249,6 +250,8 @@ int PreparePlanner::stmt_execute(const std::string& stmt_name, std::vector<pb::E
     }
     _ctx->stmt_type = prepare_ctx->stmt_type;
     _ctx->exec_prepared = true;
+    _ctx->stat_info.sql_digest = prepare_ctx->stat_info.sql_digest;
+    _ctx->stat_info.sql_sign = prepare_ctx->stat_info.sql_sign;
     return 0;
 }
 
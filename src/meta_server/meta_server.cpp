@@ -180,6 +180,7 @@ void MetaServer::meta_manager(google::protobuf::RpcController* controller,
             || request->op_type() == pb::OP_UPDATE_BYTE_SIZE
             || request->op_type() == pb::OP_UPDATE_SPLIT_LINES
             || request->op_type() == pb::OP_UPDATE_SCHEMA_CONF
+            || request->op_type() == pb::OP_UPDATE_STATISTICS
             || request->op_type() == pb::OP_UPDATE_DISTS
             || request->op_type() == pb::OP_MODIFY_RESOURCE_TAG
             || request->op_type() == pb::OP_ADD_INDEX
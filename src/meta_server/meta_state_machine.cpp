@@ -320,6 +320,10 @@ void MetaStateMachine::on_apply(braft::Iterator& iter) {
             TableManager::get_instance()->update_schema_conf(request, iter.index(), done);
             break;
         }
+        case pb::OP_UPDATE_STATISTICS: {
+            TableManager::get_instance()->update_statistics(request, iter.index(), done);
+            break;
+        }
         case pb::OP_DROP_REGION: {
             RegionManager::get_instance()->drop_region(request, iter.index(), done);
             break;
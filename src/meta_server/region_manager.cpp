@@ -40,6 +40,7 @@ void RegionManager::update_region(const pb::MetaManagerRequest& request,
     std::string min_start_key;
     std::string max_end_key;
     int64_t g_table_id = 0;
+    int64_t g_partition_id = 0;
     bool key_init = false;
     bool old_pb = false;
     std::vector<pb::RegionInfo> region_infos;
@@ -88,6 +89,7 @@ void RegionManager::update_region(const pb::MetaManagerRequest& request,
             min_start_key = region_info.start_key();
             max_end_key = region_info.end_key();
             g_table_id = table_id;
+            g_partition_id = region_info.partition_id();
             key_init = true;
         } else {
             if (g_table_id != table_id) {
@@ -95,6 +97,11 @@ void RegionManager::update_region(const pb::MetaManagerRequest& request,
                         g_table_id, table_id);
                 return;
             }
+            if (g_partition_id != region_info.partition_id()) {
+                DB_FATAL("two region has different partition id %ld vs %ld", 
+                        g_partition_id, region_info.partition_id());
+                return;
+            }
             min_start_key = (min_start_key < region_info.start_key())?
                             min_start_key : region_info.start_key();
             max_end_key = (end_key_compare(max_end_key, region_info.end_key()) > 0)?
@@ -112,7 +119,7 @@ void RegionManager::update_region(const pb::MetaManagerRequest& request,
     if (!old_pb && !add_delete_region) {
         //兼容旧的pb，old_pb不检查区间
         bool check_ok = TableManager::get_instance()->check_region_when_update(
-                            g_table_id, min_start_key, max_end_key);
+                            g_table_id, g_partition_id, min_start_key, max_end_key);
         if (!check_ok) {
             DB_FATAL("table_id:%ld, min_start_key:%s, max_end_key:%s check fail", 
                      g_table_id, str_to_hex(min_start_key).c_str(), 
@@ -131,9 +138,10 @@ void RegionManager::update_region(const pb::MetaManagerRequest& request,
     if (old_pb || add_delete_region) {
         //旧的pb结构直接使用start_key更新map
         TableManager::get_instance()->update_startkey_regionid_map_old_pb(
-            g_table_id, key_id_map);
+            g_table_id, g_partition_id, key_id_map);
     } else {
         TableManager::get_instance()->update_startkey_regionid_map(g_table_id, 
+                g_partition_id,
                 min_start_key, 
                 max_end_key,
                 key_id_map);
@@ -648,7 +656,11 @@ void RegionManager::leader_load_balance(bool whether_can_decide,
         int64_t table_id = leader_region.region().table_id();
         table_leader_counts[table_id]++;
     }
-    set_instance_leader_count(instance, table_leader_counts);
+    //增量心跳不包含全部leader，保留上次全量心跳统计的leader数
+    //store在need_leader_balance时一定会发全量心跳
+    if (!request->incremental()) {
+        set_instance_leader_count(instance, table_leader_counts);
+    }
   
     if (!request->need_leader_balance()) {
         return;
@@ -852,6 +864,13 @@ void RegionManager::update_leader_status(const pb::StoreHeartBeatRequest* reques
         region_state.status = pb::NORMAL;
         _region_state_map.set(region_id, region_state);
     }
+    //增量心跳中状态未变化的leader region只上报region_id, 同样需要更新状态
+    for (auto region_id : request->unchanged_leader_region_ids()) {
+        RegionStateInfo region_state;
+        region_state.timestamp = butil::gettimeofday_us();
+        region_state.status = pb::NORMAL;
+        _region_state_map.set(region_id, region_state);
+    }
 }
 
 void RegionManager::put_incremental_regioninfo(const int64_t apply_index, std::vector<pb::RegionInfo>& region_infos) {
@@ -935,16 +954,19 @@ bool RegionManager::check_and_update_incremental(const pb::BaikalHeartBeatReques
     return false;
 }
 
-bool RegionManager::add_region_is_exist(int64_t table_id, const std::string& start_key, 
+bool RegionManager::add_region_is_exist(int64_t table_id, int64_t partition_id, 
+                                       const std::string& start_key, 
                                        const std::string& end_key) {
     if (start_key.empty()) {
-        int64_t cur_regionid = TableManager::get_instance()->get_startkey_regionid(table_id, start_key);
+        int64_t cur_regionid = TableManager::get_instance()->get_startkey_regionid(table_id, 
+                partition_id, start_key);
         if (cur_regionid < 0) {
             //startkey为空且不在map中，说明已经存在
             return true;
         }
     } else {
-        int64_t pre_regionid = TableManager::get_instance()->get_pre_regionid(table_id, start_key);
+        int64_t pre_regionid = TableManager::get_instance()->get_pre_regionid(table_id, 
+                partition_id, start_key);
         if (pre_regionid > 0) {
             auto pre_region_info = get_region_info(pre_regionid);
             if (pre_region_info != nullptr) {
@@ -1006,6 +1028,7 @@ void RegionManager::leader_heartbeat_for_region(const pb::StoreHeartBeatRequest*
                 *(request.add_region_infos()) = leader_region_info;
                 SchemaManager::get_instance()->process_schema_info(NULL, &request, NULL, NULL);
             } else if (true == add_region_is_exist(leader_region_info.table_id(),
+                                                   leader_region_info.partition_id(),
                                                    leader_region_info.start_key(), 
                                                    leader_region_info.end_key())) {
                 DB_WARNING("region_info: %s is exist ", leader_region_info.ShortDebugString().c_str());
@@ -1532,8 +1555,8 @@ void RegionManager::erase_region_info(const std::vector<int64_t>& drop_region_id
         result_region_ids.push_back(drop_region_id);
         result_partition_ids.push_back(region_ptr->partition_id());
         int64_t table_id = region_ptr->table_id();
-        TableManager::get_instance()->erase_region(table_id, drop_region_id, 
-                region_ptr->start_key());
+        TableManager::get_instance()->erase_region(table_id, 
+                region_ptr->partition_id(), drop_region_id, region_ptr->start_key());
         result_table_ids.push_back(table_id);
         result_start_keys.push_back(region_ptr->start_key());
         result_end_keys.push_back(region_ptr->end_key());
@@ -101,6 +101,7 @@ void SchemaManager::process_schema_info(google::protobuf::RpcController* control
     case pb::OP_UPDATE_BYTE_SIZE: 
     case pb::OP_UPDATE_SPLIT_LINES: 
     case pb::OP_UPDATE_SCHEMA_CONF: 
+    case pb::OP_UPDATE_STATISTICS:
     case pb::OP_UPDATE_DISTS:
     case pb::OP_MODIFY_RESOURCE_TAG: 
     case pb::OP_ADD_INDEX:
@@ -128,6 +129,12 @@ void SchemaManager::process_schema_info(google::protobuf::RpcController* control
                     "no schema_conf", request->op_type(), log_id);
             return;
         }
+        if (request->op_type() == pb::OP_UPDATE_STATISTICS
+                && !request->table_info().has_statistics()) {
+            ERROR_SET_RESPONSE(response, pb::INPUT_PARAM_ERROR,
+                    "no statistics", request->op_type(), log_id);
+            return;
+        }
         if (request->op_type() == pb::OP_RENAME_TABLE
                 && !request->table_info().has_new_table_name()) {
             ERROR_SET_RESPONSE(response, pb::INPUT_PARAM_ERROR,
@@ -257,6 +264,13 @@ void SchemaManager::process_leader_heartbeat_for_store(const pb::StoreHeartBeatR
         response->set_leader(butil::endpoint2str(_meta_state_machine->get_leader()).c_str());
         return;
     }
+    if (request->incremental() 
+            && !RegionManager::get_instance()->has_instance_leader_count(request->instance_info().address())) {
+        //没有该store的全量基线，未上报的region状态无法确认，要求store下次发全量心跳
+        DB_WARNING("store: %s send incremental heartbeat without full heartbeat, log_id: %lu",
+                    request->instance_info().address().c_str(), log_id);
+        response->set_need_full_heartbeat(true);
+    }
     TimeCost step_time_cost;
     RegionManager::get_instance()->update_leader_status(request);
     int64_t update_status_time = step_time_cost.get_time();
@@ -567,7 +581,8 @@ int SchemaManager::pre_process_for_merge_region(const pb::MetaManagerRequest* re
     }
     int64_t table_id = request->region_merge().table_id();
     int64_t dst_region_id = TableManager::get_instance()->get_next_region_id(
-                        table_id, request->region_merge().src_start_key(), 
+                        table_id, src_region->partition_id(),
+                        request->region_merge().src_start_key(), 
                         request->region_merge().src_end_key());
     if (dst_region_id <= 0) {
         DB_FATAL("can`t find dst merge region request: %s, src region id:%ld, log_id:%ld",
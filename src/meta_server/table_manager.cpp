@@ -22,6 +22,8 @@
 #include "cluster_manager.h"
 #include "meta_util.h"
 #include "meta_rocksdb.h"
+#include "type_utils.h"
+#include "compact_row.h"
 
 namespace baikaldb {
 DECLARE_int32(concurrency_num);
@@ -362,6 +364,15 @@ void TableManager::create_table(const pb::MetaManagerRequest& request, const int
         IF_DONE_SET_RESPONSE(done, pb::INPUT_PARAM_ERROR, "index not illegal");
         return;
     }
+    if (!table_mem.whether_level_table && table_info.partition_num() > 1) {
+        ret = alloc_partition_info(table_info, table_mem);
+        if (ret < 0) {
+            DB_WARNING("table:%s 's partition info not illegal", table_name.c_str());
+            IF_DONE_SET_RESPONSE(done, pb::INPUT_PARAM_ERROR, "partition not illegal");
+            return;
+        }
+    }
+    update_row_layouts(table_info);
     table_mem.schema_pb = table_info;
     //发起交互， 层次表与非层次表区分对待，非层次表需要与store交互，创建第一个region
     //层级表直接继承后父层次的相关信息即可
@@ -643,11 +654,32 @@ void TableManager::update_schema_conf(const pb::MetaManagerRequest& request,
         if (schema_conf.has_storage_compute_separate()) {
             p_conf->set_storage_compute_separate(schema_conf.storage_compute_separate());
         }
+        if (schema_conf.has_write_combine()) {
+            p_conf->set_write_combine(schema_conf.write_combine());
+        }
         
         mem_schema_pb.set_version(mem_schema_pb.version() + 1);
     });
 }
 
+void TableManager::update_statistics(const pb::MetaManagerRequest& request,
+                                     const int64_t apply_index,
+                                     braft::Closure* done) {
+    update_table_internal(request, apply_index, done, 
+    [](const pb::MetaManagerRequest& request, pb::SchemaInfo& mem_schema_pb) {
+        // 统计信息有自己的版本，不修改schema版本，避免每次analyze都让各模块重建表信息
+        int64_t statistics_version = mem_schema_pb.statistics().version() + 1;
+        pb::TableStatistics* statistics = mem_schema_pb.mutable_statistics();
+        statistics->CopyFrom(request.table_info().statistics());
+        statistics->set_table_id(mem_schema_pb.table_id());
+        statistics->set_version(statistics_version);
+        // hll只用于合并各region，不需要下发
+        for (auto& index_stat : *statistics->mutable_indexes()) {
+            index_stat.clear_hll();
+        }
+    });
+}
+
 void TableManager::update_resource_tag(const pb::MetaManagerRequest& request, 
                                        const int64_t apply_index, 
                                        braft::Closure* done) {
@@ -984,9 +1016,11 @@ void TableManager::check_update_or_drop_table(
         if (_table_info_map[table_id].is_global_index) {
             continue;
         }
-        //表更新
-        if (_table_info_map[table_id].schema_pb.version() > schema_heart_beat.version()) {
-            *(response->add_schema_change_info()) = _table_info_map[table_id].schema_pb;
+        //表更新或统计信息更新
+        auto& schema_pb = _table_info_map[table_id].schema_pb;
+        if (schema_pb.version() > schema_heart_beat.version()
+                || schema_pb.statistics().version() > schema_heart_beat.statistics_version()) {
+            *(response->add_schema_change_info()) = schema_pb;
         }
     }
 }
@@ -1108,6 +1142,8 @@ int TableManager::write_schema_for_not_level(TableMem& table_mem,
             global_index[index.index_name()] = index.index_id();
         }
     }
+    //每个分区都要建region，先保存索引id，避免第二个分区取不到
+    std::unordered_map<std::string, int64_t> index_ids = global_index;
     //有split_key的索引先处理
     for (auto i = 0; i < table_mem.schema_pb.partition_num() && 
             (table_mem.schema_pb.engine() == pb::ROCKSDB ||
@@ -1118,7 +1154,7 @@ int TableManager::write_schema_for_not_level(TableMem& table_mem,
                 pb::InitRegion init_region_request;
                 pb::RegionInfo* region_info = init_region_request.mutable_region_info();
                 region_info->set_region_id(++tmp_max_region_id);
-                region_info->set_table_id(global_index[index_name]);
+                region_info->set_table_id(index_ids[index_name]);
                 region_info->set_main_table_id(main_table_id);
                 region_info->set_table_name(table_mem.schema_pb.table_name());
                 construct_common_region(region_info, table_mem.schema_pb.replica_num());
@@ -1365,9 +1401,9 @@ int TableManager::write_schema_for_level(const TableMem& table_mem,
 
 
 int TableManager::update_schema_for_rocksdb(int64_t table_id,
-                                               const pb::SchemaInfo& schema_info,
+                                               pb::SchemaInfo& schema_info,
                                                braft::Closure* done) {
-    
+    update_row_layouts(schema_info);
     std::string table_value;
     if (!schema_info.SerializeToString(&table_value)) {
         DB_WARNING("request serializeToArray fail when update upper table, request:%s", 
@@ -1385,6 +1421,32 @@ int TableManager::update_schema_for_rocksdb(int64_t table_id,
     return 0;
 }
 
+// 非主键字段或类型变化时追加layout，存量表在下一次修改schema时记录当前layout
+// store只在找到当前版本的layout时才写紧凑格式，所以不需要补记更早的版本
+void TableManager::update_row_layouts(pb::SchemaInfo& schema_info) {
+    std::string layout;
+    if (CompactRowCodec::build_layout(schema_info, &layout) != 0) {
+        DB_WARNING("build row layout fail, table_id: %ld", schema_info.table_id());
+        return;
+    }
+    int size = schema_info.row_layouts_size();
+    if (size > 0) {
+        const pb::RowLayout& last = schema_info.row_layouts(size - 1);
+        if (last.layout() == layout) {
+            return;
+        }
+        // 同一版本已经可能按旧layout写入，不能改
+        if (last.version() >= schema_info.version()) {
+            DB_WARNING("row layout changed without new version, table_id: %ld, version: %ld",
+                    schema_info.table_id(), schema_info.version());
+            return;
+        }
+    }
+    pb::RowLayout* row_layout = schema_info.add_row_layouts();
+    row_layout->set_version(schema_info.version());
+    row_layout->set_layout(layout);
+}
+
 void TableManager::send_drop_table_request(const std::string& namespace_name,
                              const std::string& database,
                              const std::string& table_name) {
@@ -1531,8 +1593,9 @@ int TableManager::alloc_index_id(pb::SchemaInfo& table_info, TableMem& table_mem
         }
         has_primary_key = true;
         table_info.mutable_indexs(i)->set_index_id(table_info.table_id());
-        //有partition的表的主键不能是联合主键
-        if (!table_mem.whether_level_table && table_info.partition_num() != 1) {
+        //没有指定分区规则的partition表按主键取模，主键不能是联合主键
+        if (!table_mem.whether_level_table && table_info.partition_num() != 1
+                && !table_info.has_partition_info()) {
             if (table_info.indexs(i).field_names_size() > 1) {
                 DB_WARNING("table:%s has partition_num, but not meet our rule", table_name.c_str());
                 return -1;
@@ -1555,14 +1618,73 @@ int TableManager::alloc_index_id(pb::SchemaInfo& table_info, TableMem& table_mem
     return 0;
 }
 
-int64_t TableManager::get_pre_regionid(int64_t table_id, 
+int TableManager::alloc_partition_info(pb::SchemaInfo& table_info, TableMem& table_mem) {
+    std::string table_name = table_info.table_name();
+    pb::PartitionInfo* partition_info = table_info.mutable_partition_info();
+    if (!partition_info->has_field_name()) {
+        //老的partition_num建表方式，按自增主键取模
+        for (auto& index : table_info.indexs()) {
+            if (index.index_type() == pb::I_PRIMARY) {
+                partition_info->set_field_name(index.field_names(0));
+            }
+        }
+        partition_info->set_type(pb::PT_HASH);
+    }
+    auto iter = table_mem.field_id_map.find(partition_info->field_name());
+    if (iter == table_mem.field_id_map.end()) {
+        DB_WARNING("table:%s partition field:%s not exist", 
+                    table_name.c_str(), partition_info->field_name().c_str());
+        return -1;
+    }
+    partition_info->set_field_id(iter->second);
+    for (auto& field : table_info.fields()) {
+        if (field.field_id() != iter->second) {
+            continue;
+        }
+        pb::PrimitiveType type = field.mysql_type();
+        if (!is_int(type) && type != pb::DATETIME && type != pb::TIMESTAMP 
+                && type != pb::DATE && type != pb::TIME) {
+            DB_WARNING("table:%s partition field type:%d not support", table_name.c_str(), type);
+            return -1;
+        }
+    }
+    //分区内才能保证唯一，分区列必须是主键和所有唯一索引的一部分
+    for (auto& index : table_info.indexs()) {
+        if (index.index_type() != pb::I_PRIMARY && index.index_type() != pb::I_UNIQ) {
+            continue;
+        }
+        bool found = false;
+        for (auto field_id : index.field_ids()) {
+            if (field_id == partition_info->field_id()) {
+                found = true;
+            }
+        }
+        if (!found) {
+            DB_WARNING("table:%s index:%s must include partition field:%s", table_name.c_str(), 
+                        index.index_name().c_str(), partition_info->field_name().c_str());
+            return -1;
+        }
+    }
+    if (partition_info->type() == pb::PT_RANGE) {
+        int64_t bound_size = partition_info->range_bounds_size();
+        if (bound_size != table_info.partition_num() 
+                && bound_size != table_info.partition_num() - 1) {
+            DB_WARNING("table:%s range bounds size:%ld not match partition_num:%ld",
+                        table_name.c_str(), bound_size, table_info.partition_num());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int64_t TableManager::get_pre_regionid(int64_t table_id, int64_t partition_id, 
                                             const std::string& start_key) {
     BAIDU_SCOPED_LOCK(_table_mutex);
     if (_table_info_map.find(table_id) == _table_info_map.end()) {
         DB_FATAL("table_id: %ld not exist", table_id);
         return -1;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     if (startkey_regiondesc_map.size() <= 0) {
         DB_FATAL("table_id:%ld map empty", table_id);
         return -1;
@@ -1586,14 +1708,14 @@ int64_t TableManager::get_pre_regionid(int64_t table_id,
     return iter->second.region_id;
 }
 
-int64_t TableManager::get_startkey_regionid(int64_t table_id, 
+int64_t TableManager::get_startkey_regionid(int64_t table_id, int64_t partition_id, 
                                        const std::string& start_key) {
     BAIDU_SCOPED_LOCK(_table_mutex);
     if (_table_info_map.find(table_id) == _table_info_map.end()) {
         DB_FATAL("table_id: %ld not exist", table_id);
         return -1;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     if (startkey_regiondesc_map.size() <= 0) {
         DB_FATAL("table_id:%ld map empty", table_id);
         return -1;
@@ -1609,13 +1731,14 @@ int64_t TableManager::get_startkey_regionid(int64_t table_id,
     return iter->second.region_id;
 }
 
-int TableManager::erase_region(int64_t table_id, int64_t region_id, std::string start_key) {
+int TableManager::erase_region(int64_t table_id, int64_t partition_id, 
+                               int64_t region_id, std::string start_key) {
     BAIDU_SCOPED_LOCK(_table_mutex);
     if (_table_info_map.find(table_id) == _table_info_map.end()) {
         DB_FATAL("table_id: %ld not exist", table_id);
         return -1;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     auto iter = startkey_regiondesc_map.find(start_key);
     if (iter == startkey_regiondesc_map.end()) {
         DB_FATAL("table_id:%ld can`t find region id start_key:%s",
@@ -1633,14 +1756,14 @@ int TableManager::erase_region(int64_t table_id, int64_t region_id, std::string
     return 0;
 }
 
-int64_t TableManager::get_next_region_id(int64_t table_id, std::string start_key, 
-                                        std::string end_key) {
+int64_t TableManager::get_next_region_id(int64_t table_id, int64_t partition_id, 
+                                        std::string start_key, std::string end_key) {
     BAIDU_SCOPED_LOCK(_table_mutex);
     if (_table_info_map.find(table_id) == _table_info_map.end()) {
         DB_FATAL("table_id: %ld not exist", table_id);
         return -1;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     auto iter = startkey_regiondesc_map.find(start_key);
     if (iter == startkey_regiondesc_map.end()) {
         DB_FATAL("table_id:%ld can`t find region id start_key:%s",
@@ -1684,49 +1807,51 @@ int TableManager::check_startkey_regionid_map() {
     BAIDU_SCOPED_LOCK(_table_mutex);
     for (auto table_info : _table_info_map) {
         int64_t table_id = table_info.first;
-        SmartRegionInfo pre_region;
-        bool is_first_region = true;
-        auto& startkey_regiondesc_map = table_info.second.startkey_regiondesc_map;
-        for (auto iter = startkey_regiondesc_map.begin(); iter != startkey_regiondesc_map.end(); iter++) {
-            if (is_first_region == true) {
-                //首个region
-                auto first_region = RegionManager::get_instance()->
-                                    get_region_info(iter->second.region_id);
-                if (first_region == nullptr) {
+        for (auto& partition_regions : table_info.second.startkey_regiondesc_map) {
+            SmartRegionInfo pre_region;
+            bool is_first_region = true;
+            auto& startkey_regiondesc_map = partition_regions.second;
+            for (auto iter = startkey_regiondesc_map.begin(); iter != startkey_regiondesc_map.end(); iter++) {
+                if (is_first_region == true) {
+                    //首个region
+                    auto first_region = RegionManager::get_instance()->
+                                        get_region_info(iter->second.region_id);
+                    if (first_region == nullptr) {
+                        DB_FATAL("table_id:%ld, can`t find region_id:%ld start_key:%s, in region info map", 
+                                 table_id, iter->second.region_id, str_to_hex(iter->first).c_str());
+                        continue;
+                    }
+                    DB_WARNING("table_id:%ld, first region_id:%ld, version:%d, key(%s, %s)",
+                               table_id, first_region->region_id(), first_region->version(), 
+                               str_to_hex(first_region->start_key()).c_str(), 
+                               str_to_hex(first_region->end_key()).c_str());
+                    pre_region = first_region;
+                    is_first_region = false;
+                    continue;
+                }
+                auto cur_region = RegionManager::get_instance()->
+                                     get_region_info(iter->second.region_id); 
+                if (cur_region == nullptr) {
                     DB_FATAL("table_id:%ld, can`t find region_id:%ld start_key:%s, in region info map", 
                              table_id, iter->second.region_id, str_to_hex(iter->first).c_str());
+                    is_first_region = true;
                     continue;
                 }
-                DB_WARNING("table_id:%ld, first region_id:%ld, version:%d, key(%s, %s)",
-                           table_id, first_region->region_id(), first_region->version(), 
-                           str_to_hex(first_region->start_key()).c_str(), 
-                           str_to_hex(first_region->end_key()).c_str());
-                pre_region = first_region;
-                is_first_region = false;
-                continue;
-            }
-            auto cur_region = RegionManager::get_instance()->
-                                 get_region_info(iter->second.region_id); 
-            if (cur_region == nullptr) {
-                DB_FATAL("table_id:%ld, can`t find region_id:%ld start_key:%s, in region info map", 
-                         table_id, iter->second.region_id, str_to_hex(iter->first).c_str());
-                is_first_region = true;
-                continue;
-            }
-            if (pre_region->end_key() != cur_region->start_key()) {
-                DB_FATAL("table_id:%ld, key nonsequence (region_id, version, "
-                         "start_key, end_key) pre vs cur (%ld, %ld, %s, %s) vs "
-                         "(%ld, %ld, %s, %s)", table_id, 
-                         pre_region->region_id(), pre_region->version(), 
-                         str_to_hex(pre_region->start_key()).c_str(), 
-                         str_to_hex(pre_region->end_key()).c_str(), 
-                         cur_region->region_id(), cur_region->version(), 
-                         str_to_hex(cur_region->start_key()).c_str(), 
-                         str_to_hex(cur_region->end_key()).c_str());
-                is_first_region = true;
-                continue;
+                if (pre_region->end_key() != cur_region->start_key()) {
+                    DB_FATAL("table_id:%ld, key nonsequence (region_id, version, "
+                             "start_key, end_key) pre vs cur (%ld, %ld, %s, %s) vs "
+                             "(%ld, %ld, %s, %s)", table_id, 
+                             pre_region->region_id(), pre_region->version(), 
+                             str_to_hex(pre_region->start_key()).c_str(), 
+                             str_to_hex(pre_region->end_key()).c_str(), 
+                             cur_region->region_id(), cur_region->version(), 
+                             str_to_hex(cur_region->start_key()).c_str(), 
+                             str_to_hex(cur_region->end_key()).c_str());
+                    is_first_region = true;
+                    continue;
+                }
+                pre_region = cur_region;
             }
-            pre_region = cur_region;
         }
     }
     DB_WARNING("check finish timecost:%ld", time_cost.get_time());
@@ -1750,7 +1875,7 @@ int TableManager::add_startkey_regionid_map(const pb::RegionInfo& region_info) {
     region.region_id = region_id;
     region.merge_status = MERGE_IDLE;
     std::map<std::string, RegionDesc>& key_region_map
-        = _table_info_map[table_id].startkey_regiondesc_map;
+        = _table_info_map[table_id].startkey_regiondesc_map[region_info.partition_id()];
     if (key_region_map.find(region_info.start_key()) == key_region_map.end()) {
         key_region_map[region_info.start_key()] = region;
     } else {
@@ -1768,7 +1893,7 @@ int TableManager::add_startkey_regionid_map(const pb::RegionInfo& region_info) {
     }
     return 0;
 }
-bool TableManager::check_region_when_update(int64_t table_id, 
+bool TableManager::check_region_when_update(int64_t table_id, int64_t partition_id, 
                                     std::string min_start_key, 
                                     std::string max_end_key) {
     BAIDU_SCOPED_LOCK(_table_mutex);
@@ -1776,7 +1901,7 @@ bool TableManager::check_region_when_update(int64_t table_id,
         DB_FATAL("table_id: %ld not exist", table_id);
         return false;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     if (startkey_regiondesc_map.size() == 0) {
         //首个region
         DB_WARNING("table_id:%ld min_start_key:%s, max_end_key:%s", table_id,
@@ -1799,14 +1924,14 @@ bool TableManager::check_region_when_update(int64_t table_id,
     }
     return true;
 }
-void TableManager::update_startkey_regionid_map_old_pb(int64_t table_id, 
+void TableManager::update_startkey_regionid_map_old_pb(int64_t table_id, int64_t partition_id, 
                           std::map<std::string, int64_t>& key_id_map) {
     BAIDU_SCOPED_LOCK(_table_mutex);
     if (_table_info_map.find(table_id) == _table_info_map.end()) {
         DB_FATAL("table_id: %ld not exist", table_id);
         return;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     for (auto& key_id : key_id_map) {
         RegionDesc region;
         region.region_id = key_id.second;
@@ -1817,15 +1942,15 @@ void TableManager::update_startkey_regionid_map_old_pb(int64_t table_id,
     }
 }
 
-void TableManager::update_startkey_regionid_map(int64_t table_id, std::string min_start_key, 
-                                  std::string max_end_key, 
+void TableManager::update_startkey_regionid_map(int64_t table_id, int64_t partition_id, 
+                                  std::string min_start_key, std::string max_end_key, 
                                   std::map<std::string, int64_t>& key_id_map) {
     BAIDU_SCOPED_LOCK(_table_mutex);
     if (_table_info_map.find(table_id) == _table_info_map.end()) {
         DB_FATAL("table_id: %ld not exist", table_id);
         return;
     }
-    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map;
+    auto& startkey_regiondesc_map = _table_info_map[table_id].startkey_regiondesc_map[partition_id];
     if (startkey_regiondesc_map.size() == 0) {
         //首个region加入
         for (auto& key_id : key_id_map) {
@@ -1873,7 +1998,8 @@ void TableManager::add_new_region(const pb::RegionInfo& leader_region_info) {
         return;
     }
     _need_apply_raft_table_ids.insert(table_id);
-    auto& key_region_map = _table_info_map[table_id].startkey_newregion_map;
+    auto& key_region_map = 
+        _table_info_map[table_id].startkey_newregion_map[leader_region_info.partition_id()];
     auto iter = key_region_map.find(start_key);
     if (iter != key_region_map.end()) {
         auto origin_region_info = iter->second;
@@ -2073,8 +2199,6 @@ int TableManager::get_presplit_regions(int64_t table_id,
 
 void TableManager::get_update_region_requests(int64_t table_id, TableMem& table_info, 
                                 std::vector<pb::MetaManagerRequest>& requests) {
-    auto& startkey_regiondesc_map  = table_info.startkey_regiondesc_map;
-    auto& key_newregion_map = table_info.startkey_newregion_map;
     auto& id_noneregion_map = table_info.id_noneregion_map;
     auto& id_keyregion_map  = table_info.id_keyregion_map;
     //已经没有发生变化的region，startkey_newregion_map和id_noneregion_map可清空
@@ -2111,9 +2235,12 @@ void TableManager::get_update_region_requests(int64_t table_id, TableMem& table_
                 && ptr_region->end_key() < master_region->start_key()) {
             continue;
         }
+        //分区表各分区的key空间独立，只在region所属分区内拼接
+        int64_t partition_id = ptr_region->partition_id();
         ret = get_merge_regions(table_id, ptr_region->start_key(), 
                                 master_region->start_key(), 
-                                startkey_regiondesc_map, id_noneregion_map, regions);
+                                table_info.startkey_regiondesc_map[partition_id], 
+                                id_noneregion_map, regions);
         if (ret < 0) {
             DB_WARNING("table_id:%ld, region_id:%ld get merge region failed",
                        table_id, region_id);
@@ -2122,7 +2249,7 @@ void TableManager::get_update_region_requests(int64_t table_id, TableMem& table_
         regions.push_back(ptr_region);
         ret = get_split_regions(table_id, ptr_region->end_key(), 
                                 master_region->end_key(), 
-                                key_newregion_map, regions);
+                                table_info.startkey_newregion_map[partition_id], regions);
         if (ret < 0) {
             DB_WARNING("table_id:%ld, region_id:%ld get split region failed",
                        table_id, region_id);
@@ -2143,10 +2270,10 @@ void TableManager::recycle_update_region() {
     {
         BAIDU_SCOPED_LOCK(_table_mutex);
         for (auto& table_info : _table_info_map) {
-            auto& key_newregion_map = table_info.second.startkey_newregion_map;
+            auto& partition_newregion_map = table_info.second.startkey_newregion_map;
             auto& id_noneregion_map = table_info.second.id_noneregion_map;
             auto& id_keyregion_map  = table_info.second.id_keyregion_map;
-            auto& startkey_regiondesc_map  = table_info.second.startkey_regiondesc_map;
+            auto& partition_regiondesc_map  = table_info.second.startkey_regiondesc_map;
             
             for (auto iter = id_keyregion_map.begin(); iter != id_keyregion_map.end(); ) {
                 auto cur_iter = iter++;
@@ -2171,21 +2298,32 @@ void TableManager::recycle_update_region() {
                 }
             }
             
-            if (startkey_regiondesc_map.size() == 0 && id_keyregion_map.size() == 0 
-                    && key_newregion_map.size() != 0 && id_noneregion_map.size() == 0) {
-                //如果该table没有region，但是存在store上报的新region，为预分裂region，特殊处理
-                pb::MetaManagerRequest request;
-                request.set_op_type(pb::OP_UPDATE_REGION);
-                auto ret = get_presplit_regions(table_info.first, key_newregion_map, request);
-                if (ret < 0) {
-                    continue;
+            bool has_presplit = false;
+            if (id_keyregion_map.size() == 0 && id_noneregion_map.size() == 0) {
+                for (auto& partition_newregion : partition_newregion_map) {
+                    auto& key_newregion_map = partition_newregion.second;
+                    auto desc_iter = partition_regiondesc_map.find(partition_newregion.first);
+                    if (key_newregion_map.size() == 0 || (desc_iter != partition_regiondesc_map.end()
+                            && desc_iter->second.size() != 0)) {
+                        continue;
+                    }
+                    //如果该分区没有region，但是存在store上报的新region，为预分裂region，特殊处理
+                    has_presplit = true;
+                    pb::MetaManagerRequest request;
+                    request.set_op_type(pb::OP_UPDATE_REGION);
+                    auto ret = get_presplit_regions(table_info.first, key_newregion_map, request);
+                    if (ret < 0) {
+                        continue;
+                    }
+                    requests.push_back(request);
                 }
-                requests.push_back(request);
+            }
+            if (has_presplit) {
                 continue;
             }
             if (id_keyregion_map.size() == 0) {
-                if (key_newregion_map.size() != 0 || id_noneregion_map.size() != 0) {
-                    key_newregion_map.clear();
+                if (partition_newregion_map.size() != 0 || id_noneregion_map.size() != 0) {
+                    partition_newregion_map.clear();
                     id_noneregion_map.clear();
                     DB_WARNING("table_id:%ld tmp map clear", table_info.first);
                 }
@@ -2509,15 +2647,15 @@ void TableManager::add_index(const pb::MetaManagerRequest& request,
     add_index->CopyFrom(index_info);
     mem_schema_pb.set_version(mem_schema_pb.version() + 1);
     _table_info_map[table_id].index_id_map[add_index->index_name()] = add_index->index_id();
-    set_table_pb(mem_schema_pb);
-    std::vector<pb::SchemaInfo> schema_infos{mem_schema_pb};
-    put_incremental_schemainfo(apply_index, schema_infos);
-
+    // 先持久化，update_schema_for_rocksdb可能追加row layout
     auto ret = update_schema_for_rocksdb(table_id, mem_schema_pb, done);
     if (ret < 0) {
         IF_DONE_SET_RESPONSE(done, pb::INTERNAL_ERROR, "write db fail");
         return;
     }
+    set_table_pb(mem_schema_pb);
+    std::vector<pb::SchemaInfo> schema_infos{mem_schema_pb};
+    put_incremental_schemainfo(apply_index, schema_infos);
     DB_DEBUG("DDL_LOG add_index index_info [%s]", add_index->ShortDebugString().c_str());
     DB_NOTICE("DDL_LOG add_index schema_info [%s]", _table_info_map[table_id].schema_pb.ShortDebugString().c_str());
     //持久化ddlwork
@@ -21,7 +21,182 @@
 #include "meta_server_interact.hpp"
 
 namespace baikaldb {
+DEFINE_bool(auto_incr_cache_enable, false, 
+        "allocate auto increment id from local segment cache, ids are unique but not monotonic across baikaldb");
+DEFINE_int64(auto_incr_segment_min_size, 100, "min size of auto increment id segment");
+DEFINE_int64(auto_incr_segment_max_size, 100000, "max size of auto increment id segment");
+DEFINE_int64(auto_incr_segment_target_us, 10 * 1000 * 1000LL, 
+        "expected consume time of one auto increment id segment, used to adjust segment size");
+DEFINE_int32(auto_incr_prefetch_percent, 50, 
+        "prefetch next segment when left ids of current segment lower than this percent");
+
 MetaServerInteract AutoInc::auto_incr_meta_inter;
+ThreadSafeMap<int64_t, SmartAutoIncSegmentCache> AutoInc::_segment_caches;
+
+AutoIncSegmentCache::AutoIncSegmentCache(int64_t table_id, int64_t version, FetchFunc fetch) : 
+        _table_id(table_id),
+        _version(version),
+        _fetch(fetch),
+        _prefetching(false),
+        _segment_size(FLAGS_auto_incr_segment_min_size) {
+    bthread_mutex_init(&_mutex, NULL);
+    if (_fetch == nullptr) {
+        _fetch = [](int64_t table_id, int64_t count, int64_t& start_id, int64_t& end_id) {
+            return AutoInc::gen_id_from_meta(table_id, count, 0, start_id, end_id);
+        };
+    }
+}
+
+int64_t AutoIncSegmentCache::alloc(int64_t count) {
+    // 号段被其他线程用完时继续切换，直到分配成功或者从meta取号段失败
+    while (true) {
+        SmartSegment segment = std::atomic_load(&_current);
+        if (segment != nullptr) {
+            int64_t start_id = segment->next.load();
+            while (start_id + count <= segment->end) {
+                if (segment->next.compare_exchange_weak(start_id, start_id + count)) {
+                    int64_t left = segment->end - start_id - count;
+                    if (left * 100 < segment->size * FLAGS_auto_incr_prefetch_percent) {
+                        async_prefetch();
+                    }
+                    return start_id;
+                }
+            }
+        }
+        if (switch_segment(segment, count) != 0) {
+            return -1;
+        }
+    }
+}
+
+bool AutoIncSegmentCache::skip_to(int64_t max_id) {
+    bool covered = false;
+    BAIDU_SCOPED_LOCK(_mutex);
+    for (auto& segment : {_current, _prefetched}) {
+        if (segment == nullptr) {
+            continue;
+        }
+        // 号段是meta已经分配出去的，max_id小于号段结尾说明meta计数已超过max_id
+        if (max_id < segment->end) {
+            covered = true;
+        }
+        int64_t next = segment->next.load();
+        while (next <= max_id && !segment->next.compare_exchange_weak(next, max_id + 1)) {
+        }
+    }
+    return covered;
+}
+
+AutoIncSegmentCache::SmartSegment AutoIncSegmentCache::fetch_segment(int64_t count) {
+    int64_t start_id = 0;
+    int64_t end_id = 0;
+    if (_fetch(_table_id, count, start_id, end_id) != 0) {
+        return nullptr;
+    }
+    return std::make_shared<Segment>(start_id, end_id);
+}
+
+// 同步取号段时持有_mutex跨越meta rpc：号段用完后其他分配线程本来就要等新号段，
+// 加锁保证只有一个线程去meta取号段；期间skip_to和预取结果的写入也会等这次rpc返回
+int AutoIncSegmentCache::switch_segment(const SmartSegment& exhausted, int64_t count) {
+    BAIDU_SCOPED_LOCK(_mutex);
+    if (std::atomic_load(&_current) != exhausted) {
+        // 其他线程已经切换过号段
+        return 0;
+    }
+    adjust_segment_size();
+    SmartSegment segment;
+    if (_prefetched != nullptr && _prefetched->next.load() + count <= _prefetched->end) {
+        segment = _prefetched;
+    } else {
+        segment = fetch_segment(std::max(_segment_size.load(), count));
+        if (segment == nullptr) {
+            return -1;
+        }
+    }
+    _prefetched.reset();
+    std::atomic_store(&_current, segment);
+    _segment_time.reset();
+    return 0;
+}
+
+void AutoIncSegmentCache::adjust_segment_size() {
+    if (_current == nullptr) {
+        return;
+    }
+    // 号段消耗过快则翻倍，过慢则减半，使每个号段大约使用auto_incr_segment_target_us
+    int64_t size = _segment_size.load();
+    int64_t cost = _segment_time.get_time();
+    if (cost < FLAGS_auto_incr_segment_target_us / 2) {
+        size = std::min(size * 2, FLAGS_auto_incr_segment_max_size);
+    } else if (cost > FLAGS_auto_incr_segment_target_us * 2) {
+        size = std::max(size / 2, FLAGS_auto_incr_segment_min_size);
+    }
+    _segment_size.store(size);
+}
+
+void AutoIncSegmentCache::async_prefetch() {
+    bool expected = false;
+    if (!_prefetching.compare_exchange_strong(expected, true)) {
+        return;
+    }
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        if (_prefetched != nullptr) {
+            _prefetching.store(false);
+            return;
+        }
+    }
+    // 持有shared_ptr避免预取过程中被释放
+    SmartAutoIncSegmentCache self = shared_from_this();
+    Bthread bth(&BTHREAD_ATTR_SMALL);
+    bth.run([self]() {
+        SmartSegment segment = self->fetch_segment(self->_segment_size.load());
+        if (segment == nullptr) {
+            DB_WARNING("prefetch auto increment segment fail, table_id: %ld", self->_table_id);
+        } else {
+            BAIDU_SCOPED_LOCK(self->_mutex);
+            self->_prefetched = segment;
+        }
+        self->_prefetching.store(false);
+    });
+}
+
+int AutoInc::gen_id_from_meta(int64_t table_id, int64_t count, int64_t max_id,
+        int64_t& start_id, int64_t& end_id) {
+    pb::MetaManagerRequest request;
+    pb::MetaManagerResponse response;
+    request.set_op_type(pb::OP_GEN_ID_FOR_AUTO_INCREMENT);
+    auto auto_increment_ptr = request.mutable_auto_increment();
+    auto_increment_ptr->set_table_id(table_id);
+    auto_increment_ptr->set_count(count);
+    auto_increment_ptr->set_start_id(max_id);
+    if (AutoInc::auto_incr_meta_inter.send_request("meta_manager", 
+                                                          request, 
+                                                          response) != 0) {
+        DB_FATAL("gen id from meta_server fail, table_id: %ld", table_id);
+        return -1; 
+    }
+    start_id = response.start_id();
+    end_id = response.end_id();
+    if (end_id - start_id != count) {
+        DB_FATAL("gen id count not equal to request id count, table_id: %ld, "
+                "start_id: %ld, end_id: %ld, count: %ld", table_id, start_id, end_id, count);
+        return -1;
+    }
+    return 0;
+}
+
+SmartAutoIncSegmentCache AutoInc::get_segment_cache(int64_t table_id, int64_t version) {
+    SmartAutoIncSegmentCache cache = _segment_caches.get(table_id);
+    // 表结构变化(如修改auto_increment起始值)后, 丢弃旧号段
+    if (cache == nullptr || cache->version() != version) {
+        cache = std::make_shared<AutoIncSegmentCache>(table_id, version);
+        _segment_caches.set(table_id, cache);
+    }
+    return cache;
+}
+
 int AutoInc::analyze(QueryContext* ctx) {
     ExecNode* plan = ctx->root;
     if (ctx->insert_records.size() == 0) {
@@ -37,7 +212,7 @@ int AutoInc::analyze(QueryContext* ctx) {
     if (table_info_ptr == nullptr || table_info_ptr->auto_inc_field_id == -1) {
         return 0;
     }
-    int auto_id_count = 0;
+    int64_t auto_id_count = 0;
     int64_t max_id = 0;
     for (auto& record : ctx->insert_records) {
             auto field = record->get_field_by_tag(table_info_ptr->auto_inc_field_id);
@@ -55,25 +230,36 @@ int AutoInc::analyze(QueryContext* ctx) {
     if (auto_id_count == 0 && max_id == 0) {
         return 0;
     }
-    // 请求meta来获取自增id
-    pb::MetaManagerRequest request;
-    pb::MetaManagerResponse response;
-    request.set_op_type(pb::OP_GEN_ID_FOR_AUTO_INCREMENT);
-    auto auto_increment_ptr = request.mutable_auto_increment();
-    auto_increment_ptr->set_table_id(table_id);
-    auto_increment_ptr->set_count(auto_id_count);
-    auto_increment_ptr->set_start_id(max_id);
-    if (AutoInc::auto_incr_meta_inter.send_request("meta_manager", 
-                                                          request, 
-                                                          response) != 0) {
-        DB_FATAL("gen id from meta_server fail, sql:%s", ctx->sql.c_str());
-        return -1; 
-    }
-    
-    if (auto_id_count == 0) {
-        return 0;
+    int64_t start_id = 0;
+    if (FLAGS_auto_incr_cache_enable && auto_id_count <= FLAGS_auto_incr_segment_max_size) {
+        auto cache = get_segment_cache(table_id, table_info_ptr->version);
+        // 显式指定的id超出本地已分配号段时才需要通知meta
+        if (max_id > 0 && !cache->skip_to(max_id)) {
+            int64_t end_id = 0;
+            if (gen_id_from_meta(table_id, 0, max_id, start_id, end_id) != 0) {
+                DB_FATAL("update auto increment id fail, sql:%s", ctx->sql.c_str());
+                return -1;
+            }
+        }
+        if (auto_id_count == 0) {
+            return 0;
+        }
+        start_id = cache->alloc(auto_id_count);
+        if (start_id < 0) {
+            DB_FATAL("alloc id from auto increment segment fail, sql:%s", ctx->sql.c_str());
+            return -1;
+        }
+    } else {
+        // 请求meta来获取自增id
+        int64_t end_id = 0;
+        if (gen_id_from_meta(table_id, auto_id_count, max_id, start_id, end_id) != 0) {
+            DB_FATAL("gen id from meta_server fail, sql:%s", ctx->sql.c_str());
+            return -1;
+        }
+        if (auto_id_count == 0) {
+            return 0;
+        }
     }
-    int64_t start_id = response.start_id();
     auto client = ctx->runtime_state.client_conn();
     client->last_insert_id = start_id;
     for (auto& record : ctx->insert_records) {
@@ -85,10 +271,6 @@ int AutoInc::analyze(QueryContext* ctx) {
             record->set_value(field, value);
         }
     }
-    if (start_id != (int64_t)response.end_id()) {
-        DB_FATAL("gen id count not equal to request id count, sql:%s", ctx->sql.c_str());
-        return -1;
-    }
     return 0;
 }
 }
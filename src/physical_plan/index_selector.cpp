@@ -21,6 +21,9 @@
 #include "parser.h"
 
 namespace baikaldb {
+DEFINE_bool(index_select_use_statistics, true, "use table statistics to choose index if analyzed");
+DEFINE_double(index_back_lookup_cost, 4.0, "cost ratio of looking up primary by non-covering index");
+
 int IndexSelector::analyze(QueryContext* ctx) {
     ExecNode* root = ctx->root;
     std::vector<ExecNode*> scan_nodes;
@@ -449,6 +452,9 @@ int IndexSelector::index_selector(const std::function<int32_t(int32_t, int32_t)>
         pos_index->set_index_id(table_id);
         pos_index->add_ranges();
     }
+    if (FLAGS_index_select_use_statistics && table_info->statistics != nullptr) {
+        estimate_index_cost(ctx, scan_node);
+    }
     // 单表纯kv类优化，只主键索引时候过滤掉in条件
     if (join_node == NULL &&
         pb_scan_node->indexes_size() == 1 && 
@@ -461,6 +467,122 @@ int IndexSelector::index_selector(const std::function<int32_t(int32_t, int32_t)>
     return 0;
 }
 
+int64_t IndexSelector::estimate_range_rows(int64_t table_id, IndexInfo& index_info,
+        const pb::IndexStatistics& statistics, const pb::PossibleIndex::Range& range) {
+    SchemaFactory* schema_factory = SchemaFactory::get_instance();
+    int left_field_cnt = range.left_field_cnt();
+    int right_field_cnt = range.right_field_cnt();
+    MutTableKey left_key;
+    MutTableKey right_key;
+    if (left_field_cnt > 0) {
+        SmartRecord left_record = schema_factory->new_record(table_id);
+        left_record->decode(range.left_pb_record());
+        if (left_record->encode_key(index_info, left_key, left_field_cnt, 
+                false, range.like_prefix()) != 0) {
+            return statistics.row_count();
+        }
+    }
+    if (right_field_cnt > 0) {
+        SmartRecord right_record = schema_factory->new_record(table_id);
+        right_record->decode(range.right_pb_record());
+        if (right_record->encode_key(index_info, right_key, right_field_cnt, 
+                false, range.like_prefix()) != 0) {
+            return statistics.row_count();
+        }
+    }
+    if (left_field_cnt == (int)index_info.fields.size() && left_field_cnt == right_field_cnt
+            && !range.like_prefix() && left_key.data() == right_key.data()) {
+        if (index_info.type == pb::I_PRIMARY || index_info.type == pb::I_UNIQ) {
+            return 1;
+        }
+        return TableStatistics::estimate_eq_rows(statistics, left_key.data());
+    }
+    return TableStatistics::estimate_range_rows(statistics, 
+            left_field_cnt > 0 ? left_key.data() : "", 
+            right_field_cnt > 0 ? right_key.data() : "");
+}
+
+void IndexSelector::estimate_index_cost(QueryContext* ctx, ScanNode* scan_node) {
+    int64_t table_id = scan_node->table_id();
+    pb::ScanNode* pb_scan_node = scan_node->mutable_pb_node()->
+        mutable_derive_node()->mutable_scan_node();
+    SchemaFactory* schema_factory = SchemaFactory::get_instance();
+    auto table_info = schema_factory->get_table_info_ptr(table_id);
+    auto pri_info = schema_factory->get_index_info_ptr(table_id);
+    if (table_info == nullptr || table_info->statistics == nullptr || pri_info == nullptr) {
+        return;
+    }
+    // 倒排和推荐索引不参与代价估算；任一候选索引缺少统计信息时保持原有规则
+    for (auto& pos_index : pb_scan_node->indexes()) {
+        auto info_ptr = schema_factory->get_index_info_ptr(pos_index.index_id());
+        if (info_ptr == nullptr || table_info->statistics->get_index_statistics(pos_index.index_id()) == nullptr) {
+            return;
+        }
+        if (info_ptr->type != pb::I_PRIMARY && info_ptr->type != pb::I_UNIQ 
+                && info_ptr->type != pb::I_KEY) {
+            return;
+        }
+    }
+    std::set<int32_t> select_field_ids;
+    pb::TupleDescriptor* tuple_desc = ctx != nullptr ? ctx->get_tuple_desc(scan_node->tuple_id()) : nullptr;
+    if (tuple_desc != nullptr) {
+        for (auto& slot : tuple_desc->slots()) {
+            select_field_ids.insert(slot.field_id());
+        }
+    }
+    double min_cost = -1;
+    bool has_primary = false;
+    for (auto& pos_index : *pb_scan_node->mutable_indexes()) {
+        int64_t index_id = pos_index.index_id();
+        auto info_ptr = schema_factory->get_index_info_ptr(index_id);
+        IndexInfo& index_info = *info_ptr;
+        auto index_stat = table_info->statistics->get_index_statistics(index_id);
+        int64_t rows = 0;
+        for (auto& range : pos_index.ranges()) {
+            rows += estimate_range_rows(table_id, index_info, *index_stat, range);
+        }
+        if (pos_index.ranges_size() == 0) {
+            rows = index_stat->row_count();
+        }
+        bool covering = true;
+        if (index_info.type == pb::I_PRIMARY) {
+            has_primary = true;
+        } else {
+            // 没有tuple信息时按需要回表计算
+            covering = tuple_desc != nullptr;
+            for (auto field_id : select_field_ids) {
+                bool found = false;
+                for (auto& f : index_info.fields) {
+                    found = found || f.id == field_id;
+                }
+                for (auto& f : pri_info->fields) {
+                    found = found || f.id == field_id;
+                }
+                if (!found) {
+                    covering = false;
+                    break;
+                }
+            }
+        }
+        double cost = covering ? rows : rows * FLAGS_index_back_lookup_cost;
+        pos_index.set_estimate_rows(rows);
+        pos_index.set_cost(cost);
+        if (min_cost < 0 || cost < min_cost) {
+            min_cost = cost;
+        }
+    }
+    // 二级索引回表代价比主键全表扫描还高时，加入主键扫描作为候选
+    auto pri_stat = table_info->statistics->get_index_statistics(table_id);
+    if (!has_primary && pb_scan_node->use_indexes_size() == 0 && pri_stat != nullptr
+            && pri_stat->row_count() < min_cost) {
+        pb::PossibleIndex* pos_index = pb_scan_node->add_indexes();
+        pos_index->set_index_id(table_id);
+        pos_index->add_ranges();
+        pos_index->set_estimate_rows(pri_stat->row_count());
+        pos_index->set_cost(pri_stat->row_count());
+    }
+}
+
 bool IndexSelector::check_sort_use_index(const std::function<int32_t(int32_t, int32_t)>& get_slot_id, 
         IndexInfo& index_info, 
         const std::vector<ExprNode*>& order_exprs, 
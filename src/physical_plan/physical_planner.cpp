@@ -106,6 +106,7 @@ int PhysicalPlanner::execute(QueryContext* ctx, DataBuffer* send_buf) {
         return ret;
     }
     if (ctx->is_trace) {
+        state.is_analyze = ctx->is_analyze;
         ctx->trace_node.set_node_type(ctx->root->node_type());
         ctx->root->set_trace(&ctx->trace_node);
         ctx->root->create_trace();
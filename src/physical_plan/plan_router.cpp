@@ -161,6 +161,22 @@ int PlanRouter::scan_plan_router(RocksdbScanNode* scan_node,
     if (primary != nullptr && scan_node->mutable_region_primary()->size() > 0) {
         primary->mutable_ranges()->Clear();
     }
+    //分区表走本地二级索引时没有主键range，按选中索引的range裁剪分区
+    if (primary == nullptr && multi_reverse_index.size() == 0) {
+        std::set<int64_t> partition_ids;
+        auto select_index_ptr = schema_factory->get_index_info_ptr(index_id);
+        if (select_index_ptr != nullptr && schema_factory->get_partition_ids(
+                    *select_index_ptr, pos_index, partition_ids) == 0) {
+            auto& region_infos = scan_node->region_infos();
+            for (auto iter = region_infos.begin(); iter != region_infos.end();) {
+                if (partition_ids.count(iter->second.partition_id()) == 0) {
+                    iter = region_infos.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+        }
+    }
     //如果该表没有全局二级索引
     if (!schema_factory->has_global_index(main_table_id)) {
         return 0;
@@ -379,6 +395,21 @@ int PlanRouter::select_index(pb::ScanNode* scan_node, std::vector<int>& multi_re
     if (sort_index != -1) {
         return sort_index;
     }
+    // 有统计信息时(baikaldb在IndexSelector中估算)，选择代价最小的索引
+    int min_cost_index = -1;
+    for (auto& pair : prefix_ratio_id_mapping) {
+        auto& pos_index = scan_node->indexes(pair.second);
+        if (!pos_index.has_cost()) {
+            min_cost_index = -1;
+            break;
+        }
+        if (min_cost_index == -1 || pos_index.cost() < scan_node->indexes(min_cost_index).cost()) {
+            min_cost_index = pair.second;
+        }
+    }
+    if (min_cost_index != -1) {
+        return min_cost_index;
+    }
     // ratio * 10(=0...9)相同的possible index中，按照PRIMARY, UNIQUE, KEY的优先级选择
     //DB_WARNING("prefix_ratio_id_mapping.size: %d", prefix_ratio_id_mapping.size());
     for (auto iter = prefix_ratio_id_mapping.crbegin(); iter != prefix_ratio_id_mapping.crend(); ++iter) {
@@ -17,7 +17,7 @@
 
 namespace baikaldb {
 
-EpollInfo::EpollInfo(): _max_fd(-1), _epfd(-1), _event_size(0) {}
+EpollInfo::EpollInfo(): _max_fd(-1), _epfd(-1), _event_size(0), _fd_count(0) {}
 
 EpollInfo::~EpollInfo() {
     if (_epfd > 0) {
@@ -44,6 +44,9 @@ bool EpollInfo::set_fd_mapping(int fd, SmartSocket sock) {
         DB_FATAL("Wrong fd[%d]", fd);
         return false;
     }
+    if (_fd_mapping[fd] == nullptr && sock != nullptr) {
+        ++_fd_count;
+    }
     _fd_mapping[fd] = sock;
     return true;
 }
@@ -60,6 +63,9 @@ void EpollInfo::delete_fd_mapping(int fd) {
     if (fd < 0 || fd >= CONFIG_MPL_EPOLL_MAX_SIZE) {
         return;
     }
+    if (_fd_mapping[fd] != nullptr) {
+        --_fd_count;
+    }
     _fd_mapping[fd] = SmartSocket();
     return;
 }
@@ -66,7 +66,9 @@ void* MachineDriver::bthread_callback(void* void_arg) {
     }
     (*_driver->_time_stamp)[thread_idx].second = time(NULL);
 
+    TimeCost cost;
     StateMachine::get_instance()->run_machine(task->socket, task->epoll_info, task->shutdown);
+    task->socket->last_process_us = cost.get_time();
     task->socket->mutex.unlock();
     task->is_succ = true;
     return NULL;
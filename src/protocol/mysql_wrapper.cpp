@@ -14,11 +14,33 @@
 
 #include "mysql_wrapper.h"
 #include <unordered_set>
+#include <sys/epoll.h>
+#include <bthread/unstable.h>
 #include "network_socket.h"
 #include "query_context.h"
 #include "packet_node.h"
 
 namespace baikaldb {
+DEFINE_int64(send_buf_flush_watermark, 256 * 1024LL,
+        "flush packed result to socket when send_buf exceeds this size, 0 means flush after query");
+DEFINE_int64(send_buf_pending_limit, 8 * 1024 * 1024LL,
+        "block the executor when unsent result bytes exceed this size");
+DEFINE_int32(send_buf_flush_timeout_ms, 30 * 1000,
+        "max time waiting for a slow client to read result");
+bvar::Adder<int64_t> send_buf_flush_count("send_buf_flush_count");
+bvar::Adder<int64_t> send_buf_flush_wait_count("send_buf_flush_wait_count");
+
+namespace {
+// 把send_buf中未发送的数据转移到send_iobuf，send_buf保留容量继续复用
+void move_send_buf(NetworkSocket* sock) {
+    int32_t size = sock->send_buf->_size - sock->send_buf_offset;
+    if (size > 0) {
+        sock->send_iobuf.append(sock->send_buf->_data + sock->send_buf_offset, size);
+    }
+    sock->send_buf->_size = 0;
+    sock->send_buf_offset = 0;
+}
+}
 
 MysqlWrapper::MysqlWrapper() {
     _err_handler = MysqlErrHandler::get_instance();
@@ -598,31 +620,20 @@ int MysqlWrapper::real_write(SmartSocket sock) {
         return RET_ERROR;
     }
     int ret = RET_ERROR;
-    int32_t we_want = sock->send_buf->_size - sock->send_buf_offset;
-
-    if (we_want <= 0) {
+    move_send_buf(sock.get());
+    if (sock->send_iobuf.empty()) {
         if (sock->state == STATE_CONNECTED_CLIENT) {
-            DB_WARNING("write handshake failed %s, %d, %d, we_want=%d buf_size=%lu "
-                "buf_offset=%d",
+            DB_WARNING("write handshake failed %s, %d, %d, send_buf empty",
                 sock->ip.c_str(),
                 sock->fd,
-                sock->port,
-                we_want,
-                sock->send_buf->_size,
-                sock->send_buf_offset);
+                sock->port);
         }
         return RET_SUCCESS;
     }
-    int real_write = we_want;
-    if (we_want > (int)MAX_WRITE_QUERY_RESULT_PACKET_LEN) {
-        real_write = MAX_WRITE_QUERY_RESULT_PACKET_LEN;
-    }
-    int len = write(sock->fd, sock->send_buf->_data + sock->send_buf_offset, real_write);
-    if (0 < len) {
-        sock->send_buf_offset += len;
-    } else if (len == 0) {
-        return RET_SHUTDOWN;
-    } else {
+    // 每次最多写MAX_WRITE_QUERY_RESULT_PACKET_LEN，剩余部分等EPOLLOUT再写，避免单连接占满线程
+    ssize_t len = sock->send_iobuf.cut_into_file_descriptor(sock->fd,
+            MAX_WRITE_QUERY_RESULT_PACKET_LEN);
+    if (len < 0) {
         switch (errno) {
             case EAGAIN:
                 ret = RET_WAIT_FOR_EVENT;
@@ -635,9 +646,10 @@ int MysqlWrapper::real_write(SmartSocket sock) {
                 break;
         }
         return ret;
+    } else if (len == 0) {
+        return RET_SHUTDOWN;
     }
-    if (len < real_write || we_want > (int)MAX_WRITE_QUERY_RESULT_PACKET_LEN) {
-        ret = RET_WAIT_FOR_EVENT;
+    if (!sock->send_iobuf.empty()) {
         return RET_WAIT_FOR_EVENT;
     }
     sock->send_buf->byte_array_clear();
@@ -647,6 +659,45 @@ int MysqlWrapper::real_write(SmartSocket sock) {
     return RET_SUCCESS;
 }
 
+int MysqlWrapper::flush_send_buf(NetworkSocket* sock) {
+    if (sock == nullptr || sock->send_buf == nullptr || sock->fd < 0) {
+        return RET_SUCCESS;
+    }
+    if (sock->query_ctx != nullptr) {
+        sock->query_ctx->stat_info.send_buf_size += sock->send_buf->_size - sock->send_buf_offset;
+    }
+    move_send_buf(sock);
+    send_buf_flush_count << 1;
+    TimeCost cost;
+    while (!sock->send_iobuf.empty()) {
+        ssize_t len = sock->send_iobuf.cut_into_file_descriptor(sock->fd,
+                MAX_WRITE_QUERY_RESULT_PACKET_LEN);
+        if (len > 0) {
+            continue;
+        }
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len == 0 || errno != EAGAIN) {
+            DB_WARNING("write fail, fd:%d ip:%s errno:%d", sock->fd, sock->ip.c_str(), errno);
+            return RET_SHUTDOWN;
+        }
+        // 未发送的数据不多时留给状态机后续发送，否则等客户端读走再继续执行
+        if ((int64_t)sock->send_iobuf.size() <= FLAGS_send_buf_pending_limit) {
+            return RET_SUCCESS;
+        }
+        send_buf_flush_wait_count << 1;
+        int64_t left_us = FLAGS_send_buf_flush_timeout_ms * 1000LL - cost.get_time();
+        timespec abstime = butil::microseconds_from_now(std::max(left_us, 0L));
+        if (left_us <= 0 || bthread_fd_timedwait(sock->fd, EPOLLOUT, &abstime) != 0) {
+            DB_WARNING("wait client read timeout, fd:%d ip:%s pending:%lu cost:%ld",
+                    sock->fd, sock->ip.c_str(), sock->send_iobuf.size(), cost.get_time());
+            return RET_SHUTDOWN;
+        }
+    }
+    return RET_SUCCESS;
+}
+
 bool MysqlWrapper::make_eof_packet(DataBuffer* send_buf, const int packet_id) {
     uint8_t bytes[4];
     bytes[0] = '\x05';
@@ -0,0 +1,157 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "network_reactor.h"
+#include <pthread.h>
+#include <unistd.h>
+#include "network_server.h"
+#include "machine_driver.h"
+
+namespace baikaldb {
+DECLARE_int32(epoll_timeout);
+DEFINE_int32(network_reactor_num, 4, "epoll reactor num for client connections");
+DEFINE_bool(network_reactor_bind_cpu, false, "pin reactor threads to cpu cores");
+DEFINE_int64(network_reactor_inline_us, 0, 
+        "run handshake and auth in reactor thread if last processing of the connection cost less, "
+        "statements always use bthread, 0 means always use bthread");
+DEFINE_int64(network_reactor_loop_budget_us, 10000,
+        "max inline processing time of one epoll round, remaining events go to bthread");
+
+NetworkReactor::NetworkReactor(int idx) :
+        _idx(idx),
+        _conn_count("baikal_reactor_" + std::to_string(idx) + "_conn_count", 
+                get_conn_count, this),
+        _event_count("baikal_reactor_" + std::to_string(idx) + "_event_count"),
+        _inline_count("baikal_reactor_" + std::to_string(idx) + "_inline_count"),
+        _offload_count("baikal_reactor_" + std::to_string(idx) + "_offload_count"),
+        _inline_latency("baikal_reactor_" + std::to_string(idx) + "_inline") {
+}
+
+NetworkReactor::~NetworkReactor() {
+    join();
+}
+
+bool NetworkReactor::init() {
+    return _epoll_info.init();
+}
+
+void NetworkReactor::start() {
+    _thread = std::thread([this]() {
+        run();
+    });
+}
+
+void NetworkReactor::join() {
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+bool NetworkReactor::add_client(SmartSocket sock) {
+    if (!_epoll_info.set_fd_mapping(sock->fd, sock)) {
+        return false;
+    }
+    // 新连接可写，reactor收到事件后发送握手包
+    return _epoll_info.poll_events_add(sock, EPOLLOUT);
+}
+
+void NetworkReactor::run() {
+    if (FLAGS_network_reactor_bind_cpu) {
+        long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(_idx % std::max(cpu_num, 1L), &cpu_set);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (ret != 0) {
+            DB_WARNING("reactor: %d bind cpu fail, ret: %d", _idx, ret);
+        }
+    }
+    DB_NOTICE("reactor: %d start", _idx);
+    NetworkServer* server = NetworkServer::get_instance();
+    while (!server->get_shutdown()) {
+        int fd_cnt = _epoll_info.wait(FLAGS_epoll_timeout);
+        _loop_start_us = butil::gettimeofday_us();
+        for (int cnt = 0; cnt < fd_cnt; ++cnt) {
+            process_event(_epoll_info.get_ready_fd(cnt), _epoll_info.get_ready_events(cnt));
+        }
+    }
+    DB_NOTICE("reactor: %d exit", _idx);
+}
+
+void NetworkReactor::process_event(int fd, int event) {
+    SmartSocket sock = _epoll_info.get_fd_mapping(fd);
+    if (sock == nullptr) {
+        DB_DEBUG("Can't find fd in fd_mapping, fd:[%d], reactor:[%d]", fd, _idx);
+        return;
+    }
+    if (fd != sock->fd) {
+        DB_WARNING("current [fd=%d][sock_fd=%d][event=%d][reactor=%d]",
+                fd, sock->fd, event, _idx);
+        return;
+    }
+    sock->last_active = time(NULL);
+
+    // EPOLLHUP: closed by client. because of protocol of sending package is wrong.
+    if (event & EPOLLHUP || event & EPOLLERR) {
+        if (sock->socket_type == CLIENT_SOCKET) {
+            if ((event & EPOLLHUP) && sock->shutdown == false) {
+                DB_WARNING("CLIENT EPOLL event is EPOLLHUP, fd=%d event=0x%x", fd, event);
+            } else if ((event & EPOLLERR) && sock->shutdown == false) {
+                DB_WARNING("CLIENT EPOLL event is EPOLLERR, fd=%d event=0x%x", fd, event);
+            }
+        } else {
+            DB_WARNING("socket type is wrong, fd %d event=0x%x", fd, event);
+        }
+        sock->shutdown = true;
+    }
+    if (sock->socket_type != CLIENT_SOCKET) {
+        DB_WARNING("unknown network socket type[%d].", sock->socket_type);
+        return;
+    }
+    if (sock->mutex.try_lock() == false) {
+        return;
+    }
+    if (sock->is_free || sock->fd == -1) {
+        DB_WARNING("sock is already free.");
+        sock->mutex.unlock();
+        return;
+    }
+    // close the socket event on epoll when the sock is being process
+    // and reopen it when finish process
+    _epoll_info.poll_events_mod(sock, 0);
+    _event_count << 1;
+    dispatch(sock, sock->shutdown || NetworkServer::get_instance()->get_shutdown());
+}
+
+void NetworkReactor::dispatch(SmartSocket sock, bool shutdown) {
+    // 语句执行可能阻塞(访问store、等待客户端读走结果、等待异步commit)，
+    // 上一次的耗时不能说明本次，只有握手和认证阶段在reactor线程执行
+    bool can_inline = !shutdown && (sock->state == STATE_CONNECTED_CLIENT
+        || sock->state == STATE_SEND_HANDSHAKE || sock->state == STATE_READ_AUTH);
+    bool run_inline = FLAGS_network_reactor_inline_us > 0 && can_inline
+        && sock->last_process_us < FLAGS_network_reactor_inline_us
+        && butil::gettimeofday_us() - _loop_start_us < FLAGS_network_reactor_loop_budget_us;
+    if (run_inline) {
+        _inline_count << 1;
+        TimeCost cost;
+        MachineDriver::get_instance()->dispatch(sock, &_epoll_info, shutdown, false);
+        _inline_latency << cost.get_time();
+    } else {
+        _offload_count << 1;
+        MachineDriver::get_instance()->dispatch(sock, &_epoll_info, shutdown);
+    }
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -214,18 +214,24 @@ void NetworkServer::construct_heart_beat_request(pb::BaikalHeartBeatRequest& req
                 req_info->set_version(1);
                 if (index_id == info_pair.second->id) {
                     req_info->set_version(info_pair.second->version);
+                    if (info_pair.second->statistics != nullptr) {
+                        req_info->set_statistics_version(info_pair.second->statistics->version());
+                    }
                 } 
-                std::map<int64_t, pb::RegionInfo> region_infos;
                 //
                 // TODO：读多个double buffer，可能死锁？
                 //
-                factory->get_region_by_key(index, NULL, region_infos);
-                for (auto& pair : region_infos) {
-                    auto region = req_info->add_regions();
-                    auto& region_info = pair.second;
-                    region->set_region_id(region_info.region_id());
-                    region->set_version(region_info.version());
-                    region->set_conf_version(region_info.conf_version());
+                std::vector<SmartRegionRouter> routers;
+                if (factory->get_region_routers(index.id, routers) != 0) {
+                    continue;
+                }
+                for (auto& router : routers) {
+                    for (auto& region_info : router->regions()) {
+                        auto region = req_info->add_regions();
+                        region->set_region_id(region_info->region_id());
+                        region->set_version(region_info->version());
+                        region->set_conf_version(region_info->conf_version());
+                    }
                 }
             }
         }
@@ -285,15 +291,9 @@ void NetworkServer::connection_timeout_check() {
             DB_WARNING("get current time failed.");
             return;
         }
-        if (_epoll_info == NULL) {
-            DB_WARNING("_epoll_info not initialized yet.");
-            return;
-        }
-
-        for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-            SmartSocket sock = _epoll_info->get_fd_mapping(idx);
-            if (sock == NULL || sock->is_free || sock->fd == -1) {
-                continue;
+        for_each_client([this, &time_now](SmartSocket sock, EpollInfo* epoll_info) {
+            if (sock->is_free || sock->fd == -1) {
+                return;
             }
 
             // 处理客户端Hang住的情况，server端没有发送handshake包或者auth_result包
@@ -304,14 +304,14 @@ void NetworkServer::connection_timeout_check() {
             if (!sock->is_authed && diff_us >= 1000000) {
                 // 待现有工作处理完成，需要获取锁
                 if (sock->mutex.try_lock() == false) {
-                    continue;
+                    return;
                 }
                 DB_WARNING("close un_authed connection [fd=%d][ip=%s][port=%d].",
                         sock->fd, sock->ip.c_str(), sock->port);
                 sock->shutdown = true;
-                MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+                MachineDriver::get_instance()->dispatch(sock, epoll_info,
                         sock->shutdown || _shutdown);
-                continue;
+                return;
             }
             time_now = time(NULL);
             if (sock->query_ctx != nullptr && 
@@ -324,26 +324,26 @@ void NetworkServer::connection_timeout_check() {
                             sock->user_info->username.c_str(),
                             sock->query_ctx->stat_info.log_id,
                             sock->query_ctx->sql.c_str());
-                    continue;
+                    return;
                 }
             }
             // 处理连接空闲时间过长的情况，踢掉空闲连接
             double diff = difftime(time_now, sock->last_active);
             if ((int32_t)diff < FLAGS_connect_idle_timeout_s) {
-                continue;
+                return;
             }
             // 待现有工作处理完成，需要获取锁
             if (sock->mutex.try_lock() == false) {
-                continue;
+                return;
             }
             DB_NOTICE("close idle connection [fd=%d][ip=%s:%d][now=%ld][active=%ld][user=%s]",
                     sock->fd, sock->ip.c_str(), sock->port,
                     time_now, sock->last_active,
                     sock->user_info->username.c_str());
             sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+            MachineDriver::get_instance()->dispatch(sock, epoll_info,
                     sock->shutdown || _shutdown);
-        }
+        });
     };
     while (!_shutdown) {
         check_func();
@@ -363,6 +363,10 @@ NetworkServer::NetworkServer():
 }
 
 NetworkServer::~NetworkServer() {
+    for (auto reactor : _reactors) {
+        delete reactor;
+    }
+    _reactors.clear();
     // Free epoll info.
     if (_epoll_info != NULL) {
         delete _epoll_info;
@@ -402,7 +406,8 @@ int NetworkServer::fetch_instance_info() {
 
 bool NetworkServer::init() {
     // init val 
-    _driver_thread_num = bthread::FLAGS_bthread_concurrency;
+    // reactor线程也会直接执行状态机
+    _driver_thread_num = bthread::FLAGS_bthread_concurrency + std::max(FLAGS_network_reactor_num, 1);
     TimeCost cost;
     // 先把meta数据都获取到
     pb::BaikalHeartBeatRequest request;
@@ -444,28 +449,45 @@ bool NetworkServer::init() {
 void NetworkServer::stop() {
     _heartbeat_bth.join();
 
-    if (_epoll_info == nullptr) {
-        DB_WARNING("_epoll_info not initialized yet.");
-        return;
+    for (auto reactor : _reactors) {
+        reactor->join();
     }
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = _epoll_info->get_fd_mapping(idx);
-        if (!sock) {
-            continue;
-        }
-        if (sock == nullptr || sock->fd == 0) {
-            continue;
+    for_each_client([](SmartSocket sock, EpollInfo* epoll_info) {
+        if (sock->fd == 0) {
+            return;
         }
-
         // 待现有工作处理完成，需要获取锁
         if (sock->mutex.try_lock()) {
             sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info, true, false);
+            MachineDriver::get_instance()->dispatch(sock, epoll_info, true, false);
         }
-    }
+    });
     return;
 }
 
+void NetworkServer::for_each_client(const std::function<void(SmartSocket, EpollInfo*)>& func) {
+    for (auto reactor : _reactors) {
+        EpollInfo* epoll_info = reactor->epoll_info();
+        for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
+            SmartSocket sock = epoll_info->get_fd_mapping(idx);
+            if (sock == nullptr) {
+                continue;
+            }
+            func(sock, epoll_info);
+        }
+    }
+}
+
+NetworkReactor* NetworkServer::choose_reactor() {
+    NetworkReactor* chosen = _reactors[0];
+    for (auto reactor : _reactors) {
+        if (reactor->conn_count() < chosen->conn_count()) {
+            chosen = reactor;
+        }
+    }
+    return chosen;
+}
+
 bool NetworkServer::start() {
     if (!_is_init) {
         DB_FATAL("Network server is not initail.");
@@ -522,6 +544,18 @@ int NetworkServer::make_worker_process() {
         DB_FATAL("Failed to init machine driver.");
         exit(-1);
     }
+    // 客户端连接按连接数均衡分配到各个reactor
+    int reactor_num = std::max(FLAGS_network_reactor_num, 1);
+    for (int i = 0; i < reactor_num; ++i) {
+        NetworkReactor* reactor = new NetworkReactor(i);
+        if (!reactor->init()) {
+            DB_FATAL("initial reactor: %d failed.", i);
+            delete reactor;
+            return -1;
+        }
+        _reactors.push_back(reactor);
+        reactor->start();
+    }
     _conn_check_bth.run([this]() {connection_timeout_check();});
     _heartbeat_bth.run([this]() {report_heart_beat();});
     _recover_bth.run([this]() {recovery_transactions();});
@@ -598,76 +632,20 @@ int NetworkServer::make_worker_process() {
                 client_socket->addr = client_addr;
                 client_socket->server_instance_id = _instance_id;
 
-                // Set socket mapping and event.
-                if (!_epoll_info->set_fd_mapping(client_socket->fd, client_socket)) {
-                    DB_FATAL("Failed to set fd mapping.");
+                // 由reactor处理该连接上的所有事件，包括发送握手包
+                NetworkReactor* reactor = choose_reactor();
+                if (!reactor->add_client(client_socket)) {
+                    DB_FATAL("Failed to add client to reactor.");
                     return -1;
                 }
-                _epoll_info->poll_events_add(client_socket, 0);
-
-                // New connection will be handled immediately.
-                fd = client_fd;
                 //DB_NOTICE("Accept new connect [ip=%s, port=%d, client_fd=%d]",
-                DB_WARNING("Accept new connect [ip=%s, port=%d, client_fd=%d]",
+                DB_WARNING("Accept new connect [ip=%s, port=%d, client_fd=%d, reactor_conn=%ld]",
                         ip_address,
                         client_socket->port,
-                        client_socket->fd);
-            }
-
-            // Check if socket in fd_mapping or not.
-            SmartSocket sock = _epoll_info->get_fd_mapping(fd);
-            if (sock == NULL) {
-                DB_DEBUG("Can't find fd in fd_mapping, fd:[%d], listen_fd:[%d], fd_cnt:[%d]",
-                            fd, listen_fd, cnt);
-                continue;
-            }
-            if (fd != sock->fd) {
-                DB_WARNING("current [fd=%d][sock_fd=%d]"
-                    "[event=%d][fd_cnt=%d][state=%s]",
-                    fd,
-                    sock->fd,
-                    event,
-                    fd_cnt,
-                    state2str(sock).c_str());
-                continue;
-            }
-            sock->last_active = time(NULL);
-
-            // Check socket event.
-            // EPOLLHUP: closed by client. because of protocol of sending package is wrong.
-            if (event & EPOLLHUP || event & EPOLLERR) {
-                if (sock->socket_type == CLIENT_SOCKET) {
-                    if ((event & EPOLLHUP) && sock->shutdown == false) {
-                        DB_WARNING("CLIENT EPOLL event is EPOLLHUP, fd=%d event=0x%x",
-                                        fd, event);
-                    } else if ((event & EPOLLERR) && sock->shutdown == false) {
-                        DB_WARNING("CLIENT EPOLL event is EPOLLERR, fd=%d event=0x%x",
-                                        fd, event);
-                    }
-                } else {
-                    DB_WARNING("socket type is wrong, fd %d event=0x%x", fd, event);
-                }
-                sock->shutdown = true;
-            }
-
-            // Handle client socket event by status machine.
-            if (sock->socket_type == CLIENT_SOCKET) {
-                // the socket has just connected, no need to require lock
-                if (sock->mutex.try_lock() == false) {
-                    continue;
-                }
-                if (sock->is_free || sock->fd == -1) {
-                    DB_WARNING("sock is already free.");
-                    sock->mutex.unlock();
-                    continue;
-                }
-                // close the socket event on epoll when the sock is being process
-                // and reopen it when finish process
-                _epoll_info->poll_events_mod(sock, 0);
-                MachineDriver::get_instance()->dispatch(sock, _epoll_info,
-                    sock->shutdown || _shutdown);
-            } else {
-                DB_WARNING("unknown network socket type[%d].", sock->socket_type);
+                        client_socket->fd,
+                        reactor->conn_count());
+            } else if (listen_fd != fd) {
+                DB_WARNING("unknown fd in listen epoll, fd:[%d], event:[%d]", fd, event);
             }
         }
     }
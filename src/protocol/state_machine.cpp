@@ -16,9 +16,13 @@
 #include <boost/algorithm/string.hpp>
 #include "network_server.h"
 #include "query_context.h"
+#include "statement_stats.h"
+#include "datetime.h"
 #include <rapidjson/reader.h>
 #include <rapidjson/document.h>
 #include <boost/algorithm/string/join.hpp>
+#include "store_interact.hpp"
+#include "meta_server_interact.hpp"
 
 namespace baikaldb {
 DEFINE_int32(max_connections_per_user, 4000, "default user max connections");
@@ -343,6 +347,19 @@ void StateMachine::_print_query_time(SmartSocket client) {
             stat_info->num_returned_rows : stat_info->num_affected_rows;
     }
 
+    if (FLAGS_statement_stats_enable && stat_info->sql_sign != 0) {
+        StatementSample sample;
+        sample.latency_us = stat_info->total_time;
+        sample.store_us = stat_info->server_talk_time;
+        sample.rows_returned = stat_info->num_returned_rows;
+        sample.rows_affected = stat_info->num_affected_rows;
+        sample.rows_examined = stat_info->num_scan_rows;
+        sample.error = stat_info->error_code != ER_ERROR_FIRST
+            || client->state == STATE_ERROR || client->state == STATE_ERROR_REUSE;
+        StatementStats::get_instance()->record(stat_info->sql_sign, stat_info->sql_digest,
+                stat_info->family, stat_info->table, op_type, sample);
+    }
+
     boost::replace_all(ctx->sql, "\n", " ");
     sql_agg_cost << BvarMap(stat_info->sample_sql.str(), stat_info->total_time, 
                             rows, stat_info->num_scan_rows);
@@ -979,6 +996,10 @@ bool StateMachine::_query_process(SmartSocket client) {
             ret = _handle_client_query_show_socket(client);
         } else if (boost::starts_with(client->query_ctx->sql, SQL_SHOW_PROCESSLIST)) {
             ret = _handle_client_query_show_processlist(client);
+        } else if (boost::istarts_with(client->query_ctx->sql, SQL_SHOW_STATEMENT_STATS)) {
+            ret = _handle_client_query_show_statement_stats(client);
+        } else if (boost::istarts_with(client->query_ctx->sql, SQL_ANALYZE_TABLE)) {
+            ret = _handle_client_query_analyze_table(client);
         } else if (type == SQL_SHOW_NUM
                     && boost::algorithm::istarts_with(
                             client->query_ctx->sql, SQL_SHOW_VARIABLES)) {
@@ -1937,14 +1958,12 @@ bool StateMachine::_handle_client_query_show_socket(SmartSocket client) {
     } while (0);
 
     std::map<std::string, int> ip_map;
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = epoll_info->get_fd_mapping(idx);
-        if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
-            continue;
+    NetworkServer::get_instance()->for_each_client([&ip_map](SmartSocket sock, EpollInfo*) {
+        if (sock->is_free || sock->fd == -1 || sock->ip == "") {
+            return;
         }
         ip_map[sock->ip]++;
-    }
+    });
     // Make rows.
     std::vector< std::vector<std::string> > rows;
 
@@ -1967,6 +1986,188 @@ bool StateMachine::_handle_client_query_show_socket(SmartSocket client) {
     return true;
 }
 
+bool StateMachine::_handle_client_query_show_statement_stats(SmartSocket client) {
+    // Make fields.
+    std::vector<ResultField> fields;
+    std::vector<std::string> names = {"Sign", "Family", "Table", "Op_type", "Count", "Errors",
+        "Avg_us", "P50_us", "P99_us", "Max_us", "Store_avg_us", "Rows_returned",
+        "Rows_affected", "Rows_examined", "Last_seen", "Digest"};
+    for (auto& name : names) {
+        ResultField field;
+        field.name = name;
+        field.type = MYSQL_TYPE_VARCHAR;
+        field.length = 1024;
+        fields.push_back(field);
+    }
+
+    // Make rows.
+    std::vector<StatementDigestInfo> infos;
+    StatementStats::get_instance()->list(&infos, FLAGS_statement_stats_show_limit);
+    std::vector< std::vector<std::string> > rows;
+    for (auto& info : infos) {
+        int64_t count = std::max(info.count, (int64_t)1);
+        std::vector<std::string> row;
+        row.push_back(std::to_string(info.sign));
+        row.push_back(info.family);
+        row.push_back(info.table);
+        row.push_back(pb::OpType_Name((pb::OpType)info.op_type));
+        row.push_back(std::to_string(info.count));
+        row.push_back(std::to_string(info.errors));
+        row.push_back(std::to_string(info.sum_latency_us / count));
+        row.push_back(std::to_string(info.p50_latency_us));
+        row.push_back(std::to_string(info.p99_latency_us));
+        row.push_back(std::to_string(info.max_latency_us));
+        row.push_back(std::to_string(info.sum_store_us / count));
+        row.push_back(std::to_string(info.rows_returned));
+        row.push_back(std::to_string(info.rows_affected));
+        row.push_back(std::to_string(info.rows_examined));
+        row.push_back(timestamp_to_str(info.last_seen_us / 1000000));
+        row.push_back(info.digest);
+        rows.push_back(row);
+    }
+
+    // Make mysql packet.
+    MysqlWrapper* wrapper = MysqlWrapper::get_instance();
+    if (_make_common_resultset_packet(client, fields, rows) != 0) {
+        DB_FATAL_CLIENT(client, "Failed to make result packet.");
+        wrapper->make_err_packet(client, ER_MAKE_RESULT_PACKET, "Failed to make result packet.");
+        client->state = STATE_ERROR;
+        return false;
+    }
+    client->state = STATE_READ_QUERY_RESULT;
+    return true;
+}
+
+bool StateMachine::_handle_client_query_analyze_table(SmartSocket client) {
+    if (client == nullptr) {
+        DB_FATAL("param invalid");
+        return false;
+    }
+    std::vector<std::string> split_vec;
+    boost::split(split_vec, client->query_ctx->sql,
+            boost::is_any_of(" \t\n\r.;"), boost::token_compress_on);
+    while (!split_vec.empty() && split_vec.back().empty()) {
+        split_vec.pop_back();
+    }
+    std::string db = client->current_db;
+    std::string table;
+    if (split_vec.size() == 3) {
+        table = remove_quote(split_vec[2].c_str(), '`');
+    } else if (split_vec.size() == 4) {
+        db = remove_quote(split_vec[2].c_str(), '`');
+        table = remove_quote(split_vec[3].c_str(), '`');
+    } else {
+        _wrapper->make_err_packet(client, ER_SYNTAX_ERROR, "syntax error");
+        client->state = STATE_READ_QUERY_RESULT;
+        return false;
+    }
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    std::string full_name = client->user_info->namespace_ + "." + db + "." + table;
+    int64_t table_id = -1;
+    if (factory->get_table_id(full_name, table_id) != 0) {
+        _wrapper->make_err_packet(client, ER_NO_SUCH_TABLE, "Table '%s.%s' doesn't exist", 
+                db.c_str(), table.c_str());
+        client->state = STATE_READ_QUERY_RESULT;
+        return false;
+    }
+    TableInfo table_info = factory->get_table_info(table_id);
+    // 主表region统计主键和本地二级索引，全局二级索引在各自的region上统计
+    std::vector<int64_t> router_index_ids = {table_id};
+    for (auto index_id : table_info.indices) {
+        if (factory->is_global_index(index_id)) {
+            router_index_ids.push_back(index_id);
+        }
+    }
+    std::map<int64_t, SmartRegionInfo> region_infos;
+    for (auto index_id : router_index_ids) {
+        IndexInfo index_info = factory->get_index_info(index_id);
+        std::map<int64_t, SmartRegionInfo> index_region_infos;
+        if (factory->get_region_by_key(table_id, index_info, nullptr, index_region_infos) != 0) {
+            DB_WARNING_CLIENT(client, "get region fail, index_id: %ld", index_id);
+            continue;
+        }
+        region_infos.insert(index_region_infos.begin(), index_region_infos.end());
+    }
+    std::mutex lock;
+    std::map<int64_t, std::vector<pb::IndexStatistics>> region_statistics;
+    std::atomic<int> fail_count(0);
+    ConcurrencyBthread analyze_bth(10, &BTHREAD_ATTR_SMALL);
+    for (auto& pair : region_infos) {
+        const pb::RegionInfo* region_info = pair.second.get();
+        analyze_bth.run([region_info, &lock, &region_statistics, &fail_count]() {
+            pb::StoreReq request;
+            pb::StoreRes response;
+            request.set_op_type(pb::OP_ANALYZE);
+            request.set_region_id(region_info->region_id());
+            request.set_region_version(region_info->version());
+            StoreInteract store_interact(region_info->leader());
+            if (store_interact.send_request_for_leader("query", request, response) != 0) {
+                DB_WARNING("analyze region fail, region_id: %ld, errmsg: %s", 
+                        region_info->region_id(), response.errmsg().c_str());
+                ++fail_count;
+                return;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            for (auto& index_stat : *response.mutable_statistics()->mutable_indexes()) {
+                region_statistics[index_stat.index_id()].push_back(index_stat);
+            }
+        });
+    }
+    analyze_bth.join();
+    std::string msg_type = "status";
+    std::string msg_text = "OK";
+    if (fail_count > 0) {
+        msg_type = "Error";
+        msg_text = "analyze " + std::to_string(fail_count.load()) + " regions fail";
+    } else {
+        pb::MetaManagerRequest request;
+        pb::MetaManagerResponse response;
+        request.set_op_type(pb::OP_UPDATE_STATISTICS);
+        pb::SchemaInfo* schema_info = request.mutable_table_info();
+        schema_info->set_table_name(table);
+        schema_info->set_database(db);
+        schema_info->set_namespace_name(client->user_info->namespace_);
+        pb::TableStatistics* statistics = schema_info->mutable_statistics();
+        statistics->set_table_id(table_id);
+        statistics->set_analyze_timestamp(time(NULL));
+        for (auto& pair : region_statistics) {
+            std::vector<const pb::IndexStatistics*> index_statistics;
+            for (auto& index_stat : pair.second) {
+                index_statistics.push_back(&index_stat);
+            }
+            merge_index_statistics(index_statistics, statistics->add_indexes());
+        }
+        if (MetaServerInteract::get_instance()->send_request("meta_manager", request, response) != 0) {
+            DB_WARNING_CLIENT(client, "update statistics fail, errmsg: %s", response.errmsg().c_str());
+            msg_type = "Error";
+            msg_text = "update statistics fail";
+        }
+    }
+
+    // Make fields.
+    std::vector<ResultField> fields;
+    for (auto& name : {"Table", "Op", "Msg_type", "Msg_text"}) {
+        ResultField field;
+        field.name = name;
+        field.type = MYSQL_TYPE_VARCHAR;
+        field.length = 1024;
+        fields.push_back(field);
+    }
+    // Make rows.
+    std::vector<std::vector<std::string> > rows;
+    rows.push_back({db + "." + table, "analyze", msg_type, msg_text});
+
+    // Make mysql packet.
+    if (_make_common_resultset_packet(client, fields, rows) != 0) {
+        DB_FATAL_CLIENT(client, "Failed to make result packet.");
+        _wrapper->make_err_packet(client, ER_MAKE_RESULT_PACKET, "Failed to make result packet.");
+        client->state = STATE_ERROR;
+        return false;
+    }
+    client->state = STATE_READ_QUERY_RESULT;
+    return true;
+}
+
 bool StateMachine::_handle_client_query_show_processlist(SmartSocket client) {
     // Make fields.
     std::vector<ResultField> fields;
@@ -2029,11 +2230,9 @@ bool StateMachine::_handle_client_query_show_processlist(SmartSocket client) {
 
     // Make rows.
     std::vector< std::vector<std::string> > rows;
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = epoll_info->get_fd_mapping(idx);
-        if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
-            continue;
+    NetworkServer::get_instance()->for_each_client([&rows](SmartSocket sock, EpollInfo*) {
+        if (sock->is_free || sock->fd == -1 || sock->ip == "") {
+            return;
         }
         std::vector<std::string> row;
         row.push_back(std::to_string(sock->conn_id));
@@ -2058,7 +2257,7 @@ bool StateMachine::_handle_client_query_show_processlist(SmartSocket client) {
             row.push_back(sock->query_ctx->sql);
         }
         rows.push_back(row);
-    }
+    });
 
     // Make mysql packet.
     MysqlWrapper* wrapper = MysqlWrapper::get_instance();
@@ -2588,6 +2787,7 @@ bool StateMachine::_has_more_result(SmartSocket client) {
 
 int StateMachine::_reset_network_socket_client_resource(SmartSocket client) {
     client->send_buf->byte_array_clear();
+    client->send_iobuf.clear();
     client->self_buf->byte_array_clear();
     client->send_buf_offset = 0;
     client->packet_len = 0;
@@ -2863,7 +3063,8 @@ bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
             client->on_commit_rollback();
          } 
         client->query_ctx->stat_info.query_exec_time = cost.get_time();
-        client->query_ctx->stat_info.send_buf_size = client->send_buf->_size;
+        // 执行过程中已flush的字节数在flush_send_buf中累加
+        client->query_ctx->stat_info.send_buf_size += client->send_buf->_size;
     } else {
         ret = PhysicalPlanner::full_export_start(client->query_ctx.get(), client->send_buf);
         client->query_ctx->stat_info.query_exec_time += cost.get_time();
@@ -17,6 +17,7 @@
 #include "sst_file_writer.h"
 #include "meta_writer.h"
 #include "store.h"
+#include "region_control.h"
 #include "log_entry_reader.h"
 
 namespace baikaldb {
@@ -392,7 +393,8 @@ braft::FileAdaptor* RocksdbFileSystemAdaptor::open_writer_adaptor(const std::str
     RocksWrapper* db = RocksWrapper::get_instance();
     rocksdb::Options options;
     if (is_snapshot_data_file(path)) {
-        options = db->get_options(db->get_data_handle()); 
+        // sst按region数据所在cf的配置(压缩等)生成
+        options = db->get_options(RegionControl::get_data_cf(_region_id)); 
     } else {
         options = db->get_options(db->get_meta_info_handle());
     }
@@ -456,7 +458,7 @@ braft::FileAdaptor* RocksdbFileSystemAdaptor::open_reader_adaptor(const std::str
             read_options.snapshot = sc->snapshot;
             read_options.total_order_seek = true;
             read_options.iterate_upper_bound = &iter_context->upper_bound_slice;
-            rocksdb::ColumnFamilyHandle* column_family = RocksWrapper::get_instance()->get_data_handle();
+            rocksdb::ColumnFamilyHandle* column_family = RegionControl::get_data_cf(_region_id);
             iter_context->iter.reset(RocksWrapper::get_instance()->new_iterator(read_options, column_family));
             iter_context->iter->Seek(prefix);
             sc->data_context = iter_context;
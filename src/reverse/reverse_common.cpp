@@ -16,11 +16,41 @@
 #include <cctype>
 #include <fstream>
 #include <gflags/gflags.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "proto/reverse.pb.h"
 namespace baikaldb {
 DEFINE_string(q2b_utf8_path, "./conf/q2b_utf8.dic", "q2b_utf8_path");
 DEFINE_string(q2b_gbk_path, "./conf/q2b_gbk.dic", "q2b_gbk_path");
 DEFINE_string(punctuation_path, "./conf/punctuation.dic", "punctuation_path");
+DEFINE_string(utf8_dict_path, "./conf/utf8_dict.dic", "utf8 segment dict, one word per line");
+DEFINE_bool(reverse_block_posting, false, "store long third level reverse list in blocks");
+DEFINE_int32(reverse_block_size, 128, "node count of one reverse list block");
+DEFINE_int64(reverse_list_cache_bytes, 64 * 1024 * 1024LL,
+        "third level reverse list cache size, shared by all reverse indexes in process");
+DEFINE_int64(reverse_seg_cache_bytes, 4 * 1024 * 1024LL,
+        "segment result cache size, shared by all reverse indexes in process");
+static CacheMetrics g_reverse_list_cache_metrics("reverse_list");
+static CacheMetrics g_reverse_seg_cache_metrics("reverse_seg");
+
+ReverseListCache& reverse_list_cache() {
+    static ReverseListCache cache;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        cache.init(FLAGS_reverse_list_cache_bytes, &g_reverse_list_cache_metrics, 6);
+    });
+    return cache;
+}
+
+ReverseSegCache& reverse_seg_cache() {
+    static ReverseSegCache cache;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        cache.init(FLAGS_reverse_seg_cache_bytes, &g_reverse_seg_cache_metrics, 6);
+    });
+    return cache;
+}
 
 std::atomic_long g_statistic_insert_key_num = {0};
 std::atomic_long g_statistic_delete_key_num = {0};
@@ -63,6 +93,7 @@ int Tokenizer::init() {
             _q2b_utf8[line.substr(0, pos)] = line.substr(pos + 1, 1);
         }
     }
+    load_utf8_dict(FLAGS_utf8_dict_path);
     return 0;
 }
 
@@ -313,6 +344,364 @@ void Tokenizer::split_str_gbk(const std::string& word, std::vector<std::string>&
     } 
 }
 
+namespace {
+enum Utf8CharType : uint8_t {
+    UTF8_SEP    = 0,    // 标点、空白等分隔符
+    UTF8_WORD   = 1,    // 字母、数字，连续片段整体作为一个term
+    UTF8_CJK    = 2     // 中日韩文字
+};
+
+struct Utf8Char {
+    uint32_t offset;
+    uint32_t len;
+    Utf8CharType type;
+};
+
+struct AsciiTypeTable {
+    Utf8CharType type[128];
+    AsciiTypeTable() {
+        for (int c = 0; c < 128; ++c) {
+            type[c] = isalnum(c) ? UTF8_WORD : UTF8_SEP;
+        }
+    }
+};
+const AsciiTypeTable ascii_type_table;
+
+// 从data开始连续ascii字节的长度，sse2每次判断16字节
+inline size_t ascii_run_length(const char* data, size_t size) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + i)));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < size && (data[i] & 0x80) == 0) {
+        ++i;
+    }
+    return i;
+}
+
+// ascii大写转小写，sse2每次处理16字节，调用方保证都是ascii
+inline void ascii_tolower(char* data, size_t size) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i diff = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_a), 
+                _mm_cmplt_epi8(chunk, after_z));
+        chunk = _mm_or_si128(chunk, _mm_and_si128(is_upper, diff));
+        _mm_storeu_si128((__m128i*)(data + i), chunk);
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] >= 'A' && data[i] <= 'Z') {
+            data[i] += 0x20;
+        }
+    }
+}
+
+inline bool is_utf8_continuation(char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// 解码一个utf8字符，非法编码按单字节U+FFFD处理
+inline uint32_t decode_utf8(const char* data, size_t size, uint32_t* len) {
+    uint8_t c = data[0];
+    if (c < 0x80) {
+        *len = 1;
+        return c;
+    }
+    if ((c & 0xE0) == 0xC0 && size >= 2 && is_utf8_continuation(data[1])) {
+        *len = 2;
+        return ((c & 0x1F) << 6) | (data[1] & 0x3F);
+    }
+    if ((c & 0xF0) == 0xE0 && size >= 3 && is_utf8_continuation(data[1]) 
+            && is_utf8_continuation(data[2])) {
+        *len = 3;
+        return ((c & 0x0F) << 12) | ((data[1] & 0x3F) << 6) | (data[2] & 0x3F);
+    }
+    if ((c & 0xF8) == 0xF0 && size >= 4 && is_utf8_continuation(data[1]) 
+            && is_utf8_continuation(data[2]) && is_utf8_continuation(data[3])) {
+        *len = 4;
+        return ((c & 0x07) << 18) | ((data[1] & 0x3F) << 12) 
+            | ((data[2] & 0x3F) << 6) | (data[3] & 0x3F);
+    }
+    *len = 1;
+    return 0xFFFD;
+}
+
+inline void encode_utf8(uint32_t cp, std::string& out) {
+    if (cp < 0x80) {
+        out.push_back((char)cp);
+    } else if (cp < 0x800) {
+        out.push_back((char)(0xC0 | (cp >> 6)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((char)(0xE0 | (cp >> 12)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | (cp >> 18)));
+        out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// 全角转半角，拉丁、希腊、西里尔字母大写转小写
+inline uint32_t normalize_unicode(uint32_t cp) {
+    if (cp >= 0xFF01 && cp <= 0xFF5E) {
+        cp -= 0xFEE0;
+    } else if (cp == 0x3000) {
+        cp = ' ';
+    }
+    if (cp >= 'A' && cp <= 'Z') {
+        return cp + 0x20;
+    }
+    if ((cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) 
+            || (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2)
+            || (cp >= 0x410 && cp <= 0x42F)) {
+        return cp + 0x20;
+    }
+    if (cp >= 0x400 && cp <= 0x40F) {
+        return cp + 0x50;
+    }
+    return cp;
+}
+
+inline Utf8CharType unicode_type(uint32_t cp) {
+    if (cp < 0x80) {
+        return ascii_type_table.type[cp];
+    }
+    if ((cp >= 0x4E00 && cp <= 0x9FFF)      // CJK统一汉字
+            || (cp >= 0x3400 && cp <= 0x4DBF)   // 扩展A
+            || (cp >= 0xF900 && cp <= 0xFAFF)   // 兼容汉字
+            || (cp >= 0x20000 && cp <= 0x2FA1F) // 扩展B-F及兼容补充
+            || (cp >= 0x3040 && cp <= 0x30FF)   // 平假名、片假名
+            || (cp >= 0xAC00 && cp <= 0xD7AF)) {// 韩文音节
+        return UTF8_CJK;
+    }
+    if ((cp >= 0xC0 && cp <= 0x24F && cp != 0xD7 && cp != 0xF7)   // 拉丁字母
+            || (cp >= 0x370 && cp <= 0x3FF)     // 希腊字母
+            || (cp >= 0x400 && cp <= 0x4FF)     // 西里尔字母
+            || (cp >= 0x660 && cp <= 0x669)) {  // 阿拉伯数字
+        return UTF8_WORD;
+    }
+    return UTF8_SEP;
+}
+
+// 按字符切分已归一化的字符串，ascii连续片段批量查表分类
+void split_utf8_chars(const std::string& word, std::vector<Utf8Char>& chars) {
+    chars.clear();
+    chars.reserve(word.size());
+    const char* data = word.data();
+    size_t size = word.size();
+    size_t i = 0;
+    while (i < size) {
+        size_t ascii_len = ascii_run_length(data + i, size - i);
+        for (size_t end = i + ascii_len; i < end; ++i) {
+            chars.push_back({(uint32_t)i, 1, ascii_type_table.type[(uint8_t)data[i]]});
+        }
+        if (i >= size) {
+            break;
+        }
+        uint32_t len = 0;
+        uint32_t cp = decode_utf8(data + i, size - i, &len);
+        chars.push_back({(uint32_t)i, len, unicode_type(cp)});
+        i += len;
+    }
+}
+
+inline std::string utf8_substr(const std::string& word, 
+        const std::vector<Utf8Char>& chars, size_t begin, size_t end) {
+    uint32_t offset = chars[begin].offset;
+    return word.substr(offset, chars[end - 1].offset + chars[end - 1].len - offset);
+}
+
+// 遍历切分片段，英文数字片段直接加入term_map，中日韩文字片段[begin, end)交给cjk_seg
+template <typename CjkSeg>
+void utf8_seg(const std::string& word, std::vector<Utf8Char>& chars, 
+        std::map<std::string, float>& term_map, const CjkSeg& cjk_seg) {
+    size_t i = 0;
+    while (i < chars.size()) {
+        Utf8CharType type = chars[i].type;
+        size_t end = i + 1;
+        while (end < chars.size() && chars[end].type == type) {
+            ++end;
+        }
+        if (type == UTF8_WORD) {
+            term_map[utf8_substr(word, chars, i, end)] = 0;
+        } else if (type == UTF8_CJK) {
+            cjk_seg(i, end);
+        }
+        i = end;
+    }
+}
+}
+
+void Tokenizer::normalization_utf8(std::string& word) {
+    std::string out;
+    out.reserve(word.size());
+    const char* data = word.data();
+    size_t size = word.size();
+    size_t i = 0;
+    while (i < size) {
+        size_t ascii_len = ascii_run_length(data + i, size - i);
+        if (ascii_len > 0) {
+            size_t begin = out.size();
+            out.append(data + i, ascii_len);
+            ascii_tolower(&out[begin], ascii_len);
+            i += ascii_len;
+            continue;
+        }
+        uint32_t len = 0;
+        uint32_t cp = decode_utf8(data + i, size - i, &len);
+        encode_utf8(normalize_unicode(cp), out);
+        i += len;
+    }
+    word.swap(out);
+}
+
+int Tokenizer::load_utf8_dict(const std::string& path) {
+    std::ifstream fp(path);
+    if (!fp.good()) {
+        DB_WARNING("utf8 dict: %s not found, dict segment degrade to unigrams", path.c_str());
+        return -1;
+    }
+    std::vector<Utf8Char> chars;
+    while (fp.good()) {
+        std::string line;
+        std::getline(fp, line);
+        auto pos = line.find('\t');
+        if (pos != std::string::npos) {
+            line.resize(pos);
+        }
+        normalization_utf8(line);
+        split_utf8_chars(line, chars);
+        if (chars.size() < 2) {
+            continue;
+        }
+        _utf8_dict.insert(line);
+        _utf8_dict_max_len = std::max(_utf8_dict_max_len, (uint32_t)chars.size());
+    }
+    DB_WARNING("load utf8 dict: %s, word count: %lu, max length: %u", 
+            path.c_str(), _utf8_dict.size(), _utf8_dict_max_len);
+    return 0;
+}
+
+int Tokenizer::ngram_seg_utf8(const std::string& word, uint32_t word_count, 
+        std::map<std::string, float>& term_map) {
+    if (word.empty() || word_count == 0) {
+        return 0;
+    }
+    std::string normalized = word;
+    normalization_utf8(normalized);
+    std::vector<Utf8Char> chars;
+    split_utf8_chars(normalized, chars);
+    utf8_seg(normalized, chars, term_map, [&](size_t begin, size_t end) {
+        if (end - begin <= word_count) {
+            term_map[utf8_substr(normalized, chars, begin, end)] = 0;
+            return;
+        }
+        for (size_t i = begin; i + word_count <= end; ++i) {
+            term_map[utf8_substr(normalized, chars, i, i + word_count)] = 0;
+        }
+    });
+    return 0;
+}
+
+int Tokenizer::dict_seg_utf8(const std::string& word, std::map<std::string, float>& term_map) {
+    if (word.empty()) {
+        return 0;
+    }
+    std::string normalized = word;
+    normalization_utf8(normalized);
+    std::vector<Utf8Char> chars;
+    split_utf8_chars(normalized, chars);
+    utf8_seg(normalized, chars, term_map, [&](size_t begin, size_t end) {
+        size_t i = begin;
+        while (i < end) {
+            size_t len = std::min((size_t)_utf8_dict_max_len, end - i);
+            for (; len > 1; --len) {
+                std::string term = utf8_substr(normalized, chars, i, i + len);
+                if (_utf8_dict.count(term) == 1) {
+                    term_map[term] = 0;
+                    break;
+                }
+            }
+            if (len <= 1) {
+                len = 1;
+                term_map[utf8_substr(normalized, chars, i, i + 1)] = 0;
+            }
+            i += len;
+        }
+    });
+    return 0;
+}
+
+// utf8多字节字符的每个字节都大于0x80，不会和ascii分隔符混淆
+void Tokenizer::split_str_utf8(const std::string& word, std::vector<std::string>& split_word, char delim) {
+    if (word.empty()) {
+        return;
+    }
+    // 去除前后%，适配like
+    size_t begin = word[0] == '%' ? 1 : 0;
+    size_t end = word.size();
+    if (end > begin && word[end - 1] == '%') {
+        --end;
+    }
+    size_t last = begin;
+    for (size_t i = begin; i < end; ++i) {
+        if (word[i] == delim) {
+            if (i > last) {
+                split_word.push_back(word.substr(last, i - last));
+            }
+            last = i + 1;
+        }
+    }
+    if (end > last) {
+        split_word.push_back(word.substr(last, end - last));
+    }
+}
+
+void append_varint32(std::string* buf, uint32_t value) {
+    while (value >= 0x80) {
+        buf->append(1, (char)(value | 0x80));
+        value >>= 7;
+    }
+    buf->append(1, (char)value);
+}
+
+bool get_varint32(rocksdb::Slice* input, uint32_t* value) {
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift <= 28 && !input->empty(); shift += 7) {
+        uint32_t byte = (uint8_t)(*input)[0];
+        input->remove_prefix(1);
+        result |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+void append_block_version(std::string& key, uint64_t version) {
+    uint64_t version_encode = KeyEncoder::to_endian_u64(version);
+    key.append((char*)&version_encode, sizeof(uint64_t));
+}
+
+void append_block_id(std::string& key, uint32_t block_id) {
+    uint32_t id_encode = KeyEncoder::to_endian_u32(block_id);
+    key.append((char*)&id_encode, sizeof(uint32_t));
+}
+
 bool is_prefix_end(std::unique_ptr<rocksdb::Iterator>& iterator, uint8_t level) {
     if (iterator->Valid()) {
         uint8_t level_ = get_level_from_reverse_key(iterator->key());
@@ -58,6 +58,15 @@ int CommonSchema::segment(
         case pb::S_ES_STANDARD:
             ret = Tokenizer::get_instance()->es_standard_gbk(word, term_map);
             break;
+        case pb::S_UTF8_UNIGRAMS:
+            ret = Tokenizer::get_instance()->ngram_seg_utf8(word, 1, term_map);
+            break;
+        case pb::S_UTF8_BIGRAMS:
+            ret = Tokenizer::get_instance()->ngram_seg_utf8(word, 2, term_map);
+            break;
+        case pb::S_UTF8_DICT:
+            ret = Tokenizer::get_instance()->dict_seg_utf8(word, term_map);
+            break;
 #ifdef BAIDU_INTERNAL
         case pb::S_WORDRANK: 
             ret = Tokenizer::get_instance()->wordrank(word, term_map);
@@ -95,7 +104,11 @@ int CommonSchema::create_executor(const std::string& search_data, pb::SegmentTyp
     std::vector<std::string> or_search;
     // 先用规则支持 or 操作
     // TODO 用bison来支持mysql bool查询
-    Tokenizer::get_instance()->split_str_gbk(search_data, or_search, '|');
+    if (Tokenizer::is_utf8_segment(segment_type)) {
+        Tokenizer::get_instance()->split_str_utf8(search_data, or_search, '|');
+    } else {
+        Tokenizer::get_instance()->split_str_gbk(search_data, or_search, '|');
+    }
     LogicalQuery<CommonSchema> logical_query(this);
     ExecutorNode<CommonSchema>* parent = nullptr;
     ExecutorNode<CommonSchema>* root = &logical_query._root;
@@ -106,7 +119,8 @@ int CommonSchema::create_executor(const std::string& search_data, pb::SegmentTyp
         root->_type = AND;
         root->_merge_func = CommonSchema::merge_and;
     } else {
-        root->_type = OR;
+        //top k检索时用WAND跳过分数上界不够的文档
+        root->_type = _top_k > 0 ? WAND : OR;
         root->_merge_func = CommonSchema::merge_or;
         parent = root;
     }
@@ -127,6 +141,15 @@ int CommonSchema::create_executor(const std::string& search_data, pb::SegmentTyp
             case pb::S_ES_STANDARD:
                 ret = Tokenizer::get_instance()->es_standard_gbk(or_item, term_map);
                 break;
+            case pb::S_UTF8_UNIGRAMS:
+                ret = Tokenizer::get_instance()->ngram_seg_utf8(or_item, 1, term_map);
+                break;
+            case pb::S_UTF8_BIGRAMS:
+                ret = Tokenizer::get_instance()->ngram_seg_utf8(or_item, 2, term_map);
+                break;
+            case pb::S_UTF8_DICT:
+                ret = Tokenizer::get_instance()->dict_seg_utf8(or_item, term_map);
+                break;
 #ifdef BAIDU_INTERNAL
             case pb::S_WORDRANK: 
                 ret = Tokenizer::get_instance()->wordrank(or_item, term_map);
@@ -0,0 +1,238 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "trace_analyzer.h"
+#include <algorithm>
+#include <gflags/gflags.h>
+
+namespace baikaldb {
+DEFINE_int32(analyze_slow_region_num, 5, "slowest regions listed by explain analyze, default:5");
+
+static int64_t local_time(const pb::TraceNode& node) {
+    return node.open_trace().time_cost_us() + node.get_next_trace().time_cost_us();
+}
+
+static int64_t local_rows(const pb::TraceNode& node) {
+    if (node.has_get_next_trace()) {
+        return node.get_next_trace().affect_rows();
+    }
+    return node.open_trace().affect_rows();
+}
+
+static std::string local_info(const pb::TraceNode& node) {
+    if (node.has_get_next_trace()) {
+        return node.get_next_trace().description();
+    }
+    return node.open_trace().description();
+}
+
+static std::string region_name(const pb::TraceNode* region) {
+    if (region == nullptr) {
+        return "";
+    }
+    return std::to_string(region->region_id()) + "@" + region->instance();
+}
+
+static std::string min_avg_max(int64_t min, int64_t sum, int64_t max, int64_t count) {
+    if (count == 0) {
+        return "";
+    }
+    return std::to_string(min) + "/" + std::to_string(sum / count) + "/" + std::to_string(max);
+}
+
+std::vector<std::string> TraceAnalyzer::field_names() {
+    return {"operator", "regions", "rows_in", "rows_out", "time_us(min/avg/max)",
+        "wait_us(min/avg/max)", "cpu_us", "cache_hit", "block_read", "read_bytes",
+        "key_skipped", "seeks", "slowest_region", "info"};
+}
+
+void TraceAnalyzer::OpStat::add_time(int64_t time, const pb::TraceNode* region) {
+    if (count == 0 || time < min_time) {
+        min_time = time;
+    }
+    if (count == 0 || time > max_time) {
+        max_time = time;
+        slowest = region;
+    }
+    sum_time += time;
+    ++count;
+}
+
+void TraceAnalyzer::OpStat::add_local(const pb::LocalTraceNode& local) {
+    cpu_time += local.cpu_time_us();
+    cache_hit += local.block_cache_hit();
+    block_read += local.block_read_count();
+    read_byte += local.block_read_byte();
+    key_skipped += local.key_skipped();
+    seek += local.seek_count();
+}
+
+void TraceAnalyzer::analyze(const pb::TraceNode& root,
+        std::vector<std::vector<std::string>>* rows) {
+    _rows = rows;
+    _region_costs.clear();
+    walk_local(root, 0);
+    // 最慢的几个region单独列出，用于定位数据倾斜或慢实例
+    std::sort(_region_costs.begin(), _region_costs.end(),
+            [](const RegionCost& a, const RegionCost& b) {
+        return a.region->total_time() > b.region->total_time();
+    });
+    size_t num = std::min(_region_costs.size(), (size_t)std::max(FLAGS_analyze_slow_region_num, 0));
+    for (size_t i = 0; i < num; ++i) {
+        const RegionCost& cost = _region_costs[i];
+        OpStat stat;
+        stat.add_time(cost.region->total_time(), cost.region);
+        stat.rows_out = cost.rows;
+        int64_t wait = cost.rpc_time - cost.region->total_time();
+        size_t index = _rows->size();
+        _rows->emplace_back();
+        add_row(index, "region:" + std::to_string(cost.region->region_id()), 0, stat, 0,
+                std::to_string(wait), cost.region->description());
+    }
+}
+
+int64_t TraceAnalyzer::walk_local(const pb::TraceNode& node, int depth) {
+    size_t index = _rows->size();
+    _rows->emplace_back();
+    // 没有node_type的子节点是FetcherStore每个region的rpc，其下是store返回的trace
+    std::vector<Sample> regions;
+    for (auto& child : node.child_nodes()) {
+        if (child.has_node_type()) {
+            continue;
+        }
+        for (auto& store_trace : child.child_nodes()) {
+            if (store_trace.has_region_id()) {
+                regions.push_back({&child, &store_trace});
+            }
+        }
+    }
+    int64_t rows_in = 0;
+    for (auto& child : node.child_nodes()) {
+        if (!child.has_node_type()) {
+            continue;
+        }
+        // 下推到store的算子在本地没有执行
+        if (!regions.empty() && !child.has_open_trace() && !child.has_get_next_trace()) {
+            continue;
+        }
+        rows_in += walk_local(child, depth + 1);
+    }
+    if (!regions.empty()) {
+        rows_in += walk_store(regions, depth + 1);
+    }
+    OpStat stat;
+    stat.add_time(local_time(node), nullptr);
+    stat.add_local(node.open_trace());
+    stat.add_local(node.get_next_trace());
+    stat.rows_out = local_rows(node);
+    add_row(index, pb::PlanNodeType_Name(node.node_type()), depth, stat, rows_in, "",
+            local_info(node));
+    return stat.rows_out;
+}
+
+int64_t TraceAnalyzer::walk_store(const std::vector<Sample>& regions, int depth) {
+    size_t index = _rows->size();
+    _rows->emplace_back();
+    std::vector<Sample> roots;
+    OpStat stat;
+    int64_t min_wait = 0;
+    int64_t max_wait = 0;
+    int64_t sum_wait = 0;
+    for (auto& sample : regions) {
+        const pb::TraceNode* region = sample.region;
+        // sample.node是frontend端的rpc节点
+        int64_t wait = sample.node->total_time() - region->total_time();
+        if (stat.count == 0 || wait < min_wait) {
+            min_wait = wait;
+        }
+        if (stat.count == 0 || wait > max_wait) {
+            max_wait = wait;
+        }
+        sum_wait += wait;
+        stat.add_time(region->total_time(), region);
+        int64_t rows = 0;
+        if (region->child_nodes_size() > 0) {
+            roots.push_back({&region->child_nodes(0), region});
+            rows = local_rows(region->child_nodes(0));
+        }
+        _region_costs.push_back({region, sample.node->total_time(), rows});
+    }
+    int64_t rows_in = 0;
+    if (!roots.empty()) {
+        rows_in = walk_merged(roots, depth + 1);
+    }
+    stat.rows_out = rows_in;
+    add_row(index, "STORE", depth, stat, rows_in,
+            min_avg_max(min_wait, sum_wait, max_wait, stat.count), "");
+    return stat.rows_out;
+}
+
+int64_t TraceAnalyzer::walk_merged(const std::vector<Sample>& samples, int depth) {
+    size_t index = _rows->size();
+    _rows->emplace_back();
+    int max_children = 0;
+    for (auto& sample : samples) {
+        max_children = std::max(max_children, sample.node->child_nodes_size());
+    }
+    // 各region计划相同，按位置合并子节点
+    int64_t rows_in = 0;
+    for (int i = 0; i < max_children; ++i) {
+        std::vector<Sample> children;
+        for (auto& sample : samples) {
+            if (i < sample.node->child_nodes_size()) {
+                children.push_back({&sample.node->child_nodes(i), sample.region});
+            }
+        }
+        rows_in += walk_merged(children, depth + 1);
+    }
+    OpStat stat;
+    for (auto& sample : samples) {
+        stat.add_time(local_time(*sample.node), sample.region);
+        stat.add_local(sample.node->open_trace());
+        stat.add_local(sample.node->get_next_trace());
+        stat.rows_out += local_rows(*sample.node);
+    }
+    std::string info;
+    for (auto& sample : samples) {
+        if (sample.region == stat.slowest) {
+            info = local_info(*sample.node);
+            break;
+        }
+    }
+    add_row(index, pb::PlanNodeType_Name(samples[0].node->node_type()), depth, stat, rows_in,
+            "", info);
+    return stat.rows_out;
+}
+
+void TraceAnalyzer::add_row(size_t index, const std::string& name, int depth,
+        const OpStat& stat, int64_t rows_in, const std::string& wait, const std::string& info) {
+    std::vector<std::string>& row = (*_rows)[index];
+    row.push_back(std::string(depth * 2, ' ') + name);
+    row.push_back(stat.slowest == nullptr ? "" : std::to_string(stat.count));
+    row.push_back(std::to_string(rows_in));
+    row.push_back(std::to_string(stat.rows_out));
+    row.push_back(min_avg_max(stat.min_time, stat.sum_time, stat.max_time, stat.count));
+    row.push_back(wait);
+    row.push_back(std::to_string(stat.cpu_time));
+    row.push_back(std::to_string(stat.cache_hit));
+    row.push_back(std::to_string(stat.block_read));
+    row.push_back(std::to_string(stat.read_byte));
+    row.push_back(std::to_string(stat.key_skipped));
+    row.push_back(std::to_string(stat.seek));
+    row.push_back(region_name(stat.slowest));
+    row.push_back(info);
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
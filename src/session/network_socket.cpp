@@ -136,6 +136,7 @@ bool NetworkSocket::reset_when_err() {
     is_handshake_send_partly = 0;
     self_buf->byte_array_clear();
     send_buf->byte_array_clear();
+    send_iobuf.clear();
     has_error_packet = false;
     query_ctx.reset(new QueryContext);
     return 0;
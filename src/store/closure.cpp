@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "closure.h"
+#include "store_scheduler.h"
 
 namespace baikaldb {
 DECLARE_int64(print_time_us);
@@ -49,6 +50,7 @@ void DMLClosure::Run() {
     if (region != nullptr && (op_type == pb::OP_INSERT || op_type == pb::OP_DELETE || op_type == pb::OP_UPDATE)) {
         region->update_average_cost(cost.get_time());
     }
+    StoreScheduler::get_instance()->record_foreground_latency(cost.get_time());
     if (cost.get_time() > FLAGS_print_time_us) {
         DB_NOTICE("dml log_id:%lu, type:%s, raft_total_cost:%ld, region_id: %ld, "
                     "qps:%ld, average_cost:%ld, num_prepared:%d remote_side:%s",
@@ -64,6 +66,20 @@ void DMLClosure::Run() {
     delete this;
 }
 
+void CombinedInsertClosure::Run() {
+    for (auto closure : closures) {
+        if (!status().ok()) {
+            closure->status() = status();
+        } else if (combined_response.has_errcode() && combined_response.errcode() != pb::SUCCESS) {
+            // 整条日志失败(如解析失败)，各条insert都返回该错误
+            closure->response->set_errcode(combined_response.errcode());
+            closure->response->set_errmsg(combined_response.errmsg());
+        }
+        closure->Run();
+    }
+    delete this;
+}
+
 void AddPeerClosure::Run() {
     if (!status().ok()) {
         DB_WARNING("region add peer fail, new_instance:%s, status:%s, region_id: %ld, cost:%ld", 
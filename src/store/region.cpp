@@ -20,6 +20,7 @@
 #include "mem_row_descriptor.h"
 #include "exec_node.h"
 #include "table_record.h"
+#include "column_chunk.h"
 #include "my_raft_log_storage.h"
 #include "log_entry_reader.h"
 #include "raft_log_compaction_filter.h"
@@ -49,7 +50,19 @@ DEFINE_int64(snapshot_log_exec_time_s, 60, "save_snapshot when log entries apply
 //分裂判断标准，如果3600S没有收到请求，则认为分裂失败
 DEFINE_int64(split_duration_us, 3600 * 1000 * 1000LL, "split duration time : 3600s");
 DEFINE_int64(compact_delete_lines, 200000, "compact when _num_delete_lines > compact_delete_lines");
+DEFINE_int64(heartbeat_used_size_bucket, 64 * 1024 * 1024LL,
+            "used_size change below this bucket is not reported in incremental heart beat");
+DEFINE_int64(heartbeat_table_lines_bucket, 10000,
+            "num_table_lines change below this bucket is not reported in incremental heart beat");
+DEFINE_int64(write_combine_wait_us, 1000,
+            "max time a non-transactional insert waits for others to share one raft entry");
+DEFINE_int32(write_combine_max_num, 64, "max inserts combined into one raft entry");
+DEFINE_int64(cstore_chunk_build_rows, 1000000, "max primary keys scanned by one column chunk build");
 DECLARE_int64(print_time_us);
+bvar::Adder<int64_t> write_combine_entries("store_write_combine_entries");
+bvar::Adder<int64_t> write_combine_reqs("store_write_combine_reqs");
+bvar::Adder<int64_t> column_chunk_build_count("store_column_chunk_build_count");
+bvar::Adder<int64_t> column_chunk_abort_count("store_column_chunk_abort_count");
 
 //const size_t  Region::REGION_MIN_KEY_SIZE = sizeof(int64_t) * 2 + sizeof(uint8_t);
 const uint8_t Region::PRIMARY_INDEX_FLAG = 0x01;                                   
@@ -77,7 +90,16 @@ int Region::init(bool new_region, int32_t snapshot_times) {
     ON_SCOPE_EXIT([this]() {
         _can_heartbeat = true;
     });
-    _data_cf = _rocksdb->get_data_handle();
+    // 表配置了独立column family时，region的全部数据(含索引)都放在该cf
+    pb::ColumnFamilyConf cf_conf;
+    if (_factory->get_cf_conf(get_table_id(), &cf_conf)) {
+        if (_rocksdb->create_table_column_family(get_table_id(), cf_conf) != 0) {
+            DB_FATAL("create column family fail, region_id: %ld, table_id: %ld",
+                    _region_id, get_table_id());
+            return -1;
+        }
+    }
+    _data_cf = _rocksdb->get_data_handle(get_table_id());
     _meta_cf = _rocksdb->get_meta_info_handle();
     _meta_writer = MetaWriter::get_instance();
     TimeCost time_cost;
@@ -143,6 +165,7 @@ int Region::init(bool new_region, int32_t snapshot_times) {
                             index_id,
                             FLAGS_reverse_level2_len,
                             _rocksdb,
+                            _data_cf,
                             segment_type,
                             false, // common need not cache
                             true);
@@ -153,6 +176,7 @@ int Region::init(bool new_region, int32_t snapshot_times) {
                             index_id,
                             FLAGS_reverse_level2_len,
                             _rocksdb,
+                            _data_cf,
                             segment_type,
                             true,
                             false); // xbs need not cache segment
@@ -728,12 +752,6 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
                 //计算存储分离
                 exec_dml_out_txn_query(request, response, done_guard.release());
             } else {
-                butil::IOBuf data;
-                butil::IOBufAsZeroCopyOutputStream wrapper(&data);
-                if (!request->SerializeToZeroCopyStream(&wrapper)) {
-                    cntl->SetFailed(brpc::EREQUEST, "Fail to serialize request");
-                    return;
-                }
                 DMLClosure* c = new DMLClosure;
                 c->cost.reset();
                 c->op_type = op_type;
@@ -742,10 +760,22 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
                 c->done = done_guard.release();
                 c->region = this;
                 c->remote_side = remote_side;
+                // closure接管_real_writing_cond计数，在Run中减少，合并和单独提交都只减一次
+                auto_decrease.release();
+                if (op_type == pb::OP_INSERT && _write_combine && can_combine_insert(*request)) {
+                    combine_insert(request, c);
+                    break;
+                }
+                butil::IOBuf data;
+                butil::IOBufAsZeroCopyOutputStream wrapper(&data);
+                if (!request->SerializeToZeroCopyStream(&wrapper)) {
+                    cntl->SetFailed(brpc::EREQUEST, "Fail to serialize request");
+                    c->Run();
+                    return;
+                }
                 braft::Task task;
                 task.data = &data;
                 task.done = c;
-                auto_decrease.release();
                 _node.apply(task);
             }
         } break;
@@ -952,7 +982,12 @@ void Region::query(google::protobuf::RpcController* controller,
             if (request->txn_infos_size() > 0) {
                 txn_id = request->txn_infos(0).txn_id();
             }
-            if (txn_id == 0 || request->op_type() == pb::OP_TRUNCATE_TABLE) {
+            if (request->op_type() == pb::OP_SELECT && txn_id == 0) {
+                // 非事务读同步执行，计入前台延时
+                TimeCost select_cost;
+                exec_out_txn_query(controller, request, response, done_guard.release());
+                StoreScheduler::get_instance()->record_foreground_latency(select_cost.get_time());
+            } else if (txn_id == 0 || request->op_type() == pb::OP_TRUNCATE_TABLE) {
                 exec_out_txn_query(controller, request, response, done_guard.release());
             } else {
                 exec_in_txn_query(controller, request, response, done_guard.release());
@@ -990,6 +1025,27 @@ void Region::query(google::protobuf::RpcController* controller,
                                             done_guard.release());
             break;
         }
+        case pb::OP_ANALYZE: {
+            // 全region扫描放到后台池里执行，不占用rpc线程，rpc等待扫描结束后返回
+            _multi_thread_cond.increase();
+            google::protobuf::Closure* analyze_done = done_guard.release();
+            auto cancel_analyze = [this, response, analyze_done]() {
+                response->set_errcode(pb::INTERNAL_ERROR);
+                response->set_errmsg("run analyze in background fail");
+                _multi_thread_cond.decrease_signal();
+                analyze_done->Run();
+            };
+            int ret = StoreScheduler::get_instance()->run_background(TASK_PRIORITY_NORMAL,
+                    [this, request, response, analyze_done]() {
+                        brpc::ClosureGuard guard(analyze_done);
+                        analyze(request, response);
+                        _multi_thread_cond.decrease_signal();
+                    }, cancel_analyze);
+            if (ret < 0) {
+                cancel_analyze();
+            }
+            break;
+        }
         default:
             response->set_errcode(pb::UNSUPPORT_REQ_TYPE);
             response->set_errmsg("unsupport request type");
@@ -1494,6 +1550,12 @@ void Region::dml_1pc(const pb::StoreReq& request, pb::OpType op_type,
         response.set_affected_rows(ret);
         response.set_scan_rows(state.num_scan_rows());
         response.set_errcode(pb::SUCCESS);
+        if (state.range_delete_rows > 0) {
+            // 范围删除只写了range tombstone，主动compact回收空间
+            DB_WARNING("region_id: %ld, delete range rows: %ld, do compact in queue",
+                    _region_id, state.range_delete_rows);
+            compact_data_in_queue();
+        }
     } else {
         response.set_errcode(pb::EXEC_FAIL);
         response.set_errmsg("txn commit failed.");
@@ -1592,7 +1654,6 @@ void Region::select(const pb::StoreReq& request,
             
         }
     });
-    
     int ret = 0;
     uint64_t db_conn_id = request.db_conn_id();
     if (db_conn_id == 0) {
@@ -1741,7 +1802,8 @@ void Region::select(const pb::StoreReq& request,
 }
 
 void Region::construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bool need_peer_balance,
-    std::set<int64_t>& ddl_wait_doing_table_ids) {
+    std::set<int64_t>& ddl_wait_doing_table_ids, bool incremental,
+    std::map<int64_t, uint64_t>* heartbeat_digests) {
     if (_shutdown || !_can_heartbeat) {
         return;
     }
@@ -1780,25 +1842,51 @@ void Region::construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bo
     //添加leader的心跳信息，同时更新状态
     std::vector<braft::PeerId> peers;
     if (is_leader() && _node.list_peers(&peers).ok()) {
-        pb::LeaderHeartBeat* leader_heart = request.add_leader_regions();
-        leader_heart->set_status(_region_control.get_status());
-        pb::RegionInfo* leader_region =  leader_heart->mutable_region();
-        copy_region(leader_region);
-        leader_region->set_status(_region_control.get_status());
-        //在分裂线程里更新used_sized
-        leader_region->set_used_size(_region_info.used_size());
-        leader_region->set_leader(_address);
-        //fix bug 不能直接取reigon_info的log index, 
-        //因为如果系统在做过snapshot再重启之后，一直没有数据，
-        //region info里的log index是之前持久化在磁盘的log index, 这个log index不准
-        leader_region->set_log_index(_applied_index);
-        ////填到心跳包中，并且更新本地缓存，只有leader操作
-        //_region_info.set_leader(_address);
-        //_region_info.clear_peers();
-        leader_region->clear_peers();
+        //只有leader/peer/version/status或size、行数所在的桶变化时才需要上报完整信息
+        uint64_t digest = 0;
+        auto hash_combine = [&digest](uint64_t value) {
+            digest ^= value + 0x9e3779b97f4a7c15ULL + (digest << 6) + (digest >> 2);
+        };
+        {
+            std::lock_guard<std::mutex> lock(_region_lock);
+            hash_combine(_region_info.version());
+            hash_combine(_region_info.conf_version());
+            hash_combine(_region_info.used_size() / std::max(FLAGS_heartbeat_used_size_bucket, 1L));
+            hash_combine(_region_info.can_add_peer());
+        }
+        hash_combine(_region_control.get_status());
+        hash_combine(_num_table_lines.load() / std::max(FLAGS_heartbeat_table_lines_bucket, 1L));
+        hash_combine(std::hash<std::string>()(_address));
+        hash_combine(_leader_start_count.load());
         for (auto& peer : peers) {
-            leader_region->add_peers(butil::endpoint2str(peer.addr).c_str());
-            //_region_info.add_peers(butil::endpoint2str(peer.addr).c_str());
+            hash_combine(std::hash<std::string>()(butil::endpoint2str(peer.addr).c_str()));
+        }
+        if (incremental && digest == _last_heartbeat_digest) {
+            request.add_unchanged_leader_region_ids(_region_id);
+        } else {
+            if (heartbeat_digests != nullptr) {
+                (*heartbeat_digests)[_region_id] = digest;
+            }
+            pb::LeaderHeartBeat* leader_heart = request.add_leader_regions();
+            leader_heart->set_status(_region_control.get_status());
+            pb::RegionInfo* leader_region =  leader_heart->mutable_region();
+            copy_region(leader_region);
+            leader_region->set_status(_region_control.get_status());
+            //在分裂线程里更新used_sized
+            leader_region->set_used_size(_region_info.used_size());
+            leader_region->set_leader(_address);
+            //fix bug 不能直接取reigon_info的log index, 
+            //因为如果系统在做过snapshot再重启之后，一直没有数据，
+            //region info里的log index是之前持久化在磁盘的log index, 这个log index不准
+            leader_region->set_log_index(_applied_index);
+            ////填到心跳包中，并且更新本地缓存，只有leader操作
+            //_region_info.set_leader(_address);
+            //_region_info.clear_peers();
+            leader_region->clear_peers();
+            for (auto& peer : peers) {
+                leader_region->add_peers(butil::endpoint2str(peer.addr).c_str());
+                //_region_info.add_peers(butil::endpoint2str(peer.addr).c_str());
+            }
         }
     }
     // peer、leader的ddl信息都放这里。
@@ -1868,6 +1956,10 @@ void Region::on_apply(braft::Iterator& iter) {
                 }
                 break;
             }
+            case pb::OP_COMBINED_INSERT: {
+                apply_combined_insert(request, done, _applied_index, term);
+                break;
+            }
             //分裂时new region处理old region发来的raftlog
             case pb::OP_KV_BATCH_SPLIT: {
                 apply_kv_split(request, done, _applied_index, term);
@@ -1972,6 +2064,121 @@ void Region::apply_kv_in_txn(const pb::StoreReq& request, braft::Closure* done,
     //TODO
 }
 
+// 只合并普通insert/insert ignore：合并日志中途宕机后整条日志会重放，
+// 已写入的行因主键冲突不会重复生效；replace和on duplicate key update重放不幂等，不合并
+bool Region::can_combine_insert(const pb::StoreReq& request) {
+    if (request.txn_infos_size() > 0 && request.txn_infos(0).txn_id() != 0) {
+        return false;
+    }
+    if (request.is_trace() || request.combined_reqs_size() > 0) {
+        return false;
+    }
+    for (auto& node : request.plan().nodes()) {
+        if (node.node_type() != pb::INSERT_NODE) {
+            continue;
+        }
+        const pb::InsertNode& insert_node = node.derive_node().insert_node();
+        if (insert_node.is_replace() || insert_node.update_exprs_size() > 0) {
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// 第一个到达的请求等待FLAGS_write_combine_wait_us或凑满FLAGS_write_combine_max_num条，
+// 然后把窗口内的请求合并成一条raft日志，其他请求直接返回，由closure回调
+void Region::combine_insert(const pb::StoreReq* request, DMLClosure* closure) {
+    bthread_mutex_lock(&_combine_mutex);
+    _combine_reqs.push_back(request);
+    _combine_closures.push_back(closure);
+    if (_combine_leader) {
+        if ((int)_combine_reqs.size() >= FLAGS_write_combine_max_num) {
+            bthread_cond_signal(&_combine_cond);
+        }
+        bthread_mutex_unlock(&_combine_mutex);
+        return;
+    }
+    _combine_leader = true;
+    timespec abstime = butil::microseconds_from_now(FLAGS_write_combine_wait_us);
+    while ((int)_combine_reqs.size() < FLAGS_write_combine_max_num) {
+        if (bthread_cond_timedwait(&_combine_cond, &_combine_mutex, &abstime) != 0) {
+            break;
+        }
+    }
+    std::vector<const pb::StoreReq*> reqs;
+    std::vector<DMLClosure*> closures;
+    reqs.swap(_combine_reqs);
+    closures.swap(_combine_closures);
+    _combine_leader = false;
+    bthread_mutex_unlock(&_combine_mutex);
+
+    butil::IOBuf data;
+    butil::IOBufAsZeroCopyOutputStream wrapper(&data);
+    braft::Task task;
+    task.data = &data;
+    if (reqs.size() == 1) {
+        if (!reqs[0]->SerializeToZeroCopyStream(&wrapper)) {
+            closures[0]->response->set_errcode(pb::PARSE_TO_PB_FAIL);
+            closures[0]->response->set_errmsg("Fail to serialize request");
+            closures[0]->Run();
+            return;
+        }
+        task.done = closures[0];
+        _node.apply(task);
+        return;
+    }
+    pb::StoreReq combined_req;
+    combined_req.set_op_type(pb::OP_COMBINED_INSERT);
+    combined_req.set_region_id(_region_id);
+    combined_req.set_region_version(reqs[0]->region_version());
+    for (auto req : reqs) {
+        combined_req.add_combined_reqs()->CopyFrom(*req);
+    }
+    CombinedInsertClosure* c = new CombinedInsertClosure;
+    c->closures.swap(closures);
+    if (!combined_req.SerializeToZeroCopyStream(&wrapper)) {
+        c->combined_response.set_errcode(pb::PARSE_TO_PB_FAIL);
+        c->combined_response.set_errmsg("Fail to serialize request");
+        c->Run();
+        return;
+    }
+    write_combine_entries << 1;
+    write_combine_reqs << reqs.size();
+    task.done = c;
+    _node.apply(task);
+}
+
+void Region::apply_combined_insert(const pb::StoreReq& request, braft::Closure* done, 
+                                   int64_t index, int64_t term) {
+    CombinedInsertClosure* c = (CombinedInsertClosure*)done;
+    int size = request.combined_reqs_size();
+    for (int i = 0; i < size; ++i) {
+        const pb::StoreReq& req = request.combined_reqs(i);
+        pb::StoreRes res;
+        // 除最后一条外持久化的applied_index记为index - 1，中途宕机时整条日志重放
+        int64_t applied_index = (i == size - 1) ? index : index - 1;
+        dml_1pc(req, req.op_type(), req.plan(), req.tuples(), res, applied_index, term);
+        if (c == nullptr || i >= (int)c->closures.size()) {
+            continue;
+        }
+        pb::StoreRes* response = c->closures[i]->response;
+        response->set_errcode(res.errcode());
+        if (res.has_errmsg()) {
+            response->set_errmsg(res.errmsg());
+        }
+        if (res.has_mysql_errcode()) {
+            response->set_mysql_errcode(res.mysql_errcode());
+        }
+        if (res.has_leader()) {
+            response->set_leader(res.leader());
+        }
+        if (res.has_affected_rows()) {
+            response->set_affected_rows(res.affected_rows());
+        }
+    }
+}
+
 void Region::apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done, 
                               int64_t index, int64_t term) {
     int rc = 0;
@@ -2548,6 +2755,8 @@ void Region::on_leader_start() {
     DB_WARNING("leader start, region_id: %ld", _region_id);
     _is_leader.store(true);
     _region_info.set_leader(butil::endpoint2str(_node.leader_id().addr).c_str());
+    //重新成为leader后必须在心跳中完整上报一次
+    ++_leader_start_count;
 }
 
 void Region::on_leader_start(int64_t term) {
@@ -2730,6 +2939,11 @@ int Region::on_snapshot_load(braft::SnapshotReader* reader) {
                     _region_id, time_cost.get_time(), ret);
         //不管是哪种启动方式，prepared的但没有commit的日志都通过log_entry恢复, 所以prepared事务要回滚
         _txn_pool.clear();
+        // 清空和ingest期间不生成chunk
+        _txn_pool.chunk_writer_enter();
+        ON_SCOPE_EXIT([this]() {
+            _txn_pool.chunk_writer_exit();
+        });
         //清空数据
         if (_region_info.version() != 0) {
             DB_WARNING("region_id: %ld, clear_data on_snapshot_load", _region_id);
@@ -2939,7 +3153,7 @@ void Region::reverse_merge() {
 // dump the the tuples in this region in format {{k1:v1},{k2:v2},{k3,v3}...}
 // used for debug
 std::string Region::dump_hex() {
-    auto data_cf = _rocksdb->get_data_handle();
+    auto data_cf = _data_cf;
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed, region_id: %ld", _region_id);
         return "{}";
@@ -2950,7 +3164,7 @@ std::string Region::dump_hex() {
     //key.append_i64(_region_id);
     rocksdb::ReadOptions read_option;
     //read_option.prefix_same_as_start = true;
-    std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_option, RocksWrapper::DATA_CF));
+    std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_option, data_cf));
 
     std::string dump_str("{");
     for (iter->SeekToFirst();
@@ -4266,6 +4480,111 @@ int Region::get_split_key(std::string& split_key) {
     return 0;
 }
 
+void Region::analyze(const pb::StoreReq* request, pb::StoreRes* response) {
+    TimeCost cost;
+    int64_t main_table_id = get_table_id();
+    std::vector<int64_t> indices;
+    if (_is_global_index) {
+        indices.push_back(get_global_index_id());
+    } else {
+        TableInfo table_info = _factory->get_table_info(main_table_id);
+        for (auto index_id : table_info.indices) {
+            if (_factory->is_global_index(index_id)) {
+                continue;
+            }
+            indices.push_back(index_id);
+        }
+    }
+    IndexInfo pk_info = _factory->get_index_info(main_table_id);
+    SmartRecord record = _factory->new_record(main_table_id);
+    if (record == nullptr) {
+        response->set_errcode(pb::INPUT_PARAM_ERROR);
+        response->set_errmsg("table not found");
+        return;
+    }
+    // 在快照上扫描，不受并发写入影响；扫描期间region分裂或合并时结果作废
+    int64_t region_version = get_version();
+    std::string start_key = get_start_key();
+    std::string end_key = get_end_key();
+    const rocksdb::Snapshot* snapshot = _rocksdb->get_snapshot();
+    ON_SCOPE_EXIT([this, snapshot]() {
+        _rocksdb->relase_snapshot(snapshot);
+    });
+    int64_t estimate_rows = _num_table_lines.load();
+    pb::TableStatistics* statistics = response->mutable_statistics();
+    statistics->set_table_id(main_table_id);
+    for (int64_t index_id : indices) {
+        IndexInfo index_info = _factory->get_index_info(index_id);
+        if (index_info.id == -1 || index_info.state != pb::IS_PUBLIC) {
+            continue;
+        }
+        // 倒排索引的key不是按字段编码的，不做统计
+        if (index_info.type != pb::I_PRIMARY && index_info.type != pb::I_UNIQ 
+                && index_info.type != pb::I_KEY) {
+            continue;
+        }
+        bool is_pk_range = index_info.type == pb::I_PRIMARY || _is_global_index;
+        MutTableKey prefix;
+        prefix.append_i64(_region_id).append_i64(index_id);
+        MutTableKey seek_key(prefix);
+        if (is_pk_range) {
+            seek_key.append_index(start_key);
+        }
+        rocksdb::ReadOptions read_options;
+        read_options.prefix_same_as_start = true;
+        read_options.total_order_seek = false;
+        read_options.fill_cache = false;
+        read_options.snapshot = snapshot;
+        std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_options, _data_cf));
+        IndexStatisticsBuilder builder(index_id, estimate_rows);
+        int64_t count = 0;
+        for (iter->Seek(seek_key.data()); iter->Valid()
+                && iter->key().starts_with(prefix.data()); iter->Next()) {
+            ++count;
+            if (count % 10000 == 0 && (!is_leader() || _shutdown)) {
+                response->set_errcode(pb::NOT_LEADER);
+                response->set_errmsg("not leader");
+                DB_WARNING("analyze interrupted, not leader, region_id: %ld", _region_id);
+                return;
+            }
+            rocksdb::Slice key_slice(iter->key());
+            key_slice.remove_prefix(2 * sizeof(int64_t));
+            if (is_pk_range) {
+                if (!end_key.empty() && key_slice.compare(end_key) >= 0) {
+                    break;
+                }
+            } else if (!Transaction::fits_region_range(key_slice, iter->value(),
+                    &start_key, &end_key, pk_info, index_info)) {
+                continue;
+            }
+            std::string key = key_slice.ToString();
+            if (index_info.type == pb::I_KEY) {
+                // 普通索引key后面拼接了主键，只取索引字段部分计算ndv和高频值
+                int pos = 0;
+                TableKey table_key(key_slice);
+                if (record->decode_key(index_info, table_key, pos) != 0) {
+                    continue;
+                }
+                builder.add(key, key.substr(0, pos));
+            } else {
+                builder.add(key, key);
+            }
+        }
+        builder.finish(statistics->add_indexes());
+    }
+    if (get_version() != region_version) {
+        response->clear_statistics();
+        response->set_errcode(pb::VERSION_OLD);
+        response->set_errmsg("region version changed during analyze");
+        DB_WARNING("region_id: %ld version changed during analyze, old version: %ld",
+                _region_id, region_version);
+        return;
+    }
+    response->set_errcode(pb::SUCCESS);
+    DB_WARNING("region_id: %ld analyze finish, index_num: %d, num_table_lines: %ld, cost: %ld",
+            _region_id, statistics->indexes_size(), estimate_rows, cost.get_time());
+}
+
 int Region::ddlwork_process(const pb::DdlWorkInfo& store_ddl_work) {
 
     _multi_thread_cond.increase();
@@ -4338,8 +4657,7 @@ int Region::ddlwork_add_index_process() {
         if (schema_index_state == pb::IS_WRITE_LOCAL && !_ddl_param.is_start) {
             _ddl_param.is_start = true;
             DB_NOTICE("DDL_LOG region_%lld start_add_index.", _region_id);
-            Bthread bth(&BTHREAD_ATTR_NORMAL);
-            bth.run(std::bind(&Region::start_add_index, this));
+            run_ddl_in_background(&Region::start_add_index);
         }
     }
     return 0;   
@@ -4376,6 +4694,7 @@ int Region::add_reverse_index() {
                 index.id,
                 FLAGS_reverse_level2_len,
                 _rocksdb,
+                _data_cf,
                 segment_type,
                 false, // common need not cache
                 true
@@ -4728,20 +5047,38 @@ int Region::ddlwork_del_index_process() {
         if (schema_index_state == pb::IS_DELETE_LOCAL && !_ddl_param.is_start) {
             DB_NOTICE("DDL_LOG region_%lld start_drop_index", _region_id);
             _ddl_param.is_start = true;
-            Bthread bth(&BTHREAD_ATTR_NORMAL);
-            bth.run(std::bind(&Region::start_drop_index, this));
+            run_ddl_in_background(&Region::start_drop_index);
         }
     }
     return 0;   
 }
 
-void Region::start_add_index() {
-
+// 调用方持有_region_ddl_lock
+// 计数在提交前增加，覆盖任务在队列里等待的时间，任务执行完或被取消时减少
+void Region::run_ddl_in_background(void (Region::*ddl_func)()) {
     _multi_thread_cond.increase();
-    ON_SCOPE_EXIT([this]() {
+    int ret = StoreScheduler::get_instance()->run_background(TASK_PRIORITY_NORMAL,
+            [this, ddl_func]() {
+                (this->*ddl_func)();
+                _multi_thread_cond.decrease_signal();
+            },
+            [this]() {
+                DB_WARNING("DDL_LOG region_%lld ddl task canceled", _region_id);
+                {
+                    BAIDU_SCOPED_LOCK(_region_ddl_lock);
+                    _ddl_param.is_start = false;
+                }
+                _multi_thread_cond.decrease_signal();
+            });
+    if (ret < 0) {
+        // 下次ddl心跳重新提交
+        DB_WARNING("DDL_LOG region_%lld run ddl in background fail", _region_id);
+        _ddl_param.is_start = false;
         _multi_thread_cond.decrease_signal();
-    });
+    }
+}
 
+void Region::start_add_index() {
     while (_ddl_param.delete_only_count != 0 || _ddl_param.delete_local_count != 0 || 
         _ddl_param.none_count != 0) {
         DB_WARNING("DDL_LOG region_%lld wait schema ddlinfo[%s] delete_count[%lld] delete_local[%lld] none_count[%lld]", 
@@ -4811,12 +5148,6 @@ void Region::ddlwork_finish_check_process(std::set<int64_t>& ddlwork_table_ids)
 }
 
 void Region::start_drop_index() {    
-
-    _multi_thread_cond.increase();
-    ON_SCOPE_EXIT([this]() {
-        _multi_thread_cond.decrease_signal();
-    });
-
     TimeCost drop_index_time;
     while (_ddl_param.write_only_count != 0 || _ddl_param.write_local_count != 0 ||
         _ddl_param.public_count != 0) {
@@ -4976,4 +5307,195 @@ void Region::ttl_remove_expired_data() {
     DB_WARNING("end ttl_remove_expired_data, cost: %ld region_id: %ld, num_table_lines: %ld ", 
             time_cost.get_time(), _region_id, _num_table_lines.load());
 }
+
+// chunk是本地数据的派生，和ttl删除一样各副本自己生成，不走raft
+// 不加行锁也不占_region_control：先取pool中的chunk版本再取snapshot，从snapshot生成chunk，
+// 写入时版本不变且没有进行中的写入才落盘，否则放弃这一段；之后的写入会删除覆盖它的chunk
+void Region::build_column_chunk() {
+    if (!FLAGS_cstore_use_chunk || _use_ttl || _is_global_index || _shutdown) {
+        return;
+    }
+    int64_t table_id = get_table_id();
+    if (_factory->get_table_engine(table_id) != pb::ROCKSDB_CSTORE) {
+        return;
+    }
+    _multi_thread_cond.increase();
+    ON_SCOPE_EXIT([this]() {
+        _multi_thread_cond.decrease_signal();
+    });
+    TimeCost time_cost;
+    TableInfo table_info = _factory->get_table_info(table_id);
+    IndexInfo pk_info = _factory->get_index_info(table_id);
+    std::set<int32_t> pk_field_ids;
+    for (auto& field_info : pk_info.fields) {
+        pk_field_ids.insert(field_info.id);
+    }
+    std::vector<FieldInfo*> fields;
+    for (auto& field_info : table_info.fields) {
+        if (pk_field_ids.count(field_info.id) == 0) {
+            fields.push_back(&field_info);
+        }
+    }
+    SmartRecord record = _factory->new_record(table_id);
+    if (record == nullptr) {
+        return;
+    }
+    MutTableKey pk_prefix;
+    pk_prefix.append_i64(_region_id).append_i64(table_id);
+    MutTableKey chunk_prefix = ColumnChunkCodec::chunk_prefix(_region_id, table_id, 0);
+    std::string end_key = get_end_key();
+    int64_t region_version = get_version();
+
+    std::string start_key = _chunk_build_key;
+    int64_t scan_rows = 0;
+    int64_t build_num = 0;
+    while (scan_rows < FLAGS_cstore_chunk_build_rows && !_shutdown) {
+        // 有进行中的写入，等下一轮
+        int64_t chunk_version = _txn_pool.chunk_version();
+        if (chunk_version < 0) {
+            break;
+        }
+        const rocksdb::Snapshot* snapshot = _rocksdb->get_snapshot();
+        ON_SCOPE_EXIT([this, snapshot]() {
+            _rocksdb->relase_snapshot(snapshot);
+        });
+        rocksdb::ReadOptions read_options;
+        read_options.prefix_same_as_start = true;
+        read_options.total_order_seek = false;
+        read_options.snapshot = snapshot;
+
+        // 跳过已有chunk覆盖的区间，下一个chunk的起点是本段上界
+        std::unique_ptr<rocksdb::Iterator> chunk_iter(_rocksdb->new_iterator(read_options, _data_cf));
+        MutTableKey seek_key = chunk_prefix;
+        seek_key.append_index(start_key);
+        chunk_iter->SeekForPrev(seek_key.data());
+        if (chunk_iter->Valid() && chunk_iter->key().starts_with(chunk_prefix.data())) {
+            std::string last_key;
+            rocksdb::Slice value = chunk_iter->value();
+            if (0 == ColumnChunkCodec::decode_last_key(value.data(), value.size(), &last_key)
+                    && rocksdb::Slice(start_key).compare(last_key) <= 0) {
+                start_key = last_key;
+                start_key.push_back('\0');
+                seek_key = chunk_prefix;
+                seek_key.append_index(start_key);
+            }
+        }
+        chunk_iter->Seek(seek_key.data());
+        bool has_next_chunk = chunk_iter->Valid() && chunk_iter->key().starts_with(chunk_prefix.data());
+        std::string next_chunk_key;
+        if (has_next_chunk) {
+            next_chunk_key = chunk_iter->key().ToString().substr(chunk_prefix.size());
+        }
+
+        std::vector<std::string> keys;
+        std::unique_ptr<rocksdb::Iterator> pk_iter(_rocksdb->new_iterator(read_options, _data_cf));
+        MutTableKey pk_seek_key = pk_prefix;
+        pk_seek_key.append_index(start_key);
+        for (pk_iter->Seek(pk_seek_key.data()); pk_iter->Valid(); pk_iter->Next()) {
+            rocksdb::Slice pk = pk_iter->key();
+            pk.remove_prefix(pk_prefix.size());
+            if (end_key_compare(pk, end_key) >= 0) {
+                break;
+            }
+            if (has_next_chunk && pk.compare(next_chunk_key) >= 0) {
+                break;
+            }
+            keys.emplace_back(pk.data(), pk.size());
+            if ((int)keys.size() >= FLAGS_cstore_chunk_rows) {
+                break;
+            }
+        }
+        scan_rows += keys.size();
+        if ((int)keys.size() < FLAGS_cstore_chunk_rows) {
+            // 不足一个chunk的区间留在单元格中
+            if (!has_next_chunk) {
+                start_key.clear();
+                break;
+            }
+            start_key = next_chunk_key;
+            continue;
+        }
+        start_key = keys.back();
+        start_key.push_back('\0');
+
+        rocksdb::WriteBatch batch;
+        bool put_ok = true;
+        std::vector<ColumnZoneMap> zone_maps(fields.size());
+        for (size_t i = 0; i < fields.size(); i++) {
+            FieldInfo* field = fields[i];
+            MutTableKey cell_prefix;
+            cell_prefix.append_i64(_region_id).append_i32(table_id).append_i32(field->id);
+            MutTableKey cell_seek_key = cell_prefix;
+            cell_seek_key.append_index(keys[0]);
+            std::unique_ptr<rocksdb::Iterator> cell_iter(_rocksdb->new_iterator(read_options, _data_cf));
+            cell_iter->Seek(cell_seek_key.data());
+            const FieldDescriptor* field_desc = record->get_field_by_tag(field->id);
+            ColumnChunk chunk;
+            chunk.kind = ColumnChunkCodec::value_kind(field->type);
+            for (auto& key : keys) {
+                int cmp = -1;
+                while (cell_iter->Valid() && cell_iter->key().starts_with(cell_prefix.data())) {
+                    rocksdb::Slice cell_pk = cell_iter->key();
+                    cell_pk.remove_prefix(cell_prefix.size());
+                    cmp = cell_pk.compare(key);
+                    if (cmp >= 0) {
+                        break;
+                    }
+                    cell_iter->Next();
+                }
+                if (cmp == 0 && cell_iter->Valid() && cell_iter->key().starts_with(cell_prefix.data())) {
+                    std::string value = cell_iter->value().ToString();
+                    if (0 != record->decode_field(*field, value)) {
+                        DB_WARNING("decode value failed, region_id: %ld, field_id: %d",
+                                _region_id, field->id);
+                        put_ok = false;
+                        break;
+                    }
+                    ColumnChunkCodec::append_value(record->get_value(field_desc), &chunk);
+                } else {
+                    ColumnChunkCodec::append_value(field->default_expr_value, &chunk);
+                }
+            }
+            if (!put_ok) {
+                break;
+            }
+            ColumnChunkCodec::build_zone_map(chunk, field->id, &zone_maps[i]);
+            MutTableKey key = ColumnChunkCodec::chunk_prefix(_region_id, table_id, field->id);
+            key.append_index(keys[0]);
+            std::string value;
+            ColumnChunkCodec::encode(chunk, &value);
+            batch.Put(_data_cf, key.data(), value);
+        }
+        if (!put_ok) {
+            continue;
+        }
+        MutTableKey key = chunk_prefix;
+        key.append_index(keys[0]);
+        std::string value;
+        ColumnChunkCodec::encode_keys(keys, zone_maps, &value);
+        batch.Put(_data_cf, key.data(), value);
+        bool installed = _txn_pool.install_chunk(chunk_version, [this, &batch, region_version]() {
+            // split/merge改了范围，chunk可能超出本region
+            if (get_version() != region_version) {
+                return false;
+            }
+            auto s = _rocksdb->write(rocksdb::WriteOptions(), &batch);
+            if (!s.ok()) {
+                DB_WARNING("write chunk failed, region_id: %ld, status: %s",
+                        _region_id, s.ToString().c_str());
+                return false;
+            }
+            return true;
+        });
+        if (!installed) {
+            column_chunk_abort_count << 1;
+            continue;
+        }
+        ++build_num;
+        column_chunk_build_count << 1;
+    }
+    _chunk_build_key = start_key;
+    DB_WARNING("build_column_chunk, scan rows: %ld, build chunks: %ld, cost: %ld, region_id: %ld",
+            scan_rows, build_num, time_cost.get_time(), _region_id);
+}
 } // end of namespace
@@ -16,6 +16,7 @@
 #include <boost/filesystem.hpp>
 #include "rpc_sender.h"
 #include "store.h"
+#include "meta_writer.h"
 #include "concurrency.h"
 #include "region.h"
 #include "mut_table_key.h"
@@ -28,6 +29,20 @@ DECLARE_string(snapshot_uri);
 DECLARE_string(stable_uri);
 DECLARE_int32(election_timeout_ms);
 DEFINE_int32(compact_interval, 1, "compact_interval xx (s)");
+rocksdb::ColumnFamilyHandle* RegionControl::get_data_cf(int64_t region_id) {
+    auto rocksdb = RocksWrapper::get_instance();
+    SmartRegion region = Store::get_instance()->get_region(region_id);
+    if (region != nullptr && region->get_data_cf() != nullptr) {
+        return region->get_data_cf();
+    }
+    // region不在内存中(重启时清理)，按持久化的region info路由
+    pb::RegionInfo region_info;
+    if (MetaWriter::get_instance()->read_region_info(region_id, region_info) == 0) {
+        return rocksdb->get_data_handle(region_info);
+    }
+    return rocksdb->get_data_handle();
+}
+
 int RegionControl::remove_data(int64_t drop_region_id) {
     rocksdb::WriteOptions options;
     MutTableKey start_key;
@@ -38,7 +53,7 @@ int RegionControl::remove_data(int64_t drop_region_id) {
     end_key.append_u64(0xFFFFFFFFFFFFFFFF);
 
     auto rocksdb = RocksWrapper::get_instance();
-    auto data_cf = rocksdb->get_data_handle();
+    auto data_cf = get_data_cf(drop_region_id);
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed, region_id: %ld", drop_region_id);
         return -1;
@@ -64,7 +79,7 @@ void RegionControl::compact_data(int64_t region_id) {
     end_key.append_u64(0xFFFFFFFFFFFFFFFF);
 
     auto rocksdb = RocksWrapper::get_instance();
-    auto data_cf = rocksdb->get_data_handle();
+    auto data_cf = get_data_cf(region_id);
     if (data_cf == nullptr) {
         DB_WARNING("get rocksdb data column family failed, region_id: %ld", region_id);
         return;
@@ -88,7 +103,7 @@ void RegionControl::compact_data_in_queue(int64_t region_id) {
         return;
     }
     in_compact_regions[region_id] = true;
-    Store::get_instance()->compact_queue().run([region_id]() {
+    StoreScheduler::get_instance()->run_background(TASK_PRIORITY_LOW, [region_id]() {
         if (in_compact_regions.count(region_id) == 0) {
             if (!Store::get_instance()->is_shutdown()) {
                 RegionControl::compact_data(region_id);
@@ -167,7 +182,7 @@ int RegionControl::clear_all_infos_for_region(int64_t drop_region_id) {
 int RegionControl::ingest_data_sst(const std::string& data_sst_file, int64_t region_id) {
     auto rocksdb = RocksWrapper::get_instance();
     rocksdb::IngestExternalFileOptions ifo;
-    auto data_cf = rocksdb->get_data_handle();
+    auto data_cf = get_data_cf(region_id);
     auto res = rocksdb->ingest_external_file(data_cf, {data_sst_file}, ifo);
     if (!res.ok()) {
         DB_WARNING("Error while adding file %s, Error %s, region_id: %ld",
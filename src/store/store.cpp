@@ -37,6 +37,7 @@ DECLARE_string(stable_uri);
 DECLARE_string(snapshot_uri);
 DEFINE_int64(reverse_merge_interval_us, 2 * 1000 * 1000,  "reverse_merge_interval(2 s)");
 DEFINE_int64(ttl_remove_interval_s, 24 * 3600,  "ttl_remove_interval_s(24h)");
+DEFINE_int64(column_chunk_interval_s, 60,  "column_chunk_interval_s(60s)");
 //DEFINE_int32(update_status_interval_us, 2 * 1000 * 1000,  "update_status_interval(2 s)");
 DEFINE_int32(store_port, 8110, "Server port");
 DEFINE_string(db_path, "./rocks_db", "rocksdb path");
@@ -50,9 +51,15 @@ DEFINE_int64(flush_region_interval_us, 10 * 60 * 1000 * 1000LL,
 DEFINE_int64(transaction_clear_interval_ms, 1000LL,
             "transaction clear interval, defalut(1s)");
 DEFINE_int32(max_split_concurrency, 2, "max split region concurrency, default:2");
+DEFINE_bool(store_heartbeat_incremental, false,
+            "only report changed leader regions in store heart beat");
+DEFINE_int32(store_heartbeat_full_periodicity, 10,
+            "times of store heart beat to send a full heart beat when incremental");
 DEFINE_int64(none_region_merge_interval_us, 5 * 60 * 1000 * 1000LL, 
              "none region merge interval, defalut(5 min)");
-Store::~Store() {}
+Store::~Store() {
+    bthread_mutex_destroy(&_heart_beat_mutex);
+}
 
 int Store::init_before_listen(std::vector<std::int64_t>& init_region_ids) {
     butil::EndPoint addr;
@@ -185,6 +192,7 @@ int Store::init_before_listen(std::vector<std::int64_t>& init_region_ids) {
     }
 
     start_db_statistics();
+    StoreScheduler::get_instance()->init();
     DB_WARNING("store init_before_listen success");
     return 0;
 }
@@ -216,6 +224,7 @@ int Store::init_after_listen(const std::vector<int64_t>& init_region_ids) {
     _split_check_bth.run([this]() {whether_split_thread();});
     _merge_bth.run([this]() {reverse_merge_thread();});
     _ttl_bth.run([this]() {ttl_remove_thread();});
+    _column_chunk_bth.run([this]() {column_chunk_thread();});
     _flush_bth.run([this]() {flush_region_thread();});
     _snapshot_bth.run([this]() {snapshot_thread();});
     _txn_clear_bth.run([this]() {txn_clear_thread();});
@@ -459,17 +468,26 @@ void Store::compact_region(google::protobuf::RpcController* controller,
     response->set_errcode(pb::SUCCESS);
     response->set_errmsg("success");
     if (request->region_ids_size() == 0) {
-        auto cf = _rocksdb->get_data_handle();
+        std::vector<rocksdb::ColumnFamilyHandle*> cfs;
         if (request->compact_raft_log()) {
-            cf = _rocksdb->get_raft_log_handle();
+            cfs.push_back(_rocksdb->get_raft_log_handle());
+        } else {
+            cfs.push_back(_rocksdb->get_data_handle());
+            std::vector<int64_t> table_ids;
+            _rocksdb->get_table_cf_ids(&table_ids);
+            for (auto table_id : table_ids) {
+                cfs.push_back(_rocksdb->get_data_handle(table_id));
+            }
         }
         TimeCost cost;
         rocksdb::CompactRangeOptions compact_options;
         compact_options.exclusive_manual_compaction = false;
-        auto res = _rocksdb->compact_range(compact_options, cf, nullptr, nullptr);
-        if (!res.ok()) {
-            DB_WARNING("compact_range error: code=%d, msg=%s", 
-                    res.code(), res.ToString().c_str());
+        for (auto cf : cfs) {
+            auto res = _rocksdb->compact_range(compact_options, cf, nullptr, nullptr);
+            if (!res.ok()) {
+                DB_WARNING("compact_range error: code=%d, msg=%s", 
+                        res.code(), res.ToString().c_str());
+            }
         }
         DB_WARNING("compact_db cost:%ld", cost.get_time());
         return;
@@ -595,15 +613,30 @@ void Store::heart_beat_thread() {
 }
 
 void Store::send_heart_beat() {
+    BAIDU_SCOPED_LOCK(_heart_beat_mutex);
     pb::StoreHeartBeatRequest request;
     pb::StoreHeartBeatResponse response;
+    std::map<int64_t, uint64_t> heartbeat_digests;
     //1、构造心跳请求
-    construct_heart_beat_request(request);
+    construct_heart_beat_request(request, &heartbeat_digests);
     print_heartbeat_info(request);
     //2、发送请求
     if (_meta_server_interact.send_request("store_heartbeat", request, response) != 0) {
         DB_WARNING("send heart beat request to meta server fail");
+        //meta未确认本次心跳，增量基线不可信，下次发全量
+        _need_full_heartbeat = true;
     } else {
+        if (response.need_full_heartbeat()) {
+            DB_WARNING("meta server need full heart beat");
+        }
+        _need_full_heartbeat = response.need_full_heartbeat();
+        //meta确认收到后才更新摘要，失败时这些region下次仍完整上报
+        for (auto& pair : heartbeat_digests) {
+            SmartRegion region = get_region(pair.first);
+            if (region != nullptr) {
+                region->commit_heartbeat_digest(pair.second);
+            }
+        }
         //处理心跳
         process_heart_beat_response(response);
     }
@@ -627,9 +660,42 @@ void Store::ttl_remove_thread() {
         if (_shutdown) {
             return;
         }
-        traverse_copy_region_map([](SmartRegion& region) {
-                region->ttl_remove_expired_data();
+        // ttl删除放到后台池，前台延时高时会被延后
+        BthreadCond ttl_cond;
+        traverse_copy_region_map([&ttl_cond](SmartRegion& region) {
+                ttl_cond.increase();
+                int ret = StoreScheduler::get_instance()->run_background(TASK_PRIORITY_LOW, 
+                    [region, &ttl_cond]() {
+                        region->ttl_remove_expired_data();
+                        ttl_cond.decrease_signal();
+                    });
+                if (ret < 0) {
+                    ttl_cond.decrease_signal();
+                }
+                });
+        ttl_cond.wait();
+    }
+}
+
+void Store::column_chunk_thread() {
+    while (!_shutdown) {
+        bthread_usleep_fast_shutdown(FLAGS_column_chunk_interval_s * 1000 * 1000, _shutdown);
+        if (_shutdown) {
+            return;
+        }
+        BthreadCond chunk_cond;
+        traverse_copy_region_map([&chunk_cond](SmartRegion& region) {
+                chunk_cond.increase();
+                int ret = StoreScheduler::get_instance()->run_background(TASK_PRIORITY_LOW,
+                    [region, &chunk_cond]() {
+                        region->build_column_chunk();
+                        chunk_cond.decrease_signal();
+                    });
+                if (ret < 0) {
+                    chunk_cond.decrease_signal();
+                }
                 });
+        chunk_cond.wait();
     }
 }
 
@@ -823,6 +889,9 @@ void Store::whether_split_thread() {
             }
             //设置计算存储分离开关
             ptr_region->set_separate_switch(_factory->get_separate_switch(ptr_region->get_table_id()));
+            //设置insert合并开关
+            ptr_region->set_write_combine_switch(
+                    _factory->get_write_combine_switch(ptr_region->get_table_id()));
             //update region_used_size
             ptr_region->set_used_size(region_sizes[i]);
             
@@ -1010,7 +1079,8 @@ void Store::check_region_legal_complete(int64_t region_id) {
     }
 }
 
-void Store::construct_heart_beat_request(pb::StoreHeartBeatRequest& request) {
+void Store::construct_heart_beat_request(pb::StoreHeartBeatRequest& request,
+        std::map<int64_t, uint64_t>* heartbeat_digests) {
     static int64_t count = 0;
     request.set_need_leader_balance(false);
     ++count;
@@ -1022,6 +1092,14 @@ void Store::construct_heart_beat_request(pb::StoreHeartBeatRequest& request) {
         request.set_need_peer_balance(true);
         need_peer_balance = true;
     }
+    //负载均衡需要完整的leader分布，此时必须发全量
+    bool incremental = FLAGS_store_heartbeat_incremental
+                        && !_need_full_heartbeat
+                        && !request.need_leader_balance()
+                        && !need_peer_balance
+                        && FLAGS_store_heartbeat_full_periodicity > 0
+                        && count % FLAGS_store_heartbeat_full_periodicity != 0;
+    request.set_incremental(incremental);
     //构造instance信息
     pb::InstanceInfo* instance_info = request.mutable_instance_info();
     instance_info->set_address(_address);
@@ -1054,8 +1132,10 @@ void Store::construct_heart_beat_request(pb::StoreHeartBeatRequest& request) {
     });
 
     //构造所有region的version信息
-    traverse_copy_region_map([&request, need_peer_balance, &ddl_wait_doing_table_ids](SmartRegion& region) {
-        region->construct_heart_beat_request(request, need_peer_balance, ddl_wait_doing_table_ids);
+    traverse_copy_region_map([&request, need_peer_balance, incremental, 
+            &ddl_wait_doing_table_ids, heartbeat_digests](SmartRegion& region) {
+        region->construct_heart_beat_request(request, need_peer_balance, 
+                ddl_wait_doing_table_ids, incremental, heartbeat_digests);
     });
 
 }
@@ -1116,6 +1196,7 @@ void Store::process_heart_beat_response(const pb::StoreHeartBeatResponse& respon
                     delete_region_id);
             drop_region_from_store(delete_region_id);        
         }
+        drop_unused_table_cf();
     };
     _remove_region_queue.run(remove_func);
     //ddl work
@@ -1154,11 +1235,36 @@ int Store::drop_region_from_store(int64_t drop_region_id) {
     return 0; 
 }
 
+void Store::drop_unused_table_cf() {
+    std::vector<int64_t> table_ids;
+    _rocksdb->get_table_cf_ids(&table_ids);
+    for (auto table_id : table_ids) {
+        if (_factory->exist_tableid(table_id)) {
+            continue;
+        }
+        bool has_region = false;
+        traverse_region_map([table_id, &has_region](SmartRegion& region) {
+            if (region->get_table_id() == table_id) {
+                has_region = true;
+            }
+        });
+        if (has_region) {
+            continue;
+        }
+        DB_WARNING("table_id: %ld dropped, drop column family", table_id);
+        _rocksdb->drop_table_column_family(table_id);
+    }
+}
+
 void Store::print_heartbeat_info(const pb::StoreHeartBeatRequest& request) {
-    SELF_TRACE("heart beat request(instance_info):%s, need_leader_balance: %d, need_peer_balance: %d", 
+    SELF_TRACE("heart beat request(instance_info):%s, need_leader_balance: %d, need_peer_balance: %d, "
+                "incremental: %d, changed_leader_count: %d, unchanged_leader_count: %d", 
                 request.instance_info().ShortDebugString().c_str(), 
                 request.need_leader_balance(), 
-                request.need_peer_balance());
+                request.need_peer_balance(),
+                request.incremental(),
+                request.leader_regions_size(),
+                request.unchanged_leader_region_ids_size());
     std::string str_schema;
     for (auto& schema_info : request.schema_infos()) {
         str_schema += schema_info.ShortDebugString() + ", ";
@@ -0,0 +1,169 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "store_scheduler.h"
+
+namespace baikaldb {
+DEFINE_int32(store_background_worker_num, 4, "worker num of store background task pool");
+DEFINE_int64(store_background_throttle_latency_us, 500 * 1000LL,
+        "delay background tasks when foreground p99 latency exceeds this value, 0 means no throttle");
+DEFINE_int64(store_background_throttle_min_qps, 1000,
+        "delay background tasks only when foreground qps exceeds this value, default:1000");
+DEFINE_int32(store_background_throttle_sleep_ms, 100, "background task throttle recheck interval");
+DEFINE_int32(store_background_max_throttle_ms, 10 * 1000,
+        "max throttle time of one background task, avoid starvation");
+
+TaskPool::TaskPool(const std::string& name, int worker_num) :
+        _name(name),
+        _worker_num(worker_num),
+        _queue_size("store_" + name + "_pool_queue_size"),
+        _running("store_" + name + "_pool_running"),
+        _throttle_count("store_" + name + "_pool_throttle_count"),
+        _wait_latency("store_" + name + "_pool_wait"),
+        _exec_latency("store_" + name + "_pool_exec") {
+    bthread_mutex_init(&_mutex, NULL);
+    bthread_cond_init(&_cond, NULL);
+}
+
+TaskPool::~TaskPool() {
+    bthread_cond_destroy(&_cond);
+    bthread_mutex_destroy(&_mutex);
+}
+
+void TaskPool::start(const std::function<bool()>& need_throttle) {
+    _need_throttle = need_throttle;
+    _workers.resize(_worker_num);
+    for (auto& worker : _workers) {
+        worker.run([this]() {
+            worker_loop();
+        });
+    }
+    DB_WARNING("task pool: %s start, worker_num: %d", _name.c_str(), _worker_num);
+}
+
+int TaskPool::run(TaskPriority priority, const std::function<void()>& call,
+        const std::function<void()>& cancel) {
+    bthread_mutex_lock(&_mutex);
+    if (_stop) {
+        bthread_mutex_unlock(&_mutex);
+        DB_WARNING("task pool: %s is stopped", _name.c_str());
+        return -1;
+    }
+    _queue.push({priority, _seq++, butil::gettimeofday_us(), call, cancel});
+    _queue_size << 1;
+    bthread_cond_signal(&_cond);
+    bthread_mutex_unlock(&_mutex);
+    return 0;
+}
+
+bool TaskPool::can_run_top() {
+    const Task& task = _queue.top();
+    // 队首不是高优任务时队列里没有高优任务
+    if (task.priority == TASK_PRIORITY_HIGH || _need_throttle == nullptr) {
+        return true;
+    }
+    if (butil::gettimeofday_us() - task.enqueue_time
+            > FLAGS_store_background_max_throttle_ms * 1000LL) {
+        return true;
+    }
+    return !_need_throttle();
+}
+
+void TaskPool::worker_loop() {
+    while (true) {
+        bthread_mutex_lock(&_mutex);
+        while (!_stop) {
+            if (_queue.empty()) {
+                bthread_cond_wait(&_cond, &_mutex);
+                continue;
+            }
+            if (can_run_top()) {
+                break;
+            }
+            // 过载时任务留在队列，新的高优任务到来或超时后重新判断
+            _throttle_count << 1;
+            timespec abstime = butil::milliseconds_from_now(
+                    FLAGS_store_background_throttle_sleep_ms);
+            bthread_cond_timedwait(&_cond, &_mutex, &abstime);
+        }
+        if (_stop) {
+            bthread_mutex_unlock(&_mutex);
+            return;
+        }
+        Task task = _queue.top();
+        _queue.pop();
+        _queue_size << -1;
+        bthread_mutex_unlock(&_mutex);
+
+        _wait_latency << butil::gettimeofday_us() - task.enqueue_time;
+        _running << 1;
+        TimeCost cost;
+        task.call();
+        _exec_latency << cost.get_time();
+        _running << -1;
+    }
+}
+
+void TaskPool::stop() {
+    bthread_mutex_lock(&_mutex);
+    _stop = true;
+    bthread_cond_broadcast(&_cond);
+    bthread_mutex_unlock(&_mutex);
+}
+
+void TaskPool::join() {
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    // worker已全部退出，剩余任务不再执行，调用cancel让提交方回包、释放计数
+    std::vector<Task> canceled;
+    bthread_mutex_lock(&_mutex);
+    while (!_queue.empty()) {
+        canceled.push_back(_queue.top());
+        _queue.pop();
+        _queue_size << -1;
+    }
+    bthread_mutex_unlock(&_mutex);
+    for (auto& task : canceled) {
+        if (task.cancel != nullptr) {
+            task.cancel();
+        }
+    }
+    DB_WARNING("task pool: %s join, cancel tasks: %lu", _name.c_str(), canceled.size());
+}
+
+StoreScheduler::StoreScheduler() :
+        _background_pool("background", FLAGS_store_background_worker_num),
+        _foreground_latency("store_foreground") {
+}
+
+void StoreScheduler::init() {
+    _background_pool.start([this]() {
+        return need_throttle_background();
+    });
+}
+
+// 少量慢查询(大scan)会拉高p99，只有请求量也足够大时才认为前台过载
+bool StoreScheduler::need_throttle_background() {
+    if (FLAGS_store_background_throttle_latency_us <= 0) {
+        return false;
+    }
+    if (_foreground_latency.qps() < FLAGS_store_background_throttle_min_qps) {
+        return false;
+    }
+    return _foreground_latency.latency_percentile(0.99) > FLAGS_store_background_throttle_latency_us;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,16 @@
+#!/bin/sh
+#打开表的insert合并开关，store会把并发的非事务insert合并成一条raft日志
+
+echo -e "\n"
+curl -d '{
+    "op_type":"OP_UPDATE_SCHEMA_CONF",
+    "table_info": {
+        "table_name": "'$2'",
+        "database": "'$3'",
+        "namespace_name": "'$4'",
+        "schema_conf":{
+            "write_combine": true
+        }
+    }
+}' http://$1/MetaService/meta_manager
+echo -e "\n"
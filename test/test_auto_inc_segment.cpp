@@ -0,0 +1,235 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <mutex>
+#include "auto_inc.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int64(auto_incr_segment_min_size);
+DECLARE_int64(auto_incr_segment_max_size);
+DECLARE_int32(auto_incr_prefetch_percent);
+
+// 模拟meta的自增计数，号段连续分配
+struct FakeMeta {
+    std::mutex mutex;
+    int64_t next_id = 1;
+    int fail_count = 0;
+    int fetch_count = 0;
+    std::vector<std::pair<int64_t, int64_t>> segments;
+
+    int fetch(int64_t count, int64_t& start_id, int64_t& end_id) {
+        // 模拟rpc耗时
+        bthread_usleep(1000);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++fetch_count;
+        if (fail_count > 0) {
+            --fail_count;
+            return -1;
+        }
+        start_id = next_id;
+        end_id = next_id + count;
+        next_id = end_id;
+        segments.emplace_back(start_id, end_id);
+        return 0;
+    }
+    // 对应gen_id_from_meta(table_id, 0, max_id)
+    void update(int64_t max_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        next_id = std::max(next_id, max_id + 1);
+    }
+    void set_fail_count(int count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fail_count = count;
+    }
+    int get_fetch_count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fetch_count;
+    }
+};
+
+static SmartAutoIncSegmentCache make_cache(const std::shared_ptr<FakeMeta>& meta) {
+    // 预取的bthread可能晚于用例结束，由回调持有FakeMeta
+    return std::make_shared<AutoIncSegmentCache>(1, 1,
+            [meta](int64_t, int64_t count, int64_t& start_id, int64_t& end_id) {
+                return meta->fetch(count, start_id, end_id);
+            });
+}
+
+static bool wait_fetch_count(const std::shared_ptr<FakeMeta>& meta, int count) {
+    for (int i = 0; i < 1000; ++i) {
+        if (meta->get_fetch_count() >= count) {
+            return true;
+        }
+        bthread_usleep(1000);
+    }
+    return false;
+}
+
+class AutoIncSegmentTest : public testing::Test {
+protected:
+    void SetUp() override {
+        _min_size = FLAGS_auto_incr_segment_min_size;
+        _max_size = FLAGS_auto_incr_segment_max_size;
+        _prefetch_percent = FLAGS_auto_incr_prefetch_percent;
+        // 号段大小固定为10
+        FLAGS_auto_incr_segment_min_size = 10;
+        FLAGS_auto_incr_segment_max_size = 10;
+    }
+    void TearDown() override {
+        FLAGS_auto_incr_segment_min_size = _min_size;
+        FLAGS_auto_incr_segment_max_size = _max_size;
+        FLAGS_auto_incr_prefetch_percent = _prefetch_percent;
+    }
+    int64_t _min_size;
+    int64_t _max_size;
+    int32_t _prefetch_percent;
+};
+
+// 并发分配的id不重复，且每个号段从头连续使用，只有最后使用的号段没有用完
+TEST_F(AutoIncSegmentTest, case_concurrent_alloc) {
+    FLAGS_auto_incr_prefetch_percent = 50;
+    auto meta = std::make_shared<FakeMeta>();
+    SmartAutoIncSegmentCache cache = make_cache(meta);
+    const int concurrency = 20;
+    const int alloc_count = 100;
+    std::mutex mutex;
+    std::vector<int64_t> ids;
+    ConcurrencyBthread con_bth(concurrency);
+    for (int i = 0; i < concurrency; ++i) {
+        con_bth.run([&]() {
+            std::vector<int64_t> local_ids;
+            for (int j = 0; j < alloc_count; ++j) {
+                int64_t id = cache->alloc(1);
+                ASSERT_GT(id, 0);
+                local_ids.push_back(id);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.insert(ids.end(), local_ids.begin(), local_ids.end());
+        });
+    }
+    con_bth.join();
+    ASSERT_EQ(concurrency * alloc_count, (int)ids.size());
+    std::sort(ids.begin(), ids.end());
+    EXPECT_TRUE(std::unique(ids.begin(), ids.end()) == ids.end());
+
+    std::vector<std::pair<int64_t, int64_t>> segments;
+    {
+        std::lock_guard<std::mutex> lock(meta->mutex);
+        segments = meta->segments;
+    }
+    int partial = 0;
+    size_t matched = 0;
+    for (auto& segment : segments) {
+        auto begin = std::lower_bound(ids.begin(), ids.end(), segment.first);
+        auto end = std::lower_bound(ids.begin(), ids.end(), segment.second);
+        int64_t used = end - begin;
+        matched += used;
+        if (used == 0) {
+            // 预取后还没切换到的号段
+            continue;
+        }
+        EXPECT_EQ(segment.first, *begin);
+        EXPECT_EQ(segment.first + used - 1, *(end - 1));
+        if (used < segment.second - segment.first) {
+            ++partial;
+        }
+    }
+    EXPECT_EQ(ids.size(), matched);
+    EXPECT_LE(partial, 1);
+}
+
+// 显式指定的id落在本地号段内时跳过，否则需要通知meta
+TEST_F(AutoIncSegmentTest, case_skip_to) {
+    // 关闭预取，号段切换是确定的
+    FLAGS_auto_incr_prefetch_percent = 0;
+    auto meta = std::make_shared<FakeMeta>();
+    SmartAutoIncSegmentCache cache = make_cache(meta);
+    // 还没有号段
+    EXPECT_FALSE(cache->skip_to(5));
+    meta->update(5);
+    EXPECT_EQ(6, cache->alloc(1));
+    // 当前号段[6, 16)
+    EXPECT_TRUE(cache->skip_to(10));
+    EXPECT_EQ(11, cache->alloc(2));
+    // 小于已分配的id不影响后续分配
+    EXPECT_TRUE(cache->skip_to(3));
+    EXPECT_EQ(13, cache->alloc(1));
+    // 超出号段，号段作废，由meta记录max_id
+    EXPECT_FALSE(cache->skip_to(50));
+    meta->update(50);
+    EXPECT_EQ(51, cache->alloc(1));
+    EXPECT_EQ(2, meta->get_fetch_count());
+    // 等于号段结尾也需要通知meta
+    EXPECT_FALSE(cache->skip_to(61));
+}
+
+// 预取的号段同样会被skip_to跳过
+TEST_F(AutoIncSegmentTest, case_skip_to_prefetched) {
+    FLAGS_auto_incr_prefetch_percent = 100;
+    auto meta = std::make_shared<FakeMeta>();
+    SmartAutoIncSegmentCache cache = make_cache(meta);
+    EXPECT_EQ(1, cache->alloc(1));
+    // 剩余不足100%，触发预取[11, 21)
+    ASSERT_TRUE(wait_fetch_count(meta, 2));
+    bthread_usleep(10 * 1000);
+    EXPECT_TRUE(cache->skip_to(15));
+    // 当前号段已跳过，切换到预取的号段
+    EXPECT_EQ(16, cache->alloc(5));
+}
+
+// 预取失败后下次分配重新预取，同步取号段失败返回-1，之后可以重试
+TEST_F(AutoIncSegmentTest, case_fetch_fail) {
+    FLAGS_auto_incr_prefetch_percent = 50;
+    auto meta = std::make_shared<FakeMeta>();
+    SmartAutoIncSegmentCache cache = make_cache(meta);
+    EXPECT_EQ(1, cache->alloc(5));
+    meta->set_fail_count(1);
+    // 剩余4个，触发预取，预取失败
+    EXPECT_EQ(6, cache->alloc(1));
+    ASSERT_TRUE(wait_fetch_count(meta, 2));
+    bthread_usleep(10 * 1000);
+    // 重新预取成功
+    EXPECT_EQ(7, cache->alloc(1));
+    ASSERT_TRUE(wait_fetch_count(meta, 3));
+    bthread_usleep(10 * 1000);
+    // 已有预取号段，不重复预取
+    EXPECT_EQ(8, cache->alloc(3));
+    // 切换到预取的号段，不再同步请求meta
+    EXPECT_EQ(11, cache->alloc(3));
+    EXPECT_EQ(3, meta->get_fetch_count());
+
+    // 预取和同步取号段都失败
+    meta->set_fail_count(2);
+    EXPECT_EQ(14, cache->alloc(6));
+    ASSERT_TRUE(wait_fetch_count(meta, 4));
+    bthread_usleep(10 * 1000);
+    EXPECT_EQ(-1, cache->alloc(2));
+    EXPECT_EQ(5, meta->get_fetch_count());
+    // 当前号段剩余的id仍然可用，之后重新预取
+    EXPECT_EQ(20, cache->alloc(1));
+    ASSERT_TRUE(wait_fetch_count(meta, 6));
+    bthread_usleep(10 * 1000);
+    EXPECT_EQ(21, cache->alloc(2));
+    EXPECT_EQ(6, meta->get_fetch_count());
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,165 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "baikal_client.h"
+#include "baikal_client_epoll.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    // epoll线程跑到进程结束，回调死锁时用例按超时失败而不是卡在join
+    std::thread epoll_thread([]() {
+        baikal::client::EpollServer::get_instance()->start_server();
+    });
+    epoll_thread.detach();
+    while (!baikal::client::EpollServer::get_instance()->is_running()) {
+        usleep(1000);
+    }
+    return RUN_ALL_TESTS();
+}
+
+namespace baikal {
+namespace client {
+class Waiter {
+public:
+    void notify() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_count;
+        _cond.notify_all();
+    }
+    bool wait(int count) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _cond.wait_for(lock, std::chrono::seconds(5),
+                [this, count]() { return _count >= count; });
+    }
+    int count() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _count;
+    }
+private:
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    int _count = 0;
+};
+
+// 回调在epoll线程里执行，回调中重新注册同一个fd不能死锁
+class ReregisterHandler : public MysqlEventHandler {
+public:
+    ReregisterHandler(int fd, int peer) : _fd(fd), _peer(peer) {
+        _info.handler = this;
+        _info.timeout = 5000;
+    }
+    bool start() {
+        return EpollServer::get_instance()->add_event(_fd, EPOLLIN, &_info);
+    }
+    virtual void on_event(int event_out) {
+        events.push_back(event_out);
+        char c;
+        EXPECT_EQ(1, read(_fd, &c, 1));
+        if (events.size() == 1) {
+            EXPECT_EQ(1, write(_peer, "b", 1));
+            EXPECT_TRUE(start());
+        }
+        waiter.notify();
+    }
+    std::vector<int> events;
+    Waiter waiter;
+private:
+    int _fd;
+    int _peer;
+    MysqlEventInfo _info;
+};
+
+class TimeoutHandler : public MysqlEventHandler {
+public:
+    virtual void on_event(int event_out) {
+        event = event_out;
+        waiter.notify();
+    }
+    int event = 0;
+    Waiter waiter;
+};
+
+class CountHandler : public AsyncQueryHandler {
+public:
+    virtual void on_done(int ret, uint64_t affected_rows) {
+        this->ret = ret;
+        waiter.notify();
+    }
+    int ret = SUCCESS;
+    Waiter waiter;
+};
+
+TEST(test_epoll_server, case_reregister_in_callback) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    ReregisterHandler handler(fds[0], fds[1]);
+    ASSERT_TRUE(handler.start());
+    ASSERT_EQ(1, write(fds[1], "a", 1));
+    ASSERT_TRUE(handler.waiter.wait(2));
+    ASSERT_EQ(2, handler.events.size());
+    EXPECT_TRUE(handler.events[0] & MYSQL_WAIT_READ);
+    EXPECT_TRUE(handler.events[1] & MYSQL_WAIT_READ);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(test_epoll_server, case_timeout) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    TimeoutHandler handler;
+    MysqlEventInfo info;
+    info.handler = &handler;
+    info.timeout = 50;
+    ASSERT_TRUE(EpollServer::get_instance()->add_event(fds[0], EPOLLIN, &info));
+    ASSERT_TRUE(handler.waiter.wait(1));
+    EXPECT_EQ(MYSQL_WAIT_TIMEOUT, handler.event);
+    // 超时后已注销，再有数据也不会重复回调
+    ASSERT_EQ(1, write(fds[1], "a", 1));
+    usleep(300 * 1000);
+    EXPECT_EQ(1, handler.waiter.count());
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 取不到连接时每条sql都恰好回调一次失败，lane和batch自行释放
+TEST(test_async_query, case_fetch_connection_fail) {
+    std::map<std::string, BnsInfo*> bns_infos;
+    Service service(bns_infos, 0, false, true);
+    CountHandler handlers[5];
+    std::vector<AsyncQuery> queries;
+    for (int i = 0; i < 5; ++i) {
+        queries.push_back(AsyncQuery(i, "select 1", &handlers[i]));
+    }
+    EXPECT_EQ(SERVICE_NOT_INIT_ERROR, service.async_query_batch(queries, 2));
+    ASSERT_EQ(SUCCESS, AsyncQueryBatch::start(&service, queries, 2));
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(handlers[i].waiter.wait(1));
+    }
+    usleep(100 * 1000);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(1, handlers[i].waiter.count());
+        EXPECT_EQ(FETCH_CONNECT_FAIL, handlers[i].ret);
+    }
+    EXPECT_EQ(SUCCESS, AsyncQueryBatch::start(&service, std::vector<AsyncQuery>(), 2));
+}
+}  // namespace client
+}  // namespace baikal
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,242 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "column_chunk.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static void check_round_trip(const ColumnChunk& chunk, size_t* encode_size = nullptr) {
+    std::string value;
+    ColumnChunkCodec::encode(chunk, &value);
+    if (encode_size != nullptr) {
+        *encode_size = value.size();
+    }
+    ColumnChunk decode_chunk;
+    ASSERT_EQ(0, ColumnChunkCodec::decode(value.data(), value.size(), &decode_chunk));
+    ASSERT_EQ(chunk.row_count, decode_chunk.row_count);
+    ASSERT_EQ(chunk.kind, decode_chunk.kind);
+    for (size_t i = 0; i < chunk.row_count; ++i) {
+        EXPECT_EQ(chunk.is_null(i), decode_chunk.is_null(i));
+    }
+    EXPECT_EQ(chunk.ints, decode_chunk.ints);
+    EXPECT_EQ(chunk.doubles, decode_chunk.doubles);
+    EXPECT_EQ(chunk.strings, decode_chunk.strings);
+
+    value.resize(value.size() / 2);
+    EXPECT_EQ(-1, ColumnChunkCodec::decode(value.data(), value.size(), &decode_chunk));
+}
+
+TEST(test_column_chunk, case_int) {
+    ColumnChunk chunk;
+    chunk.kind = CHUNK_KIND_INT;
+    // 递增序列走delta bitpack
+    for (int64_t i = 0; i < 4096; ++i) {
+        chunk.ints.push_back(1000000 + i * 3);
+    }
+    chunk.row_count = chunk.ints.size();
+    size_t size = 0;
+    check_round_trip(chunk, &size);
+    EXPECT_LT(size, 4096U);
+
+    // 大量重复值走rle
+    chunk.clear();
+    for (int64_t i = 0; i < 4096; ++i) {
+        chunk.ints.push_back(i / 1000);
+    }
+    chunk.row_count = chunk.ints.size();
+    check_round_trip(chunk, &size);
+    EXPECT_LT(size, 64U);
+
+    // 边界值
+    chunk.clear();
+    chunk.ints = {INT64_MIN, INT64_MAX, 0, -1, 1, INT64_MIN, INT64_MAX};
+    chunk.row_count = chunk.ints.size();
+    check_round_trip(chunk);
+}
+
+TEST(test_column_chunk, case_double_string) {
+    ColumnChunk chunk;
+    chunk.kind = CHUNK_KIND_DOUBLE;
+    for (int i = 0; i < 100; ++i) {
+        chunk.doubles.push_back(i * 0.25);
+    }
+    chunk.row_count = chunk.doubles.size();
+    check_round_trip(chunk);
+
+    chunk.clear();
+    chunk.kind = CHUNK_KIND_STRING;
+    const char* cities[] = {"beijing", "shanghai", "shenzhen"};
+    for (int i = 0; i < 3000; ++i) {
+        chunk.strings.push_back(cities[i % 3]);
+    }
+    chunk.row_count = chunk.strings.size();
+    size_t size = 0;
+    check_round_trip(chunk, &size);
+    // 字典编码每行2bit
+    EXPECT_LT(size, 1000U);
+
+    chunk.clear();
+    for (int i = 0; i < 100; ++i) {
+        chunk.strings.push_back("name_" + std::to_string(i));
+    }
+    chunk.row_count = chunk.strings.size();
+    check_round_trip(chunk);
+}
+
+TEST(test_column_chunk, case_value) {
+    std::vector<pb::PrimitiveType> types = {pb::INT8, pb::INT32, pb::UINT64, pb::DATETIME,
+            pb::TIME, pb::DATE, pb::DOUBLE, pb::STRING};
+    for (auto type : types) {
+        ColumnChunk chunk;
+        chunk.kind = ColumnChunkCodec::value_kind(type);
+        std::vector<ExprValue> values;
+        for (int i = 0; i < 50; ++i) {
+            if (i % 7 == 3) {
+                values.push_back(ExprValue());
+                ColumnChunkCodec::append_value(values.back(), &chunk);
+                continue;
+            }
+            ExprValue value(pb::INT64);
+            value._u.int64_val = i * 11 - 100;
+            if (type == pb::STRING) {
+                value.type = pb::STRING;
+                value.str_val = std::to_string(i % 5);
+            } else {
+                value.cast_to(type);
+            }
+            values.push_back(value);
+            ColumnChunkCodec::append_value(value, &chunk);
+        }
+        ASSERT_EQ(values.size(), chunk.row_count);
+        std::string encode;
+        ColumnChunkCodec::encode(chunk, &encode);
+        ColumnChunk decode_chunk;
+        ASSERT_EQ(0, ColumnChunkCodec::decode(encode.data(), encode.size(), &decode_chunk));
+        for (size_t i = 0; i < values.size(); ++i) {
+            ExprValue value = ColumnChunkCodec::get_value(decode_chunk, i, type);
+            if (values[i].is_null()) {
+                EXPECT_TRUE(value.is_null());
+            } else {
+                EXPECT_EQ(0, values[i].compare(value));
+            }
+        }
+    }
+}
+
+TEST(test_column_chunk, case_keys) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "user_%010d", i * 13);
+        keys.push_back(key);
+    }
+    ColumnChunk chunk;
+    chunk.kind = CHUNK_KIND_INT;
+    for (int i = 0; i < 1000; ++i) {
+        chunk.ints.push_back(i);
+    }
+    chunk.row_count = chunk.ints.size();
+    std::vector<ColumnZoneMap> zone_maps(1);
+    ColumnChunkCodec::build_zone_map(chunk, 2, &zone_maps[0]);
+    std::string value;
+    ColumnChunkCodec::encode_keys(keys, zone_maps, &value);
+    // 前缀压缩
+    EXPECT_LT(value.size(), keys.size() * keys[0].size() / 2);
+    std::string last_key;
+    ASSERT_EQ(0, ColumnChunkCodec::decode_last_key(value.data(), value.size(), &last_key));
+    EXPECT_EQ(keys.back(), last_key);
+    std::vector<std::string> decode_keys;
+    ASSERT_EQ(0, ColumnChunkCodec::decode_keys(value.data(), value.size(), &decode_keys));
+    EXPECT_EQ(keys, decode_keys);
+    std::vector<ColumnZoneMap> decode_zone_maps;
+    ASSERT_EQ(0, ColumnChunkCodec::decode_zone_maps(value.data(), value.size(), &decode_zone_maps));
+    ASSERT_EQ(1U, decode_zone_maps.size());
+    EXPECT_EQ(2, decode_zone_maps[0].field_id);
+    EXPECT_EQ(0, decode_zone_maps[0].min_int);
+    EXPECT_EQ(999, decode_zone_maps[0].max_int);
+
+    value.resize(value.size() - 1);
+    EXPECT_EQ(-1, ColumnChunkCodec::decode_keys(value.data(), value.size(), &decode_keys));
+}
+
+TEST(test_column_chunk, case_zone_map) {
+    ColumnChunk chunk;
+    chunk.kind = CHUNK_KIND_INT;
+    for (int i = 0; i < 100; ++i) {
+        ExprValue value(pb::INT32);
+        value._u.int32_val = 100 + i;
+        ColumnChunkCodec::append_value(i % 10 == 0 ? ExprValue() : value, &chunk);
+    }
+    ColumnZoneMap zone_map;
+    ColumnChunkCodec::build_zone_map(chunk, 1, &zone_map);
+    EXPECT_EQ(10U, zone_map.null_count);
+    EXPECT_EQ(101, zone_map.min_int);
+    EXPECT_EQ(199, zone_map.max_int);
+
+    auto make_pred = [](ZoneOp op, std::vector<int64_t> values) {
+        ZonePredicate pred;
+        pred.field_id = 1;
+        pred.field_type = pb::INT32;
+        pred.op = op;
+        for (auto v : values) {
+            ExprValue literal(pb::INT64);
+            literal._u.int64_val = v;
+            ExprValue value;
+            EXPECT_TRUE(ColumnChunkCodec::convert_zone_value(literal, pb::INT32, &value));
+            pred.values.push_back(value);
+        }
+        return pred;
+    };
+    EXPECT_TRUE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_EQ, {150})));
+    EXPECT_FALSE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_EQ, {200})));
+    EXPECT_FALSE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_LT, {101})));
+    EXPECT_TRUE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_LE, {101})));
+    EXPECT_FALSE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_GT, {199})));
+    EXPECT_TRUE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_GE, {199})));
+    EXPECT_FALSE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_IN, {1, 2, 300})));
+    EXPECT_TRUE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_IN, {1, 120})));
+    EXPECT_TRUE(ColumnChunkCodec::may_match(zone_map, make_pred(ZONE_IS_NULL, {})));
+
+    // 整数列不用浮点常量过滤
+    ExprValue literal(pb::DOUBLE);
+    literal._u.double_val = 2.5;
+    ExprValue value;
+    EXPECT_FALSE(ColumnChunkCodec::convert_zone_value(literal, pb::INT32, &value));
+
+    ColumnChunk str_chunk;
+    str_chunk.kind = CHUNK_KIND_STRING;
+    str_chunk.strings = {"beijing", "shanghai"};
+    str_chunk.row_count = 2;
+    ColumnChunkCodec::build_zone_map(str_chunk, 3, &zone_map);
+    ZonePredicate pred;
+    pred.field_id = 3;
+    pred.field_type = pb::STRING;
+    pred.op = ZONE_EQ;
+    ExprValue str(pb::STRING);
+    str.str_val = "guangzhou";
+    pred.values.push_back(str);
+    EXPECT_TRUE(ColumnChunkCodec::may_match(zone_map, pred));
+    pred.values[0].str_val = "tianjin";
+    EXPECT_FALSE(ColumnChunkCodec::may_match(zone_map, pred));
+    pred.op = ZONE_IS_NULL;
+    EXPECT_FALSE(ColumnChunkCodec::may_match(zone_map, pred));
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -31,6 +31,7 @@
 #include "common.h"
 #include "password.h"
 #include "schema_factory.h"
+#include "lru_cache.h"
 
 int main(int argc, char* argv[])
 {
@@ -213,4 +214,29 @@ TEST(ThreadSafeMap, count) {
     }
 }
 
+TEST(ShardedCache, capacity) {
+    ShardedCache<int64_t, std::string> cache;
+    // 1个分片，容量100字节
+    cache.init(100, nullptr, 0);
+    for (int64_t i = 0; i < 10; ++i) {
+        ASSERT_EQ(cache.add(i, std::to_string(i), 20), 0);
+    }
+    // 只保留最近的5个
+    ASSERT_EQ(cache.usage(), 100);
+    std::string value;
+    ASSERT_EQ(cache.find(4, &value), -1);
+    ASSERT_EQ(cache.find(5, &value), 0);
+    ASSERT_EQ(value, "5");
+    // 5被访问过，淘汰6
+    ASSERT_EQ(cache.add(10, "10", 20), 0);
+    ASSERT_EQ(cache.check(5), 0);
+    ASSERT_EQ(cache.check(6), -1);
+    // 超过分片容量不缓存
+    ASSERT_EQ(cache.add(11, "11", 200), -1);
+    ASSERT_EQ(cache.check(11), -1);
+    cache.del(5);
+    ASSERT_EQ(cache.check(5), -1);
+    ASSERT_EQ(cache.usage(), 80);
+}
+
 }  // namespace baikal
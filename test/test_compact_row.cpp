@@ -0,0 +1,366 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include "compact_row.h"
+#include "schema_factory.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+using google::protobuf::DescriptorPool;
+using google::protobuf::DynamicMessageFactory;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::FieldDescriptorProto;
+using google::protobuf::FileDescriptorProto;
+using google::protobuf::Message;
+
+// 字段1是主键
+static pb::SchemaInfo make_schema(int64_t table_id, int64_t version,
+        const std::vector<std::pair<int, pb::PrimitiveType>>& fields) {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_database");
+    info.set_table_name("test_compact_row_" + std::to_string(table_id));
+    info.set_partition_num(1);
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(table_id);
+    info.set_version(version);
+    for (auto& pair : fields) {
+        pb::FieldInfo* field = info.add_fields();
+        field->set_field_name("col" + std::to_string(pair.first));
+        field->set_field_id(pair.first);
+        field->set_mysql_type(pair.second);
+    }
+    pb::IndexInfo* index_pk = info.add_indexs();
+    index_pk->set_index_type(pb::I_PRIMARY);
+    index_pk->set_index_name("pk_index");
+    index_pk->add_field_ids(1);
+    index_pk->set_index_id(table_id);
+    return info;
+}
+
+static SmartRowLayout make_layout(const pb::SchemaInfo& schema) {
+    std::string desc;
+    if (CompactRowCodec::build_layout(schema, &desc) != 0) {
+        return nullptr;
+    }
+    std::shared_ptr<CompactRowLayout> layout(new CompactRowLayout);
+    if (layout->parse(desc) != 0) {
+        return nullptr;
+    }
+    return layout;
+}
+
+// 按schema构造表的动态message，和SchemaFactory的做法一致
+struct DynamicTable {
+    DescriptorPool pool;
+    std::unique_ptr<DynamicMessageFactory> factory;
+    const Message* prototype = nullptr;
+
+    DynamicTable(const pb::SchemaInfo& schema) {
+        FileDescriptorProto file;
+        file.set_name("table.proto");
+        auto msg = file.add_message_type();
+        msg->set_name("table");
+        for (auto& info : schema.fields()) {
+            if (info.deleted()) {
+                continue;
+            }
+            auto field = msg->add_field();
+            field->set_name(info.field_name());
+            field->set_number(info.field_id());
+            field->set_type((FieldDescriptorProto::Type)primitive_to_proto_type(info.mysql_type()));
+            field->set_label(FieldDescriptorProto::LABEL_OPTIONAL);
+        }
+        pool.BuildFile(file);
+        factory.reset(new DynamicMessageFactory(&pool));
+        prototype = factory->GetPrototype(pool.FindMessageTypeByName("table"));
+    }
+    Message* create() {
+        return prototype->New();
+    }
+};
+
+TEST(test_compact_row, case_round_trip) {
+    pb::SchemaInfo schema = make_schema(1, 3, {{1, pb::INT64}, {2, pb::INT32}, {3, pb::UINT32},
+            {4, pb::UINT64}, {5, pb::INT64}, {6, pb::FLOAT}, {7, pb::DOUBLE}, {8, pb::BOOL},
+            {9, pb::STRING}, {10, pb::DATETIME}, {11, pb::TIME}, {13, pb::INT32}});
+    SmartRowLayout layout = make_layout(schema);
+    ASSERT_TRUE(layout != nullptr);
+    // 不含主键列
+    EXPECT_EQ(11U, layout->field_ids.size());
+    EXPECT_EQ(-1, layout->find(1));
+    EXPECT_EQ(-1, layout->find(12));
+
+    DynamicTable table(schema);
+    std::unique_ptr<Message> row(table.create());
+    auto reflection = row->GetReflection();
+    auto descriptor = row->GetDescriptor();
+    reflection->SetInt64(row.get(), descriptor->FindFieldByNumber(1), 1);
+    reflection->SetInt32(row.get(), descriptor->FindFieldByNumber(2), -12);
+    reflection->SetUInt32(row.get(), descriptor->FindFieldByNumber(3), UINT32_MAX);
+    reflection->SetUInt64(row.get(), descriptor->FindFieldByNumber(4), UINT64_MAX);
+    reflection->SetInt64(row.get(), descriptor->FindFieldByNumber(5), INT64_MIN);
+    reflection->SetFloat(row.get(), descriptor->FindFieldByNumber(6), 1.5f);
+    reflection->SetDouble(row.get(), descriptor->FindFieldByNumber(7), -2.25);
+    reflection->SetBool(row.get(), descriptor->FindFieldByNumber(8), true);
+    reflection->SetString(row.get(), descriptor->FindFieldByNumber(9), std::string("a\0b", 3));
+    reflection->SetUInt64(row.get(), descriptor->FindFieldByNumber(10), 123456789);
+    reflection->SetInt32(row.get(), descriptor->FindFieldByNumber(11), -3600);
+    std::string value;
+    ASSERT_EQ(0, CompactRowCodec::encode(*row, 3, *layout, {1}, &value));
+    ASSERT_TRUE(CompactRowCodec::is_compact(value.data(), value.size()));
+    // pb序列化的首字节不会被当成紧凑格式
+    std::string pb_value = row->SerializeAsString();
+    EXPECT_FALSE(CompactRowCodec::is_compact(pb_value.data(), pb_value.size()));
+    // 行头只有magic和schema版本
+    int64_t version = 0;
+    EXPECT_EQ(2, CompactRowCodec::parse_header(value.data(), value.size(), &version));
+    EXPECT_EQ(3, version);
+    EXPECT_EQ(2 + (11 + 7) / 8 + layout->fixed_size + layout->var_count * sizeof(uint32_t) + 3,
+            value.size());
+
+    CompactRowReader reader;
+    ASSERT_EQ(0, reader.init(layout, value.data(), value.size()));
+    EXPECT_EQ(3, reader.schema_version());
+    EXPECT_TRUE(reader.is_null(layout->find(13)));
+    EXPECT_FALSE(reader.is_null(layout->find(9)));
+    std::unique_ptr<Message> decode_row(table.create());
+    ASSERT_EQ(0, CompactRowCodec::decode(reader, decode_row.get()));
+    // 主键列由key解析，value里没有
+    reflection->ClearField(row.get(), descriptor->FindFieldByNumber(1));
+    EXPECT_EQ(row->SerializeAsString(), decode_row->SerializeAsString());
+
+    for (size_t len = 0; len < value.size(); ++len) {
+        EXPECT_NE(0, reader.init(layout, value.data(), len));
+    }
+}
+
+TEST(test_compact_row, case_build_layout) {
+    pb::SchemaInfo schema = make_schema(2, 1, {{1, pb::INT64}, {3, pb::STRING}, {2, pb::INT32},
+            {4, pb::DOUBLE}});
+    std::string desc;
+    ASSERT_EQ(0, CompactRowCodec::build_layout(schema, &desc));
+    // 建表请求里主键只有字段名，结果相同
+    pb::SchemaInfo by_name = schema;
+    by_name.mutable_indexs(0)->clear_field_ids();
+    by_name.mutable_indexs(0)->add_field_names("col1");
+    std::string name_desc;
+    ASSERT_EQ(0, CompactRowCodec::build_layout(by_name, &name_desc));
+    EXPECT_EQ(desc, name_desc);
+
+    // 删除的列不在layout里
+    schema.mutable_fields(3)->set_deleted(true);
+    SmartRowLayout layout = make_layout(schema);
+    ASSERT_TRUE(layout != nullptr);
+    ASSERT_EQ(2U, layout->field_ids.size());
+    EXPECT_EQ(2, layout->field_ids[0]);
+    EXPECT_EQ(3, layout->field_ids[1]);
+    EXPECT_EQ(ROW_INT32, layout->kinds[0]);
+    EXPECT_EQ(ROW_STRING, layout->kinds[1]);
+}
+
+// message和layout不一致时不能编码，调用方改写pb格式
+TEST(test_compact_row, case_layout_mismatch) {
+    pb::SchemaInfo schema = make_schema(3, 1, {{1, pb::INT64}, {2, pb::INT32}, {3, pb::STRING}});
+    SmartRowLayout layout = make_layout(schema);
+    ASSERT_TRUE(layout != nullptr);
+    std::string value;
+
+    pb::SchemaInfo add_column = make_schema(3, 2, {{1, pb::INT64}, {2, pb::INT32},
+            {3, pb::STRING}, {4, pb::INT32}});
+    DynamicTable add_table(add_column);
+    std::unique_ptr<Message> row(add_table.create());
+    EXPECT_NE(0, CompactRowCodec::encode(*row, 2, *layout, {1}, &value));
+
+    pb::SchemaInfo modify_column = make_schema(3, 2, {{1, pb::INT64}, {2, pb::INT64},
+            {3, pb::STRING}});
+    DynamicTable modify_table(modify_column);
+    row.reset(modify_table.create());
+    EXPECT_NE(0, CompactRowCodec::encode(*row, 2, *layout, {1}, &value));
+
+    DynamicTable table(schema);
+    row.reset(table.create());
+    EXPECT_EQ(0, CompactRowCodec::encode(*row, 1, *layout, {1}, &value));
+}
+
+// 旧版本写入的行按写入时的layout解析
+TEST(test_compact_row, case_schema_change) {
+    const int64_t table_id = 4;
+    pb::SchemaInfo old_schema = make_schema(table_id, 1, {{1, pb::INT64}, {2, pb::STRING},
+            {3, pb::INT32}, {4, pb::DOUBLE}});
+    SmartRowLayout old_layout = make_layout(old_schema);
+    ASSERT_TRUE(old_layout != nullptr);
+    DynamicTable old_table(old_schema);
+    std::unique_ptr<Message> row(old_table.create());
+    auto reflection = row->GetReflection();
+    auto descriptor = row->GetDescriptor();
+    reflection->SetInt64(row.get(), descriptor->FindFieldByNumber(1), 1);
+    reflection->SetString(row.get(), descriptor->FindFieldByNumber(2), "123");
+    reflection->SetInt32(row.get(), descriptor->FindFieldByNumber(3), -7);
+    reflection->SetDouble(row.get(), descriptor->FindFieldByNumber(4), 2.5);
+    std::string value;
+    ASSERT_EQ(0, CompactRowCodec::encode(*row, 1, *old_layout, {1}, &value));
+
+    // 版本2改了表名，layout不变；版本3删除列4，列2改成bigint，列3改成varchar，新增列5
+    pb::SchemaInfo schema = make_schema(table_id, 3, {{1, pb::INT64}, {2, pb::INT64},
+            {3, pb::STRING}, {4, pb::DOUBLE}, {5, pb::UINT32}});
+    schema.mutable_fields(3)->set_deleted(true);
+    SmartRowLayout new_layout = make_layout(schema);
+    ASSERT_TRUE(new_layout != nullptr);
+    pb::RowLayout* row_layout = schema.add_row_layouts();
+    row_layout->set_version(1);
+    row_layout->set_layout(old_layout->desc);
+    row_layout = schema.add_row_layouts();
+    row_layout->set_version(3);
+    row_layout->set_layout(new_layout->desc);
+
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    factory->init();
+    SchemaVec tables;
+    tables.Add()->CopyFrom(schema);
+    factory->update_tables_double_buffer_sync(tables);
+    SmartTable table_info = factory->get_table_info_ptr(table_id);
+    ASSERT_TRUE(table_info != nullptr);
+    EXPECT_EQ(old_layout->desc, table_info->get_row_layout(1)->desc);
+    EXPECT_EQ(old_layout->desc, table_info->get_row_layout(2)->desc);
+    EXPECT_EQ(new_layout->desc, table_info->get_row_layout(3)->desc);
+    // 还没收到的版本和记录layout之前的版本都找不到
+    EXPECT_TRUE(table_info->get_row_layout(4) == nullptr);
+    EXPECT_TRUE(table_info->get_row_layout(0) == nullptr);
+
+    DynamicTable new_table(schema);
+    std::unique_ptr<Message> new_row(new_table.create());
+    ASSERT_EQ(0, CompactRowCodec::decode(table_id, value.data(), value.size(), new_row.get()));
+    reflection = new_row->GetReflection();
+    descriptor = new_row->GetDescriptor();
+    EXPECT_EQ(123, reflection->GetInt64(*new_row, descriptor->FindFieldByNumber(2)));
+    EXPECT_EQ("-7", reflection->GetString(*new_row, descriptor->FindFieldByNumber(3)));
+    EXPECT_FALSE(reflection->HasField(*new_row, descriptor->FindFieldByNumber(5)));
+
+    // 新版本写入的行
+    reflection->SetUInt32(new_row.get(), descriptor->FindFieldByNumber(5), 5);
+    ASSERT_EQ(0, CompactRowCodec::encode(*new_row, 3, *new_layout, {1}, &value));
+    CompactRowReader reader;
+    ASSERT_EQ(0, reader.init(table_id, value.data(), value.size()));
+    EXPECT_EQ(3, reader.schema_version());
+    EXPECT_EQ(-1, reader.layout().find(4));
+    EXPECT_FALSE(reader.is_null(reader.layout().find(5)));
+
+    // 没有记录layout的表不能解析紧凑格式
+    EXPECT_NE(0, reader.init(table_id + 100, value.data(), value.size()));
+}
+
+// 宽表上对比pb整行解析和紧凑格式按列解码
+TEST(test_compact_row, perf_wide_table) {
+    const int field_count = 200;
+    std::vector<std::pair<int, pb::PrimitiveType>> fields;
+    for (int i = 1; i <= field_count; ++i) {
+        pb::PrimitiveType type = pb::INT32;
+        if (i % 4 == 0) {
+            type = pb::STRING;
+        } else if (i % 4 == 1) {
+            type = pb::INT64;
+        }
+        fields.emplace_back(i, type);
+    }
+    pb::SchemaInfo schema = make_schema(5, 1, fields);
+    SmartRowLayout layout = make_layout(schema);
+    ASSERT_TRUE(layout != nullptr);
+    DynamicTable table(schema);
+    const int row_count = 2000;
+    std::vector<std::string> pb_values;
+    std::vector<std::string> compact_values;
+    size_t pb_bytes = 0;
+    size_t compact_bytes = 0;
+    for (int r = 0; r < row_count; ++r) {
+        std::unique_ptr<Message> row(table.create());
+        auto reflection = row->GetReflection();
+        auto descriptor = row->GetDescriptor();
+        for (int i = 1; i <= field_count; ++i) {
+            auto field = descriptor->FindFieldByNumber(i);
+            if ((r + i) % 10 == 0) {
+                continue;
+            }
+            if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+                reflection->SetString(row.get(), field, "value_" + std::to_string(r * i));
+            } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
+                reflection->SetInt64(row.get(), field, (int64_t)r * 1000003 + i);
+            } else {
+                reflection->SetInt32(row.get(), field, r + i);
+            }
+        }
+        pb_values.push_back(row->SerializeAsString());
+        compact_values.emplace_back();
+        ASSERT_EQ(0, CompactRowCodec::encode(*row, 1, *layout, {}, &compact_values.back()));
+        pb_bytes += pb_values.back().size();
+        compact_bytes += compact_values.back().size();
+    }
+
+    std::vector<int> want = {3, 100, 198};
+    std::unique_ptr<Message> out(table.create());
+    auto descriptor = out->GetDescriptor();
+    std::vector<const FieldDescriptor*> want_fields;
+    for (int id : want) {
+        want_fields.push_back(descriptor->FindFieldByNumber(id));
+    }
+    auto now_us = []() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    int64_t start = now_us();
+    for (auto& value : pb_values) {
+        out->Clear();
+        ASSERT_TRUE(out->ParseFromString(value));
+    }
+    int64_t pb_full = now_us() - start;
+
+    start = now_us();
+    for (auto& value : compact_values) {
+        out->Clear();
+        CompactRowReader reader;
+        ASSERT_EQ(0, reader.init(layout, value.data(), value.size()));
+        ASSERT_EQ(0, CompactRowCodec::decode(reader, out.get()));
+    }
+    int64_t compact_full = now_us() - start;
+
+    start = now_us();
+    for (auto& value : compact_values) {
+        out->Clear();
+        CompactRowReader reader;
+        ASSERT_EQ(0, reader.init(layout, value.data(), value.size()));
+        for (size_t i = 0; i < want.size(); ++i) {
+            int slot = reader.layout().find(want[i]);
+            if (!reader.is_null(slot)) {
+                ASSERT_EQ(0, reader.read_field(slot, want_fields[i], out.get()));
+            }
+        }
+    }
+    int64_t compact_partial = now_us() - start;
+    printf("rows: %d, fields: %d, pb bytes: %lu, compact bytes: %lu\n",
+            row_count, field_count, pb_bytes, compact_bytes);
+    printf("pb full: %ldus, compact full: %ldus, compact %lu fields: %ldus\n",
+            pb_full, compact_full, want.size(), compact_partial);
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
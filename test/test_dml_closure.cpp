@@ -0,0 +1,94 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "closure.h"
+#include "region.h"
+#include "rocks_wrapper.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+// exec_out_txn_query中每个写请求计数加一，交给closure后由closure在Run中减一，
+// split/merge等待计数归零，减多或减少都会破坏写入屏障
+class DMLClosureTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        RocksWrapper* rocksdb = RocksWrapper::get_instance();
+        ASSERT_EQ(0, rocksdb->init("./rocks_db_dml_closure"));
+        pb::RegionInfo region_info;
+        region_info.set_region_id(1);
+        region_info.set_table_id(1);
+        region_info.set_version(1);
+        braft::PeerId peer_id;
+        peer_id.parse("127.0.0.1:8110:0");
+        _region.reset(new Region(rocksdb, SchemaFactory::get_instance(), "127.0.0.1:8110",
+                "region_1", peer_id, region_info, 1));
+    }
+    DMLClosure* new_closure(pb::StoreRes* response) {
+        _region->real_writing_increase();
+        DMLClosure* c = new DMLClosure;
+        c->op_type = pb::OP_INSERT;
+        c->cntl = &_cntl;
+        c->response = response;
+        c->done = brpc::DoNothing();
+        c->region = _region.get();
+        return c;
+    }
+    std::unique_ptr<Region> _region;
+    brpc::Controller _cntl;
+};
+
+TEST_F(DMLClosureTest, case_plain) {
+    pb::StoreRes response;
+    DMLClosure* c = new_closure(&response);
+    EXPECT_EQ(1, _region->real_writing_count());
+    c->Run();
+    EXPECT_EQ(0, _region->real_writing_count());
+
+    // raft提交失败也只减一次
+    c = new_closure(&response);
+    c->status().set_error(EPERM, "not leader");
+    c->Run();
+    EXPECT_EQ(0, _region->real_writing_count());
+    EXPECT_EQ(pb::NOT_LEADER, response.errcode());
+}
+
+TEST_F(DMLClosureTest, case_combined) {
+    pb::StoreRes responses[3];
+    CombinedInsertClosure* combined = new CombinedInsertClosure;
+    for (auto& response : responses) {
+        combined->closures.push_back(new_closure(&response));
+    }
+    EXPECT_EQ(3, _region->real_writing_count());
+    combined->Run();
+    EXPECT_EQ(0, _region->real_writing_count());
+
+    combined = new CombinedInsertClosure;
+    for (auto& response : responses) {
+        combined->closures.push_back(new_closure(&response));
+    }
+    combined->combined_response.set_errcode(pb::PARSE_TO_PB_FAIL);
+    combined->Run();
+    EXPECT_EQ(0, _region->real_writing_count());
+    for (auto& response : responses) {
+        EXPECT_EQ(pb::PARSE_TO_PB_FAIL, response.errcode());
+    }
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,117 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <map>
+#include "peer_selector.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int64(peer_ewma_decay_ms);
+DECLARE_int64(peer_eject_base_ms);
+DECLARE_int64(peer_readmit_ms);
+
+TEST(test_peer_selector, case_p2c) {
+    PeerSelector selector;
+    int64_t now = 1000000;
+    std::vector<std::string> peers = {"a:1", "b:1"};
+    selector.on_send("a:1");
+    selector.on_finish("a:1", 1000, false, now);
+    selector.on_send("b:1");
+    selector.on_finish("b:1", 5000, false, now);
+    // 只有两个候选时P2C一定比较这两个
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ("a:1", selector.select(peers, "", now));
+    }
+    // 在途请求多的实例代价变高
+    for (int i = 0; i < 10; ++i) {
+        selector.on_send("a:1");
+    }
+    EXPECT_EQ("b:1", selector.select(peers, "", now));
+    EXPECT_EQ("a:1", selector.select(peers, "b:1", now));
+    EXPECT_EQ("", selector.select({"a:1"}, "a:1", now));
+}
+
+TEST(test_peer_selector, case_ewma) {
+    PeerSelector selector;
+    int64_t now = 1000000;
+    selector.on_finish("a:1", 1000, false, now);
+    // 延迟突增立即生效
+    selector.on_finish("a:1", 20000, false, now + 1000);
+    EXPECT_EQ(20000, selector.ewma_latency("a:1", now + 1000));
+    // 回落是平滑的
+    selector.on_finish("a:1", 1000, false, now + 2000);
+    int64_t ewma = selector.ewma_latency("a:1", now + 2000);
+    EXPECT_GT(ewma, 10000);
+    EXPECT_LT(ewma, 20000);
+    // 空闲后衰减，慢节点还能被重新选中
+    int64_t idle = now + 2000 + FLAGS_peer_ewma_decay_ms * 1000 * 10;
+    EXPECT_LT(selector.ewma_latency("a:1", idle), 10);
+}
+
+TEST(test_peer_selector, case_eject_fail) {
+    PeerSelector selector;
+    int64_t now = 1000000;
+    std::vector<std::string> peers = {"a:1", "b:1"};
+    selector.on_finish("b:1", 1000, false, now);
+    for (int i = 0; i < 3; ++i) {
+        selector.on_finish("a:1", 100, true, now);
+    }
+    EXPECT_TRUE(selector.is_ejected("a:1", now));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ("b:1", selector.select(peers, "", now));
+    }
+    // 全部不可用时不拒绝服务
+    EXPECT_EQ("a:1", selector.select(peers, "b:1", now));
+
+    // 摘除到期后在恢复期内逐步放量
+    int64_t readmit = now + FLAGS_peer_eject_base_ms * 1000;
+    EXPECT_FALSE(selector.is_ejected("a:1", readmit));
+    int a_count = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (selector.select(peers, "", readmit + 1000) == "a:1") {
+            ++a_count;
+        }
+    }
+    EXPECT_LT(a_count, 50);
+    // 再次摘除时间翻倍
+    for (int i = 0; i < 3; ++i) {
+        selector.on_finish("a:1", 100, true, readmit);
+    }
+    EXPECT_TRUE(selector.is_ejected("a:1", readmit + FLAGS_peer_eject_base_ms * 1000 * 3 / 2));
+}
+
+TEST(test_peer_selector, case_eject_outlier) {
+    PeerSelector selector;
+    int64_t now = 1000000;
+    std::vector<std::string> peers = {"a:1", "b:1", "c:1"};
+    selector.on_finish("a:1", 1000, false, now);
+    selector.on_finish("b:1", 1200, false, now);
+    selector.on_finish("c:1", 200000, false, now);
+    std::map<std::string, int> counts;
+    for (int i = 0; i < 100; ++i) {
+        ++counts[selector.select(peers, "", now)];
+    }
+    EXPECT_TRUE(selector.is_ejected("c:1", now));
+    EXPECT_EQ(0, counts["c:1"]);
+    EXPECT_EQ(100, counts["a:1"] + counts["b:1"]);
+    EXPECT_EQ(-1, selector.table_latency_percentile(1, 0.99));
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
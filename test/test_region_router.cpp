@@ -0,0 +1,169 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <map>
+#include "region_router.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static std::string make_key(int64_t i) {
+    // 8字节region前缀 + 大端序主键，和真实key一样有长公共前缀
+    std::string key("\x00\x00\x00\x00\x00\x00\x00\x07", 8);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        key.push_back((char)((i >> shift) & 0xFF));
+    }
+    return key;
+}
+
+static std::vector<SmartRegionInfo> make_regions(int count, int64_t step) {
+    std::vector<SmartRegionInfo> regions;
+    for (int i = 0; i < count; ++i) {
+        std::shared_ptr<pb::RegionInfo> region(new pb::RegionInfo);
+        region->set_region_id(i + 1);
+        region->set_table_id(7);
+        region->set_table_name("db.t");
+        region->set_partition_id(0);
+        region->set_replica_num(3);
+        region->set_version(1);
+        region->set_conf_version(1);
+        region->set_start_key(i == 0 ? "" : make_key(i * step));
+        region->set_end_key(i == count - 1 ? "" : make_key((i + 1) * step));
+        region->set_leader("10.0.0." + std::to_string(i % 200) + ":8110");
+        for (int p = 0; p < 3; ++p) {
+            region->add_peers("10.0.0." + std::to_string((i + p) % 200) + ":8110");
+        }
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+TEST(test_region_router, case_lookup) {
+    auto regions = make_regions(1000, 100);
+    std::map<std::string, int64_t> key_region;
+    for (auto& region : regions) {
+        key_region[region->start_key()] = region->region_id();
+    }
+    RegionRouter router(1, regions);
+    ASSERT_EQ(1000U, router.size());
+    for (int64_t i = -5; i < 1000 * 100 + 5; i += 7) {
+        std::string key = i < 0 ? std::string("\x00", 1) : make_key(i);
+        auto iter = key_region.upper_bound(key);
+        EXPECT_EQ((size_t)std::distance(key_region.begin(), iter), router.upper_bound(key));
+        --iter;
+        auto region = router.find(key);
+        ASSERT_TRUE(region != nullptr);
+        EXPECT_EQ(iter->second, region->region_id());
+    }
+    // 恰好等于start_key
+    EXPECT_EQ(501, router.find(make_key(500 * 100))->region_id());
+    EXPECT_EQ(1U, router.upper_bound(""));
+    EXPECT_EQ(37, router.get_region(37)->region_id());
+    EXPECT_TRUE(router.get_region(100000) == nullptr);
+
+    RegionRouter empty(1, {});
+    EXPECT_TRUE(empty.find("abc") == nullptr);
+    EXPECT_EQ(0U, empty.upper_bound("abc"));
+}
+
+TEST(test_region_router, case_replace_region) {
+    auto regions = make_regions(100, 10);
+    SmartRegionRouter router(new RegionRouter(1, regions));
+    std::shared_ptr<pb::RegionInfo> region(new pb::RegionInfo(*router->get_region(10)));
+    region->set_leader("10.0.0.250:8110");
+    auto new_router = router->replace_region(2, region);
+    ASSERT_TRUE(new_router != nullptr);
+    EXPECT_EQ(2, new_router->version());
+    EXPECT_EQ("10.0.0.250:8110", new_router->get_region(10)->leader());
+    // 旧快照不受影响，其他region共享
+    EXPECT_NE("10.0.0.250:8110", router->get_region(10)->leader());
+    EXPECT_EQ(router->get_region(11).get(), new_router->get_region(11).get());
+    EXPECT_EQ(10, new_router->find(region->start_key())->region_id());
+
+    // 范围变化不能原地替换
+    region->set_start_key(make_key(12345));
+    EXPECT_TRUE(router->replace_region(3, region) == nullptr);
+}
+
+// 2万region上对比原来的map + 拷贝pb和路由快照
+TEST(test_region_router, perf_route) {
+    const int region_count = 20000;
+    auto regions = make_regions(region_count, 1000);
+    std::map<std::string, int64_t> key_region;
+    std::unordered_map<int64_t, pb::RegionInfo> region_mapping;
+    for (auto& region : regions) {
+        key_region[region->start_key()] = region->region_id();
+        region_mapping[region->region_id()] = *region;
+    }
+    RegionRouter router(1, regions);
+    auto now_us = []() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200000; ++i) {
+        keys.push_back(make_key((int64_t)rand() % ((int64_t)region_count * 1000)));
+    }
+
+    int64_t sum = 0;
+    int64_t start = now_us();
+    for (auto& key : keys) {
+        auto iter = key_region.upper_bound(key);
+        --iter;
+        pb::RegionInfo info = region_mapping[iter->second];
+        sum += info.region_id();
+    }
+    int64_t map_point = now_us() - start;
+
+    int64_t router_sum = 0;
+    start = now_us();
+    for (auto& key : keys) {
+        router_sum += router.find(key)->region_id();
+    }
+    int64_t router_point = now_us() - start;
+    EXPECT_EQ(sum, router_sum);
+
+    const int scan_times = 20;
+    start = now_us();
+    for (int i = 0; i < scan_times; ++i) {
+        std::map<int64_t, pb::RegionInfo> region_infos;
+        for (auto& pair : key_region) {
+            region_infos[pair.second] = region_mapping[pair.second];
+        }
+        EXPECT_EQ((size_t)region_count, region_infos.size());
+    }
+    int64_t map_scan = now_us() - start;
+
+    start = now_us();
+    for (int i = 0; i < scan_times; ++i) {
+        std::map<int64_t, SmartRegionInfo> region_infos;
+        for (auto& region : router.regions()) {
+            region_infos[region->region_id()] = region;
+        }
+        EXPECT_EQ((size_t)region_count, region_infos.size());
+    }
+    int64_t router_scan = now_us() - start;
+    printf("regions: %d, key index bytes: %lu\n", region_count,
+            StartKeyIndex(regions).bytes());
+    printf("point %lu: map+copy %ldus, router %ldus; full scan x%d: map+copy %ldus, router %ldus\n",
+            keys.size(), map_point, router_point, scan_times, map_scan, router_scan);
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,82 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "reverse_common.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+TEST(test_reverse_block, case_varint) {
+    std::string buf;
+    std::vector<uint32_t> values = {0, 1, 127, 128, 16383, 16384, UINT32_MAX};
+    for (auto value : values) {
+        append_varint32(&buf, value);
+    }
+    rocksdb::Slice input(buf);
+    for (auto value : values) {
+        uint32_t decode = 0;
+        EXPECT_TRUE(get_varint32(&input, &decode));
+        EXPECT_EQ(value, decode);
+    }
+    EXPECT_TRUE(input.empty());
+    uint32_t decode = 0;
+    EXPECT_FALSE(get_varint32(&input, &decode));
+}
+
+TEST(test_reverse_block, case_encode_decode) {
+    pb::CommonReverseList list;
+    for (int i = 0; i < 300; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "pk_%08d", i * 7);
+        auto node = list.add_reverse_nodes();
+        node->set_key(key);
+        node->set_flag(i % 3 == 0 ? pb::REVERSE_NODE_DELETE : pb::REVERSE_NODE_NORMAL);
+        if (i % 2 == 0) {
+            node->set_weight(i * 0.5);
+        }
+    }
+    pb::CommonReverseList decode_list;
+    size_t block_bytes = 0;
+    for (int begin = 0; begin < list.reverse_nodes_size(); begin += 128) {
+        int end = std::min(begin + 128, list.reverse_nodes_size());
+        std::string value;
+        encode_reverse_block<pb::CommonReverseNode, pb::CommonReverseList>(list, begin, end, &value);
+        block_bytes += value.size();
+        int ret = decode_reverse_block<pb::CommonReverseNode, pb::CommonReverseList>(
+                value, &decode_list);
+        EXPECT_EQ(0, ret);
+    }
+    ASSERT_EQ(list.reverse_nodes_size(), decode_list.reverse_nodes_size());
+    for (int i = 0; i < list.reverse_nodes_size(); ++i) {
+        EXPECT_EQ(list.reverse_nodes(i).SerializeAsString(),
+                decode_list.reverse_nodes(i).SerializeAsString());
+    }
+    // key前缀压缩后比整个pb小
+    EXPECT_LT(block_bytes, (size_t)list.ByteSize());
+
+    std::string bad_value;
+    encode_reverse_block<pb::CommonReverseNode, pb::CommonReverseList>(list, 0, 10, &bad_value);
+    bad_value.resize(bad_value.size() / 2);
+    pb::CommonReverseList bad_list;
+    int ret = decode_reverse_block<pb::CommonReverseNode, pb::CommonReverseList>(
+            bad_value, &bad_list);
+    EXPECT_EQ(-1, ret);
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -159,6 +159,37 @@ TEST(test_parser, case_create_table_hll) {
     }
 }
 
+TEST(test_parser, case_create_table_partition) {
+    parser::SqlParser parser;
+    std::string sql = "create table t1 (id bigint not null auto_increment, "
+        "primary key (id)) engine=rocksdb partition by hash(id) partitions 8";
+    parser.parse(sql);
+    ASSERT_EQ(parser::SUCC, parser.error);
+    ASSERT_EQ(1, parser.result.size());
+    CreateTableStmt* stmt = (CreateTableStmt*)parser.result[0];
+    ASSERT_TRUE(stmt->partition != nullptr);
+    EXPECT_EQ(parser::PARTITION_HASH, stmt->partition->type);
+    EXPECT_STREQ("id", stmt->partition->column->name.value);
+    EXPECT_EQ(8, stmt->partition->partition_num);
+
+    parser::SqlParser range_parser;
+    sql = "create table t2 (id bigint not null, ts datetime not null, "
+        "primary key (ts, id)) partition by range(ts) ("
+        "partition p0 values less than ('2020-01-01'), "
+        "partition p1 values less than (20210101), "
+        "partition p2 values less than maxvalue)";
+    range_parser.parse(sql);
+    ASSERT_EQ(parser::SUCC, range_parser.error);
+    ASSERT_EQ(1, range_parser.result.size());
+    stmt = (CreateTableStmt*)range_parser.result[0];
+    ASSERT_TRUE(stmt->partition != nullptr);
+    EXPECT_EQ(parser::PARTITION_RANGE, stmt->partition->type);
+    ASSERT_EQ(3, stmt->partition->ranges.size());
+    EXPECT_STREQ("p1", stmt->partition->ranges[1]->name.value);
+    EXPECT_TRUE(stmt->partition->ranges[1]->less_expr != nullptr);
+    EXPECT_TRUE(stmt->partition->ranges[2]->less_expr == nullptr);
+}
+
 TEST(test_parser, begin_txn) {
     parser::SqlParser parser;
     std::string sql = "BEGIN;";
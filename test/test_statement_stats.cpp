@@ -0,0 +1,108 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "statement_stats.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(statement_stats_max_digests);
+
+TEST(test_statement_stats, case_histogram) {
+    std::vector<int64_t> values = {0, 1, 3, 4, 7, 8, 100, 12345, 1LL << 40};
+    for (int64_t v : values) {
+        int index = LatencyHistogram::bucket_index(v);
+        EXPECT_GE(LatencyHistogram::bucket_upper(index), v);
+        if (index > 0) {
+            EXPECT_LT(LatencyHistogram::bucket_upper(index - 1), v);
+        }
+    }
+    LatencyHistogram hist;
+    for (int i = 1; i <= 1000; ++i) {
+        hist.add(i * 100);
+    }
+    EXPECT_EQ(1000, hist.count());
+    int64_t p50 = hist.percentile(0.5);
+    EXPECT_GE(p50, 50000);
+    EXPECT_LE(p50, 50000 * 5 / 4);
+    int64_t p99 = hist.percentile(0.99);
+    EXPECT_GE(p99, 99000);
+    EXPECT_LE(p99, 99000 * 5 / 4);
+}
+
+TEST(test_statement_stats, case_record) {
+    StatementStats stats;
+    std::string fast = "SELECT * FROM t WHERE id = ?";
+    std::string slow = "SELECT * FROM t WHERE name LIKE ?";
+    uint64_t fast_sign = StatementStats::sign(fast);
+    uint64_t slow_sign = StatementStats::sign(slow);
+    EXPECT_NE(fast_sign, slow_sign);
+    for (int i = 0; i < 100; ++i) {
+        StatementSample sample;
+        sample.latency_us = 1000;
+        sample.store_us = 800;
+        sample.rows_returned = 1;
+        sample.rows_examined = 1;
+        stats.record(fast_sign, fast, "db", "t", 1, sample, i);
+    }
+    StatementSample sample;
+    sample.latency_us = 500000;
+    sample.rows_examined = 10000;
+    sample.error = true;
+    stats.record(slow_sign, slow, "db", "t", 1, sample, 100);
+
+    std::vector<StatementDigestInfo> infos;
+    stats.list(&infos, 0);
+    ASSERT_EQ(2U, infos.size());
+    // 按总耗时排序
+    EXPECT_EQ(slow_sign, infos[0].sign);
+    EXPECT_EQ(1, infos[0].errors);
+    EXPECT_EQ(500000, infos[0].p99_latency_us);
+    EXPECT_EQ(fast, infos[1].digest);
+    EXPECT_EQ(100, infos[1].count);
+    EXPECT_EQ(100, infos[1].rows_returned);
+    EXPECT_EQ(80000, infos[1].sum_store_us);
+    EXPECT_EQ(1000, infos[1].max_latency_us);
+    EXPECT_EQ(1000, infos[1].p50_latency_us);
+    stats.list(&infos, 1);
+    EXPECT_EQ(1U, infos.size());
+}
+
+TEST(test_statement_stats, case_evict) {
+    StatementStats stats;
+    FLAGS_statement_stats_max_digests = 32;
+    for (int i = 0; i < 1000; ++i) {
+        std::string digest = "SELECT " + std::to_string(i);
+        stats.record(StatementStats::sign(digest), digest, "db", "t", 1, StatementSample(), i);
+    }
+    EXPECT_LE(stats.size(), 32U);
+    // 最近执行的一定保留
+    std::string last = "SELECT 999";
+    std::vector<StatementDigestInfo> infos;
+    stats.list(&infos, 0);
+    bool found = false;
+    for (auto& info : infos) {
+        found = found || info.digest == last;
+    }
+    EXPECT_TRUE(found);
+    stats.clear();
+    EXPECT_EQ(0U, stats.size());
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,130 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "statistics.h"
+#include "mut_table_key.h"
+#include "schema_factory.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static std::string make_key(int64_t value) {
+    MutTableKey key;
+    key.append_i64(value);
+    return key.data();
+}
+
+TEST(test_statistics, case_build) {
+    // 0..999, 每个值出现一次; 额外插入500个7
+    IndexStatisticsBuilder builder(1, 1500, 10, 4);
+    for (int64_t i = 0; i < 1000; ++i) {
+        int repeat = (i == 7) ? 501 : 1;
+        for (int j = 0; j < repeat; ++j) {
+            std::string key = make_key(i);
+            builder.add(key + make_key(j), key);
+        }
+    }
+    pb::IndexStatistics stat;
+    builder.finish(&stat);
+    EXPECT_EQ(1, stat.index_id());
+    EXPECT_EQ(1500, stat.row_count());
+    EXPECT_NEAR(1000, stat.ndv(), 50);
+    EXPECT_EQ(10, stat.buckets_size());
+    ASSERT_EQ(1, stat.mcvs_size());
+    EXPECT_EQ(make_key(7), stat.mcvs(0).value());
+    EXPECT_EQ(501, stat.mcvs(0).count());
+
+    EXPECT_EQ(501, TableStatistics::estimate_eq_rows(stat, make_key(7)));
+    EXPECT_EQ(1, TableStatistics::estimate_eq_rows(stat, make_key(100)));
+    EXPECT_EQ(1500, TableStatistics::estimate_range_rows(stat, "", ""));
+    int64_t rows = TableStatistics::estimate_range_rows(stat, make_key(900), "");
+    EXPECT_GT(rows, 50);
+    EXPECT_LT(rows, 300);
+}
+
+TEST(test_statistics, case_merge) {
+    std::vector<pb::IndexStatistics> region_stats(2);
+    for (int region = 0; region < 2; ++region) {
+        IndexStatisticsBuilder builder(1, 1000, 10, 4);
+        for (int64_t i = region * 1000; i < (region + 1) * 1000; ++i) {
+            builder.add(make_key(i), make_key(i));
+        }
+        builder.finish(&region_stats[region]);
+    }
+    pb::IndexStatistics stat;
+    merge_index_statistics({&region_stats[0], &region_stats[1]}, &stat, 10, 4);
+    EXPECT_EQ(2000, stat.row_count());
+    EXPECT_NEAR(2000, stat.ndv(), 100);
+    EXPECT_EQ(10, stat.buckets_size());
+    EXPECT_EQ(make_key(0), stat.buckets(0).lower_bound());
+    EXPECT_EQ(make_key(1999), stat.buckets(9).upper_bound());
+}
+
+// analyze不修改schema版本，统计信息按自己的版本更新
+TEST(test_statistics, case_update_without_schema_version) {
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    factory->init();
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_database");
+    info.set_table_name("test_statistics");
+    info.set_partition_num(1);
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(101);
+    info.set_version(3);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    pb::IndexInfo* index_pk = info.add_indexs();
+    index_pk->set_index_type(pb::I_PRIMARY);
+    index_pk->set_index_name("pk_index");
+    index_pk->add_field_ids(1);
+    index_pk->set_index_id(101);
+    SchemaVec tables;
+    tables.Add()->CopyFrom(info);
+    factory->update_tables_double_buffer_sync(tables);
+    EXPECT_EQ(nullptr, factory->get_table_info(101).statistics);
+
+    pb::TableStatistics* statistics = tables.Mutable(0)->mutable_statistics();
+    statistics->set_table_id(101);
+    statistics->set_version(1);
+    pb::IndexStatistics* index_stat = statistics->add_indexes();
+    index_stat->set_index_id(101);
+    index_stat->set_row_count(100);
+    factory->update_tables_double_buffer_sync(tables);
+    TableInfo table_info = factory->get_table_info(101);
+    EXPECT_EQ(3, table_info.version);
+    ASSERT_NE(nullptr, table_info.statistics);
+    EXPECT_EQ(1, table_info.statistics->version());
+    EXPECT_EQ(100, table_info.statistics->get_index_statistics(101)->row_count());
+
+    // 版本没有变大时忽略
+    index_stat->set_row_count(200);
+    factory->update_tables_double_buffer_sync(tables);
+    EXPECT_EQ(100, factory->get_table_info(101).statistics->get_index_statistics(101)->row_count());
+    statistics->set_version(2);
+    factory->update_tables_double_buffer_sync(tables);
+    table_info = factory->get_table_info(101);
+    EXPECT_EQ(3, table_info.version);
+    EXPECT_EQ(200, table_info.statistics->get_index_statistics(101)->row_count());
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
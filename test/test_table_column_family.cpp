@@ -0,0 +1,88 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+#include "rocks_wrapper.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+// 表独立cf：创建后按表取handle，重启后按持久化的配置打开，drop后退回公共data cf
+TEST(test_table_column_family, case_lifecycle) {
+    const std::string path = "./rocks_db_table_cf";
+    boost::filesystem::remove_all(path);
+    RocksWrapper* rocksdb = RocksWrapper::get_instance();
+    ASSERT_EQ(0, rocksdb->init(path));
+    pb::ColumnFamilyConf cf_conf;
+    cf_conf.set_compaction_style(pb::CS_UNIVERSAL);
+    cf_conf.set_bloom_bits_per_key(10);
+
+    // create
+    ASSERT_EQ(0, rocksdb->create_table_column_family(1001, cf_conf));
+    rocksdb::ColumnFamilyHandle* handle = rocksdb->get_data_handle(1001);
+    ASSERT_NE(nullptr, handle);
+    EXPECT_NE(rocksdb->get_data_handle(), handle);
+    EXPECT_EQ(RocksWrapper::table_cf_name(1001), handle->GetName());
+    EXPECT_EQ(rocksdb->get_data_handle(), rocksdb->get_data_handle(1002));
+    // 重复创建返回已有的cf
+    ASSERT_EQ(0, rocksdb->create_table_column_family(1001, cf_conf));
+    EXPECT_EQ(handle, rocksdb->get_data_handle(1001));
+    // 全局索引region用主表的cf
+    pb::RegionInfo region_info;
+    region_info.set_table_id(1002);
+    region_info.set_main_table_id(1001);
+    EXPECT_EQ(handle, rocksdb->get_data_handle(region_info));
+    ASSERT_TRUE(rocksdb->put(rocksdb::WriteOptions(), handle, "key", "value").ok());
+
+    // reopen
+    rocksdb->close();
+    ASSERT_EQ(0, rocksdb->init(path));
+    handle = rocksdb->get_data_handle(1001);
+    ASSERT_NE(rocksdb->get_data_handle(), handle);
+    EXPECT_EQ(RocksWrapper::table_cf_name(1001), handle->GetName());
+    EXPECT_EQ(rocksdb::kCompactionStyleUniversal,
+            rocksdb->get_options(handle).compaction_style);
+    std::string value;
+    ASSERT_TRUE(rocksdb->get(rocksdb::ReadOptions(), handle, "key", &value).ok());
+    EXPECT_EQ("value", value);
+    std::vector<int64_t> table_ids;
+    rocksdb->get_table_cf_ids(&table_ids);
+    ASSERT_EQ(1, table_ids.size());
+    EXPECT_EQ(1001, table_ids[0]);
+
+    // drop
+    ASSERT_EQ(0, rocksdb->drop_table_column_family(1001));
+    EXPECT_EQ(rocksdb->get_data_handle(), rocksdb->get_data_handle(1001));
+    table_ids.clear();
+    rocksdb->get_table_cf_ids(&table_ids);
+    EXPECT_EQ(0, table_ids.size());
+    ASSERT_EQ(0, rocksdb->drop_table_column_family(1001));
+
+    rocksdb->close();
+    ASSERT_EQ(0, rocksdb->init(path));
+    EXPECT_EQ(rocksdb->get_data_handle(), rocksdb->get_data_handle(1001));
+    std::vector<std::string> cf_names;
+    ASSERT_TRUE(rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(), path, &cf_names).ok());
+    for (auto& cf_name : cf_names) {
+        EXPECT_NE(RocksWrapper::table_cf_name(1001), cf_name);
+    }
+    rocksdb->close();
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
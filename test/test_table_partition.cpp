@@ -0,0 +1,105 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "table_partition.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static ExprValue int_value(int64_t i) {
+    ExprValue value(pb::INT64);
+    value._u.int64_val = i;
+    return value;
+}
+
+TEST(test_table_partition, case_hash) {
+    pb::PartitionInfo info;
+    info.set_type(pb::PT_HASH);
+    info.set_field_id(1);
+    TablePartition partition;
+    EXPECT_EQ(0, partition.init(info, 4, pb::INT64));
+    EXPECT_EQ(1, partition.get_partition_id(int_value(5)));
+    EXPECT_EQ(3, partition.get_partition_id(int_value(-5)));
+    EXPECT_EQ(0, partition.get_partition_id(ExprValue()));
+
+    std::vector<int64_t> ids;
+    partition.get_partition_ids(int_value(6), int_value(6), ids);
+    ASSERT_EQ(1u, ids.size());
+    EXPECT_EQ(2, ids[0]);
+    // 范围条件无法裁剪hash分区
+    partition.get_partition_ids(int_value(1), int_value(2), ids);
+    EXPECT_EQ(4u, ids.size());
+
+    EXPECT_EQ(-1, partition.init(info, 4, pb::STRING));
+    EXPECT_EQ(-1, partition.init(info, 0, pb::INT64));
+}
+
+TEST(test_table_partition, case_range) {
+    pb::PartitionInfo info;
+    info.set_type(pb::PT_RANGE);
+    info.set_field_id(2);
+    info.add_range_bounds("10");
+    info.add_range_bounds("20");
+    TablePartition partition;
+    // 缺省最后一个上界为MAXVALUE
+    EXPECT_EQ(0, partition.init(info, 3, pb::INT64));
+    EXPECT_EQ(0, partition.get_partition_id(int_value(-100)));
+    EXPECT_EQ(1, partition.get_partition_id(int_value(10)));
+    EXPECT_EQ(1, partition.get_partition_id(int_value(19)));
+    EXPECT_EQ(2, partition.get_partition_id(int_value(1000)));
+
+    std::vector<int64_t> ids;
+    partition.get_partition_ids(int_value(12), int_value(25), ids);
+    ASSERT_EQ(2u, ids.size());
+    EXPECT_EQ(1, ids[0]);
+    EXPECT_EQ(2, ids[1]);
+    partition.get_partition_ids(ExprValue(), int_value(5), ids);
+    ASSERT_EQ(1u, ids.size());
+    EXPECT_EQ(0, ids[0]);
+    partition.get_partition_ids(int_value(15), ExprValue(), ids);
+    EXPECT_EQ(2u, ids.size());
+
+    // 所有分区都有上界，超出时无分区可写
+    info.add_range_bounds("30");
+    EXPECT_EQ(0, partition.init(info, 3, pb::INT64));
+    EXPECT_EQ(-1, partition.get_partition_id(int_value(30)));
+    partition.get_partition_ids(int_value(35), ExprValue(), ids);
+    EXPECT_EQ(0u, ids.size());
+
+    pb::PartitionInfo bad;
+    bad.set_type(pb::PT_RANGE);
+    bad.add_range_bounds("20");
+    bad.add_range_bounds("10");
+    EXPECT_EQ(-1, partition.init(bad, 3, pb::INT64));
+}
+
+TEST(test_table_partition, case_range_datetime) {
+    pb::PartitionInfo info;
+    info.set_type(pb::PT_RANGE);
+    info.add_range_bounds("2020-01-01 00:00:00");
+    TablePartition partition;
+    EXPECT_EQ(0, partition.init(info, 2, pb::DATETIME));
+    ExprValue value(pb::STRING);
+    value.str_val = "2019-12-31 23:59:59";
+    EXPECT_EQ(0, partition.get_partition_id(value));
+    value.str_val = "2020-06-01 00:00:00";
+    EXPECT_EQ(1, partition.get_partition_id(value));
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,106 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include "reverse_common.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static std::set<std::string> terms(const std::map<std::string, float>& term_map) {
+    std::set<std::string> res;
+    for (auto& pair : term_map) {
+        res.insert(pair.first);
+    }
+    return res;
+}
+
+TEST(test_tokenizer, case_ngram_utf8) {
+    auto tokenizer = Tokenizer::get_instance();
+    std::map<std::string, float> term_map;
+    tokenizer->ngram_seg_utf8("百度BaikalDB，分布式数据库 v2.0", 2, term_map);
+    std::set<std::string> expect = {"百度", "baikaldb", "分布", "布式", "式数", "数据", "据库", 
+        "v2", "0"};
+    EXPECT_EQ(expect, terms(term_map));
+
+    term_map.clear();
+    tokenizer->ngram_seg_utf8("数据库", 1, term_map);
+    expect = {"数", "据", "库"};
+    EXPECT_EQ(expect, terms(term_map));
+
+    // 全角转半角，转小写
+    term_map.clear();
+    tokenizer->ngram_seg_utf8("ＡＢＣ１２３　Ünïcode", 2, term_map);
+    expect = {"abc123", "ünïcode"};
+    EXPECT_EQ(expect, terms(term_map));
+
+    // 非法utf8按分隔符处理
+    term_map.clear();
+    tokenizer->ngram_seg_utf8(std::string("ab\xff\xfe" "cd"), 2, term_map);
+    expect = {"ab", "cd"};
+    EXPECT_EQ(expect, terms(term_map));
+}
+
+TEST(test_tokenizer, case_dict_utf8) {
+    const char* path = "./test_utf8_dict.dic";
+    {
+        std::ofstream fp(path);
+        fp << "数据\n数据库\n分布式\n";
+    }
+    auto tokenizer = Tokenizer::get_instance();
+    tokenizer->load_utf8_dict(path);
+    std::map<std::string, float> term_map;
+    tokenizer->dict_seg_utf8("分布式数据库系统mysql", term_map);
+    std::set<std::string> expect = {"分布式", "数据库", "系", "统", "mysql"};
+    EXPECT_EQ(expect, terms(term_map));
+
+    std::vector<std::string> split_word;
+    tokenizer->split_str_utf8("%数|据|库%", split_word, '|');
+    std::vector<std::string> expect_split = {"数", "据", "库"};
+    EXPECT_EQ(expect_split, split_word);
+}
+
+TEST(test_tokenizer, case_perf) {
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "BaikalDB是一个分布式关系型数据库，支持全文检索 Fulltext Search 1234 ";
+    }
+    auto tokenizer = Tokenizer::get_instance();
+    for (uint32_t word_count : {1, 2}) {
+        TimeCost cost;
+        int loop = 20;
+        for (int i = 0; i < loop; ++i) {
+            std::map<std::string, float> term_map;
+            tokenizer->ngram_seg_utf8(text, word_count, term_map);
+        }
+        int64_t time = std::max(cost.get_time(), 1L);
+        DB_NOTICE("ngram_seg_utf8 word_count:%u, %ld bytes/us", 
+                word_count, text.size() * loop / time);
+    }
+    TimeCost cost;
+    int loop = 20;
+    for (int i = 0; i < loop; ++i) {
+        std::map<std::string, float> term_map;
+        tokenizer->dict_seg_utf8(text, term_map);
+    }
+    int64_t time = std::max(cost.get_time(), 1L);
+    DB_NOTICE("dict_seg_utf8 %ld bytes/us", text.size() * loop / time);
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,115 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "trace_analyzer.h"
+#include "trace_state.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+// 模拟FetcherStore收到的一个region的trace
+static void add_region(pb::TraceNode* manager, int64_t region_id, int64_t rpc_time,
+        int64_t store_time, int64_t scan_rows, int64_t filter_rows) {
+    pb::TraceNode* rpc = manager->add_child_nodes();
+    rpc->set_total_time(rpc_time);
+    pb::TraceNode* store = rpc->add_child_nodes();
+    store->set_instance("127.0.0.1:8110");
+    store->set_region_id(region_id);
+    store->set_total_time(store_time);
+    pb::TraceNode* filter = store->add_child_nodes();
+    filter->set_node_type(pb::WHERE_FILTER_NODE);
+    filter->mutable_get_next_trace()->set_time_cost_us(store_time - 10);
+    filter->mutable_get_next_trace()->set_affect_rows(filter_rows);
+    pb::TraceNode* scan = filter->add_child_nodes();
+    scan->set_node_type(pb::SCAN_NODE);
+    scan->mutable_get_next_trace()->set_time_cost_us(store_time - 20);
+    scan->mutable_get_next_trace()->set_affect_rows(scan_rows);
+    scan->mutable_get_next_trace()->set_block_cache_hit(3);
+    scan->mutable_get_next_trace()->set_block_read_count(1);
+}
+
+TEST(test_trace_analyzer, case_merge_regions) {
+    pb::TraceNode root;
+    root.set_node_type(pb::PACKET_NODE);
+    pb::TraceNode* manager = root.add_child_nodes();
+    manager->set_node_type(pb::SELECT_MANAGER_NODE);
+    manager->mutable_get_next_trace()->set_time_cost_us(5000);
+    manager->mutable_get_next_trace()->set_affect_rows(30);
+    // 下推到store的算子，本地没有执行
+    manager->add_child_nodes()->set_node_type(pb::WHERE_FILTER_NODE);
+    add_region(manager, 1, 1000, 800, 100, 10);
+    add_region(manager, 2, 4000, 3000, 300, 20);
+
+    std::vector<std::vector<std::string>> rows;
+    TraceAnalyzer().analyze(root, &rows);
+    // PACKET, SELECT_MANAGER, STORE, FILTER, SCAN, 两个region
+    ASSERT_EQ(7U, rows.size());
+    size_t fields = TraceAnalyzer::field_names().size();
+    for (auto& row : rows) {
+        EXPECT_EQ(fields, row.size());
+    }
+    EXPECT_EQ("PACKET_NODE", rows[0][0]);
+    EXPECT_EQ("  SELECT_MANAGER_NODE", rows[1][0]);
+    EXPECT_EQ("30", rows[1][2]);
+    EXPECT_EQ("    STORE", rows[2][0]);
+    EXPECT_EQ("2", rows[2][1]);
+    EXPECT_EQ("800/1900/3000", rows[2][4]);
+    EXPECT_EQ("200/600/1000", rows[2][5]);
+    EXPECT_EQ("2@127.0.0.1:8110", rows[2][12]);
+    EXPECT_EQ("      WHERE_FILTER_NODE", rows[3][0]);
+    EXPECT_EQ("400", rows[3][2]);
+    EXPECT_EQ("30", rows[3][3]);
+    EXPECT_EQ("        SCAN_NODE", rows[4][0]);
+    EXPECT_EQ("780/1880/2980", rows[4][4]);
+    EXPECT_EQ("6", rows[4][7]);
+    EXPECT_EQ("2", rows[4][8]);
+    // 最慢的region排在前面
+    EXPECT_EQ("region:2", rows[5][0]);
+    EXPECT_EQ("1000", rows[5][5]);
+    EXPECT_EQ("region:1", rows[6][0]);
+}
+
+TEST(test_trace_local_node, case_perf_count) {
+    rocksdb::PerfLevel level = rocksdb::GetPerfLevel();
+    rocksdb::PerfContext* ctx = rocksdb::get_perf_context();
+    ctx->Reset();
+    pb::TraceNode trace_node;
+    {
+        TraceLocalNode local_node("scan", &trace_node, GET_NEXT_TRACE, nullptr);
+        EXPECT_EQ(rocksdb::PerfLevel::kEnableCount, rocksdb::GetPerfLevel());
+        ctx->block_cache_hit_count += 5;
+        ctx->seek_child_seek_count += 2;
+    }
+    EXPECT_EQ(level, rocksdb::GetPerfLevel());
+    EXPECT_EQ(5, trace_node.get_next_trace().block_cache_hit());
+    EXPECT_EQ(2, trace_node.get_next_trace().seek_count());
+
+    // 期间perf_context被Reset，差值为负时整组不计
+    ctx->block_cache_hit_count = 100;
+    {
+        TraceLocalNode local_node("scan", &trace_node, GET_NEXT_TRACE, nullptr);
+        ctx->Reset();
+        ctx->seek_child_seek_count += 3;
+    }
+    EXPECT_EQ(5, trace_node.get_next_trace().block_cache_hit());
+    EXPECT_EQ(2, trace_node.get_next_trace().seek_count());
+    EXPECT_EQ(2, trace_node.get_next_trace().repeat_cnt());
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,86 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include "transaction.h"
+#include "rocks_wrapper.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+// delete走DeleteRange时，范围删除、索引删除和meta写入在同一个事务中，
+// 回滚时都不生效，提交时一起生效
+class RemoveRangeTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        _rocksdb = RocksWrapper::get_instance();
+        ASSERT_EQ(0, _rocksdb->init("./rocks_db_remove_range"));
+        SmartTransaction txn(new Transaction(0, nullptr, false));
+        ASSERT_EQ(0, txn->begin());
+        for (int i = 0; i < 100; i++) {
+            ASSERT_EQ(0, txn->put_kv(key(i), "v"));
+        }
+        ASSERT_EQ(0, txn->put_kv("index_50", "v"));
+        ASSERT_TRUE(txn->commit().ok());
+        _rocksdb->remove(rocksdb::WriteOptions(), _rocksdb->get_meta_info_handle(), "applied_index");
+    }
+    std::string key(int i) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "pk_%03d", i);
+        return buf;
+    }
+    bool exists(rocksdb::ColumnFamilyHandle* cf, const std::string& k) {
+        std::string value;
+        return _rocksdb->get(rocksdb::ReadOptions(), cf, k, &value).ok();
+    }
+    void remove(SmartTransaction txn) {
+        ASSERT_EQ(0, txn->begin());
+        ASSERT_EQ(0, txn->delete_kv("index_50"));
+        std::string end = key(79);
+        end.push_back('\0');
+        ASSERT_EQ(0, txn->remove_range(key(20), end));
+        ASSERT_EQ(0, txn->put_meta_info("applied_index", "10"));
+    }
+    RocksWrapper* _rocksdb = nullptr;
+};
+
+TEST_F(RemoveRangeTest, case_rollback) {
+    SmartTransaction txn(new Transaction(0, nullptr, false));
+    remove(txn);
+    ASSERT_TRUE(txn->rollback().ok());
+    auto data_cf = _rocksdb->get_data_handle();
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(exists(data_cf, key(i)));
+    }
+    EXPECT_TRUE(exists(data_cf, "index_50"));
+    EXPECT_FALSE(exists(_rocksdb->get_meta_info_handle(), "applied_index"));
+}
+
+TEST_F(RemoveRangeTest, case_commit) {
+    SmartTransaction txn(new Transaction(0, nullptr, false));
+    remove(txn);
+    ASSERT_TRUE(txn->commit().ok());
+    auto data_cf = _rocksdb->get_data_handle();
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(i < 20 || i > 79, exists(data_cf, key(i)));
+    }
+    EXPECT_FALSE(exists(data_cf, "index_50"));
+    EXPECT_TRUE(exists(_rocksdb->get_meta_info_handle(), "applied_index"));
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
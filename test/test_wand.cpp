@@ -0,0 +1,134 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <set>
+#include "common.h"
+#include "boolean_executor.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+struct TestSchema {
+    typedef pb::CommonReverseNode PostingNodeT;
+    typedef std::string PrimaryIdT;
+    static int compare_id_func(const PrimaryIdT& id1, const PrimaryIdT& id2) {
+        return id1.compare(id2);
+    }
+    static int merge_or(PostingNodeT& to, const PostingNodeT& from, BoolArg*) {
+        to.set_weight(to.weight() + from.weight());
+        return 0;
+    }
+    static float score(const PostingNodeT& node) {
+        return node.weight();
+    }
+    static bool filter(const PostingNodeT&, BoolArg*) {
+        return false;
+    }
+    static void init_node(PostingNodeT&, const std::string&, BoolArg*) {
+    }
+};
+
+class TestParser : public RindexNodeParser<TestSchema> {
+public:
+    TestParser() : RindexNodeParser<TestSchema>(nullptr) {}
+    int init(const std::string&) {
+        return 0;
+    }
+    const PostingNodeT* current_node() {
+        return _ix < _list.reverse_nodes_size() ? &_list.reverse_nodes(_ix) : nullptr;
+    }
+    const PrimaryIdT* current_id() {
+        auto node = current_node();
+        return node != nullptr ? &node->key() : nullptr;
+    }
+    const PostingNodeT* next() {
+        ++_ix;
+        return current_node();
+    }
+    const PostingNodeT* advance(const PrimaryIdT& target_id) {
+        while (current_id() != nullptr && *current_id() < target_id) {
+            ++_ix;
+        }
+        return current_node();
+    }
+    float max_score() {
+        return _max_score;
+    }
+    void add(const std::string& key, float weight) {
+        auto node = _list.add_reverse_nodes();
+        node->set_key(key);
+        node->set_weight(weight);
+        _max_score = std::max(_max_score, weight);
+    }
+private:
+    pb::CommonReverseList _list;
+    int _ix = 0;
+    float _max_score = 0;
+};
+
+TEST(test_wand, case_top_k) {
+    srand(1);
+    for (int round = 0; round < 50; ++round) {
+        int term_num = 2 + rand() % 4;
+        int k = 1 + rand() % 5;
+        std::map<std::string, float> scores;
+        auto wand = new WandBooleanExecutor<TestSchema>(NODE_COPY, nullptr);
+        for (int t = 0; t < term_num; ++t) {
+            TestParser* parser = new TestParser;
+            for (int d = 0; d < 200; ++d) {
+                if (rand() % 4 != 0) {
+                    continue;
+                }
+                char key[16];
+                snprintf(key, sizeof(key), "d%04d", d);
+                float weight = rand() % 100 / (t + 1.0f);
+                parser->add(key, weight);
+                scores[key] += weight;
+            }
+            wand->add(new TermBooleanExecutor<TestSchema>(parser, "t", NODE_COPY, nullptr));
+        }
+        std::multiset<float> heap;
+        int returned = 0;
+        while (auto node = wand->next()) {
+            ++returned;
+            EXPECT_FLOAT_EQ(scores[node->key()], node->weight());
+            heap.insert(node->weight());
+            if ((int)heap.size() > k) {
+                heap.erase(heap.begin());
+            }
+            if ((int)heap.size() == k) {
+                wand->set_threshold(*heap.begin());
+            }
+        }
+        std::vector<float> expect;
+        for (auto& pair : scores) {
+            expect.push_back(pair.second);
+        }
+        std::sort(expect.rbegin(), expect.rend());
+        std::vector<float> result(heap.rbegin(), heap.rend());
+        ASSERT_EQ(std::min(k, (int)expect.size()), (int)result.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            EXPECT_FLOAT_EQ(expect[i], result[i]);
+        }
+        EXPECT_LE(returned, (int)scores.size());
+        delete wand;
+    }
+}
+}  // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */